@@ -7,6 +7,7 @@
 #include "util/matrix.h"
 
 #include "util/logging.h"
+#include "util/continuation.h"
 
 
 #include <Python.h>
@@ -18,6 +19,9 @@ namespace py = boost::python;
 #define BELIEF_PENALTY_MPC
 //#define BELIEF_MPC
 
+// time cold solves against coarse-to-fine warm started solves
+//#define CONTINUATION_BENCHMARK
+
 
 extern "C" {
 #include "beliefPenaltyMPC.h"
@@ -57,6 +61,11 @@ const double initial_penalty_coeff = 10;
 const double initial_trust_box_size = 1;
 const int max_penalty_coeff_increases = 2;
 const int max_sqp_iterations = 50;
+
+// fine timesteps per coarse timestep of the first warm start, 1 disables it
+// (off: factor 2 takes ~1.9x the cold start time and ends at a higher cost)
+const int coarse_to_fine_factor = 1;
+const int continuation_benchmark_runs = 10;
 }
 
 
@@ -595,6 +604,23 @@ double beliefPenaltyCollocation(std::vector< Matrix<B_DIM> >& B, std::vector< Ma
 
 
 
+// solve a coarse problem with controls held over factor timesteps and
+// interpolate it to warm start U, B is rolled out along the result
+double coarseToFineInit(std::vector< Matrix<B_DIM> >& B, std::vector< Matrix<U_DIM> >& U, int factor)
+{
+	// no goal constraint, the parameter problem only pays for uncertainty and control
+	auto goalPenalty = [](const Matrix<B_DIM>& bT) -> double { return 0; };
+	return util::coarse_to_fine_init(beliefDynamics, computeCost, goalPenalty, uMin, uMax, factor, B, U);
+}
+
+void benchmarkContinuation(const std::vector< Matrix<B_DIM> >& Binit, const std::vector< Matrix<U_DIM> >& Uinit, beliefPenaltyMPC_params& problem, beliefPenaltyMPC_output& output, beliefPenaltyMPC_info& info)
+{
+	auto solve = [&](std::vector< Matrix<B_DIM> >& B, std::vector< Matrix<U_DIM> >& U) {
+		return beliefPenaltyCollocation(B, U, problem, output, info);
+	};
+	util::benchmark_continuation(coarseToFineInit, solve, std::vector<int>({1, 2, 3, 5}), cfg::continuation_benchmark_runs, Binit, Uinit);
+}
+
 int main(int argc, char* argv[])
 {
 
@@ -686,6 +712,15 @@ int main(int argc, char* argv[])
 			*/ 
 		}
 
+		if (h == 0) {
+#ifdef CONTINUATION_BENCHMARK
+			benchmarkContinuation(B, U, problem, output, info);
+#endif
+			// later iterations are warm started from the shifted previous solution
+			if (cfg::coarse_to_fine_factor > 1) {
+				coarseToFineInit(B, U, cfg::coarse_to_fine_factor);
+			}
+		}
 		
 		double cost = beliefPenaltyCollocation(B, U, problem, output, info);
 		
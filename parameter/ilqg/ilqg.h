@@ -5,6 +5,9 @@
 #include "util/matrix.h"
 #include "util/utils.h"
 #include <vector>
+#include <memory>
+
+#include "util/threadpool.h"
 
 #include <Python.h>
 #include <boost/python.hpp>
@@ -350,6 +353,18 @@ inline void integrateControlPolicy(void (*linearizeDynamics)(const Matrix<_xDim>
 	}
 }
 
+// Rollout buffers for one step size of the line search, allocated once per solve
+template <size_t _xDim, size_t _uDim>
+struct LineSearchBuffers {
+	std::vector<Matrix<_xDim> > xNext;
+	std::vector<SymmetricMatrix<_xDim> > SigmaNext;
+	std::vector<Matrix<_uDim> > uNext;
+	std::vector<SymmetricMatrix<_xDim> > WNext;
+	double eps, cost;
+
+	LineSearchBuffers(size_t pathLen = 0) : xNext(pathLen + 1), SigmaNext(pathLen + 1), uNext(pathLen), WNext(pathLen), eps(0), cost(infCost) { }
+};
+
 template <size_t _xDim, size_t _uDim, size_t _zDim>
 inline void forwardIteration(void (*linearizeDynamics)(const Matrix<_xDim>&, const Matrix<_uDim>&, Matrix<_xDim>&, Matrix<_xDim, _xDim>&, Matrix<_xDim,_uDim>&, SymmetricMatrix<_xDim>&, unsigned int), 
 	void (*linearizeObservation)(const Matrix<_xDim>&, Matrix<_zDim, _xDim>&, SymmetricMatrix<_zDim>&),
@@ -357,14 +372,12 @@ inline void forwardIteration(void (*linearizeDynamics)(const Matrix<_xDim>&, con
 	bool (*quadratizeCost)(const Matrix<_xDim>&, const SymmetricMatrix<_xDim>&, const Matrix<_uDim>&, double&, SymmetricMatrix<_xDim>&, SymmetricMatrix<_uDim>&, Matrix<_uDim, _xDim>&, Matrix<1,_xDim>&, Matrix<1,_uDim>&, Matrix<1,_sDim>&, unsigned int),
 	const std::vector<Matrix<_uDim, _xDim> >& L, const std::vector<Matrix<_uDim> >& l, 
 	std::vector<Matrix<_xDim> >& xBar, std::vector<SymmetricMatrix<_xDim> >& SigmaBar, std::vector<Matrix<_uDim> >& uBar, std::vector<SymmetricMatrix<_xDim> >& WBar, 
-	double& bestCost, double& eps, double gradient)
+	double& bestCost, double& eps, double gradient, LineSearchBuffers<_xDim,_uDim>& buffers)
 {
-	size_t pathLen = uBar.size();
-
-	std::vector<Matrix<_xDim> > xNext(pathLen + 1);
-	std::vector<SymmetricMatrix<_xDim> > SigmaNext(pathLen + 1);
-	std::vector<Matrix<_uDim> > uNext(pathLen);
-	std::vector<SymmetricMatrix<_xDim> > WNext(pathLen);
+	std::vector<Matrix<_xDim> >& xNext = buffers.xNext;
+	std::vector<SymmetricMatrix<_xDim> >& SigmaNext = buffers.SigmaNext;
+	std::vector<Matrix<_uDim> >& uNext = buffers.uNext;
+	std::vector<SymmetricMatrix<_xDim> >& WNext = buffers.WNext;
 
 	double cost;
 
@@ -519,6 +532,59 @@ inline void forwardIteration(void (*linearizeDynamics)(const Matrix<_xDim>&, con
 	WBar = WNext;*/
 }
 
+// Evaluates one step size per buffer concurrently, starting at twice the previous eps and halving,
+// and keeps the best. If none of them improves on the current cost, the serial bracketing search
+// continues below the smallest one. team has one thread per buffer plus one for the current cost.
+template <size_t _xDim, size_t _uDim, size_t _zDim>
+inline void parallelForwardIteration(void (*linearizeDynamics)(const Matrix<_xDim>&, const Matrix<_uDim>&, Matrix<_xDim>&, Matrix<_xDim, _xDim>&, Matrix<_xDim,_uDim>&, SymmetricMatrix<_xDim>&, unsigned int), 
+	void (*linearizeObservation)(const Matrix<_xDim>&, Matrix<_zDim, _xDim>&, SymmetricMatrix<_zDim>&),
+	void (*quadratizeFinalCost)(const Matrix<_xDim>&, const SymmetricMatrix<_xDim>&, double&, SymmetricMatrix<_xDim>&, Matrix<1,_xDim>&, Matrix<1,_sDim>&, unsigned int),
+	bool (*quadratizeCost)(const Matrix<_xDim>&, const SymmetricMatrix<_xDim>&, const Matrix<_uDim>&, double&, SymmetricMatrix<_xDim>&, SymmetricMatrix<_uDim>&, Matrix<_uDim, _xDim>&, Matrix<1,_xDim>&, Matrix<1,_uDim>&, Matrix<1,_sDim>&, unsigned int),
+	const std::vector<Matrix<_uDim, _xDim> >& L, const std::vector<Matrix<_uDim> >& l, 
+	std::vector<Matrix<_xDim> >& xBar, std::vector<SymmetricMatrix<_xDim> >& SigmaBar, std::vector<Matrix<_uDim> >& uBar, std::vector<SymmetricMatrix<_xDim> >& WBar, 
+	double& bestCost, double& eps, double gradient, std::vector<LineSearchBuffers<_xDim,_uDim> >& buffers, util::ForkJoin& team)
+{
+	const int numSteps = buffers.size();
+	const double topEps = std::min(1.0, 2.0*eps);
+
+	// index 0 is the expected cost for eps = 0, index k > 0 evaluates buffers[k-1]
+	auto evaluate = [&](int k) {
+		if (k == 0) {
+			bestCost = computeExpectedCost(linearizeDynamics, quadratizeFinalCost, quadratizeCost, L, xBar, SigmaBar, uBar, WBar);
+			return;
+		}
+
+		LineSearchBuffers<_xDim,_uDim>& b = buffers[k-1];
+		b.eps = ldexp(topEps, -(k-1));
+		integrateControlPolicy(linearizeDynamics, linearizeObservation,
+			L, l, b.eps, xBar, SigmaBar[0], uBar,
+			b.xNext, b.SigmaNext, b.uNext, b.WNext);
+		b.cost = computeExpectedCost(linearizeDynamics, quadratizeFinalCost, quadratizeCost, L, b.xNext, b.SigmaNext, b.uNext, b.WNext);
+	};
+	team.run(evaluate);
+
+	int best = -1;
+	for (int k = 0; k < numSteps; ++k) {
+		double cost = buffers[k].cost;
+		if (cost < bestCost && abs(cost) < 1.0 / DBL_EPSILON && (best < 0 || cost < buffers[best].cost)) {
+			best = k;
+		}
+	}
+
+	if (best < 0) {
+		eps = 0.5*buffers[numSteps-1].eps;
+		forwardIteration(linearizeDynamics, linearizeObservation, quadratizeFinalCost, quadratizeCost, L, l, xBar, SigmaBar, uBar, WBar, bestCost, eps, gradient, buffers[0]);
+		return;
+	}
+
+	eps = buffers[best].eps;
+	bestCost = buffers[best].cost;
+	xBar = buffers[best].xNext;
+	SigmaBar = buffers[best].SigmaNext;
+	uBar = buffers[best].uNext;
+	WBar = buffers[best].WNext;
+}
+
 // nominal trajectory given as follows: xBar and SigmaBar must contain at least one item: the initial belief. uBar must contain the control inputs along the initial nominal trajectory.
 template <size_t _xDim, size_t _uDim, size_t _zDim>
 inline void solvePOMDP(void (*linearizeDynamics)(const Matrix<_xDim>&, const Matrix<_uDim>&, Matrix<_xDim>&, Matrix<_xDim, _xDim>&, Matrix<_xDim,_uDim>&, SymmetricMatrix<_xDim>&, unsigned int), 
@@ -526,7 +592,8 @@ inline void solvePOMDP(void (*linearizeDynamics)(const Matrix<_xDim>&, const Mat
 	void (*quadratizeFinalCost)(const Matrix<_xDim>&, const SymmetricMatrix<_xDim>&, double&, SymmetricMatrix<_xDim>&, Matrix<1,_xDim>&, Matrix<1,_sDim>&, unsigned int),
 	bool (*quadratizeCost)(const Matrix<_xDim>&, const SymmetricMatrix<_xDim>&, const Matrix<_uDim>&, double&, SymmetricMatrix<_xDim>&, SymmetricMatrix<_uDim>&, 
 						   Matrix<_uDim, _xDim>&, Matrix<1,_xDim>&, Matrix<1,_uDim>&, Matrix<1,_sDim>&, unsigned int),
-	std::vector<Matrix<_xDim> >& xBar, std::vector<SymmetricMatrix<_xDim> >& SigmaBar, std::vector<Matrix<_uDim> >& uBar, std::vector<Matrix<_uDim, _xDim> >& L)
+	std::vector<Matrix<_xDim> >& xBar, std::vector<SymmetricMatrix<_xDim> >& SigmaBar, std::vector<Matrix<_uDim> >& uBar, std::vector<Matrix<_uDim, _xDim> >& L,
+	int lineSearchSteps = 0)
 {
 	double bestCost = DBL_MAX;
 	bool terminate = false;
@@ -567,11 +634,22 @@ inline void solvePOMDP(void (*linearizeDynamics)(const Matrix<_xDim>&, const Mat
 	size_t iter = 1;
 
 	// TODO: can't plan forever, needs MPC, so have max iterations
+	// lineSearchSteps > 1 evaluates that many step sizes of each line search concurrently
+	std::vector<LineSearchBuffers<_xDim,_uDim> > lineSearchBuffers(std::max(1, lineSearchSteps), LineSearchBuffers<_xDim,_uDim>(pathLen));
+	std::unique_ptr<util::ForkJoin> team;
+	if (lineSearchSteps > 1) {
+		team.reset(new util::ForkJoin(lineSearchSteps + 1));
+	}
+
 	while(!terminate && iter<50)
 	{
 		backwardIteration(linearizeDynamics, linearizeObservation, quadratizeFinalCost, quadratizeCost, xBar, SigmaBar, uBar, L, l, gradient);
 		//double prevCost = bestCost;
-		forwardIteration(linearizeDynamics, linearizeObservation, quadratizeFinalCost, quadratizeCost, L, l, xBar, SigmaBar, uBar, WBar, bestCost, eps, gradient);
+		if (team) {
+			parallelForwardIteration(linearizeDynamics, linearizeObservation, quadratizeFinalCost, quadratizeCost, L, l, xBar, SigmaBar, uBar, WBar, bestCost, eps, gradient, lineSearchBuffers, *team);
+		} else {
+			forwardIteration(linearizeDynamics, linearizeObservation, quadratizeFinalCost, quadratizeCost, L, l, xBar, SigmaBar, uBar, WBar, bestCost, eps, gradient, lineSearchBuffers[0]);
+		}
 
 		double absl = 0.0;
 		double absu = 0.0;
@@ -79,6 +79,11 @@ void BoxesSystem::init(mat& box_centers, mat& box_dims, const ObsType obs_type,
 	this->box_centers = box_centers;
 	this->box_dims = box_dims;
 	this->obs_type = obs_type;
+	if (use_casadi && ((cost_type == CostType::approx_entropy) || (cost_type == CostType::kdpee))) {
+		LOG_WARN("Only the exact entropy and platt costs are available in CasADi, not using CasADi");
+		use_casadi = false;
+	}
+
 	this->cost_type = cost_type;
 	this->use_casadi = use_casadi;
 	this->xMin = xMin;
@@ -162,6 +167,10 @@ double BoxesSystem::cost(const std::vector<mat>& X, const std::vector<mat>& U, c
 	double cost;
 	if (this->cost_type == CostType::entropy) {
 		cost = this->cost_entropy(X, U, P);
+	} else if (this->cost_type == CostType::approx_entropy) {
+		cost = this->cost_entropy(X, U, P, this->entropy_tolerance);
+	} else if (this->cost_type == CostType::kdpee) {
+		cost = this->cost_kdpee(X, U, P);
 	} else {
 		cost = this->cost_entropy(X, U, P);
 	}
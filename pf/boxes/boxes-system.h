@@ -13,7 +13,7 @@ namespace Constants {
 }
 
 enum class ObsType { distance};
-enum class CostType { entropy, platt};
+enum class CostType { entropy, approx_entropy, kdpee, platt};
 
 typedef std::vector<ObsType> ObsTypeList;
 inline std::istream& operator>>(std::istream& in, ObsType& obs_type)
@@ -36,6 +36,10 @@ inline std::istream& operator>>(std::istream& in, CostType& cost_type)
     in >> token;
     if (token == "entropy") {
         cost_type = CostType::entropy;
+    } else if (token == "approx_entropy") {
+        cost_type = CostType::approx_entropy;
+    } else if (token == "kdpee") {
+        cost_type = CostType::kdpee;
     } else if (token == "platt") {
         cost_type = CostType::platt;
     } else {
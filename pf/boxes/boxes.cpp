@@ -426,7 +426,7 @@ bool found(const mat& P, mat& dims) {
 	return (max_spread < dims(0) + dims(1));
 }
 
-void parse_boxes(int argc, char* argv[], ObsType& obs_type, CostType& cost_type, bool& use_casadi, mat& box_centers, mat& box_dims) {
+void parse_boxes(int argc, char* argv[], ObsType& obs_type, CostType& cost_type, double& entropy_tol, bool& use_casadi, mat& box_centers, mat& box_dims) {
 	ObsTypeList obs_list;
 	CostTypeList cost_list;
 	std::vector<double> centers, dims;
@@ -437,7 +437,8 @@ void parse_boxes(int argc, char* argv[], ObsType& obs_type, CostType& cost_type,
 		    				("help", "produce help message")
 		    				("M", po::value<int>(&M), "Number of particles (default 100)")
 		    				("obs", po::value<ObsTypeList>(&obs_list)->multitoken(), "Observation type <angle> or <distance> (default is <angle>)")
-		    				("cost", po::value<CostTypeList>(&cost_list)->multitoken(), "Cost type <entropy> or <platt> (default is <entropy>)")
+		    				("cost", po::value<CostTypeList>(&cost_list)->multitoken(), "Cost type <entropy>, <approx_entropy>, <kdpee> or <platt> (default is <entropy>)")
+		    				("entropy_tol", po::value<double>(&entropy_tol), "Relative error of the <approx_entropy> kernel sums (default 1e-3)")
 		    				("casadi", po::value<bool>(&use_casadi), "Use CasADi or not")
 		    				("centers", po::value<std::vector<double> >(&centers)->multitoken(), "for N boxes, 2*N length of (x,y) coordinates")
 		    				("dims", po::value<std::vector<double> >(&dims)->multitoken(), "for N boxes, 2*N length of (width, height)")
@@ -487,9 +488,11 @@ void parse_boxes(int argc, char* argv[], ObsType& obs_type, CostType& cost_type,
 
 int main(int argc, char* argv[]) {
 	srand(time(0));
+	util::seed_random(time(0));
 
 	ObsType obs_type = ObsType::distance;
 	CostType cost_type = CostType::entropy;
+	double entropy_tol = 1e-3;
 	bool use_casadi = true;
 	M = 100;
 	mat box_centers(N*X_DIM, 1, fill::zeros);
@@ -497,13 +500,14 @@ int main(int argc, char* argv[]) {
 	box_centers << -.25 << endr << 0;
 	box_dims << .5 << endr << .25;
 
-	parse_boxes(argc, argv, obs_type, cost_type, use_casadi, box_centers, box_dims);
+	parse_boxes(argc, argv, obs_type, cost_type, entropy_tol, use_casadi, box_centers, box_dims);
 
 	x0 << 1.5 << endr << 0;
 
 	LOG_DEBUG("Initializing...");
 	BoxesSystem sys = BoxesSystem(box_centers, box_dims, obs_type, cost_type, use_casadi,
 			T, M, N, DT, X_DIM, U_DIM, Z_DIM, Q_DIM, R_DIM);
+	sys.set_entropy_tolerance(entropy_tol);
 	LOG_DEBUG("System initialized");
 
 	const int M_FULL = 1000;
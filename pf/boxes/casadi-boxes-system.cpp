@@ -42,6 +42,10 @@ void CasadiBoxesSystem::init(mat& box_dims, ObsType obs_type, CostType cost_type
 	this->box_dims = box_dims;
 	this->obs_type = obs_type;
 	this->cost_type = cost_type;
+	if ((cost_type != CostType::entropy) && (cost_type != CostType::platt)) {
+		LOG_WARN("The approximate entropy costs have no symbolic form, using the exact entropy");
+		this->cost_type = CostType::entropy;
+	}
 	this->R = R;
 
 	this->cost_func = this->casadi_cost_func();
@@ -389,6 +389,7 @@ double eihCollocation(std::vector<mat> &X, std::vector<mat> &U, mat &P, EihSyste
 void setup_eih_environment(PR2 *brett, Arm::ArmType arm_type, bool zero_seed, mat &P, EihSystem **sys) {
 	if (zero_seed) {
 		srand(time(0));
+		util::seed_random(time(0));
 	}
 
 	rave::EnvironmentBasePtr env = brett->get_env();
@@ -430,6 +431,10 @@ void setup_eih_environment(PR2 *brett, Arm::ArmType arm_type, bool zero_seed, ma
 		kinect = r_kinect;
 	}
 	*sys = new EihSystem(env, manip, kinect, EihSystem::ObsType::fov, T);
+
+	Scene scene;
+	rave_utils::env_to_scene(env, scene);
+	(*sys)->set_scene(scene);
 	kinect->render_on();
 	boost::this_thread::sleep(boost::posix_time::seconds(2));
 }
@@ -471,6 +476,8 @@ int main(int argc, char* argv[]) {
 		LOG_DEBUG("Initial cost: %4.10f", init_cost);
 		LOG_DEBUG("Cost: %4.10f", cost);
 		LOG_DEBUG("Time: %4.10f ms", forces_time*1000);
+		LOG_DEBUG("Render cache: %d hits, %d misses", sys->get_render_cache().hits(), sys->get_render_cache().misses());
+		sys->get_render_cache().reset_counters();
 
 		std::cout << "U\n";
 		for(int t=0; t < T-1; ++t) {
@@ -5,6 +5,8 @@
 #include "pr2_sim.h"
 #include "rave_utils.h"
 #include "utils.h"
+#include "raycaster.h"
+#include "../../../util/pose-cache.h"
 
 #include <armadillo>
 using namespace arma;
@@ -21,6 +23,11 @@ inline T sigmoid(const T &x, const double alpha) {
 
 class EihSystem : public virtual System {
 public:
+	struct View {
+		cube image;
+		mat z_buffer;
+	};
+
 	enum ObsType {fov, fov_occluded, fov_occluded_color};
 
 	EihSystem(rave::EnvironmentBasePtr e, Manipulator *m, KinectSensor *k);
@@ -45,10 +52,24 @@ public:
 	Manipulator* get_manip() { return manip; }
 	KinectSensor* get_kinect() { return kinect; }
 
+	/**
+	 * \brief Renders the planned views by raycasting scene (on entropy_pool) instead of the
+	 *        simulated kinect, which needs the OpenRAVE viewer and waits for new frames
+	 */
+	void set_scene(const Scene &scene);
+
+	/**
+	 * \brief Rendered views keyed by kinect pose, so cost evaluations that revisit a
+	 *        configuration (finite differences, line searches) do not render it again
+	 */
+	util::PoseCache<View>& get_render_cache() { return render_cache; }
+
 protected:
 	void init(const mat &uMin, const mat &uMat,
 			ObsType obs_type=ObsType::fov_occluded_color, int T=5, double DT=1.0);
 
+	void render(cube &image, mat &z_buffer);
+
 	double obsfunc_continuous_weight(const mat &particle, const cube &image, const mat &z_buffer, bool plot=false);
 	double obsfunc_discrete_weight(const mat &particle, const cube &image, const mat &z_buffer, bool plot=false);
 
@@ -66,6 +87,11 @@ protected:
 	KinectSensor *kinect;
 	ObsType obs_type;
 
+	Scene scene;
+	std::shared_ptr<Raycaster> raycaster; // NULL renders with the kinect
+	RaycastImage raycast_image;
+	util::PoseCache<View> render_cache;
+
 	std::vector<mat> desired_observations;
 
 	// save handles. clear every time update_state_and_particles called
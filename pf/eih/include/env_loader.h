@@ -0,0 +1,18 @@
+#ifndef _ENV_LOADER_H__
+#define _ENV_LOADER_H__
+
+#include <string>
+
+#include "raycaster.h"
+
+/**
+ * \brief Adds the box and cylinder geometry of the static KinBodies in an OpenRAVE
+ *        environment XML file (such as the files in envs) to scene, without OpenRAVE.
+ *
+ * KinBodies with a file attribute are looked up relative to the environment file and
+ * then in $OPENRAVE_DATA. Robots and trimesh geometry are skipped with a warning.
+ * Returns false if the file could not be parsed.
+ */
+bool load_env_xml(const std::string& file_name, Scene& scene);
+
+#endif
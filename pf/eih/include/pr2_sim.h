@@ -147,6 +147,7 @@ public:
 
 	int get_height() { return height; }
 	int get_width() { return width; }
+	mat get_intrinsics() { return P; }
 
 private:
 	int height, width;
@@ -183,6 +184,7 @@ public:
 
 	int get_height() { return camera_sensor->get_height(); }
 	int get_width() { return camera_sensor->get_width(); }
+	mat get_intrinsics() { return camera_sensor->get_intrinsics(); }
 	double get_min_range() { return depth_sensor->get_min_range(); }
 	double get_max_range() { return depth_sensor->get_max_range(); }
 	double get_optimal_range() { return depth_sensor->get_optimal_range(); }
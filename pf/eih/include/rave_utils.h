@@ -9,6 +9,8 @@ using namespace arma;
 #include <openrave-core.h>
 namespace rave = OpenRAVE;
 
+#include "raycaster.h"
+
 namespace rave_utils {
 
 void cart_to_joint(rave::RobotBase::ManipulatorPtr manip, const rave::Transform &matrix4,
@@ -34,6 +36,10 @@ mat rave_vec_to_mat(rave::Vector v, bool is_4d=false);
 
 rave::Vector mat_to_rave_vec(mat m);
 
+void rave_transform_to_pose(const rave::Transform &rt, double pose[12]);
+
+void env_to_scene(rave::EnvironmentBasePtr env, Scene &scene);
+
 }
 
 #endif
@@ -0,0 +1,106 @@
+#ifndef _RAYCASTER_H__
+#define _RAYCASTER_H__
+
+#include <vector>
+#include <string>
+
+#include "../../../util/particles.h"
+#include "../../../util/threadpool.h"
+
+/**
+ * Triangle soup of the static environment, in world coordinates, stored as structure
+ * of arrays (first vertex and the two edges from it) so the ray-triangle tests run
+ * across triangles in SIMD registers. Each triangle has the color and label (index in
+ * body_names) of the body it came from.
+ */
+class Scene {
+public:
+	Scene() : background{0, 0, 0} { }
+
+	int add_body(const std::string& name);
+	void add_triangle(const double a[3], const double b[3], const double c[3], const float color[3], int label);
+
+	/**
+	 * \brief Box centered at the origin of pose (row-major 3x4 [R t]) with half sizes extents
+	 */
+	void add_box(const double pose[12], const double extents[3], const float color[3], int label);
+
+	/**
+	 * \brief Cylinder along the y axis of pose (the OpenRAVE convention), with the given number of sides
+	 */
+	void add_cylinder(const double pose[12], double radius, double height, const float color[3], int label,
+			int sides=16);
+
+	int size() const { return num_triangles; }
+
+	/**
+	 * \brief Vertices of triangle i
+	 */
+	void get_triangle(int i, double a[3], double b[3], double c[3]) const;
+	int get_label(int i) const { return labels[i]; }
+
+	const std::vector<std::string>& get_body_names() const { return body_names; }
+
+	float background[3];
+
+private:
+	friend class Raycaster;
+
+	typedef std::vector<float, util::AlignedAllocator<float> > aligned_vector;
+
+	int num_triangles = 0;
+	aligned_vector ax, ay, az, e1x, e1y, e1z, e2x, e2y, e2z;
+	std::vector<float> colors;
+	std::vector<int> labels;
+	std::vector<std::string> body_names;
+};
+
+/**
+ * Pinhole camera: pixel (row, col) looks along ((col - cx)/fx, (row - cy)/fy, 1) in the
+ * camera frame, the inverse of CameraSensor::get_pixel_from_point
+ */
+struct RaycastCamera {
+	int height, width;
+	double fx, fy, cx, cy;
+	double max_range;
+
+	// row-major 3x4 [R t], camera to world
+	double pose[12];
+};
+
+/**
+ * Depth, color and body label per pixel. Each channel is column-major height x width
+ * (Armadillo's layout), so z_buffer and image convert to mat and cube with one copy.
+ */
+struct RaycastImage {
+	int height, width;
+	std::vector<double> z_buffer; // distance from the camera to the hit, max_range if none
+	std::vector<double> image; // rgb in [0,1], one height x width slice per channel
+	std::vector<int> labels; // -1 if no hit
+};
+
+/**
+ * Headless software renderer of a Scene. Rows of pixels are split over the pool (if
+ * any); each ray is tested against blocks of triangles with branch-free Moller-Trumbore,
+ * whose misses are selected away with integer masks so the loop vectorizes.
+ */
+class Raycaster {
+public:
+	Raycaster(const Scene& scene, util::ThreadPool* pool=NULL) : scene(scene), pool(pool) { }
+
+	void render(const RaycastCamera& camera, RaycastImage& out) const;
+
+	/**
+	 * \brief Distance along the unit direction dir from origin to the nearest triangle
+	 *        (max_range if none), and its index (-1 if none)
+	 */
+	double cast(const double origin[3], const double dir[3], double max_range, int& triangle) const;
+
+private:
+	const Scene& scene;
+	util::ThreadPool* pool;
+
+	static const int BLOCK = 256;
+};
+
+#endif
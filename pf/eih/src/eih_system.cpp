@@ -79,6 +79,12 @@ void EihSystem::init(const mat &uMin, const mat &uMax, ObsType obs_type, int T,
  * EihSystem public methods
  */
 
+void EihSystem::set_scene(const Scene &scene) {
+	this->scene = scene;
+	render_cache.clear();
+	raycaster.reset(new Raycaster(this->scene, entropy_pool.get()));
+}
+
 mat EihSystem::dynfunc(const mat &x, const mat &u) {
 	int X_DIM = std::max(x.n_rows, x.n_cols);
 	mat x_new = x + DT*u;
@@ -400,8 +406,9 @@ double EihSystem::cost(const std::vector<mat>& X, const std::vector<mat>& U, con
 		mat x_tp1 = dynfunc(X[t], U[t]);
 		manip->set_joint_values(x_tp1);
 
-		cube image = kinect->get_image(true);
-		mat z_buffer = kinect->get_z_buffer(false);
+		cube image;
+		mat z_buffer;
+		render(image, z_buffer);
 
 		for(int m=0; m < M; ++m) {
 			W_tp1(m) = obsfunc_continuous_weight(P.col(m), image, z_buffer) * W_t(m);
@@ -456,6 +463,43 @@ mat EihSystem::cost_grad(const mat &x0, std::vector<mat>& U, const mat& P) {
 	return g;
 }
 
+/**
+ * EihSystem protected methods
+ */
+
+void EihSystem::render(cube &image, mat &z_buffer) {
+	RaycastCamera camera;
+	rave_utils::rave_transform_to_pose(kinect->get_pose(), camera.pose);
+
+	View* view = render_cache.find(camera.pose);
+	if (view != NULL) {
+		image = view->image;
+		z_buffer = view->z_buffer;
+		return;
+	}
+
+	if (!raycaster) {
+		image = kinect->get_image(true);
+		z_buffer = kinect->get_z_buffer(false);
+	} else {
+		mat P = kinect->get_intrinsics();
+		camera.height = kinect->get_height();
+		camera.width = kinect->get_width();
+		camera.fx = P(0,0);
+		camera.fy = P(1,1);
+		camera.cx = P(0,2);
+		camera.cy = P(1,2);
+		camera.max_range = kinect->get_max_range();
+
+		raycaster->render(camera, raycast_image);
+		z_buffer = mat(&raycast_image.z_buffer[0], camera.height, camera.width);
+		image = cube(&raycast_image.image[0], camera.height, camera.width, 3);
+	}
+
+	View rendered = {image, z_buffer};
+	render_cache.insert(camera.pose, rendered);
+}
+
 // plots kinect position
 void EihSystem::display_states_and_particles(const std::vector<mat>& X, const mat& P, bool pause) {
 	handles.clear();
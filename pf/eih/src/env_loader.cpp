@@ -0,0 +1,231 @@
+#include "../include/env_loader.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <algorithm>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#include <boost/filesystem.hpp>
+
+#include "../../../util/logging.h"
+
+namespace pt = boost::property_tree;
+namespace fs = boost::filesystem;
+
+namespace {
+
+/**
+ * Row-major 3x4 [R t]
+ */
+struct Pose {
+	double m[12];
+
+	Pose() {
+		std::fill(m, m + 12, 0);
+		m[0] = m[5] = m[10] = 1;
+	}
+
+	Pose operator*(const Pose& other) const {
+		Pose p;
+		for(int i=0; i < 3; ++i) {
+			for(int j=0; j < 4; ++j) {
+				p.m[4*i+j] = m[4*i]*other.m[j] + m[4*i+1]*other.m[4+j] + m[4*i+2]*other.m[8+j] +
+						((j == 3) ? m[4*i+3] : 0);
+			}
+		}
+		return p;
+	}
+};
+
+std::string lower(std::string s) {
+	std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+	return s;
+}
+
+std::vector<double> parse_numbers(const std::string& s) {
+	std::vector<double> numbers;
+	std::istringstream stream(s);
+	double x;
+	while (stream >> x) { numbers.push_back(x); }
+	return numbers;
+}
+
+std::string attribute(const pt::ptree& node, const std::string& name) {
+	boost::optional<const pt::ptree&> attributes = node.get_child_optional("<xmlattr>");
+	if (attributes) {
+		for(pt::ptree::const_iterator it=attributes->begin(); it != attributes->end(); ++it) {
+			if (lower(it->first) == name) { return it->second.data(); }
+		}
+	}
+	return "";
+}
+
+/**
+ * \brief Applies the Translation, RotationAxis and RotationMat children of node in
+ *        order, as OpenRAVE does: translations add, rotations left-multiply the rotation
+ */
+void parse_transform(const pt::ptree& node, Pose& pose) {
+	for(pt::ptree::const_iterator it=node.begin(); it != node.end(); ++it) {
+		std::string tag = lower(it->first);
+		std::vector<double> v = parse_numbers(it->second.data());
+
+		Pose rotation;
+		if ((tag == "translation") && (v.size() == 3)) {
+			pose.m[3] += v[0]; pose.m[7] += v[1]; pose.m[11] += v[2];
+			continue;
+		} else if ((tag == "rotationaxis") && (v.size() == 4)) {
+			double n = sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+			double x = v[0]/n, y = v[1]/n, z = v[2]/n;
+			double a = v[3]*M_PI/180, c = cos(a), s = sin(a), C = 1 - c;
+			double R[9] = {x*x*C + c, x*y*C - z*s, x*z*C + y*s,
+					y*x*C + z*s, y*y*C + c, y*z*C - x*s,
+					z*x*C - y*s, z*y*C + x*s, z*z*C + c};
+			for(int i=0; i < 9; ++i) { rotation.m[4*(i/3) + i%3] = R[i]; }
+		} else if ((tag == "rotationmat") && (v.size() == 9)) {
+			for(int i=0; i < 9; ++i) { rotation.m[4*(i/3) + i%3] = v[i]; }
+		} else {
+			continue;
+		}
+
+		Pose rotated = rotation*pose;
+		for(int i=0; i < 3; ++i) {
+			for(int j=0; j < 3; ++j) { pose.m[4*i+j] = rotated.m[4*i+j]; }
+		}
+	}
+}
+
+void add_geom(const pt::ptree& geom, const Pose& body_pose, const std::string& body_name, int label, Scene& scene) {
+	Pose geom_pose;
+	parse_transform(geom, geom_pose);
+	Pose pose = body_pose*geom_pose;
+
+	float color[3] = {.5f, .5f, .5f};
+	double extents[3] = {0, 0, 0};
+	double radius = 0, height = 0;
+	for(pt::ptree::const_iterator it=geom.begin(); it != geom.end(); ++it) {
+		std::string tag = lower(it->first);
+		std::vector<double> v = parse_numbers(it->second.data());
+		if ((tag == "diffusecolor") && (v.size() >= 3)) {
+			std::copy(v.begin(), v.begin() + 3, color);
+		} else if ((tag == "extents") && (v.size() == 3)) {
+			std::copy(v.begin(), v.end(), extents);
+		} else if ((tag == "radius") && (v.size() == 1)) {
+			radius = v[0];
+		} else if ((tag == "height") && (v.size() == 1)) {
+			height = v[0];
+		}
+	}
+
+	std::string type = lower(attribute(geom, "type"));
+	if (type == "box") {
+		scene.add_box(pose.m, extents, color, label);
+	} else if (type == "cylinder") {
+		scene.add_cylinder(pose.m, radius, height, color, label);
+	} else {
+		LOG_WARN("Skipping %s geometry of %s", type.c_str(), body_name.c_str());
+	}
+}
+
+bool load_kinbody(const pt::ptree& kinbody, const Pose& parent_pose, const fs::path& directory,
+		const std::string& name, int label, Scene& scene);
+
+/**
+ * \brief Bodies of kinbody_file, for KinBodies that reference one
+ */
+bool load_kinbody_file(const std::string& file, const Pose& pose, const fs::path& directory,
+		const std::string& name, int label, Scene& scene) {
+	std::vector<fs::path> candidates(1, directory / file);
+	const char* data_path = getenv("OPENRAVE_DATA");
+	if (data_path != NULL) {
+		std::istringstream paths(data_path);
+		std::string path;
+		while (std::getline(paths, path, ':')) {
+			candidates.push_back(fs::path(path) / file);
+		}
+	}
+
+	for(int i=0; i < candidates.size(); ++i) {
+		if (!fs::exists(candidates[i])) { continue; }
+
+		pt::ptree tree;
+		try {
+			pt::read_xml(candidates[i].string(), tree);
+		} catch (pt::xml_parser_error& e) {
+			LOG_WARN("Could not parse %s: %s", candidates[i].string().c_str(), e.what());
+			return false;
+		}
+		for(pt::ptree::const_iterator it=tree.begin(); it != tree.end(); ++it) {
+			if (lower(it->first) == "kinbody") {
+				return load_kinbody(it->second, pose, candidates[i].parent_path(), name, label, scene);
+			}
+		}
+	}
+
+	LOG_WARN("Skipping %s, could not find %s", name.c_str(), file.c_str());
+	return false;
+}
+
+bool load_kinbody(const pt::ptree& kinbody, const Pose& parent_pose, const fs::path& directory,
+		const std::string& name, int label, Scene& scene) {
+	Pose kinbody_pose;
+	parse_transform(kinbody, kinbody_pose);
+	Pose pose = parent_pose*kinbody_pose;
+
+	std::string file = attribute(kinbody, "file");
+	if (!file.empty()) {
+		return load_kinbody_file(file, pose, directory, name, label, scene);
+	}
+
+	for(pt::ptree::const_iterator it=kinbody.begin(); it != kinbody.end(); ++it) {
+		if (lower(it->first) != "body") { continue; }
+
+		Pose body_pose;
+		parse_transform(it->second, body_pose);
+		body_pose = pose*body_pose;
+		for(pt::ptree::const_iterator g=it->second.begin(); g != it->second.end(); ++g) {
+			if (lower(g->first) == "geom") {
+				add_geom(g->second, body_pose, name, label, scene);
+			}
+		}
+	}
+	return true;
+}
+
+}
+
+bool load_env_xml(const std::string& file_name, Scene& scene) {
+	pt::ptree tree;
+	try {
+		pt::read_xml(file_name, tree);
+	} catch (pt::xml_parser_error& e) {
+		LOG_ERROR("Could not parse %s: %s", file_name.c_str(), e.what());
+		return false;
+	}
+
+	const pt::ptree* environment = NULL;
+	for(pt::ptree::const_iterator it=tree.begin(); it != tree.end(); ++it) {
+		if (lower(it->first) == "environment") { environment = &it->second; }
+	}
+	if (environment == NULL) {
+		LOG_ERROR("No Environment in %s", file_name.c_str());
+		return false;
+	}
+
+	fs::path directory = fs::path(file_name).parent_path();
+	for(pt::ptree::const_iterator it=environment->begin(); it != environment->end(); ++it) {
+		std::string tag = lower(it->first);
+		if (tag == "bkgndcolor") {
+			std::vector<double> v = parse_numbers(it->second.data());
+			if (v.size() == 3) { std::copy(v.begin(), v.end(), scene.background); }
+		} else if (tag == "robot") {
+			LOG_WARN("Skipping robot %s", attribute(it->second, "name").c_str());
+		} else if (tag == "kinbody") {
+			std::string name = attribute(it->second, "name");
+			load_kinbody(it->second, Pose(), directory, name, scene.add_body(name), scene);
+		}
+	}
+
+	return true;
+}
@@ -168,4 +168,44 @@ rave::Vector mat_to_rave_vec(mat m) {
 }
 
 
+void rave_transform_to_pose(const rave::Transform &rt, double pose[12]) {
+	rave::TransformMatrix rtm(rt);
+	for(int i=0; i < 3; ++i) {
+		for(int j=0; j < 3; ++j) {
+			pose[4*i+j] = rtm.m[4*i+j];
+		}
+		pose[4*i+3] = rtm.trans[i];
+	}
+}
+
+// collision meshes of every link of the non-robot bodies, labeled by body
+void env_to_scene(rave::EnvironmentBasePtr env, Scene &scene) {
+	std::vector<rave::KinBodyPtr> bodies;
+	env->GetBodies(bodies);
+	for(int b=0; b < bodies.size(); ++b) {
+		if (bodies[b]->IsRobot()) { continue; }
+		int label = scene.add_body(bodies[b]->GetName());
+
+		const std::vector<rave::KinBody::LinkPtr> &links = bodies[b]->GetLinks();
+		for(int l=0; l < links.size(); ++l) {
+			float color[3] = {.5f, .5f, .5f};
+			if (links[l]->GetGeometries().size() > 0) {
+				rave::Vector diffuse = links[l]->GetGeometry(0)->GetDiffuseColor();
+				color[0] = diffuse.x; color[1] = diffuse.y; color[2] = diffuse.z;
+			}
+
+			rave::TriMesh mesh = links[l]->GetCollisionData();
+			mesh.ApplyTransform(links[l]->GetTransform());
+			for(int i=0; i+2 < mesh.indices.size(); i += 3) {
+				double v[3][3];
+				for(int k=0; k < 3; ++k) {
+					const rave::Vector &p = mesh.vertices[mesh.indices[i+k]];
+					v[k][0] = p.x; v[k][1] = p.y; v[k][2] = p.z;
+				}
+				scene.add_triangle(v[0], v[1], v[2], color, label);
+			}
+		}
+	}
+}
+
 }
@@ -0,0 +1,191 @@
+#include "../include/raycaster.h"
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+using util::particles::float_bits;
+using util::particles::bits_float;
+
+namespace {
+
+// intersections closer than this to the ray origin are ignored
+const float MIN_DISTANCE = 1e-4f;
+const float MIN_DETERMINANT = 1e-12f;
+
+void transform_point(const double pose[12], const double p[3], double out[3]) {
+	for(int i=0; i < 3; ++i) {
+		out[i] = pose[4*i]*p[0] + pose[4*i+1]*p[1] + pose[4*i+2]*p[2] + pose[4*i+3];
+	}
+}
+
+}
+
+/**
+ * Scene
+ */
+
+int Scene::add_body(const std::string& name) {
+	body_names.push_back(name);
+	return body_names.size() - 1;
+}
+
+void Scene::add_triangle(const double a[3], const double b[3], const double c[3], const float color[3], int label) {
+	ax.push_back(a[0]); ay.push_back(a[1]); az.push_back(a[2]);
+	e1x.push_back(b[0] - a[0]); e1y.push_back(b[1] - a[1]); e1z.push_back(b[2] - a[2]);
+	e2x.push_back(c[0] - a[0]); e2y.push_back(c[1] - a[1]); e2z.push_back(c[2] - a[2]);
+	colors.insert(colors.end(), color, color + 3);
+	labels.push_back(label);
+	++num_triangles;
+}
+
+void Scene::get_triangle(int i, double a[3], double b[3], double c[3]) const {
+	a[0] = ax[i]; a[1] = ay[i]; a[2] = az[i];
+	b[0] = a[0] + e1x[i]; b[1] = a[1] + e1y[i]; b[2] = a[2] + e1z[i];
+	c[0] = a[0] + e2x[i]; c[1] = a[1] + e2y[i]; c[2] = a[2] + e2z[i];
+}
+
+void Scene::add_box(const double pose[12], const double extents[3], const float color[3], int label) {
+	double corners[8][3];
+	for(int i=0; i < 8; ++i) {
+		double local[3] = {(i & 1) ? extents[0] : -extents[0],
+				(i & 2) ? extents[1] : -extents[1],
+				(i & 4) ? extents[2] : -extents[2]};
+		transform_point(pose, local, corners[i]);
+	}
+
+	// two triangles per face, corners indexed by their (x, y, z) bits
+	const int faces[6][4] = {{0,2,6,4}, {1,5,7,3}, {0,4,5,1}, {2,3,7,6}, {0,1,3,2}, {4,6,7,5}};
+	for(int f=0; f < 6; ++f) {
+		add_triangle(corners[faces[f][0]], corners[faces[f][1]], corners[faces[f][2]], color, label);
+		add_triangle(corners[faces[f][0]], corners[faces[f][2]], corners[faces[f][3]], color, label);
+	}
+}
+
+void Scene::add_cylinder(const double pose[12], double radius, double height, const float color[3], int label,
+		int sides) {
+	double bottom_center[3], top_center[3];
+	double local_bottom[3] = {0, -height/2, 0}, local_top[3] = {0, height/2, 0};
+	transform_point(pose, local_bottom, bottom_center);
+	transform_point(pose, local_top, top_center);
+
+	for(int s=0; s < sides; ++s) {
+		double angle0 = 2*M_PI*s / sides, angle1 = 2*M_PI*(s+1) / sides;
+		double local[4][3] = {{radius*cos(angle0), -height/2, radius*sin(angle0)},
+				{radius*cos(angle1), -height/2, radius*sin(angle1)},
+				{radius*cos(angle1), height/2, radius*sin(angle1)},
+				{radius*cos(angle0), height/2, radius*sin(angle0)}};
+		double p[4][3];
+		for(int i=0; i < 4; ++i) {
+			transform_point(pose, local[i], p[i]);
+		}
+
+		add_triangle(p[0], p[1], p[2], color, label);
+		add_triangle(p[0], p[2], p[3], color, label);
+		add_triangle(bottom_center, p[1], p[0], color, label);
+		add_triangle(top_center, p[3], p[2], color, label);
+	}
+}
+
+/**
+ * Raycaster
+ */
+
+const int Raycaster::BLOCK; // std::min below takes it by reference
+
+double Raycaster::cast(const double origin[3], const double dir[3], double max_range, int& triangle) const {
+	const float ox = origin[0], oy = origin[1], oz = origin[2];
+	const float dx = dir[0], dy = dir[1], dz = dir[2];
+	const int32_t min_det_bits = float_bits(MIN_DETERMINANT);
+	const int32_t miss_bits = float_bits(std::numeric_limits<float>::infinity());
+
+	int32_t nearest_bits = float_bits(float(max_range));
+	triangle = -1;
+
+	float t[BLOCK];
+	for(int begin=0; begin < scene.num_triangles; begin += BLOCK) {
+		int count = std::min(scene.num_triangles - begin, BLOCK);
+		const float *ax = &scene.ax[begin], *ay = &scene.ay[begin], *az = &scene.az[begin];
+		const float *e1x = &scene.e1x[begin], *e1y = &scene.e1y[begin], *e1z = &scene.e1z[begin];
+		const float *e2x = &scene.e2x[begin], *e2y = &scene.e2y[begin], *e2z = &scene.e2z[begin];
+
+		int32_t block_min = miss_bits;
+		for(int i=0; i < count; ++i) {
+			// p = dir x e2, det = e1 . p
+			float px = dy*e2z[i] - dz*e2y[i], py = dz*e2x[i] - dx*e2z[i], pz = dx*e2y[i] - dy*e2x[i];
+			float det = e1x[i]*px + e1y[i]*py + e1z[i]*pz;
+			float inv_det = 1.f / det;
+
+			float sx = ox - ax[i], sy = oy - ay[i], sz = oz - az[i];
+			float u = (sx*px + sy*py + sz*pz)*inv_det;
+
+			// q = s x e1
+			float qx = sy*e1z[i] - sz*e1y[i], qy = sz*e1x[i] - sx*e1z[i], qz = sx*e1y[i] - sy*e1x[i];
+			float v = (dx*qx + dy*qy + dz*qz)*inv_det;
+			float dist = (e2x[i]*qx + e2y[i]*qy + e2z[i]*qz)*inv_det;
+
+			// hit if u, v, 1 - u - v and dist - MIN_DISTANCE are non-negative and det is not tiny
+			int32_t negative = (float_bits(u) | float_bits(v) | float_bits(1.f - u - v) |
+					float_bits(dist - MIN_DISTANCE)) >> 31;
+			int32_t parallel = ((float_bits(det) & 0x7fffffff) < min_det_bits) ? -1 : 0;
+			int32_t miss = negative | parallel;
+
+			int32_t bits = (float_bits(dist) & ~miss) | (miss_bits & miss);
+			t[i] = bits_float(bits);
+			// non-negative floats order like their bits
+			block_min = (bits < block_min) ? bits : block_min;
+		}
+
+		if (block_min < nearest_bits) {
+			nearest_bits = block_min;
+			for(int i=0; i < count; ++i) {
+				if (float_bits(t[i]) == block_min) {
+					triangle = begin + i;
+					break;
+				}
+			}
+		}
+	}
+
+	return (triangle >= 0) ? double(bits_float(nearest_bits)) : max_range;
+}
+
+void Raycaster::render(const RaycastCamera& camera, RaycastImage& out) const {
+	int height = camera.height, width = camera.width, num_pixels = height*width;
+	out.height = height;
+	out.width = width;
+	out.z_buffer.resize(num_pixels);
+	out.image.resize(3*num_pixels);
+	out.labels.resize(num_pixels);
+
+	const double* pose = camera.pose;
+	const double origin[3] = {pose[3], pose[7], pose[11]};
+
+	auto render_row = [&](int row) {
+		for(int col=0; col < width; ++col) {
+			double d[3] = {(col - camera.cx) / camera.fx, (row - camera.cy) / camera.fy, 1};
+			double dir[3];
+			for(int i=0; i < 3; ++i) {
+				dir[i] = pose[4*i]*d[0] + pose[4*i+1]*d[1] + pose[4*i+2]*d[2];
+			}
+			double norm = sqrt(dir[0]*dir[0] + dir[1]*dir[1] + dir[2]*dir[2]);
+			for(int i=0; i < 3; ++i) { dir[i] /= norm; }
+
+			int triangle;
+			int index = col*height + row;
+			out.z_buffer[index] = cast(origin, dir, camera.max_range, triangle);
+
+			const float* color = (triangle >= 0) ? &scene.colors[3*triangle] : scene.background;
+			for(int k=0; k < 3; ++k) {
+				out.image[k*num_pixels + index] = color[k];
+			}
+			out.labels[index] = (triangle >= 0) ? scene.labels[triangle] : -1;
+		}
+	};
+
+	if (pool != NULL) {
+		pool->parallel_for(0, height, render_row);
+	} else {
+		for(int row=0; row < height; ++row) { render_row(row); }
+	}
+}
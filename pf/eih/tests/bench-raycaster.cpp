@@ -0,0 +1,164 @@
+#include "../include/raycaster.h"
+#include "../include/env_loader.h"
+
+#include "../../../util/Timer.h"
+#include "../../../util/logging.h"
+#include "../../../util/threadpool.h"
+
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <limits>
+
+#define RUNS 5
+
+// rows of the reference render that are timed and compared, the rest is extrapolated
+#define REFERENCE_ROWS 48
+
+// single precision hits may differ from the double precision reference by this much (m)
+#define TOLERANCE 1e-4
+
+/**
+ * \brief Double precision Moller-Trumbore over every triangle, one ray at a time
+ */
+double reference_cast(const Scene& scene, const double o[3], const double d[3], double max_range, int& label) {
+	double nearest = max_range;
+	label = -1;
+	for(int i=0; i < scene.size(); ++i) {
+		double a[3], b[3], c[3];
+		scene.get_triangle(i, a, b, c);
+		double e1[3] = {b[0]-a[0], b[1]-a[1], b[2]-a[2]}, e2[3] = {c[0]-a[0], c[1]-a[1], c[2]-a[2]};
+		double p[3] = {d[1]*e2[2] - d[2]*e2[1], d[2]*e2[0] - d[0]*e2[2], d[0]*e2[1] - d[1]*e2[0]};
+		double det = e1[0]*p[0] + e1[1]*p[1] + e1[2]*p[2];
+		if (fabs(det) < 1e-12) { continue; }
+
+		double s[3] = {o[0]-a[0], o[1]-a[1], o[2]-a[2]};
+		double u = (s[0]*p[0] + s[1]*p[1] + s[2]*p[2]) / det;
+		if ((u < 0) || (u > 1)) { continue; }
+
+		double q[3] = {s[1]*e1[2] - s[2]*e1[1], s[2]*e1[0] - s[0]*e1[2], s[0]*e1[1] - s[1]*e1[0]};
+		double v = (d[0]*q[0] + d[1]*q[1] + d[2]*q[2]) / det;
+		if ((v < 0) || (u + v > 1)) { continue; }
+
+		double t = (e2[0]*q[0] + e2[1]*q[1] + e2[2]*q[2]) / det;
+		if ((t >= 1e-4) && (t < nearest)) {
+			nearest = t;
+			label = scene.get_label(i);
+		}
+	}
+	return nearest;
+}
+
+/**
+ * \brief Camera at eye looking at target, x right and y down in the image
+ */
+RaycastCamera look_at(int height, int width, const double eye[3], const double target[3]) {
+	RaycastCamera camera;
+	camera.height = height;
+	camera.width = width;
+	// r_gripper_cam intrinsics (64 x 48, KK 128 96 32.5 24.5), scaled to the resolution
+	camera.fx = 2*width;
+	camera.fy = 2*width;
+	camera.cx = (width - 1) / 2.0;
+	camera.cy = (height - 1) / 2.0;
+	camera.max_range = 5;
+
+	double z[3] = {target[0]-eye[0], target[1]-eye[1], target[2]-eye[2]};
+	double n = sqrt(z[0]*z[0] + z[1]*z[1] + z[2]*z[2]);
+	for(int i=0; i < 3; ++i) { z[i] /= n; }
+	double x[3] = {z[1], -z[0], 0}; // z x (0,0,1)
+	n = sqrt(x[0]*x[0] + x[1]*x[1]);
+	for(int i=0; i < 3; ++i) { x[i] /= n; }
+	double y[3] = {z[1]*x[2] - z[2]*x[1], z[2]*x[0] - z[0]*x[2], z[0]*x[1] - z[1]*x[0]};
+
+	for(int i=0; i < 3; ++i) {
+		camera.pose[4*i] = x[i];
+		camera.pose[4*i+1] = y[i];
+		camera.pose[4*i+2] = z[i];
+		camera.pose[4*i+3] = eye[i];
+	}
+	return camera;
+}
+
+void bench_env(const std::string& env_file, const double eye[3], const double target[3], util::ThreadPool& pool) {
+	Scene scene;
+	if (!load_env_xml(env_file, scene)) { return; }
+	std::cout << env_file << ": " << scene.size() << " triangles\n";
+
+	Raycaster serial(scene), parallel(scene, &pool);
+	util::Timer timer;
+
+	int resolutions[][2] = {{48, 64}, {240, 320}, {480, 640}};
+	for(int r=0; r < sizeof(resolutions)/sizeof(resolutions[0]); ++r) {
+		RaycastCamera camera = look_at(resolutions[r][0], resolutions[r][1], eye, target);
+		const double* pose = camera.pose;
+		const double origin[3] = {pose[3], pose[7], pose[11]};
+		int height = camera.height, width = camera.width;
+
+		RaycastImage image;
+		util::Timer_tic(&timer);
+		for(int run=0; run < RUNS; ++run) {
+			serial.render(camera, image);
+		}
+		double serial_time = util::Timer_toc(&timer) / RUNS;
+
+		util::Timer_tic(&timer);
+		for(int run=0; run < RUNS; ++run) {
+			parallel.render(camera, image);
+		}
+		double parallel_time = util::Timer_toc(&timer) / RUNS;
+
+		// reference on evenly spaced rows
+		int rows = std::min(height, REFERENCE_ROWS);
+		double max_err = 0;
+		int label_mismatches = 0, hits = 0;
+		util::Timer_tic(&timer);
+		for(int k=0; k < rows; ++k) {
+			int row = k*height / rows;
+			for(int col=0; col < width; ++col) {
+				double d[3] = {(col - camera.cx) / camera.fx, (row - camera.cy) / camera.fy, 1}, dir[3];
+				for(int i=0; i < 3; ++i) {
+					dir[i] = pose[4*i]*d[0] + pose[4*i+1]*d[1] + pose[4*i+2]*d[2];
+				}
+				double n = sqrt(dir[0]*dir[0] + dir[1]*dir[1] + dir[2]*dir[2]);
+				for(int i=0; i < 3; ++i) { dir[i] /= n; }
+
+				int label;
+				double z = reference_cast(scene, origin, dir, camera.max_range, label);
+				int index = col*height + row;
+				max_err = std::max(max_err, fabs(z - image.z_buffer[index]));
+				// labels may differ where the ray passes within rounding of an edge
+				label_mismatches += (label != image.labels[index]);
+				hits += (label >= 0);
+			}
+		}
+		double reference_time = util::Timer_toc(&timer) * (height / double(rows));
+
+		std::cout << std::setw(10) << width << "x" << std::setw(4) << std::left << height << std::right
+				<< std::setw(16) << reference_time << std::setw(16) << serial_time
+				<< std::setw(16) << parallel_time << std::setw(12) << reference_time / parallel_time
+				<< std::setw(16) << max_err << std::setw(12) << label_mismatches
+				<< std::setw(10) << hits / double(rows*width) << "\n";
+
+		if (max_err > TOLERANCE) {
+			LOG_ERROR("Depth differs from the reference by %g at %dx%d", max_err, width, height);
+		}
+	}
+}
+
+int main(int argc, char* argv[]) {
+	std::string envs_dir = (argc > 1) ? argv[1] : "../eih/envs";
+
+	util::ThreadPool pool;
+	std::cout << "threads: " << pool.size() << "\n";
+	std::cout << std::setw(15) << "resolution" << std::setw(16) << "reference (s)" << std::setw(16) << "serial (s)"
+			<< std::setw(16) << "pool (s)" << std::setw(12) << "speedup" << std::setw(16) << "max depth err"
+			<< std::setw(12) << "labels" << std::setw(10) << "hits" << "\n";
+
+	// r_gripper_cam over the table in the mantis posture
+	double eye[3] = {.4, -.2, 1.2}, table[3] = {1.1, 0, .56};
+	bench_env(envs_dir + "/pr2-table.env.xml", eye, table, pool);
+
+	double eye_sensors[3] = {-.6, .3, 1.3}, counter[3] = {-1.2, -.9, .7};
+	bench_env(envs_dir + "/testpr2sensors.env.xml", eye_sensors, counter, pool);
+}
@@ -137,6 +137,7 @@ void setup_eih_environment(PR2 *brett, int M, Arm::ArmType arm_type, bool zero_s
 		EihSystem **sys, EihSystem::ObsType obs_type) {
 	if (zero_seed) {
 		srand(time(0));
+		util::seed_random(time(0));
 	}
 
 	rave::EnvironmentBasePtr env = brett->get_env();
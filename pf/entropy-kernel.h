@@ -0,0 +1,244 @@
+#ifndef __ENTROPY_KERNEL_H__
+#define __ENTROPY_KERNEL_H__
+
+#include "../util/threadpool.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include <armadillo>
+using namespace arma;
+
+// particles per block of the pairwise loop, sized so a block of distances stays in L1
+#define ENTROPY_KERNEL_BLOCK 256
+
+/**
+ * \brief Sums exp(-0.5*|Y.col(m) - Y.col(p)|^2) over p for the rows [m_begin, m_end)
+ * \param Yt whitened observations, one contiguous array of M values per dimension
+ */
+inline void gauss_kernel_sums_rows(const double* Yt, int M, int dim, int m_begin, int m_end, double* K) {
+	double dist[ENTROPY_KERNEL_BLOCK];
+
+	for(int m=m_begin; m < m_end; ++m) {
+		double sum = 0;
+		for(int p_begin=0; p_begin < M; p_begin += ENTROPY_KERNEL_BLOCK) {
+			const int n = std::min(ENTROPY_KERNEL_BLOCK, M - p_begin);
+
+			// unit stride over the block so the distance loop vectorizes
+			std::fill(dist, dist + n, 0.);
+			for(int k=0; k < dim; ++k) {
+				const double* y = Yt + k*M + p_begin;
+				const double y_m = Yt[k*M + m];
+				for(int i=0; i < n; ++i) {
+					const double d = y_m - y[i];
+					dist[i] += d*d;
+				}
+			}
+
+			for(int i=0; i < n; ++i) {
+				sum += exp(-0.5*dist[i]);
+			}
+		}
+		K[m] = sum;
+	}
+}
+
+// whitened observations, particle-major so each dimension is contiguous over particles
+inline void whiten_observations(const mat& H, const mat& Sf, mat& Yt) {
+	Yt = trans(solve(trimatu(Sf), H));
+}
+
+// normalization of gauss_likelihood for the factor Sf
+inline double gauss_normalizer(const mat& Sf) {
+	return pow(2*M_PI, Sf.n_cols/2) * prod(diagvec(Sf));
+}
+
+/**
+ * \brief Computes K(m) = sum_p N(H.col(m) - H.col(p); 0, S) for all M particles
+ *
+ * Same values as summing System::gauss_likelihood(H.col(m) - H.col(p), S), but S is
+ * factored and the observations whitened once, so the M^2 loop is only squared
+ * distances and exp. Row blocks are split across the pool.
+ *
+ * \param Sf chol(S), as used by gauss_likelihood
+ */
+inline void gauss_kernel_sums(const mat& H, const mat& Sf, mat& K, util::ThreadPool& pool) {
+	const int M = H.n_cols;
+	const int dim = H.n_rows;
+
+	mat Yt;
+	whiten_observations(H, Sf, Yt);
+
+	K.set_size(M, 1);
+	const double* y = Yt.memptr();
+	double* k = K.memptr();
+
+	const int num_blocks = (M + ENTROPY_KERNEL_BLOCK - 1) / ENTROPY_KERNEL_BLOCK;
+	pool.parallel_for(0, num_blocks, [&](int b) {
+		gauss_kernel_sums_rows(y, M, dim, b*ENTROPY_KERNEL_BLOCK, std::min(M, (b+1)*ENTROPY_KERNEL_BLOCK), k);
+	});
+
+	K /= gauss_normalizer(Sf);
+}
+
+// particles per kd-tree leaf, leaves are summed exactly
+#define ENTROPY_TREE_LEAF 32
+#define ENTROPY_TREE_MAX_DEPTH 64
+
+/**
+ * kd-tree over whitened observations for approximate kernel sums.
+ *
+ * A node is summed as count * midpoint of the kernel bounds over its bounding box
+ * once the bounds are close enough, so nodes far from the query (bounds near 0) and
+ * nodes small relative to the bandwidth (bounds near each other) are not visited.
+ * Each sum has relative error at most the tolerance. The buffers are kept between
+ * builds, so repeated cost evaluations with the same M do not allocate.
+ */
+class GaussKernelTree {
+public:
+	GaussKernelTree() : M(0), dim(0) { }
+
+	// Yt as from whiten_observations
+	void build(const mat& Yt) {
+		M = Yt.n_rows;
+		dim = Yt.n_cols;
+
+		index.resize(M);
+		for(int i=0; i < M; ++i) { index[i] = i; }
+		nodes.clear();
+		lo.clear();
+		hi.clear();
+		build_node(Yt, 0, M, 0);
+
+		points.resize(M*dim);
+		for(int i=0; i < M; ++i) {
+			for(int k=0; k < dim; ++k) {
+				points[i*dim+k] = Yt(index[i], k);
+			}
+		}
+	}
+
+	/**
+	 * \brief K(m) = sum_p exp(-0.5*|y_m - y_p|^2), up to a factor (1 +- tolerance)
+	 */
+	void sums(double tolerance, double* K, util::ThreadPool& pool) const {
+		const int num_blocks = (M + ENTROPY_KERNEL_BLOCK - 1) / ENTROPY_KERNEL_BLOCK;
+		pool.parallel_for(0, num_blocks, [&](int b) {
+			int end = std::min(M, (b+1)*ENTROPY_KERNEL_BLOCK);
+			for(int i=b*ENTROPY_KERNEL_BLOCK; i < end; ++i) {
+				K[index[i]] = query(&points[i*dim], tolerance);
+			}
+		});
+	}
+
+private:
+	struct Node {
+		int begin, end;
+		int left, right; // -1 for leaves
+	};
+
+	int M, dim;
+	std::vector<Node> nodes;
+	std::vector<double> lo, hi;  // bounding box of node n is [n*dim, (n+1)*dim)
+	std::vector<int> index;      // tree order to particle
+	std::vector<double> points;  // particles in tree order
+
+	int build_node(const mat& Yt, int begin, int end, int depth) {
+		int n = nodes.size();
+		Node node = {begin, end, -1, -1};
+		nodes.push_back(node);
+
+		int widest = 0;
+		double widest_extent = -1;
+		for(int k=0; k < dim; ++k) {
+			double min_k = INFINITY, max_k = -INFINITY;
+			for(int i=begin; i < end; ++i) {
+				min_k = std::min(min_k, Yt(index[i], k));
+				max_k = std::max(max_k, Yt(index[i], k));
+			}
+			lo.push_back(min_k);
+			hi.push_back(max_k);
+			if (max_k - min_k > widest_extent) {
+				widest = k;
+				widest_extent = max_k - min_k;
+			}
+		}
+
+		if ((end - begin <= ENTROPY_TREE_LEAF) || (depth >= ENTROPY_TREE_MAX_DEPTH-1) || (widest_extent <= 0)) {
+			return n;
+		}
+
+		// split at the median of the widest dimension
+		int mid = (begin + end) / 2;
+		std::nth_element(index.begin() + begin, index.begin() + mid, index.begin() + end,
+				[&](int a, int b) { return Yt(a, widest) < Yt(b, widest); });
+
+		int left = build_node(Yt, begin, mid, depth+1);
+		int right = build_node(Yt, mid, end, depth+1);
+		nodes[n].left = left;
+		nodes[n].right = right;
+		return n;
+	}
+
+	double query(const double* q, double tolerance) const {
+		// the query itself contributes 1, so an absolute error of tolerance/M per
+		// particle is within the relative tolerance
+		const double min_kernel = 1. / M;
+
+		int stack[ENTROPY_TREE_MAX_DEPTH+1];
+		int top = 0;
+		stack[top++] = 0;
+
+		double sum = 0;
+		while (top > 0) {
+			const Node& node = nodes[stack[--top]];
+			const int n = &node - &nodes[0];
+
+			double dmin = 0, dmax = 0;
+			for(int k=0; k < dim; ++k) {
+				double below = lo[n*dim+k] - q[k], above = q[k] - hi[n*dim+k];
+				double d = std::max(0., std::max(below, above));
+				double far = std::max(-below, -above);
+				dmin += d*d;
+				dmax += far*far;
+			}
+			const double kmax = exp(-0.5*dmin), kmin = exp(-0.5*dmax);
+
+			// error per particle is at most (kmax - kmin)/2
+			if (kmax - kmin <= tolerance*std::max(kmin, min_kernel)) {
+				sum += (node.end - node.begin)*0.5*(kmax + kmin);
+			} else if (node.left < 0) {
+				for(int i=node.begin; i < node.end; ++i) {
+					double d2 = 0;
+					for(int k=0; k < dim; ++k) {
+						double d = q[k] - points[i*dim+k];
+						d2 += d*d;
+					}
+					sum += exp(-0.5*d2);
+				}
+			} else {
+				stack[top++] = node.left;
+				stack[top++] = node.right;
+			}
+		}
+		return sum;
+	}
+};
+
+/**
+ * \brief Approximates gauss_kernel_sums with each K(m) within a factor (1 +- tolerance)
+ */
+inline void gauss_kernel_sums_approx(const mat& H, const mat& Sf, double tolerance, GaussKernelTree& tree,
+		mat& K, util::ThreadPool& pool) {
+	mat Yt;
+	whiten_observations(H, Sf, Yt);
+	tree.build(Yt);
+
+	K.set_size(H.n_cols, 1);
+	tree.sums(tolerance, K.memptr(), pool);
+
+	K /= gauss_normalizer(Sf);
+}
+
+#endif
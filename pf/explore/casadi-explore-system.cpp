@@ -40,6 +40,10 @@ void CasadiExploreSystem::init_dims(int T, int M, int N, double DT, int X_DIM, i
 void CasadiExploreSystem::init(const ObsType obs_type, const CostType cost_type, mat& R) {
 	this->obs_type = obs_type;
 	this->cost_type = cost_type;
+	if ((cost_type != CostType::entropy) && (cost_type != CostType::platt)) {
+		LOG_WARN("The approximate entropy costs have no symbolic form, using the exact entropy");
+		this->cost_type = CostType::entropy;
+	}
 	this->R = R;
 
 	this->cost_func = this->casadi_cost_func();
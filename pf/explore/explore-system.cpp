@@ -74,6 +74,11 @@ void ExploreSystem::init(mat& target, const ObsType obs_type, const CostType cos
 							  mat& xMin, mat& xMax, mat& uMin, mat& uMax, mat& R) {
 	this->target = target;
 	this->obs_type = obs_type;
+	if (use_casadi && ((cost_type == CostType::approx_entropy) || (cost_type == CostType::kdpee))) {
+		LOG_WARN("Only the exact entropy and platt costs are available in CasADi, not using CasADi");
+		use_casadi = false;
+	}
+
 	this->cost_type = cost_type;
 	this->use_casadi = use_casadi;
 	this->xMin = xMin;
@@ -136,6 +141,10 @@ double ExploreSystem::cost(const std::vector<mat>& X, const std::vector<mat>& U,
 	double cost;
 	if (this->cost_type == CostType::entropy) {
 		cost = this->cost_entropy(X, U, P);
+	} else if (this->cost_type == CostType::approx_entropy) {
+		cost = this->cost_entropy(X, U, P, this->entropy_tolerance);
+	} else if (this->cost_type == CostType::kdpee) {
+		cost = this->cost_kdpee(X, U, P);
 	} else {
 		cost = this->cost_platt(X, U, P);
 	}
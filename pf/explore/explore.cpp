@@ -425,7 +425,7 @@ bool found(const mat& P) {
 	return (max_spread < 1);
 }
 
-void parse_explore(int argc, char* argv[], ObsType& obs_type, CostType& cost_type, bool& use_casadi) {
+void parse_explore(int argc, char* argv[], ObsType& obs_type, CostType& cost_type, double& entropy_tol, bool& use_casadi) {
 	ObsTypeList obs_list;
 	CostTypeList cost_list;
 
@@ -435,7 +435,8 @@ void parse_explore(int argc, char* argv[], ObsType& obs_type, CostType& cost_typ
 		    				("help", "produce help message")
 		    				("M", po::value<int>(&M), "Number of particles (default 100)")
 		    				("obs", po::value<ObsTypeList>(&obs_list)->multitoken(), "Observation type <angle> or <distance> (default is <angle>)")
-		    				("cost", po::value<CostTypeList>(&cost_list)->multitoken(), "Cost type <entropy> or <platt> (default is <entropy>)")
+		    				("cost", po::value<CostTypeList>(&cost_list)->multitoken(), "Cost type <entropy>, <approx_entropy>, <kdpee> or <platt> (default is <entropy>)")
+		    				("entropy_tol", po::value<double>(&entropy_tol), "Relative error of the <approx_entropy> kernel sums (default 1e-3)")
 		    				("casadi", po::value<bool>(&use_casadi), "Use CasADi or not")
 		    				;
 
@@ -470,10 +471,11 @@ int main(int argc, char* argv[]) {
 
 	ObsType obs_type = ObsType::angle;
 	CostType cost_type = CostType::entropy;
+	double entropy_tol = 1e-3;
 	bool use_casadi = true;
 	M = 100;
 
-	parse_explore(argc, argv, obs_type, cost_type, use_casadi);
+	parse_explore(argc, argv, obs_type, cost_type, entropy_tol, use_casadi);
 
 	mat target(X_DIM, 1, fill::zeros);
 //	target << 2.5 << endr << 2.5;
@@ -482,6 +484,7 @@ int main(int argc, char* argv[]) {
 	LOG_DEBUG("Initializing...");
 	ExploreSystem sys = ExploreSystem(target, obs_type, cost_type, use_casadi,
 			T, M, N, DT, X_DIM, U_DIM, Z_DIM, Q_DIM, R_DIM);
+	sys.set_entropy_tolerance(entropy_tol);
 	LOG_DEBUG("System initialized");
 
 	x0 << 0 << endr << 0;// << endr << .5 << endr << 0;
@@ -0,0 +1,56 @@
+#ifndef __KDPEE_ENTROPY_H__
+#define __KDPEE_ENTROPY_H__
+
+extern "C" {
+#include "kdpee/kdpee/kdpee.h"
+}
+
+#include <vector>
+#include <algorithm>
+
+/**
+ * k-d partitioning entropy estimate (Stowell and Plumbley) of a sample set in O(M log M).
+ *
+ * Holds the per-dimension copies of the samples and the index buffer kdpee partitions,
+ * so repeated estimates with the same number of samples (e.g. during finite difference
+ * gradients) do not allocate.
+ */
+class KdpeeEntropy {
+public:
+	KdpeeEntropy(floatval zcut=1.96) : zcut(zcut) { }
+
+	/**
+	 * \brief Differential entropy in nats of the n samples of dimension d
+	 *        stored column-major in Z (e.g. the columns of an arma::mat)
+	 */
+	double operator()(const double* Z, int d, int n) {
+
+		data.resize(d*n);
+		dimrefs.resize(d);
+		mins.resize(d);
+		maxs.resize(d);
+		keys.resize(n);
+
+		for(int i=0; i < d; ++i) {
+			floatval* row = &data[i*n];
+			for(int j=0; j < n; ++j) {
+				row[j] = Z[j*d+i];
+			}
+			dimrefs[i] = row;
+			mins[i] = *std::min_element(row, row + n);
+			maxs[i] = *std::max_element(row, row + n);
+		}
+
+		return kdpee(&dimrefs[0], n, d, &mins[0], &maxs[0], zcut, &keys[0]);
+	}
+
+private:
+	floatval zcut;
+
+	std::vector<floatval> data;  // dimension i is [i*n, (i+1)*n)
+	std::vector<const floatval*> dimrefs;
+	std::vector<floatval> mins, maxs;
+	std::vector<int> keys;
+};
+
+#endif
@@ -6,7 +6,7 @@
  *
  */
 
-System::System() { }
+System::System() : entropy_pool(new util::ThreadPool()), entropy_tolerance(1e-3), resampler(entropy_pool.get()) { }
 
 /**
  *
@@ -80,25 +80,19 @@ double System::gauss_likelihood(const mat& v, const mat& S) {
 	return w;
 }
 
+/**
+ * r in [0, 1/M), so sample m is at r + m/M of the cumulative weight
+ */
 mat System::low_variance_sampler(const mat& P, const mat& W, double r) {
 	int M = P.n_cols;
-	mat P_sampled(P.n_rows, P.n_cols, fill::zeros);
-
-	double c = W(0);
-	int i = 0;
-	for(int m=0; m < M; ++m) {
-		double u = r + m * (1/double(M));
-		while (u > c) {
-			c += W(++i);
-		}
-		P_sampled.col(m) = P.col(i);
-	}
+	mat P_sampled(P.n_rows, M);
+	resampler.resample(P.memptr(), P.n_rows, W.memptr(), M, M, r*M, P_sampled.memptr());
 
 	return P_sampled;
 }
 
 
-double System::cost_entropy(const std::vector<mat>& X, const std::vector<mat>& U, const mat& P) {
+double System::cost_entropy(const std::vector<mat>& X, const std::vector<mat>& U, const mat& P, double tolerance) {
 	int T = X.size();
 	int M = P.n_cols;
 
@@ -132,16 +126,17 @@ double System::cost_entropy(const std::vector<mat>& X, const std::vector<mat>& U
 //				   log(accu(W[t-1] % W[t]));
 //	}
 
+	mat Rf = chol(this->R);
 	mat W_t = (1/double(M))*ones<mat>(M, 1);
+	mat K;
 	for(int t=1; t < T; ++t) {
-		mat W_tp1(M, 1, fill::zeros);
-		for(int m=0; m < M; ++m) {
-			for(int p=0; p < M; ++p) {
-				mat diff = H[t].col(m) - H[t].col(p);
-				W_tp1(m) += this->gauss_likelihood(diff, this->R);
-			}
-			W_tp1(m) *= W_t(m);
+		// W_tp1(m) = W_t(m) * sum_p gauss_likelihood(H[t].col(m) - H[t].col(p), R)
+		if (tolerance > 0) {
+			gauss_kernel_sums_approx(H[t], Rf, tolerance, this->entropy_tree, K, *this->entropy_pool);
+		} else {
+			gauss_kernel_sums(H[t], Rf, K, *this->entropy_pool);
 		}
+		mat W_tp1 = K % W_t;
 		W_tp1 = W_tp1 / accu(W_tp1);
 
 		entropy += accu(-W_tp1 % log(W_tp1));
@@ -152,6 +147,36 @@ double System::cost_entropy(const std::vector<mat>& X, const std::vector<mat>& U
 	return entropy;
 }
 
+/**
+ * Negative kdpee entropy of the particles' noise-free predicted observations, summed
+ * over time. This is a proxy, not an estimate of cost_entropy: the information an
+ * observation z carries about the particles is I(z;p) = H(z) - H(z|p), and with
+ * additive observation noise of fixed covariance H(z|p) does not depend on the
+ * trajectory, so maximizing H(z) maximizes the information gain. H(z) is approximated
+ * by the entropy of the noise-free observations, which is close when the noise is
+ * small next to their spread. Each timestep is scored against the unweighted prior
+ * particles rather than the expected posterior cost_entropy propagates, in exchange
+ * for O(M log M) per timestep instead of O(M^2).
+ */
+double System::cost_kdpee(const std::vector<mat>& X, const std::vector<mat>& U, const mat& P) {
+	int T = X.size();
+	int M = P.n_cols;
+
+	double cost = 0;
+
+	mat H(Z_DIM, M);
+	mat r(Z_DIM, 1, fill::zeros);
+	for(int t=0; t < T-1; ++t) {
+		mat x_tp1 = this->dynfunc(X[t], U[t]);
+		for(int m=0; m < M; ++m) {
+			H.col(m) = this->obsfunc(x_tp1, P.col(m), r);
+		}
+		cost -= this->kdpee_entropy(H.memptr(), H.n_rows, H.n_cols);
+	}
+
+	return cost;
+}
+
 double System::cost_platt(const std::vector<mat>& X, const std::vector<mat>& U, const mat& P) {
 	int T = X.size();
 	int M = P.n_cols;
@@ -14,6 +14,8 @@ namespace po = boost::program_options;
 #include <cmath>
 
 #include "../util/logging.h"
+#include "../util/random.h"
+#include "../util/resampling.h"
 
 #include <symbolic/casadi.hpp>
 #include <symbolic/stl_vector_tools.hpp>
@@ -22,6 +24,9 @@ namespace po = boost::program_options;
 #include <armadillo>
 using namespace arma;
 
+#include "entropy-kernel.h"
+#include "kdpee-entropy.h"
+
 #define MIN(a,b) (((a)<(b))?(a):(b))
 #define MAX(a,b) (((a)>(b))?(a):(b))
 
@@ -30,13 +35,15 @@ const double INFTY = 1e10;
 
 
 inline double uniform(double low, double high) {
-	return (high - low)*(rand() / double(RAND_MAX)) + low;
+	return util::thread_random().uniform(low, high);
 }
 
 inline mat sample_gaussian(mat mean, mat covariance) {
-	mat sample(mean.n_rows, mean.n_cols, fill::randn);
+	mat sample(mean.n_rows, mean.n_cols);
+	util::thread_random().normal(sample.memptr(), sample.n_elem);
 
-	mat L = chol(covariance);
+	// lower factor, covariance = L*L'
+	mat L = trans(chol(covariance));
 	sample = L*sample + mean;
 
 	return sample;
@@ -83,6 +90,9 @@ public:
 
 	virtual void display_states_and_particles(const std::vector<mat>& X, const mat& P, bool pause=true) =0;
 
+	// relative error allowed in the kernel sums of the approximate entropy cost
+	void set_entropy_tolerance(double tolerance) { this->entropy_tolerance = tolerance; }
+
 	mat get_xMin() { return this->xMin; }
 	mat get_xMax() { return this->xMax; }
 	mat get_uMin() { return this->uMin; }
@@ -99,10 +109,19 @@ protected:
 
 	CasadiSystem* casadi_sys;
 
+	// workers for the pairwise kernel in cost_entropy, shared so systems stay copyable
+	std::shared_ptr<util::ThreadPool> entropy_pool;
+	GaussKernelTree entropy_tree;
+	double entropy_tolerance;
+	KdpeeEntropy kdpee_entropy;
+	util::LowVarianceResampler resampler; // runs on entropy_pool
+
 	double gauss_likelihood(const mat& v, const mat& S);
 	mat low_variance_sampler(const mat& P, const mat& W, double r);
 
-	double cost_entropy(const std::vector<mat>& X, const std::vector<mat>& U, const mat& P);
+	// tolerance > 0 approximates the kernel sums with entropy_tree instead of the exact M^2 loop
+	double cost_entropy(const std::vector<mat>& X, const std::vector<mat>& U, const mat& P, double tolerance=0);
+	double cost_kdpee(const std::vector<mat>& X, const std::vector<mat>& U, const mat& P);
 	double cost_platt(const std::vector<mat>& X, const std::vector<mat>& U, const mat& P);
 };
 
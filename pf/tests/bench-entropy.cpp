@@ -0,0 +1,111 @@
+#include "../entropy-kernel.h"
+
+#include "../../util/Timer.h"
+#include "../../util/logging.h"
+
+#include <iostream>
+#include <iomanip>
+
+#include <armadillo>
+using namespace arma;
+
+#define Z_DIM 3
+#define RUNS 3
+
+// rows of the reference loop that are timed, the rest is extrapolated
+#define REFERENCE_ROWS 100
+
+// relative error of the approximate kernel sums
+#define TOLERANCE 1e-3
+
+// System::gauss_likelihood, which cost_entropy called for every pair
+double gauss_likelihood(const mat& v, const mat& S) {
+	mat Sf = chol(S);
+	mat M = solve(Sf, v);
+
+	double E = -0.5*accu(M % M);
+	double C = pow(2*M_PI, S.n_cols/2) * prod(diagvec(Sf));
+	double w = exp(E) / C;
+
+	return w;
+}
+
+void reference_kernel_sums(const mat& H, const mat& R, int rows, mat& K) {
+	int M = H.n_cols;
+	K = zeros<mat>(M, 1);
+	for(int m=0; m < rows; ++m) {
+		for(int p=0; p < M; ++p) {
+			mat diff = H.col(m) - H.col(p);
+			K(m) += gauss_likelihood(diff, R);
+		}
+	}
+}
+
+void bench_entropy() {
+	srand(0);
+	arma_rng::set_seed(0);
+
+	mat R = .1*eye<mat>(Z_DIM, Z_DIM);
+	R(0,1) = R(1,0) = .02;
+	mat Rf = chol(R);
+
+	util::ThreadPool pool;
+	GaussKernelTree tree;
+	util::Timer timer;
+
+	std::cout << "threads: " << pool.size() << "\n";
+	std::cout << std::setw(6) << "M" << std::setw(16) << "reference (s)" << std::setw(16) << "kernel (s)"
+			<< std::setw(12) << "speedup" << std::setw(16) << "max rel err"
+			<< std::setw(16) << "approx (s)" << std::setw(16) << "approx rel err" << "\n";
+
+	int Ms[] = {100, 250, 500, 1000, 2500, 5000, 10000};
+	for(int i=0; i < sizeof(Ms)/sizeof(Ms[0]); ++i) {
+		int M = Ms[i];
+		mat H = randn<mat>(Z_DIM, M);
+
+		int rows = std::min(M, REFERENCE_ROWS);
+		mat K_ref;
+		util::Timer_tic(&timer);
+		reference_kernel_sums(H, R, rows, K_ref);
+		double reference_time = util::Timer_toc(&timer) * (M / double(rows));
+
+		mat K;
+		util::Timer_tic(&timer);
+		for(int run=0; run < RUNS; ++run) {
+			gauss_kernel_sums(H, Rf, K, pool);
+		}
+		double kernel_time = util::Timer_toc(&timer) / RUNS;
+
+		mat K_approx;
+		util::Timer_tic(&timer);
+		for(int run=0; run < RUNS; ++run) {
+			gauss_kernel_sums_approx(H, Rf, TOLERANCE, tree, K_approx, pool);
+		}
+		double approx_time = util::Timer_toc(&timer) / RUNS;
+
+		double max_err = 0;
+		for(int m=0; m < rows; ++m) {
+			max_err = std::max(max_err, fabs(K(m) - K_ref(m)) / K_ref(m));
+		}
+
+		double max_approx_err = 0;
+		for(int m=0; m < M; ++m) {
+			max_approx_err = std::max(max_approx_err, fabs(K_approx(m) - K(m)) / K(m));
+		}
+
+		std::cout << std::setw(6) << M << std::setw(16) << reference_time << std::setw(16) << kernel_time
+				<< std::setw(12) << reference_time / kernel_time << std::setw(16) << max_err
+				<< std::setw(16) << approx_time << std::setw(16) << max_approx_err << "\n";
+
+		if (max_err > 1e-9) {
+			LOG_ERROR("Kernel sums differ from gauss_likelihood for M = %d", M);
+		}
+		if (max_approx_err > TOLERANCE) {
+			LOG_ERROR("Approximate kernel sums exceed the tolerance for M = %d", M);
+		}
+	}
+}
+
+int main(int argc, char* argv[]) {
+	bench_entropy();
+}
@@ -4,18 +4,20 @@
 #include <boost/filesystem.hpp>
 namespace py = boost::python;
 
-//#include "../kdpee/kdpee/kdpee.h"
+#include "../kdpee-entropy.h"
 
 #include <../util/logging.h>
+#include <../util/Timer.h>
 
 #include <iostream>
+#include <iomanip>
 
 #include <armadillo>
 
 using namespace arma;
 
 #define TIMESTEPS 50
-#define PARTICLES 100
+#define ITERATIONS 5
 
 #define X_DIM 2
 #define U_DIM 2
@@ -26,7 +28,6 @@ using namespace arma;
 #define DT 1.0
 
 const int T = TIMESTEPS;
-const int M = PARTICLES;
 
 mat::fixed<X_DIM, X_DIM> A;
 mat::fixed<X_DIM, U_DIM> B;
@@ -155,38 +156,52 @@ double particle_entropy(const mat& P) {
 	return entropy;
 }
 
-//floatval particle_entropy_kdpee(const mat& P) {
-//	const int d = P.n_rows;
-//	const int n = P.n_cols;
-//
-//	floatval **dimrefs = new floatval*[d];
-//	for(int i=0; i < d; ++i) {
-//		dimrefs[i] = new floatval[n];
-//		for(int j=0; j < n; ++j) {
-//			dimrefs[i][j] = P(i,j);
-//		}
-//	}
-//
-//	floatval *mins = new floatval[d];
-//	floatval *maxs = new floatval[d];
-//
-//	for(int i=0; i < d; ++i) {
-//		mat row = P.row(i);
-//		mins[i] = row.min();
-//		maxs[i] = row.max();
-//	}
-//
-//	const floatval zcut = 1.96;
-//
-//	int *keys = new int[n];
-//	for(int i=0; i < n; ++i) {
-//		keys[i] = i+1;
-//	}
-//
-//	const floatval **dimrefs_const = const_cast<const floatval**>(dimrefs);
-//	floatval entropy_kdpee = kdpee(dimrefs_const, n, d, mins, maxs, zcut, keys);
-//	return entropy_kdpee;
-//}
+double particle_entropy_kdpee(const mat& P) {
+	static KdpeeEntropy kdpee_entropy;
+	return kdpee_entropy(P.memptr(), P.n_rows, P.n_cols);
+}
+
+// System::cost_platt for a single timestep
+double particle_platt(const mat& P) {
+	int M = P.n_cols;
+
+	mat H(Z_DIM, M);
+	mat r(R_DIM, 1, fill::zeros);
+	for(int m=0; m < M; ++m) {
+		H.col(m) = obsfunc(P.col(m), r);
+	}
+
+	double platt = 0;
+	for(int m=1; m < M; ++m) {
+		mat diff = H.col(m) - H.col(0);
+		platt += (1/float(M-1))*exp(-accu(diff % diff));
+	}
+
+	return platt;
+}
+
+// accuracy and time of one particle entropy measure against the Kalman filter entropy
+struct EntropyStats {
+	const char* name;
+	double (*estimate)(const mat& P);
+	double mean_rel_err, correlation, time;
+	mat values;
+
+	EntropyStats(const char* name, double (*estimate)(const mat& P)) :
+		name(name), estimate(estimate), mean_rel_err(0), correlation(0), time(0), values(T, 1, fill::zeros) { }
+
+	void record(int t, const mat& P) {
+		util::Timer timer;
+		util::Timer_tic(&timer);
+		values(t) = estimate(P);
+		time += util::Timer_toc(&timer);
+	}
+
+	void accumulate(const mat& k_entropys) {
+		mean_rel_err += (1/double(ITERATIONS))*accu(100*abs((k_entropys - values)/values))/T;
+		correlation += (1/double(ITERATIONS))*as_scalar(cor(k_entropys, values));
+	}
+};
 
 void plot(const mat& mu, const mat& sigma, const mat& P) {
 	int M = P.n_cols;
@@ -235,22 +250,8 @@ void plot(const mat& mu, const mat& sigma, const mat& P) {
 	}
 }
 
-void test_entropy() {
-	srand(time(0));
-
-	A = eye<mat>(X_DIM, X_DIM);
-	B = zeros<mat>(X_DIM, X_DIM);
-	C = eye<mat>(Z_DIM, X_DIM);
-	D = zeros<mat>(Z_DIM, 1);
-
-	Q = 1*eye<mat>(Q_DIM, Q_DIM); // 1e-2
-	R = 1*eye<mat>(R_DIM, R_DIM); // 1e-1
-
-	int max_iter = 10;
-	mat mean_err_entropy(1, 1, fill::zeros), std_err_entropy(1, 1, fill::zeros);
-	mat mean_err_kdpee(1, 1, fill::zeros), std_err_kdpee(1, 1, fill::zeros);
-	for(int iter=0; iter < max_iter; ++iter) {
-		std::cout << "iter: " << iter << "\n";
+void test_entropy(int M, std::vector<EntropyStats>& stats) {
+	for(int iter=0; iter < ITERATIONS; ++iter) {
 		mat x0(X_DIM, 1, fill::zeros);
 		mat sigma0 = 1*eye<mat>(X_DIM, X_DIM);
 
@@ -265,19 +266,14 @@ void test_entropy() {
 		mat x_tp1(X_DIM, 1, fill::zeros), sigma_tp1(X_DIM, X_DIM, fill::zeros);
 		mat P_tp1(X_DIM, M, fill::zeros);
 
-		mat k_entropys(T, 1, fill::zeros), p_entropys(T, 1, fill::zeros), kdpee_entropys(T, 1, fill::zeros);
+		mat k_entropys(T, 1, fill::zeros);
 
 		k_entropys(0) = 0.5*log(pow(2*M_PI*exp(1), X_DIM) * det(sigma0));
-//		std::cout << "sigma0 entropy: " << k_entropys(0) << "\n";
-
-		p_entropys(0) = particle_entropy(P0);
-//		std::cout << "P0 entropy: " << p_entropys(0) << "\n";
-
-//		kdpee_entropys(0) = particle_entropy_kdpee(P0);
-//		std::cout << "kdpee0 entropy: " << kdpee_entropys(0) << "\n";
+		for(int i=0; i < stats.size(); ++i) {
+			stats[i].record(0, P0);
+		}
 
 		for(int t=1; t < T; ++t) {
-//			std::cout << "\nt: " << t << "\n";
 			mat u = sample_gaussian(zeros<mat>(U_DIM,1), 1*eye<mat>(U_DIM,U_DIM));
 			mat dyn_noise = sample_gaussian(zeros<mat>(Q_DIM,1), .1*Q);
 			mat obs_noise = sample_gaussian(zeros<mat>(R_DIM,1), .1*R);
@@ -288,7 +284,6 @@ void test_entropy() {
 			kalman_update(x_tp1_p, sigma_t, z_tp1, x_tp1, sigma_tp1);
 			k_entropys(t) = 0.5*log(pow(2*M_PI*exp(1), X_DIM) * det(sigma_tp1));
 
-//			std::cout << "kalman entropy: " << k_entropys(t) << "\n";
 			x_t = x_tp1;
 			sigma_t = sigma_tp1;
 
@@ -298,33 +293,58 @@ void test_entropy() {
 				P_tp1_p.col(m) = dynfunc(P_t.col(m), u, dyn_noise);
 			}
 			particle_update(P_tp1_p, z_tp1, P_tp1);
-			p_entropys(t) = particle_entropy(P_tp1);
-//			std::cout << "particle entropy: " << p_entropys(t) << "\n";
-
-//			kdpee_entropys(t) = particle_entropy_kdpee(P_tp1);
-//			std::cout << "kdpee entropy: " << kdpee_entropys(t) << "\n";
+			for(int i=0; i < stats.size(); ++i) {
+				stats[i].record(t, P_tp1);
+			}
 
 			P_t = P_tp1;
 
 			//		plot(x_t, sigma_t, P_t);
 		}
 
-		mat percent_diff_entropy = 100*abs((k_entropys - p_entropys)/p_entropys);
-		mean_err_entropy += (1/double(max_iter))*mean(percent_diff_entropy);
-		std_err_entropy += (1/double(max_iter))*stddev(percent_diff_entropy);
-
-//		mat percent_diff_kdpee = 100*abs((k_entropys - kdpee_entropys)/kdpee_entropys);
-//		mean_err_kdpee += (1/double(max_iter))*mean(percent_diff_kdpee);
-//		std_err_kdpee+= (1/double(max_iter))*stddev(percent_diff_kdpee);
+		for(int i=0; i < stats.size(); ++i) {
+			stats[i].accumulate(k_entropys);
+		}
 	}
-
-	std::cout << "\nparticle total mean rel err: " << mean_err_entropy(0) << "\n";
-	std::cout << "particle total std rel err: " << std_err_entropy(0) << "\n\n";
-
-//	std::cout << "kdpee total mean rel err: " << mean_err_kdpee(0) << "\n";
-//	std::cout << "kdpee total std rel err: " << std_err_kdpee(0) << "\n\n";
 }
 
+/**
+ * Compares the pairwise particle entropy, kdpee and platt against the
+ * Kalman filter entropy of the same linear Gaussian system. platt is not an
+ * entropy, so only its correlation with the Kalman entropy is meaningful.
+ */
 int main(int argc, char* argv[]) {
-	test_entropy();
+	srand(time(0));
+
+	A = eye<mat>(X_DIM, X_DIM);
+	B = zeros<mat>(X_DIM, X_DIM);
+	C = eye<mat>(Z_DIM, X_DIM);
+	D = zeros<mat>(Z_DIM, 1);
+
+	Q = 1*eye<mat>(Q_DIM, Q_DIM); // 1e-2
+	R = 1*eye<mat>(R_DIM, R_DIM); // 1e-1
+
+	std::cout << std::setw(6) << "M" << std::setw(12) << "cost" << std::setw(16) << "mean rel err %"
+			<< std::setw(16) << "corr kalman" << std::setw(16) << "time/call (s)" << "\n";
+
+	int Ms[] = {25, 50, 100, 200, 400};
+	for(int i=0; i < sizeof(Ms)/sizeof(Ms[0]); ++i) {
+		std::vector<EntropyStats> stats;
+		stats.push_back(EntropyStats("entropy", particle_entropy));
+		stats.push_back(EntropyStats("kdpee", particle_entropy_kdpee));
+		stats.push_back(EntropyStats("platt", particle_platt));
+
+		test_entropy(Ms[i], stats);
+
+		for(int j=0; j < stats.size(); ++j) {
+			std::cout << std::setw(6) << Ms[i] << std::setw(12) << stats[j].name;
+			if (j < 2) {
+				std::cout << std::setw(16) << stats[j].mean_rel_err;
+			} else {
+				std::cout << std::setw(16) << "-";
+			}
+			std::cout << std::setw(16) << stats[j].correlation
+					<< std::setw(16) << stats[j].time / (ITERATIONS*T) << "\n";
+		}
+	}
 }
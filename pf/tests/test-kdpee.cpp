@@ -0,0 +1,77 @@
+#include "../kdpee-entropy.h"
+
+#include <../util/random.h>
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+/**
+ * Checks KdpeeEntropy against distributions with known differential entropy and
+ * against the invariances every entropy estimator has. Needs neither Armadillo nor Python.
+ */
+
+#define M 20000
+
+// column-major 2 x M samples of diag(sigma) * N(0,I)
+std::vector<double> gaussian_samples(util::Random& random, double sigma0, double sigma1) {
+	std::vector<double> Z(2*M);
+	random.normal(&Z[0], 2*M);
+	for(int j=0; j < M; ++j) {
+		Z[2*j] *= sigma0;
+		Z[2*j+1] *= sigma1;
+	}
+	return Z;
+}
+
+bool check(const char* name, double value, double expected, double tolerance) {
+	bool ok = fabs(value - expected) <= tolerance;
+	if (!ok) {
+		std::cout << name << ": " << value << ", expected " << expected << " +- " << tolerance << "\n";
+	}
+	return ok;
+}
+
+int main(int argc, char* argv[]) {
+	util::Random random(0);
+	KdpeeEntropy kdpee_entropy;
+	int failures = 0;
+
+	// N(0, diag(1,4)) has entropy log(2 pi e) + .5 log(4)
+	std::vector<double> Z = gaussian_samples(random, 1, 2);
+	double h_gauss = kdpee_entropy(&Z[0], 2, M);
+	if (!check("gaussian", h_gauss, log(2*M_PI*M_E) + .5*log(4.), .15)) { ++failures; }
+
+	// uniform on [0,2] x [0,3] has entropy log(6)
+	std::vector<double> U(2*M);
+	random.uniform(&U[0], 2*M);
+	for(int j=0; j < M; ++j) {
+		U[2*j] *= 2;
+		U[2*j+1] *= 3;
+	}
+	if (!check("uniform", kdpee_entropy(&U[0], 2, M), log(6.), .1)) { ++failures; }
+
+	// translation leaves the partition and so the estimate unchanged
+	std::vector<double> Z_shifted(Z);
+	for(int j=0; j < M; ++j) {
+		Z_shifted[2*j] += 10;
+		Z_shifted[2*j+1] -= 3;
+	}
+	if (!check("translated", kdpee_entropy(&Z_shifted[0], 2, M), h_gauss, 1e-9)) { ++failures; }
+
+	// scaling every dimension by a adds d log(a)
+	std::vector<double> Z_scaled(Z);
+	for(int i=0; i < 2*M; ++i) {
+		Z_scaled[i] *= 3;
+	}
+	if (!check("scaled", kdpee_entropy(&Z_scaled[0], 2, M), h_gauss + 2*log(3.), 1e-6)) { ++failures; }
+
+	// spreading the samples out, as cost_kdpee rewards, raises the estimate
+	std::vector<double> W = gaussian_samples(random, 2, 2);
+	if (kdpee_entropy(&W[0], 2, M) <= h_gauss) {
+		std::cout << "wider distribution has no larger entropy\n"; ++failures;
+	}
+
+	std::cout << (failures ? "FAILED\n" : "passed\n");
+	return failures;
+}
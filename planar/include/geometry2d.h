@@ -101,8 +101,23 @@ namespace geometry2d {
 
 double signed_distance(const Vector2d& p, std::vector<Beam>& beams);
 
+/**
+ * Also the gradient of the signed distance w.r.t. p,
+ * the outward normal of the closest border segment at p
+ */
+double signed_distance(const Vector2d& p, std::vector<Beam>& beams, Vector2d& grad);
+
 bool is_inside(const Vector2d& p, std::vector<Beam>& beams);
 
+/**
+ * signed_distance / is_inside of every column of P (same results as per point).
+ * The points are bucketed in a uniform grid, and each cell evaluates only the
+ * beams and border segments near it, for all its points at once
+ */
+void signed_distance(const Matrix<double,2,Dynamic>& P, std::vector<Beam>& beams, VectorXd& sd);
+
+void is_inside(const Matrix<double,2,Dynamic>& P, std::vector<Beam>& beams, Array<bool,Dynamic,1>& inside);
+
 std::vector<Segment> beams_border(const std::vector<Beam>& beams);
 
 void truncate_belief(const std::vector<Beam>& beams, const Vector2d& cur_mean, const Matrix2d& cur_cov,
@@ -4,11 +4,15 @@
 #include "planar-utils.h"
 
 #include <iostream>
+#include <unordered_map>
+#include <stdint.h>
 
 #include <Eigen/Eigen>
 #include <Eigen/StdVector>
 using namespace Eigen;
 
+#include "../../util/threadpool.h"
+
 template <size_t _dim0, size_t _dim1>
 using mat = Matrix<double, _dim0, _dim1>;
 
@@ -18,9 +22,117 @@ using vec = Matrix<double, _dim, 1>;
 
 namespace gmm {
 
+/**
+ * Mean-shift mode finding with the kernel exp(-|x - p| / bandwidth), truncated where it
+ * falls below min_kernel (so shifts only visit the particles in nearby cells of a spatial
+ * hash). Seeds are the modes of the previous call (warm start) plus one particle per
+ * occupied bandwidth-sized cell that is not already within a bandwidth of a mode, and
+ * are shifted in parallel on the pool (if any). Each particle goes to its nearest mode.
+ */
+class ModeFinder {
+public:
+	ModeFinder(util::ThreadPool* pool=NULL, double bandwidth=1, double min_kernel=1e-3, double tolerance=1e-3);
+
+	void find_modes(const MatrixXd& P, std::vector<VectorXd>& modes, std::vector<std::vector<int>>& mode_particle_indices);
+
+	VectorXd find_nearest_mode(const VectorXd& p, const MatrixXd& P) const;
+
+	/**
+	 * \brief Forgets the previous modes, so the next call starts cold
+	 */
+	void reset() { previous_modes.clear(); }
+
+private:
+	util::ThreadPool* pool;
+	double bandwidth, support, tolerance;
+
+	std::vector<VectorXd> previous_modes;
+
+	// particles sorted by support-sized cell, with the range of each cell
+	std::vector<int> cell_particles;
+	std::unordered_map<uint64_t, std::pair<int,int>> cells;
+
+	void build_grid(const MatrixXd& P);
+	uint64_t cell_key(const int* cell, int dim) const;
+	void shift_seeds(const MatrixXd& P, std::vector<VectorXd>& seeds) const;
+	void merge_modes(const std::vector<VectorXd>& converged, std::vector<VectorXd>& modes) const;
+};
+
+/**
+ * Gaussian mixture over a particle set, kept up to date through resampling.
+ *
+ * Each mode keeps its particle count and the sums of its particles' offsets and outer
+ * products about a fixed reference (the mode when it was found). Resampling only copies
+ * and drops particles, so the sums change by (copies - 1) times each ancestor's terms,
+ * which is zero for every particle kept exactly once. The mixture is refit with the
+ * ModeFinder only when a mode splits (no particle left near the mode, or its mean has
+ * drifted a bandwidth from it) or two modes merge (means within a bandwidth).
+ */
+class MixtureTracker {
+public:
+	MixtureTracker(util::ThreadPool* pool=NULL, double bandwidth=1);
+
+	/**
+	 * \brief Fits the mixture to P from scratch
+	 */
+	void fit(const MatrixXd& P);
+
+	/**
+	 * \brief Whether the mixture is the one of P, i.e. P is what was last fit or resampled
+	 */
+	bool tracks(const MatrixXd& P) const;
+
+	/**
+	 * \brief Follows a resampling of the tracked particles: column m of P_sampled is
+	 *        the tracked particle ancestors[m], without jitter
+	 */
+	void resample(const MatrixXd& P_sampled, const std::vector<int>& ancestors);
+
+	/**
+	 * \brief Same outputs as fit_gaussians_to_pf
+	 */
+	void get_gaussians(std::vector<VectorXd>& obj_means, std::vector<MatrixXd>& obj_covs,
+			std::vector<MatrixXd>& obj_particles) const;
+
+	int num_modes() const { return modes.size(); }
+	int num_refits() const { return refits; }
+
+private:
+	struct Mode {
+		VectorXd mode, sum;
+		MatrixXd sum_sq;
+		double count;
+
+		VectorXd mean() const { return mode + sum / count; }
+
+		/**
+		 * \brief Sample covariance, or the kernel's (bandwidth^2 I) for a single particle,
+		 *        which has no spread of its own (counts are sums of integers)
+		 */
+		MatrixXd cov(double bandwidth) const {
+			if (count < 1.5) { return bandwidth*bandwidth*MatrixXd::Identity(sum.rows(), sum.rows()); }
+			return (sum_sq - sum*sum.transpose() / count) / (count - 1);
+		}
+	};
+
+	ModeFinder mode_finder;
+	double bandwidth;
+	int refits;
+
+	MatrixXd particles;
+	std::vector<int> labels;
+	std::vector<Mode> modes;
+
+	void drop_empty_modes();
+	bool needs_refit() const;
+};
+
 void fit_gaussians_to_pf(const MatrixXd& P, std::vector<VectorXd>& obj_means, std::vector<MatrixXd>& obj_covs,
 		std::vector<MatrixXd>& obj_particles);
 
+void fit_gaussians_to_pf(const MatrixXd& P, ModeFinder& mode_finder, std::vector<VectorXd>& obj_means,
+		std::vector<MatrixXd>& obj_covs, std::vector<MatrixXd>& obj_particles);
+
 void find_modes(const MatrixXd& P, std::vector<VectorXd>& modes, std::vector<std::vector<int>>& mode_particle_indices);
 
 VectorXd find_nearest_mode(const VectorXd& p, const MatrixXd& P);
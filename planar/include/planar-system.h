@@ -25,6 +25,7 @@ using namespace Eigen;
 
 
 #include "../../util/logging.h"
+#include "../../util/resampling.h"
 
 #define TIMESTEPS 10
 #define DT 1.0 // Note: if you change this, must change the FORCES matlab file
@@ -41,7 +42,9 @@ using namespace Eigen;
 
 #define TOTAL_VARS (TIMESTEPS*J_DIM + (TIMESTEPS-1)*U_DIM)
 
-#define M_DIM 1000 // number of particles
+#define M_DIM 1000 // initial and maximum number of particles
+#define M_MIN 100 // minimum number of particles
+#define M_BIN_SIZE .5 // KLD-sampling grid resolution
 
 template <size_t _dim0, size_t _dim1>
 using mat = Matrix<double, _dim0, _dim1>;
@@ -49,6 +52,9 @@ using mat = Matrix<double, _dim0, _dim1>;
 template <size_t _dim>
 using vec = Matrix<double, _dim, 1>;
 
+// particles are columns, their number adapts (KLD-sampling)
+typedef Matrix<double, C_DIM, Dynamic> MatrixP;
+
 struct PlanarGaussian {
 	vec<C_DIM> obj_mean;
 	mat<C_DIM,C_DIM> obj_cov;
@@ -59,6 +65,26 @@ struct PlanarGaussian {
 		obj_mean(m), obj_cov(c), obj_particles(P), pct(p) { };
 };
 
+/**
+ * First order model of the signed distance of an object from the field of view,
+ * around the joints j and object it was linearized at
+ */
+struct LinearizedSignedDistance {
+	vec<J_DIM> j;
+	vec<C_DIM> object;
+	double sd;
+	vec<J_DIM> grad_j; // closest border point moved by the joints, projected on grad_object
+	vec<C_DIM> grad_object; // normal of the closest border segment
+
+	double signed_distance(const vec<J_DIM>& j_new, const vec<C_DIM>& object_new) const {
+		return sd + grad_j.dot(j_new - j) + grad_object.dot(object_new - object);
+	}
+
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+typedef std::vector<LinearizedSignedDistance, aligned_allocator<LinearizedSignedDistance>> StdVectorLSD; // [timestep]
+
 
 class PlanarSystem {
 	const double step = 0.0078125*0.0078125;
@@ -75,14 +101,15 @@ public:
 	vec<J_DIM> dynfunc(const vec<J_DIM>& j, const vec<U_DIM>& u, const vec<Q_DIM>& q, bool enforce_limits=false);
 	vec<Z_DIM> obsfunc(const vec<J_DIM>& j, const vec<C_DIM>& object, const vec<R_DIM>& r);
 
-	mat<Z_DIM,Z_DIM> delta_matrix(const vec<J_DIM>& j, const vec<C_DIM>& object, const double alpha);
+	mat<Z_DIM,Z_DIM> delta_matrix(const vec<J_DIM>& j, const vec<C_DIM>& object, const double alpha,
+			const LinearizedSignedDistance* lsd=NULL);
 
 	void belief_dynamics(const vec<X_DIM>& x_t, const mat<X_DIM,X_DIM>& sigma_t, const vec<U_DIM>& u_t, const double alpha,
-			vec<X_DIM>& x_tp1, mat<X_DIM,X_DIM>& sigma_tp1);
-	void execute_control_step(const vec<X_DIM>& x_t_real, const vec<X_DIM>& x_t_t, const mat<X_DIM,X_DIM>& sigma_t_t, const vec<U_DIM>& u_t, const mat<C_DIM,M_DIM>& P_t,
-			vec<X_DIM>& x_tp1_real, vec<X_DIM>& x_tp1_tp1, mat<X_DIM,X_DIM>& sigma_tp1_tp1, mat<C_DIM,M_DIM>& P_tp1);
-	void execute_control_step(const vec<J_DIM>& j_t_real, const vec<J_DIM>& j_t, const vec<U_DIM>& u_t, const mat<C_DIM,M_DIM>& P_t,
-			vec<J_DIM>& j_tp1_real, vec<J_DIM>& j_tp1, mat<C_DIM,M_DIM>& P_tp1);
+			vec<X_DIM>& x_tp1, mat<X_DIM,X_DIM>& sigma_tp1, const LinearizedSignedDistance* lsd=NULL);
+	void execute_control_step(const vec<X_DIM>& x_t_real, const vec<X_DIM>& x_t_t, const mat<X_DIM,X_DIM>& sigma_t_t, const vec<U_DIM>& u_t, const MatrixP& P_t,
+			vec<X_DIM>& x_tp1_real, vec<X_DIM>& x_tp1_tp1, mat<X_DIM,X_DIM>& sigma_tp1_tp1, MatrixP& P_tp1);
+	void execute_control_step(const vec<J_DIM>& j_t_real, const vec<J_DIM>& j_t, const vec<U_DIM>& u_t, const MatrixP& P_t,
+			vec<J_DIM>& j_tp1_real, vec<J_DIM>& j_tp1, MatrixP& P_tp1);
 
 	std::vector<Beam> get_fov(const vec<J_DIM>& j);
 	std::vector<Segment> get_link_segments(const vec<E_DIM>& j);
@@ -95,13 +122,13 @@ public:
 	vec<C_DIM> get_camera() { return camera_origin; }
 
 	double cost(const std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>& J, const vec<C_DIM>& obj, const mat<X_DIM,X_DIM>& sigma0,
-			const std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U, const double alpha);
+			const std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U, const double alpha, const StdVectorLSD* lsd=NULL);
 	double cost_gmm(const std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>& J, const mat<J_DIM,J_DIM>& j_sigma0,
 			const std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U,
-			const std::vector<PlanarGaussian>& planar_gmm, const double alpha);
+			const std::vector<PlanarGaussian>& planar_gmm, const double alpha, const std::vector<StdVectorLSD>* lsds=NULL);
 	double cost_entropy(const std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>& J,
 			const std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U,
-			const mat<C_DIM,M_DIM>& P, const double alpha);
+			const MatrixP& P, const double alpha);
 
 	vec<TOTAL_VARS> cost_grad(std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>& J, const vec<C_DIM>& obj,
 			const mat<X_DIM,X_DIM>& sigma0, std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U, const double alpha);
@@ -110,15 +137,15 @@ public:
 			const std::vector<PlanarGaussian>& planar_gmm, const double alpha);
 	vec<TOTAL_VARS> cost_entropy_grad(std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>& J,
 			std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U,
-			const mat<C_DIM,M_DIM>& P, const double alpha);
+			const MatrixP& P, const double alpha);
 
 //	void cost_and_cost_grad(std::vector<vec<X_DIM>, aligned_allocator<vec<X_DIM>>>& X, const mat<X_DIM,X_DIM>& sigma0,
 //			std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U, const double alpha, const bool use_fadbad,
 //			double& cost, vec<TOTAL_VARS>& grad);
 
-	void fit_gaussians_to_pf(const mat<C_DIM,M_DIM>& P,
+	void fit_gaussians_to_pf(const MatrixP& P,
 			std::vector<PlanarGaussian>& planar_gmm);
-	void fit_gaussians_to_pf_figtree(const mat<C_DIM,M_DIM>& P,
+	void fit_gaussians_to_pf_figtree(const MatrixP& P,
 			std::vector<PlanarGaussian>& planar_gmm);
 
 
@@ -162,16 +189,29 @@ private:
 
 //	FadbadPlanarSystem fps;
 
+	util::KLDSampling kld = util::KLDSampling(M_BIN_SIZE, M_MIN, M_DIM);
+
+	// mixture for fit_gaussians_to_pf, followed through low_variance_sampler between refits
+	std::shared_ptr<util::ThreadPool> mode_pool = std::make_shared<util::ThreadPool>();
+	gmm::MixtureTracker gmm_tracker = gmm::MixtureTracker(mode_pool.get());
+
 	void init(const vec<C_DIM>& camera_origin, const vec<C_DIM>& object, bool is_static);
 	void init_display();
 
 	void linearize_dynfunc(const vec<X_DIM>& x, const vec<U_DIM>& u, const vec<Q_DIM>& q, mat<X_DIM,X_DIM>& A, mat<X_DIM,Q_DIM>& M);
 	void linearize_obsfunc(const vec<X_DIM>& x, const vec<R_DIM>& r, mat<Z_DIM,X_DIM>& H, mat<Z_DIM,R_DIM>& N);
-
-	void update_particles(const vec<J_DIM>& j_tp1_t, const double delta_fov_real, const vec<Z_DIM>& z_tp1_real, const mat<C_DIM,M_DIM>& P_t,
-			mat<C_DIM,M_DIM>& P_tp1);
+	void linearize_signed_distances(const std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>& J,
+			const std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U,
+			const std::vector<vec<C_DIM>, aligned_allocator<vec<C_DIM>>>& objects,
+			std::vector<StdVectorLSD>& lsds);
+	void get_link_point_jac(const vec<J_DIM>& j, const int link, const vec<C_DIM>& point, mat<C_DIM,J_DIM>& jac);
+	bool get_border_segment_jac(const vec<J_DIM>& j, const Segment& segment, const vec<C_DIM>& point, mat<C_DIM,J_DIM>& jac);
+	bool get_border_point_jac(const vec<J_DIM>& j, const std::vector<Segment>& border, const vec<C_DIM>& point, mat<C_DIM,J_DIM>& jac);
+
+	void update_particles(const vec<J_DIM>& j_tp1_t, const double delta_fov_real, const vec<Z_DIM>& z_tp1_real, const MatrixP& P_t,
+			MatrixP& P_tp1);
 	double gauss_likelihood(const vec<C_DIM>& v, const mat<C_DIM,C_DIM>& S);
-	void low_variance_sampler(const mat<C_DIM,M_DIM>& P, const vec<M_DIM>& W, mat<C_DIM,M_DIM>& P_sampled);
+	void low_variance_sampler(const MatrixP& P, const VectorXd& W, MatrixP& P_sampled);
 
 };
 
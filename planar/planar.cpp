@@ -1,6 +1,10 @@
 #include "include/planar-system.h"
 #include "include/gmm.h"
 #include "../util/Timer.h"
+#include "../util/multistart.h"
+
+#include <mutex>
+#include <random>
 
 //#define USE_GMM_COST
 
@@ -9,6 +13,10 @@ extern "C" {
 planarMPC_FLOAT **H, **f, **lb, **ub, **z, *c, *A, *b;
 }
 
+// FORCES keeps its workspace in globals, so concurrent collocations
+// must fill the problem and solve while holding this
+std::mutex forces_mutex;
+
 const int T = TIMESTEPS;
 const double INFTY = 1e10;
 
@@ -19,14 +27,28 @@ const double alpha_init = .01; // 1
 const double alpha_gain = 3; // 3
 const double alpha_epsilon = .1; // .001
 const double alpha_max_increases = 5; // 10
+// sharpest alpha planar_minimize_merit collocates with, alpha_init*alpha_gain^k for k < alpha_max_increases
+const double alpha_final = alpha_init*pow(alpha_gain, alpha_max_increases-1);
 
 const double improve_ratio_threshold = 1e-1; // .1
 const double min_approx_improve = 1e-1; // 1
 const double min_trust_box_size = .1; // .1
 const double trust_shrink_ratio = .5; // .5
 const double trust_expand_ratio = 1.5; // 1.5
+
+const int num_starts = 4; // 1 disables multistart
+const double multistart_cancel_margin = .25; // relative merit gap before a start is cancelled
+const double multistart_init_noise = M_PI/32; // std dev of perturbation to initial controls
 }
 
+typedef std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>> StdVectorJ;
+typedef std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>> StdVectorU;
+
+struct PlanarTrajectory {
+	StdVectorJ J;
+	StdVectorU U;
+};
+
 void setup_mpc_vars(planarMPC_params& problem, planarMPC_output& output) {
 	// inputs
 	H = new planarMPC_FLOAT*[T];
@@ -219,9 +241,10 @@ void L_BFGS(const std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>& J,
 double planar_collocation(std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>& J,
 		std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U,
 		const mat<J_DIM,J_DIM>& j_sigma0,
-		const std::vector<PlanarGaussian>& planar_gmm, const mat<C_DIM,M_DIM>& P,
+		const std::vector<PlanarGaussian>& planar_gmm, const MatrixP& P,
 		const double alpha,
-		PlanarSystem& sys, planarMPC_params &problem, planarMPC_output &output, planarMPC_info &info) {
+		PlanarSystem& sys, planarMPC_params &problem, planarMPC_output &output, planarMPC_info &info,
+		util::MultiStartContext* ctx=NULL, int stage=0) {
 	int max_iter = 100;
 	double Xeps = .5;
 	double Ueps = .5;
@@ -230,6 +253,7 @@ double planar_collocation(std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>
 	double constant_cost, hessian_constant, jac_constant;
 	vec<TOTAL_VARS> grad = vec<TOTAL_VARS>::Zero();
 	mat<TOTAL_VARS,TOTAL_VARS> hess = mat<TOTAL_VARS,TOTAL_VARS>::Identity();
+	vec<TOTAL_VARS> diaghess = vec<TOTAL_VARS>::Zero();
 
 	std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>> Jopt(T, vec<J_DIM>::Zero());
 	std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>> Uopt(T-1, vec<U_DIM>::Zero());
@@ -265,26 +289,13 @@ double planar_collocation(std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>
 				grad = gradopt;
 			}
 
-			vec<TOTAL_VARS> diaghess = hess.diagonal();
+			// force Hessian to be PSD
+			diaghess = hess.diagonal().cwiseMax(0);
 
 			constant_cost = 0;
 			hessian_constant = 0;
 			jac_constant = 0;
 
-			// fill in Hessian first so we can force it to be PSD
-			index = 0;
-			for(int t=0; t < T-1; ++t) {
-				for(int i=0; i < (J_DIM+U_DIM); ++i) {
-					double val = diaghess(index++);
-					H[t][i] = (val < 0) ? 0 : val;
-				}
-			}
-			for(int i=0; i < J_DIM; ++i) {
-				double val = diaghess(index++);
-				H[T-1][i] = (val < 0) ? 0 : val;
-			}
-
-			// fill in gradient
 			index = 0;
 			for(int t=0; t < T-1; ++t) {
 				vec<(J_DIM+U_DIM)> zbar;
@@ -292,9 +303,8 @@ double planar_collocation(std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>
 				zbar.segment<U_DIM>(J_DIM) = U[t];
 
 				for(int i=0; i < (J_DIM+U_DIM); ++i) {
-					hessian_constant += H[t][i]*zbar(i)*zbar(i);
+					hessian_constant += diaghess(index)*zbar(i)*zbar(i);
 					jac_constant -= grad(index)*zbar(i);
-					f[t][i] = grad(index) - H[t][i]*zbar(i);
 					index++;
 				}
 			}
@@ -302,16 +312,11 @@ double planar_collocation(std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>
 			vec<J_DIM> zbar = J[T-1];
 
 			for(int i=0; i < J_DIM; ++i) {
-				hessian_constant += H[T-1][i]*zbar(i)*zbar(i);
+				hessian_constant += diaghess(index)*zbar(i)*zbar(i);
 				jac_constant -= grad(index)*zbar(i);
-				f[T-1][i] = grad(index) - H[T-1][i]*zbar(i);
 				index++;
 			}
 
-			for(int i=0; i < J_DIM; ++i) {
-				c[i] = J[0](i);
-			}
-
 			constant_cost = 0.5*hessian_constant + jac_constant + merit;
 		}
 
@@ -320,6 +325,50 @@ double planar_collocation(std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>
 		vec<U_DIM> u_min, u_max;
 		sys.get_limits(x_min, x_max, u_min, u_max);
 
+		// end goal constraint on end effector
+		vec<C_DIM> goal_pos = planar_gmm[0].obj_mean;
+		double goal_delta = .01;
+
+		vec<E_DIM> ee_jT = J[T-1].segment<E_DIM>(0);
+		vec<C_DIM> ee_pos = sys.get_ee_pos(ee_jT);
+		mat<C_DIM,E_DIM> ee_pos_jac;
+		sys.get_ee_pos_jac(ee_jT, ee_pos_jac);
+		mat<C_DIM,J_DIM> ee_pos_jac_full = mat<C_DIM,J_DIM>::Zero();
+		ee_pos_jac_full.block<C_DIM,E_DIM>(0,0) = ee_pos_jac;
+
+		mat<2*C_DIM,J_DIM> Amat;
+		Amat.block<C_DIM,J_DIM>(0,0) = ee_pos_jac_full;
+		Amat.block<C_DIM,J_DIM>(C_DIM,0) = -ee_pos_jac_full;
+		Amat.setZero(); // TODO: tmp
+
+		vec<2*C_DIM> bVec;
+		bVec.segment<C_DIM>(0) = goal_pos - ee_pos + ee_pos_jac_full*J[T-1] + goal_delta*vec<C_DIM>::Ones();
+		bVec.segment<C_DIM>(C_DIM) = -goal_pos + ee_pos - ee_pos_jac_full*J[T-1] + goal_delta*vec<C_DIM>::Ones();
+		bVec.setZero(); // TODO: tmp
+
+		// everything from filling in the problem to reading the solution touches FORCES globals
+		std::unique_lock<std::mutex> forces_lock(forces_mutex);
+
+		// fill in Hessian and gradient
+		index = 0;
+		for(int t=0; t < T-1; ++t) {
+			for(int i=0; i < (J_DIM+U_DIM); ++i) {
+				double zbar_i = (i < J_DIM) ? J[t](i) : U[t](i-J_DIM);
+				H[t][i] = diaghess(index);
+				f[t][i] = grad(index) - H[t][i]*zbar_i;
+				index++;
+			}
+		}
+		for(int i=0; i < J_DIM; ++i) {
+			H[T-1][i] = diaghess(index);
+			f[T-1][i] = grad(index) - H[T-1][i]*J[T-1](i);
+			index++;
+		}
+
+		for(int i=0; i < J_DIM; ++i) {
+			c[i] = J[0](i);
+		}
+
 		// set trust region bounds based on current trust region size
 		for(int t=0; t < T; ++t) {
 			index = 0;
@@ -346,27 +395,7 @@ double planar_collocation(std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>
 			}
 		}
 
-		// end goal constraint on end effector
-		vec<C_DIM> goal_pos = planar_gmm[0].obj_mean;
-		double goal_delta = .01;
-
-		vec<E_DIM> ee_jT = J[T-1].segment<E_DIM>(0);
-		vec<C_DIM> ee_pos = sys.get_ee_pos(ee_jT);
-		mat<C_DIM,E_DIM> ee_pos_jac;
-		sys.get_ee_pos_jac(ee_jT, ee_pos_jac);
-		mat<C_DIM,J_DIM> ee_pos_jac_full = mat<C_DIM,J_DIM>::Zero();
-		ee_pos_jac_full.block<C_DIM,E_DIM>(0,0) = ee_pos_jac;
-
-		mat<2*C_DIM,J_DIM> Amat;
-		Amat.block<C_DIM,J_DIM>(0,0) = ee_pos_jac_full;
-		Amat.block<C_DIM,J_DIM>(C_DIM,0) = -ee_pos_jac_full;
-		Amat.setZero(); // TODO: tmp
 		fill_col_major(A, Amat);
-
-		vec<2*C_DIM> bVec;
-		bVec.segment<C_DIM>(0) = goal_pos - ee_pos + ee_pos_jac_full*J[T-1] + goal_delta*vec<C_DIM>::Ones();
-		bVec.segment<C_DIM>(C_DIM) = -goal_pos + ee_pos - ee_pos_jac_full*J[T-1] + goal_delta*vec<C_DIM>::Ones();
-		bVec.setZero(); // TODO: tmp
 		fill_col_major(b, bVec);
 
 		// Verify problem inputs
@@ -398,6 +427,7 @@ double planar_collocation(std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>
 //			exit(-1);
 			return INFINITY;
 		}
+		forces_lock.unlock();
 
 		model_merit = optcost + constant_cost; // need to add constant terms that were dropped
 
@@ -456,6 +486,10 @@ double planar_collocation(std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>
 
 			J = Jopt; U = Uopt;
 			solution_accepted = true;
+
+			if ((ctx != NULL) && !ctx->report(meritopt, stage)) {
+				return meritopt;
+			}
 		}
 
 	}
@@ -466,14 +500,19 @@ double planar_collocation(std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>
 double planar_minimize_merit(std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>& J,
 		std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U,
 		const mat<J_DIM,J_DIM>& j_sigma0,
-		const std::vector<PlanarGaussian>& planar_gmm, const mat<C_DIM,M_DIM>& P,
-		PlanarSystem& sys, planarMPC_params &problem, planarMPC_output &output, planarMPC_info &info) {
+		const std::vector<PlanarGaussian>& planar_gmm, const MatrixP& P,
+		PlanarSystem& sys, planarMPC_params &problem, planarMPC_output &output, planarMPC_info &info,
+		util::MultiStartContext* ctx=NULL) {
 	double alpha = cfg::alpha_init;
 	double cost = INFINITY;
 
 	for(int num_alpha_increases=0; num_alpha_increases < cfg::alpha_max_increases; ++num_alpha_increases) {
 		LOG_DEBUG("Calling collocation with alpha = %4.2f", alpha);
-		cost = planar_collocation(J, U, j_sigma0, planar_gmm, P, alpha, sys, problem, output, info);
+		cost = planar_collocation(J, U, j_sigma0, planar_gmm, P, alpha, sys, problem, output, info,
+				ctx, num_alpha_increases);
+		if ((ctx != NULL) && ctx->is_cancelled()) {
+			break;
+		}
 
 		LOG_DEBUG("Reintegrating trajectory");
 		for(int t=0; t < T-1; ++t) {
@@ -503,20 +542,12 @@ double planar_minimize_merit(std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM
 	return cost;
 }
 
-void init_collocation(const vec<J_DIM>& j0, const mat<C_DIM,M_DIM>& P, PlanarSystem& sys,
+/**
+ * \brief Straight-line trajectory (in joint space) from j0 towards obj_mean
+ */
+void straight_line_collocation(const vec<J_DIM>& j0, const vec<C_DIM>& obj_mean, PlanarSystem& sys,
 		std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>& J,
-		std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U,
-		std::vector<PlanarGaussian>& planar_gmm) {
-	// re-initialize GMM from PF
-//	sys.fit_gaussians_to_pf(P, planar_gmm);
-	sys.fit_gaussians_to_pf_figtree(P, planar_gmm);
-
-	// find Gaussian with most particles
-	// by construction of fit_gaussians_to_pf, is the first one
-//	vec<C_DIM> obj_mean = planar_gmm[0].obj_mean;
-	// try last one instead
-	vec<C_DIM> obj_mean = planar_gmm.back().obj_mean;
-
+		std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U) {
 	// search for IK soln j_goal to get to max_obj_mean
 	// starting with initial guess at j0
 	vec<E_DIM> j_goal = j0.segment<E_DIM>(0);
@@ -540,6 +571,95 @@ void init_collocation(const vec<J_DIM>& j0, const mat<C_DIM,M_DIM>& P, PlanarSys
 	}
 }
 
+void init_collocation(const vec<J_DIM>& j0, const MatrixP& P, PlanarSystem& sys,
+		std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>& J,
+		std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U,
+		std::vector<PlanarGaussian>& planar_gmm) {
+	// re-initialize GMM from PF, which the tracker followed through the last resampling
+	sys.fit_gaussians_to_pf(P, planar_gmm);
+//	sys.fit_gaussians_to_pf_figtree(P, planar_gmm);
+
+	// find Gaussian with most particles
+	// by construction of fit_gaussians_to_pf, is the first one
+//	vec<C_DIM> obj_mean = planar_gmm[0].obj_mean;
+	// try last one instead
+	vec<C_DIM> obj_mean = planar_gmm.back().obj_mean;
+
+	straight_line_collocation(j0, obj_mean, sys, J, U);
+}
+
+/**
+ * \brief Initial guess for multistart k > 0: straight line towards one of the
+ *        Gaussians (cycling through planar_gmm) with seeded noise on the controls
+ */
+void multistart_init_collocation(const vec<J_DIM>& j0, const std::vector<PlanarGaussian>& planar_gmm,
+		PlanarSystem& sys, const util::MultiStartContext& ctx,
+		std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>& J,
+		std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U) {
+	straight_line_collocation(j0, planar_gmm[ctx.start % planar_gmm.size()].obj_mean, sys, J, U);
+
+	vec<X_DIM> x_min, x_max;
+	vec<U_DIM> u_min, u_max;
+	sys.get_limits(x_min, x_max, u_min, u_max);
+
+	std::mt19937 generator(ctx.seed);
+	std::normal_distribution<double> distribution(0.0, cfg::multistart_init_noise);
+	for(int t=0; t < T-1; ++t) {
+		for(int i=0; i < U_DIM; ++i) {
+			U[t](i) = std::min(u_max(i), std::max(u_min(i), U[t](i) + distribution(generator)));
+		}
+		J[t+1] = sys.dynfunc(J[t], U[t], vec<Q_DIM>::Zero());
+	}
+}
+
+/**
+ * \brief Runs cfg::num_starts collocations in parallel, the first from (J,U)
+ *        and the rest from perturbed guesses, and keeps the best trajectory
+ */
+double planar_multistart_minimize_merit(std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>& J,
+		std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U,
+		const mat<J_DIM,J_DIM>& j_sigma0,
+		const std::vector<PlanarGaussian>& planar_gmm, const MatrixP& P,
+		PlanarSystem& sys, planarMPC_params &problem, planarMPC_output &output, planarMPC_info &info) {
+	if (cfg::num_starts <= 1) {
+		return planar_minimize_merit(J, U, j_sigma0, planar_gmm, P, sys, problem, output, info);
+	}
+
+	util::MultiStart<PlanarTrajectory> multistart(util::MultiStartConfig(cfg::num_starts, 0, cfg::multistart_cancel_margin));
+
+	PlanarTrajectory best;
+	best.J = J; best.U = U;
+	vec<J_DIM> j0 = J[0];
+
+	// each start gets its own system, so no state is shared between concurrent starts.
+	// Copied (and destroyed) on this thread, since the copies hold python objects
+	std::vector<PlanarSystem, aligned_allocator<PlanarSystem>> start_sys(cfg::num_starts, sys);
+
+	double cost = multistart.run(
+			[&](const util::MultiStartContext& ctx, PlanarTrajectory& traj) {
+				if (ctx.start > 0) {
+					multistart_init_collocation(j0, planar_gmm, start_sys[ctx.start], ctx, traj.J, traj.U);
+				}
+			},
+			[&](util::MultiStartContext& ctx, PlanarTrajectory& traj) -> double {
+				PlanarSystem& sys_k = start_sys[ctx.start];
+				planar_minimize_merit(traj.J, traj.U, j_sigma0, planar_gmm, P, sys_k, problem, output, info, &ctx);
+				if (ctx.is_cancelled()) {
+					return INFINITY;
+				}
+				// starts leave the alpha schedule at different alphas (cfg::alpha_epsilon),
+				// so they are compared at the final one of the schedule
+#ifdef USE_GMM_COST
+				return sys_k.cost_gmm(traj.J, j_sigma0, traj.U, planar_gmm, cfg::alpha_final);
+#else
+				return sys_k.cost_entropy(traj.J, traj.U, P, cfg::alpha_final);
+#endif
+			}, best);
+
+	J = best.J; U = best.U;
+	return cost;
+}
+
 int main(int argc, char* argv[]) {
 //	srand(time(0));
 
@@ -565,7 +685,7 @@ int main(int argc, char* argv[]) {
 	std::cout << "object: " << object.transpose() << "\n";
 	std::cout << "j0: " << j0.transpose() << "\n";
 
-	mat<C_DIM,M_DIM> P0;
+	MatrixP P0(C_DIM, M_DIM);
 	for(int m=0; m < M_DIM; ++m) {
 		P0(0, m) = planar_utils::uniform(-10, 10);
 		P0(1, m) = planar_utils::uniform(2, 11);
@@ -580,7 +700,7 @@ int main(int argc, char* argv[]) {
 	// track real states
 	std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>> J_real(1, j0_real);
 	// particle filter
-	std::vector<mat<C_DIM,M_DIM>, aligned_allocator<mat<C_DIM,M_DIM>>> pf_tracker(1, P0);
+	std::vector<MatrixP> pf_tracker(1, P0);
 
 	// initialize FORCES variables
 	planarMPC_params problem;
@@ -603,7 +723,7 @@ int main(int argc, char* argv[]) {
 
 		// optimize
 		util::Timer_tic(&forces_timer);
-		double cost = planar_minimize_merit(J, U, j_sigma0, planar_gmm, P0, sys, problem, output, info);
+		double cost = planar_multistart_minimize_merit(J, U, j_sigma0, planar_gmm, P0, sys, problem, output, info);
 		double forces_time = util::Timer_toc(&forces_timer);
 
 		LOG_INFO("Optimized cost: %4.5f", cost);
@@ -617,7 +737,7 @@ int main(int argc, char* argv[]) {
 		sys.display(J, planar_gmm);
 
 		vec<J_DIM> j_tp1_real, j_tp1;
-		mat<C_DIM,M_DIM> P_tp1;
+		MatrixP P_tp1;
 		sys.execute_control_step(J_real.back(), j0, U[0], P0,
 				j_tp1_real, j_tp1, P_tp1);
 
@@ -340,6 +340,203 @@ double Beam::area() {
 	return fabs((base(0)*(a(1) - b(1)) + a(0)*(b(1) - base(1)) + b(0)*(base(1) - a(1))) / 2.0);
 }
 
+/**
+ * Batch helpers, evaluate one segment or beam for all points (x(m), y(m)) at once
+ * with the same arithmetic as the Segment and Beam methods
+ */
+
+static ArrayXd segment_distances(const Segment& s, const ArrayXd& x, const ArrayXd& y) {
+	// t as in Segment::closest_point_to, NaN t (degenerate segment) falls back to the end points
+	Vector2d v = s.p1 - s.p0;
+	ArrayXd t = -(v(0)*(s.p0(0) - x) + v(1)*(s.p0(1) - y)) / v.dot(v);
+
+	ArrayXd dx = t*v(0) + s.p0(0) - x, dy = t*v(1) + s.p0(1) - y;
+	ArrayXd dist_line = (dx*dx + dy*dy).sqrt();
+	ArrayXd dist_p0 = ((x - s.p0(0)).square() + (y - s.p0(1)).square()).sqrt();
+	ArrayXd dist_p1 = ((x - s.p1(0)).square() + (y - s.p1(1)).square()).sqrt();
+
+	return ((t >= 0) && (t <= 1)).select(dist_line, dist_p0.min(dist_p1));
+}
+
+// area of Beam(base, a, (x,y)), whose constructor orders a and the point by angle from base
+// (compared as slopes, atan is monotonic)
+static ArrayXd beam_areas(const Vector2d& base, const Vector2d& a, const ArrayXd& x, const ArrayXd& y) {
+	double a_slope = (a(1) - base(1))/(a(0) - base(0));
+	ArrayXd p_slope = (y - base(1))/(x - base(0));
+
+	ArrayXd area_ap = (base(0)*(a(1) - y) + a(0)*(y - base(1)) + x*(base(1) - a(1))).abs() / 2.0;
+	ArrayXd area_pa = (base(0)*(y - a(1)) + x*(a(1) - base(1)) + a(0)*(base(1) - y)).abs() / 2.0;
+
+	return (a_slope < p_slope).select(area_ap, area_pa);
+}
+
+// Beam::is_inside for all points
+static Array<bool,Dynamic,1> beam_is_inside(const Beam& beam, const ArrayXd& x, const ArrayXd& y) {
+	const Vector2d &base = beam.base, &a = beam.a, &b = beam.b;
+	double total_area = fabs((base(0)*(a(1) - b(1)) + a(0)*(b(1) - base(1)) + b(0)*(base(1) - a(1))) / 2.0);
+	ArrayXd area_sum = beam_areas(base, a, x, y) + beam_areas(base, b, x, y) + beam_areas(a, b, x, y);
+
+	ArrayXd min_dist_to_side = segment_distances(Segment(base, a), x, y).min(
+			segment_distances(Segment(a, b), x, y).min(
+			segment_distances(Segment(base, b), x, y)));
+
+	return ((total_area - area_sum).abs() < epsilon) && (min_dist_to_side > epsilon);
+}
+
+// points per cell the batched queries bucket into
+static const int POINTS_PER_CELL = 32;
+
+/**
+ * Uniform grid over the bounding box of a batch of points, with the point indices
+ * bucketed by cell so a batched query only evaluates the segments and beams near a cell
+ */
+class PointGrid {
+public:
+	PointGrid(const Matrix<double,2,Dynamic>& P) {
+		int M = P.cols();
+		n = std::max(1, int(sqrt(M / double(POINTS_PER_CELL))));
+		lo = P.rowwise().minCoeff();
+		cell_size = (P.rowwise().maxCoeff() - lo) / n;
+		cell_size = (cell_size.array() > 0).select(cell_size, 1);
+
+		std::vector<int> cell(M);
+		cell_begin.assign(n*n + 1, 0);
+		for(int m=0; m < M; ++m) {
+			cell[m] = index(P.col(m));
+			++cell_begin[cell[m] + 1];
+		}
+		for(int c=0; c < n*n; ++c) {
+			cell_begin[c+1] += cell_begin[c];
+		}
+		order.resize(M);
+		std::vector<int> next(cell_begin.begin(), cell_begin.end() - 1);
+		for(int m=0; m < M; ++m) {
+			order[next[cell[m]]++] = m;
+		}
+	}
+
+	int num_cells() const { return n*n; }
+	int begin(int c) const { return cell_begin[c]; }
+	int end(int c) const { return cell_begin[c+1]; }
+	int point(int i) const { return order[i]; }
+
+	AlignedBox2d cell_box(int c) const {
+		Vector2d cell_lo = lo + Vector2d(c / n, c % n).cwiseProduct(cell_size);
+		return AlignedBox2d(cell_lo, cell_lo + cell_size);
+	}
+
+private:
+	int n; // cells per side
+	Vector2d lo, cell_size;
+	std::vector<int> order, cell_begin; // points of cell c are order[cell_begin[c]] until order[cell_begin[c+1]]
+
+	int index(const Vector2d& p) const {
+		Vector2i i = ((p - lo).cwiseQuotient(cell_size)).cast<int>().cwiseMax(0).cwiseMin(n-1);
+		return i(1) + i(0)*n;
+	}
+};
+
+/**
+ * Bounding box of a beam, grown so no point outside it passes the area test of
+ * Beam::is_inside. A point at distance d outside the triangle adds at least
+ * d * min side length * sin(min angle / 2) to the summed areas.
+ */
+static AlignedBox2d beam_box(const Beam& beam) {
+	const Vector2d v[3] = {beam.base, beam.a, beam.b};
+	AlignedBox2d box(v[0]);
+	double min_length = INFINITY, min_sin_half_angle = 1;
+	for(int i=0; i < 3; ++i) {
+		box.extend(v[i]);
+		Vector2d u = v[(i+1)%3] - v[i], w = v[(i+2)%3] - v[i];
+		double cos_angle = u.dot(w) / (u.norm()*w.norm());
+		min_length = std::min(min_length, u.norm());
+		min_sin_half_angle = std::min(min_sin_half_angle, sqrt(std::max(0.0, (1 - cos_angle)/2)));
+	}
+
+	double pad = 2*epsilon / (min_length*min_sin_half_angle);
+	if (!(pad < INFINITY)) {
+		pad = INFINITY; // degenerate beam, always evaluated
+	}
+	box.min().array() -= pad;
+	box.max().array() += pad;
+	return box;
+}
+
+/**
+ * Batched is_inside and, if sd is not NULL, signed_distance. Per cell of a PointGrid
+ * only the beams whose grown box reaches the cell are tested, and only the border
+ * segments that can be closest to a point in the cell are measured.
+ */
+static void batch_query(const Matrix<double,2,Dynamic>& P, std::vector<Beam>& beams,
+		Array<bool,Dynamic,1>& inside, VectorXd* sd) {
+	PointGrid grid(P);
+
+	std::vector<AlignedBox2d> beam_boxes(beams.size());
+	for(int i=0; i < beams.size(); ++i) {
+		beam_boxes[i] = beam_box(beams[i]);
+	}
+
+	std::vector<Segment> border;
+	std::vector<AlignedBox2d> border_boxes;
+	if (sd != NULL) {
+		border = geometry2d::beams_border(beams);
+		for(int i=0; i < border.size(); ++i) {
+			border_boxes.push_back(AlignedBox2d(border[i].p0.cwiseMin(border[i].p1), border[i].p0.cwiseMax(border[i].p1)));
+		}
+		sd->resize(P.cols());
+	}
+	inside.resize(P.cols());
+
+	ArrayXd x, y, dist;
+	Array<bool,Dynamic,1> cell_inside;
+	for(int c=0; c < grid.num_cells(); ++c) {
+		int num_points = grid.end(c) - grid.begin(c);
+		if (num_points == 0) { continue; }
+
+		x.resize(num_points);
+		y.resize(num_points);
+		for(int i=0; i < num_points; ++i) {
+			x(i) = P(0, grid.point(grid.begin(c) + i));
+			y(i) = P(1, grid.point(grid.begin(c) + i));
+		}
+		AlignedBox2d box = grid.cell_box(c);
+
+		cell_inside = Array<bool,Dynamic,1>::Constant(num_points, false);
+		for(int b=0; b < beams.size(); ++b) {
+			if (beam_boxes[b].intersects(box)) {
+				cell_inside = cell_inside || beam_is_inside(beams[b], x, y);
+			}
+		}
+
+		if (sd != NULL) {
+			// distance to a segment is convex, so it is largest over the cell at a corner
+			double max_dist = INFINITY;
+			for(int s=0; s < border.size(); ++s) {
+				double max_dist_s = 0;
+				for(int k=0; k < 4; ++k) {
+					max_dist_s = std::max(max_dist_s, border[s].distance_to(box.corner(AlignedBox2d::CornerType(k))));
+				}
+				max_dist = std::min(max_dist, max_dist_s);
+			}
+
+			dist = ArrayXd::Constant(num_points, INFINITY);
+			for(int s=0; s < border.size(); ++s) {
+				if (border_boxes[s].exteriorDistance(box) <= (1 + 1e-9)*max_dist) {
+					dist = dist.min(segment_distances(border[s], x, y));
+				}
+			}
+		}
+
+		for(int i=0; i < num_points; ++i) {
+			int m = grid.point(grid.begin(c) + i);
+			inside(m) = cell_inside(i);
+			if (sd != NULL) {
+				(*sd)(m) = (cell_inside(i)) ? -dist(i) : dist(i);
+			}
+		}
+	}
+}
+
 /**
  * Functions
  */
@@ -358,6 +555,24 @@ double signed_distance(const Vector2d& p, std::vector<Beam>& beams) {
 	return sd_sign*dist;
 }
 
+double signed_distance(const Vector2d& p, std::vector<Beam>& beams, Vector2d& grad) {
+	double sd_sign = (is_inside(p, beams)) ? -1 : 1;
+
+	std::vector<Segment> border = beams_border(beams);
+	double dist = INFINITY;
+	Vector2d closest = p;
+	for(int i=0; i < border.size(); ++i) {
+		double dist_i = border[i].distance_to(p);
+		if (dist_i < dist) {
+			dist = dist_i;
+			closest = border[i].closest_point_to(p);
+		}
+	}
+
+	grad = (dist > 0) ? Vector2d(sd_sign*(p - closest)/dist) : Vector2d::Zero();
+	return sd_sign*dist;
+}
+
 bool is_inside(const Vector2d& p, std::vector<Beam>& beams) {
 	bool inside = false;
 	for(int i=0; i < beams.size(); ++i) {
@@ -366,6 +581,15 @@ bool is_inside(const Vector2d& p, std::vector<Beam>& beams) {
 	return inside;
 }
 
+void signed_distance(const Matrix<double,2,Dynamic>& P, std::vector<Beam>& beams, VectorXd& sd) {
+	Array<bool,Dynamic,1> inside;
+	batch_query(P, beams, inside, &sd);
+}
+
+void is_inside(const Matrix<double,2,Dynamic>& P, std::vector<Beam>& beams, Array<bool,Dynamic,1>& inside) {
+	batch_query(P, beams, inside, NULL);
+}
+
 // NOTE: assumes beams are sorted from right to left
 std::vector<Segment> beams_border(const std::vector<Beam>& beams) {
 	std::vector<Segment> segments;
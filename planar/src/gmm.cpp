@@ -1,13 +1,25 @@
 #include "../include/gmm.h"
 
+#include <cstring>
+#include <unordered_set>
+
 namespace gmm {
 
+// converged seeds closer than this are the same mode
+const double MODE_MERGE_DIST = .05;
+
 void fit_gaussians_to_pf(const MatrixXd& P, std::vector<VectorXd>& obj_means, std::vector<MatrixXd>& obj_covs,
 		std::vector<MatrixXd>& obj_particles) {
+	ModeFinder mode_finder;
+	fit_gaussians_to_pf(P, mode_finder, obj_means, obj_covs, obj_particles);
+}
+
+void fit_gaussians_to_pf(const MatrixXd& P, ModeFinder& mode_finder, std::vector<VectorXd>& obj_means,
+		std::vector<MatrixXd>& obj_covs, std::vector<MatrixXd>& obj_particles) {
 	// find modes and associated particles
 	std::vector<VectorXd> modes;
 	std::vector<std::vector<int>> mode_particle_indices;
-	find_modes(P, modes, mode_particle_indices);
+	mode_finder.find_modes(P, modes, mode_particle_indices);
 
 	// create matrices from associated mode_particle_indices
 	// and then calculate covariance
@@ -31,36 +43,335 @@ void fit_gaussians_to_pf(const MatrixXd& P, std::vector<VectorXd>& obj_means, st
 void find_modes(const MatrixXd& P,
 		std::vector<VectorXd>& modes,
 		std::vector<std::vector<int>>& mode_particle_indices) {
-	for(int m=0; m < P.cols(); ++m) {
-		VectorXd nearest_mode = find_nearest_mode(P.col(m), P);
+	ModeFinder mode_finder;
+	mode_finder.find_modes(P, modes, mode_particle_indices);
+}
+
+/**
+ * Mean-shift from p over all particles, without truncating the kernel
+ */
+VectorXd find_nearest_mode(const VectorXd& p, const MatrixXd& P) {
+	VectorXd new_mean = p, mean = INFINITY*VectorXd::Ones(p.rows(), p.cols());
+
+	while((mean - new_mean).norm() > 1e-3) {
+		mean = new_mean;
+		VectorXd kernel_weight = (-(1/1)*(P.colwise() - mean).colwise().norm()).array().exp(); // TODO: window size
+		new_mean = kernel_weight.transpose().replicate(2,1).cwiseProduct(P).rowwise().sum() / kernel_weight.sum();
+	}
+
+	return mean;
+}
+
+/**
+ * ModeFinder
+ */
+
+ModeFinder::ModeFinder(util::ThreadPool* pool, double bandwidth, double min_kernel, double tolerance) :
+		pool(pool), bandwidth(bandwidth), support(-bandwidth*log(min_kernel)), tolerance(tolerance) { }
+
+void ModeFinder::find_modes(const MatrixXd& P,
+		std::vector<VectorXd>& modes,
+		std::vector<std::vector<int>>& mode_particle_indices) {
+	int dim = P.rows(), M = P.cols();
+	modes.clear();
+	mode_particle_indices.clear();
+	if (M == 0) { return; }
+
+	build_grid(P);
+
+	// warm start from the previous modes
+	std::vector<VectorXd> seeds = previous_modes;
+	shift_seeds(P, seeds);
+	merge_modes(seeds, modes);
+
+	// then one particle per bandwidth-sized cell that no mode accounts for yet
+	seeds.clear();
+	std::unordered_set<uint64_t> seeded_cells;
+	std::vector<int> cell(dim);
+	for(int m=0; m < M; ++m) {
+		for(int d=0; d < dim; ++d) {
+			cell[d] = int(floor(P(d,m) / bandwidth));
+		}
+		if (!seeded_cells.insert(cell_key(&cell[0], dim)).second) { continue; }
+
+		bool near_mode = false;
+		for(int i=0; (i < modes.size()) && !near_mode; ++i) {
+			near_mode = ((P.col(m) - modes[i]).norm() < bandwidth);
+		}
+		if (!near_mode) {
+			seeds.push_back(P.col(m));
+		}
+	}
+	shift_seeds(P, seeds);
+	merge_modes(seeds, modes);
 
-		bool nearest_mode_exists = false;
+	// assign particles to their nearest mode and drop modes without any
+	std::vector<std::vector<int>> indices(modes.size());
+	for(int m=0; m < M; ++m) {
+		int nearest = 0;
+		double nearest_dist = INFINITY;
 		for(int i=0; i < modes.size(); ++i) {
-			if ((modes[i] - nearest_mode).norm() < .05) {
-				mode_particle_indices[i].push_back(m);
-				nearest_mode_exists = true;
-				break;
+			double dist = (P.col(m) - modes[i]).squaredNorm();
+			if (dist < nearest_dist) {
+				nearest = i;
+				nearest_dist = dist;
 			}
 		}
+		indices[nearest].push_back(m);
+	}
 
-		if (!nearest_mode_exists) {
-			modes.push_back(nearest_mode);
-			mode_particle_indices.push_back(std::vector<int>());
+	std::vector<VectorXd> occupied_modes;
+	for(int i=0; i < modes.size(); ++i) {
+		if (indices[i].size() > 0) {
+			occupied_modes.push_back(modes[i]);
+			mode_particle_indices.push_back(indices[i]);
 		}
 	}
+	modes = occupied_modes;
+	previous_modes = modes;
 }
 
-VectorXd find_nearest_mode(const VectorXd& p, const MatrixXd& P) {
-	VectorXd new_mean = p, mean = INFINITY*VectorXd::Ones(p.rows(), p.cols());
+/**
+ * Mean-shift from p over the particles within the kernel support, build_grid(P) first
+ */
+VectorXd ModeFinder::find_nearest_mode(const VectorXd& p, const MatrixXd& P) const {
+	int dim = P.rows();
+	int num_neighbors = 1;
+	for(int d=0; d < dim; ++d) { num_neighbors *= 3; }
 
-	while((mean - new_mean).norm() > 1e-3) {
+	VectorXd new_mean = p, mean = INFINITY*VectorXd::Ones(dim), sum(dim);
+	std::vector<int> center(dim), cell(dim);
+	std::vector<uint64_t> keys(num_neighbors);
+
+	while((mean - new_mean).norm() > tolerance) {
 		mean = new_mean;
-		VectorXd kernel_weight = (-(1/1)*(P.colwise() - mean).colwise().norm()).array().exp(); // TODO: window size
-		new_mean = kernel_weight.transpose().replicate(2,1).cwiseProduct(P).rowwise().sum() / kernel_weight.sum();
+
+		// cells around the mean, without repeats in case of hash collisions
+		for(int d=0; d < dim; ++d) {
+			center[d] = int(floor(mean(d) / support));
+		}
+		for(int k=0; k < num_neighbors; ++k) {
+			for(int d=0, c=k; d < dim; ++d, c /= 3) {
+				cell[d] = center[d] + c % 3 - 1;
+			}
+			keys[k] = cell_key(&cell[0], dim);
+		}
+		std::sort(keys.begin(), keys.end());
+		int num_keys = std::unique(keys.begin(), keys.end()) - keys.begin();
+
+		sum.setZero();
+		double total_weight = 0;
+		for(int k=0; k < num_keys; ++k) {
+			auto range = cells.find(keys[k]);
+			if (range == cells.end()) { continue; }
+
+			for(int j=range->second.first; j < range->second.second; ++j) {
+				const double* x = P.data() + cell_particles[j]*dim;
+				double dist_sq = 0;
+				for(int d=0; d < dim; ++d) {
+					dist_sq += (x[d] - mean(d))*(x[d] - mean(d));
+				}
+				if (dist_sq < support*support) {
+					double weight = exp(-sqrt(dist_sq) / bandwidth);
+					for(int d=0; d < dim; ++d) {
+						sum(d) += weight*x[d];
+					}
+					total_weight += weight;
+				}
+			}
+		}
+
+		// no particles within the support, stays put
+		new_mean = (total_weight > 0) ? VectorXd(sum / total_weight) : mean;
 	}
 
 	return mean;
 }
 
+void ModeFinder::build_grid(const MatrixXd& P) {
+	int dim = P.rows(), M = P.cols();
+
+	std::vector<std::pair<uint64_t,int>> keyed(M);
+	std::vector<int> cell(dim);
+	for(int m=0; m < M; ++m) {
+		for(int d=0; d < dim; ++d) {
+			cell[d] = int(floor(P(d,m) / support));
+		}
+		keyed[m] = std::make_pair(cell_key(&cell[0], dim), m);
+	}
+	std::sort(keyed.begin(), keyed.end());
+
+	cell_particles.resize(M);
+	cells.clear();
+	for(int j=0; j < M; ++j) {
+		cell_particles[j] = keyed[j].second;
+		if ((j == 0) || (keyed[j].first != keyed[j-1].first)) {
+			cells[keyed[j].first] = std::make_pair(j, j);
+		}
+		cells[keyed[j].first].second = j+1;
+	}
+}
+
+uint64_t ModeFinder::cell_key(const int* cell, int dim) const {
+	uint64_t key = 0xcbf29ce484222325ULL;
+	for(int d=0; d < dim; ++d) {
+		key = (key ^ uint64_t(uint32_t(cell[d]))) * 0x100000001B3ULL; // FNV-1a style mixing
+	}
+	return key;
+}
+
+void ModeFinder::shift_seeds(const MatrixXd& P, std::vector<VectorXd>& seeds) const {
+	auto shift = [&](int s) { seeds[s] = find_nearest_mode(seeds[s], P); };
+	if ((pool != NULL) && (seeds.size() > 1)) {
+		pool->parallel_for(0, seeds.size(), shift);
+	} else {
+		for(int s=0; s < seeds.size(); ++s) { shift(s); }
+	}
+}
+
+void ModeFinder::merge_modes(const std::vector<VectorXd>& converged, std::vector<VectorXd>& modes) const {
+	for(int s=0; s < converged.size(); ++s) {
+		bool mode_exists = false;
+		for(int i=0; (i < modes.size()) && !mode_exists; ++i) {
+			mode_exists = ((modes[i] - converged[s]).norm() < MODE_MERGE_DIST);
+		}
+		if (!mode_exists) {
+			modes.push_back(converged[s]);
+		}
+	}
+}
+
+/**
+ * MixtureTracker
+ */
+
+MixtureTracker::MixtureTracker(util::ThreadPool* pool, double bandwidth) :
+		mode_finder(pool, bandwidth), bandwidth(bandwidth), refits(0) { }
+
+void MixtureTracker::fit(const MatrixXd& P) {
+	int dim = P.rows();
+	std::vector<VectorXd> mode_positions;
+	std::vector<std::vector<int>> mode_particle_indices;
+	mode_finder.find_modes(P, mode_positions, mode_particle_indices);
+
+	particles = P;
+	labels.assign(P.cols(), 0);
+	modes.resize(mode_positions.size());
+	for(int i=0; i < modes.size(); ++i) {
+		Mode& mode = modes[i];
+		mode.mode = mode_positions[i];
+		mode.sum = VectorXd::Zero(dim);
+		mode.sum_sq = MatrixXd::Zero(dim, dim);
+		mode.count = mode_particle_indices[i].size();
+		for(int j=0; j < mode_particle_indices[i].size(); ++j) {
+			int m = mode_particle_indices[i][j];
+			VectorXd offset = P.col(m) - mode.mode;
+			mode.sum += offset;
+			mode.sum_sq += offset*offset.transpose();
+			labels[m] = i;
+		}
+	}
+	++refits;
+}
+
+bool MixtureTracker::tracks(const MatrixXd& P) const {
+	return (P.rows() == particles.rows()) && (P.cols() == particles.cols()) && (P.cols() == labels.size()) &&
+			(memcmp(P.data(), particles.data(), P.size()*sizeof(double)) == 0);
+}
+
+void MixtureTracker::resample(const MatrixXd& P_sampled, const std::vector<int>& ancestors) {
+	int M = particles.cols();
+	if (labels.size() != M) {
+		fit(P_sampled);
+		return;
+	}
+
+	std::vector<int> copies(M, 0);
+	for(int m=0; m < ancestors.size(); ++m) {
+		++copies[ancestors[m]];
+	}
+
+	// only the particles not kept exactly once change the sums
+	for(int i=0; i < M; ++i) {
+		if (copies[i] != 1) {
+			Mode& mode = modes[labels[i]];
+			double extra = copies[i] - 1;
+			VectorXd offset = particles.col(i) - mode.mode;
+			mode.count += extra;
+			mode.sum += extra*offset;
+			mode.sum_sq += extra*(offset*offset.transpose());
+		}
+	}
+
+	std::vector<int> sampled_labels(ancestors.size());
+	for(int m=0; m < ancestors.size(); ++m) {
+		sampled_labels[m] = labels[ancestors[m]];
+	}
+	labels.swap(sampled_labels);
+	particles = P_sampled;
+
+	drop_empty_modes();
+	if (needs_refit()) {
+		fit(P_sampled);
+	}
+}
+
+void MixtureTracker::get_gaussians(std::vector<VectorXd>& obj_means, std::vector<MatrixXd>& obj_covs,
+		std::vector<MatrixXd>& obj_particles) const {
+	obj_means.clear();
+	obj_covs.clear();
+	obj_particles.clear();
+
+	std::vector<int> filled(modes.size(), 0);
+	for(int i=0; i < modes.size(); ++i) {
+		obj_means.push_back(modes[i].mean());
+		obj_covs.push_back(modes[i].cov(bandwidth));
+		obj_particles.push_back(MatrixXd(particles.rows(), int(modes[i].count + .5)));
+	}
+	for(int m=0; m < labels.size(); ++m) {
+		obj_particles[labels[m]].col(filled[labels[m]]++) = particles.col(m);
+	}
+}
+
+void MixtureTracker::drop_empty_modes() {
+	std::vector<int> relabel(modes.size(), -1);
+	std::vector<Mode> kept;
+	for(int i=0; i < modes.size(); ++i) {
+		// counts are sums of integers, so an empty mode is below .5
+		if (modes[i].count > .5) {
+			relabel[i] = kept.size();
+			kept.push_back(modes[i]);
+		}
+	}
+	if (kept.size() == modes.size()) { return; }
+
+	modes.swap(kept);
+	for(int m=0; m < labels.size(); ++m) {
+		labels[m] = relabel[labels[m]];
+	}
+}
+
+bool MixtureTracker::needs_refit() const {
+	// merge: two means within a bandwidth
+	std::vector<VectorXd> means(modes.size());
+	for(int i=0; i < modes.size(); ++i) {
+		means[i] = modes[i].mean();
+		for(int j=0; j < i; ++j) {
+			if ((means[i] - means[j]).norm() < bandwidth) { return true; }
+		}
+	}
+
+	// split: a mean drifted from its mode, or no particle left near the mode
+	std::vector<bool> supported(modes.size(), false);
+	for(int m=0; m < labels.size(); ++m) {
+		const Mode& mode = modes[labels[m]];
+		supported[labels[m]] = supported[labels[m]] || ((particles.col(m) - mode.mode).norm() < bandwidth);
+	}
+	for(int i=0; i < modes.size(); ++i) {
+		if (!supported[i] || ((means[i] - modes[i].mode).norm() > bandwidth)) { return true; }
+	}
+
+	return false;
+}
 
 }
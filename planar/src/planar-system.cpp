@@ -78,15 +78,25 @@ vec<Z_DIM> PlanarSystem::obsfunc(const vec<J_DIM>& j, const vec<C_DIM>& object,
 }
 
 
-mat<Z_DIM,Z_DIM> PlanarSystem::delta_matrix(const vec<J_DIM>& j, const vec<C_DIM>& object, const double alpha) {
+/**
+ * \brief Delta determined by the signed distance of the object from the field of view,
+ *        from the linearization lsd when one is given
+ */
+mat<Z_DIM,Z_DIM> PlanarSystem::delta_matrix(const vec<J_DIM>& j, const vec<C_DIM>& object, const double alpha,
+		const LinearizedSignedDistance* lsd) {
 	mat<Z_DIM,Z_DIM> delta = mat<Z_DIM,Z_DIM>::Zero();
 
 	for(int i=0; i < J_DIM; ++i) {
 		delta(i, i) = 1; // TODO: should this depend on SD of link segments?
 	}
 
-	std::vector<Beam> fov = get_fov(j);
-	double sd = geometry2d::signed_distance(object, fov);
+	double sd;
+	if (lsd != NULL) {
+		sd = lsd->signed_distance(j, object);
+	} else {
+		std::vector<Beam> fov = get_fov(j);
+		sd = geometry2d::signed_distance(object, fov);
+	}
 	double sd_sigmoid = 1.0 - 1.0/(1.0 + exp(-alpha*sd));
 	for(int i=J_DIM; i < X_DIM; ++i) {
 		delta(i, i) = sd_sigmoid;
@@ -99,7 +109,7 @@ mat<Z_DIM,Z_DIM> PlanarSystem::delta_matrix(const vec<J_DIM>& j, const vec<C_DIM
  * \brief Propagates belief through EKF with max-likelihood noise assumption
  */
 void PlanarSystem::belief_dynamics(const vec<X_DIM>& x_t, const mat<X_DIM,X_DIM>& sigma_t, const vec<U_DIM>& u_t, const double alpha,
-		vec<X_DIM>& x_tp1, mat<X_DIM,X_DIM>& sigma_tp1) {
+		vec<X_DIM>& x_tp1, mat<X_DIM,X_DIM>& sigma_tp1, const LinearizedSignedDistance* lsd) {
 	// propagate dynamics
 	x_tp1 = x_t;
 	x_tp1.segment<J_DIM>(0) = dynfunc(x_t.segment<J_DIM>(0), u_t, vec<Q_DIM>::Zero());
@@ -116,13 +126,13 @@ void PlanarSystem::belief_dynamics(const vec<X_DIM>& x_t, const mat<X_DIM,X_DIM>
 	mat<Z_DIM,R_DIM> N = mat<Z_DIM,R_DIM>::Zero();
 	linearize_obsfunc(x_tp1, vec<R_DIM>::Zero(), H, N);
 
-	mat<Z_DIM,Z_DIM> delta = delta_matrix(x_tp1.segment<J_DIM>(0), x_tp1.segment<C_DIM>(J_DIM), alpha);
+	mat<Z_DIM,Z_DIM> delta = delta_matrix(x_tp1.segment<J_DIM>(0), x_tp1.segment<C_DIM>(J_DIM), alpha, lsd);
 	mat<X_DIM,Z_DIM> K = sigma_tp1_bar*H.transpose()*delta*(delta*H*sigma_tp1_bar*H.transpose()*delta + R).inverse()*delta;
 	sigma_tp1 = (mat<X_DIM,X_DIM>::Identity() - K*H)*sigma_tp1_bar;
 }
 
-void PlanarSystem::execute_control_step(const vec<X_DIM>& x_t_real, const vec<X_DIM>& x_t_t, const mat<X_DIM,X_DIM>& sigma_t_t, const vec<U_DIM>& u_t, const mat<C_DIM,M_DIM>& P_t,
-			vec<X_DIM>& x_tp1_real, vec<X_DIM>& x_tp1_tp1, mat<X_DIM,X_DIM>& sigma_tp1_tp1, mat<C_DIM,M_DIM>& P_tp1) {
+void PlanarSystem::execute_control_step(const vec<X_DIM>& x_t_real, const vec<X_DIM>& x_t_t, const mat<X_DIM,X_DIM>& sigma_t_t, const vec<U_DIM>& u_t, const MatrixP& P_t,
+			vec<X_DIM>& x_tp1_real, vec<X_DIM>& x_tp1_tp1, mat<X_DIM,X_DIM>& sigma_tp1_tp1, MatrixP& P_tp1) {
 	// find next real state from input + noise
 	vec<Q_DIM> control_noise = vec<Q_DIM>::Zero();// + chol(.2*Q)*randn<vec>(Q_DIM);
 	vec<R_DIM> obs_noise = vec<R_DIM>::Zero();// + chol(.2*R)*randn<vec>(R_DIM);
@@ -159,8 +169,8 @@ void PlanarSystem::execute_control_step(const vec<X_DIM>& x_t_real, const vec<X_
 	update_particles(x_tp1_t.segment<J_DIM>(0), delta_real(0), z_tp1_real, P_t, P_tp1);
 }
 
-void PlanarSystem::execute_control_step(const vec<J_DIM>& j_t_real, const vec<J_DIM>& j_t, const vec<U_DIM>& u_t, const mat<C_DIM,M_DIM>& P_t,
-		vec<J_DIM>& j_tp1_real, vec<J_DIM>& j_tp1, mat<C_DIM,M_DIM>& P_tp1) {
+void PlanarSystem::execute_control_step(const vec<J_DIM>& j_t_real, const vec<J_DIM>& j_t, const vec<U_DIM>& u_t, const MatrixP& P_t,
+		vec<J_DIM>& j_tp1_real, vec<J_DIM>& j_tp1, MatrixP& P_tp1) {
 	// find next real state from input + noise
 	vec<Q_DIM> control_noise = vec<Q_DIM>::Zero();// + chol(.2*Q)*randn<vec>(Q_DIM);
 	vec<R_DIM> obs_noise = vec<R_DIM>::Zero();// + chol(.2*R)*randn<vec>(R_DIM);
@@ -295,7 +305,8 @@ void PlanarSystem::get_limits(vec<X_DIM>& x_min, vec<X_DIM>& x_max, vec<U_DIM>&
 }
 
 double PlanarSystem::cost(const std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>& J, const vec<C_DIM>& obj,
-		const mat<X_DIM,X_DIM>& sigma0, const std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U, const double alpha) {
+		const mat<X_DIM,X_DIM>& sigma0, const std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U, const double alpha,
+		const StdVectorLSD* lsd) {
 	double cost = 0;
 	int T = J.size();
 
@@ -303,7 +314,7 @@ double PlanarSystem::cost(const std::vector<vec<J_DIM>, aligned_allocator<vec<J_
 	mat<X_DIM,X_DIM> sigma_t = sigma0, sigma_tp1 = mat<X_DIM,X_DIM>::Zero();
 	for(int t=0; t < T-1; ++t) {
 		x_t << J[t], obj;
-		belief_dynamics(x_t, sigma_t, U[t], alpha, x_tp1, sigma_tp1);
+		belief_dynamics(x_t, sigma_t, U[t], alpha, x_tp1, sigma_tp1, (lsd != NULL) ? &(*lsd)[t+1] : NULL);
 		cost += alpha_control*U[t].dot(U[t]);
 		if (t < T-2) {
 			cost += alpha_belief*sigma_tp1.trace();
@@ -328,7 +339,7 @@ double PlanarSystem::cost(const std::vector<vec<J_DIM>, aligned_allocator<vec<J_
  */
 double PlanarSystem::cost_gmm(const std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>& J, const mat<J_DIM,J_DIM>& j_sigma0,
 			const std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U,
-			const std::vector<PlanarGaussian>& planar_gmm, const double alpha) {
+			const std::vector<PlanarGaussian>& planar_gmm, const double alpha, const std::vector<StdVectorLSD>* lsds) {
 	double cost_gmm = 0;
 
 	mat<X_DIM,X_DIM> sigma0 = mat<X_DIM,X_DIM>::Zero();
@@ -336,7 +347,7 @@ double PlanarSystem::cost_gmm(const std::vector<vec<J_DIM>, aligned_allocator<ve
 	for(int i=0; i < planar_gmm.size(); ++i) {
 		sigma0.block<C_DIM,C_DIM>(J_DIM,J_DIM) = planar_gmm[i].obj_cov;
 //		cost_gmm += planar_gmm[i].pct*cost(J, planar_gmm[i].obj_mean, sigma0, U, alpha);
-		cost_gmm += cost(J, planar_gmm[i].obj_mean, sigma0, U, alpha);
+		cost_gmm += cost(J, planar_gmm[i].obj_mean, sigma0, U, alpha, (lsds != NULL) ? &(*lsds)[i] : NULL);
 	}
 
 	return cost_gmm;
@@ -344,19 +355,21 @@ double PlanarSystem::cost_gmm(const std::vector<vec<J_DIM>, aligned_allocator<ve
 
 double PlanarSystem::cost_entropy(const std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>& J,
 		const std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U,
-		const mat<C_DIM,M_DIM>& P, const double alpha) {
+		const MatrixP& P, const double alpha) {
 	int T = J.size();
 	double entropy = 0;
 #define H_DIM 3
 
+	int M = P.cols();
 	vec<J_DIM> j_tp1;
-	std::vector<mat<H_DIM,M_DIM>, aligned_allocator<mat<H_DIM,M_DIM>>> H(T);
+	std::vector<MatrixXd> H(T, MatrixXd(H_DIM, M));
+	VectorXd sd(M);
 	for(int t=0; t < T-1; ++t) {
 		j_tp1 = dynfunc(J[t], U[t], vec<Q_DIM>::Zero());
 		std::vector<Beam> fov = get_fov(j_tp1);
-		for(int m=0; m < M_DIM; ++m) {
-			double sd = geometry2d::signed_distance(P.col(m), fov);
-			double delta = 1.0 - 1.0/(1.0 + exp(-alpha*sd));
+		geometry2d::signed_distance(P, fov, sd);
+		for(int m=0; m < M; ++m) {
+			double delta = 1.0 - 1.0/(1.0 + exp(-alpha*sd(m)));
 			H[t+1].col(m) << delta, P.col(m) - camera_origin;
 		}
 	}
@@ -366,11 +379,11 @@ double PlanarSystem::cost_entropy(const std::vector<vec<J_DIM>, aligned_allocato
 	mat<H_DIM,H_DIM> S = S_diag.asDiagonal();
 
 
-	vec<M_DIM> W_t = (1/double(M_DIM))*vec<M_DIM>::Ones(), W_tp1;
+	VectorXd W_t = (1/double(M))*VectorXd::Ones(M), W_tp1(M);
 	for(int t=1; t < T; ++t) {
 		W_tp1.setZero();
-		for(int m=0; m < M_DIM; ++m) {
-			for(int p=0; p < M_DIM; ++p) {
+		for(int m=0; m < M; ++m) {
+			for(int p=0; p < M; ++p) {
 				vec<H_DIM> v = H[t].col(m) - H[t].col(p);
 
 				/* Gauss likelihood */
@@ -402,6 +415,10 @@ vec<TOTAL_VARS> PlanarSystem::cost_grad(std::vector<vec<J_DIM>, aligned_allocato
 
 	vec<TOTAL_VARS> grad;
 
+	// a perturbation of J[t] or U[t] only moves the field of view at t+1
+	std::vector<StdVectorLSD> lsds;
+	linearize_signed_distances(J, U, std::vector<vec<C_DIM>, aligned_allocator<vec<C_DIM>>>(1, obj), lsds);
+
 	double orig, cost_p, cost_m;
 	int index = 0;
 	for(int t=0; t < T; ++t) {
@@ -409,10 +426,10 @@ vec<TOTAL_VARS> PlanarSystem::cost_grad(std::vector<vec<J_DIM>, aligned_allocato
 			orig = J[t][i];
 
 			J[t][i] = orig + step;
-			cost_p = cost(J, obj, sigma0, U, alpha);
+			cost_p = cost(J, obj, sigma0, U, alpha, &lsds[0]);
 
 			J[t][i] = orig - step;
-			cost_m = cost(J, obj, sigma0, U, alpha);
+			cost_m = cost(J, obj, sigma0, U, alpha, &lsds[0]);
 
 			grad(index++) = (cost_p - cost_m) / (2*step);
 		}
@@ -422,15 +439,16 @@ vec<TOTAL_VARS> PlanarSystem::cost_grad(std::vector<vec<J_DIM>, aligned_allocato
 				orig = U[t][i];
 
 				U[t][i] = orig + step;
-				cost_p = cost(J, obj, sigma0, U, alpha);
+				cost_p = cost(J, obj, sigma0, U, alpha, &lsds[0]);
 
 				U[t][i] = orig - step;
-				cost_m = cost(J, obj, sigma0, U, alpha);
+				cost_m = cost(J, obj, sigma0, U, alpha, &lsds[0]);
 
 				grad(index++) = (cost_p - cost_m) / (2*step);
 			}
 		}
 	}
+
 	return grad;
 }
 
@@ -441,6 +459,13 @@ vec<TOTAL_VARS> PlanarSystem::cost_gmm_grad(std::vector<vec<J_DIM>, aligned_allo
 
 	vec<TOTAL_VARS> grad;
 
+	std::vector<vec<C_DIM>, aligned_allocator<vec<C_DIM>>> objects;
+	for(int i=0; i < planar_gmm.size(); ++i) {
+		objects.push_back(planar_gmm[i].obj_mean);
+	}
+	std::vector<StdVectorLSD> lsds;
+	linearize_signed_distances(J, U, objects, lsds);
+
 	double orig, cost_p, cost_m;
 	int index = 0;
 	for(int t=0; t < T; ++t) {
@@ -448,10 +473,10 @@ vec<TOTAL_VARS> PlanarSystem::cost_gmm_grad(std::vector<vec<J_DIM>, aligned_allo
 			orig = J[t][i];
 
 			J[t][i] = orig + step;
-			cost_p = cost_gmm(J, j_sigma0, U, planar_gmm, alpha);
+			cost_p = cost_gmm(J, j_sigma0, U, planar_gmm, alpha, &lsds);
 
 			J[t][i] = orig - step;
-			cost_m = cost_gmm(J, j_sigma0, U, planar_gmm, alpha);
+			cost_m = cost_gmm(J, j_sigma0, U, planar_gmm, alpha, &lsds);
 
 			grad(index++) = (cost_p - cost_m) / (2*step);
 		}
@@ -461,21 +486,22 @@ vec<TOTAL_VARS> PlanarSystem::cost_gmm_grad(std::vector<vec<J_DIM>, aligned_allo
 				orig = U[t][i];
 
 				U[t][i] = orig + step;
-				cost_p = cost_gmm(J, j_sigma0, U, planar_gmm, alpha);
+				cost_p = cost_gmm(J, j_sigma0, U, planar_gmm, alpha, &lsds);
 
 				U[t][i] = orig - step;
-				cost_m = cost_gmm(J, j_sigma0, U, planar_gmm, alpha);
+				cost_m = cost_gmm(J, j_sigma0, U, planar_gmm, alpha, &lsds);
 
 				grad(index++) = (cost_p - cost_m) / (2*step);
 			}
 		}
 	}
+
 	return grad;
 }
 
 vec<TOTAL_VARS> PlanarSystem::cost_entropy_grad(std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>& J,
 		std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U,
-		const mat<C_DIM,M_DIM>& P, const double alpha) {
+		const MatrixP& P, const double alpha) {
 	int T = J.size();
 
 	vec<TOTAL_VARS> grad;
@@ -551,9 +577,10 @@ vec<TOTAL_VARS> PlanarSystem::cost_entropy_grad(std::vector<vec<J_DIM>, aligned_
 //}
 
 /**
- * First index of planar_gmm contains the most particles
+ * First index of planar_gmm contains the most particles. Refits only if P is not the
+ * particle set the tracked mixture followed through low_variance_sampler.
  */
-void PlanarSystem::fit_gaussians_to_pf(const mat<C_DIM,M_DIM>& P,
+void PlanarSystem::fit_gaussians_to_pf(const MatrixP& P,
 		std::vector<PlanarGaussian>& planar_gmm) {
 	planar_gmm.clear();
 
@@ -561,7 +588,10 @@ void PlanarSystem::fit_gaussians_to_pf(const mat<C_DIM,M_DIM>& P,
 	std::vector<VectorXd> obj_means_dyn;
 	std::vector<MatrixXd> obj_covs_dyn;
 	std::vector<MatrixXd> obj_particles_tmp;
-	gmm::fit_gaussians_to_pf(P, obj_means_dyn, obj_covs_dyn, obj_particles_tmp);
+	if (!gmm_tracker.tracks(P)) {
+		gmm_tracker.fit(P);
+	}
+	gmm_tracker.get_gaussians(obj_means_dyn, obj_covs_dyn, obj_particles_tmp);
 
 	// find Gaussian with most particles
 	int max_obj_index = -1;
@@ -580,7 +610,7 @@ void PlanarSystem::fit_gaussians_to_pf(const mat<C_DIM,M_DIM>& P,
 	obj_mean = obj_means_dyn[max_obj_index];
 	obj_cov = obj_covs_dyn[max_obj_index];
 	planar_gmm.push_back(PlanarGaussian(obj_mean, obj_cov,
-			obj_particles_tmp[max_obj_index], obj_particles_tmp[max_obj_index].cols()/double(M_DIM)));
+			obj_particles_tmp[max_obj_index], obj_particles_tmp[max_obj_index].cols()/double(P.cols())));
 
 	for(int i=0; i < obj_means_dyn.size(); ++i) {
 		int num_particles = obj_particles_tmp[i].cols();
@@ -588,19 +618,25 @@ void PlanarSystem::fit_gaussians_to_pf(const mat<C_DIM,M_DIM>& P,
 			obj_mean = obj_means_dyn[i];
 			obj_cov = obj_covs_dyn[i];
 			planar_gmm.push_back(PlanarGaussian(obj_mean, obj_cov,
-					obj_particles_tmp[i], num_particles/double(M_DIM)));
+					obj_particles_tmp[i], num_particles/double(P.cols())));
 		}
 	}
+
+	// same order as fit_gaussians_to_pf_figtree, highest pct first
+	std::stable_sort(planar_gmm.begin(), planar_gmm.end(),
+	          [](const PlanarGaussian& a, const PlanarGaussian& b) {
+	  return a.pct > b.pct;
+	});
 }
 
-void PlanarSystem::fit_gaussians_to_pf_figtree(const mat<C_DIM,M_DIM>& P,
+void PlanarSystem::fit_gaussians_to_pf_figtree(const MatrixP& P,
 		std::vector<PlanarGaussian>& planar_gmm) {
 	util::Timer figtree_timer;
 	util::Timer_tic(&figtree_timer);
 
 	int d = C_DIM;						 // dimension
-	int M = M_DIM; 						 // number of targets
-	int N = M_DIM; 						 // number of sources
+	int M = P.cols(); 					 // number of targets
+	int N = P.cols(); 					 // number of sources
 	double h = sqrt(2)*3; 				 // bandwith (h = sqrt(2)*sigma)
 	double epsilon = .1; 				 // 1e-2
 	double *x = new double[d*N]; 		 // source array
@@ -626,7 +662,7 @@ void PlanarSystem::fit_gaussians_to_pf_figtree(const mat<C_DIM,M_DIM>& P,
 		q[d*N+j] = 1;
 	}
 
-	mat<C_DIM,M_DIM> means = P, new_means;
+	MatrixP means = P, new_means(C_DIM, M);
 	double max_diff = INFINITY;
 	while(max_diff > 1e-3) {
 		for(int j=0; j < M; ++j) {
@@ -651,7 +687,7 @@ void PlanarSystem::fit_gaussians_to_pf_figtree(const mat<C_DIM,M_DIM>& P,
 
 	std::vector<vec<C_DIM>, aligned_allocator<vec<C_DIM>>> modes;
 	std::vector<std::vector<int>> mode_particle_indices;
-	for(int m=0; m < M_DIM; ++m) {
+	for(int m=0; m < M; ++m) {
 		bool is_new_mode = true;
 		for(int i=0; i < modes.size(); ++i) {
 			if ((means.col(m) - modes[i]).norm() < .05) {
@@ -685,7 +721,7 @@ void PlanarSystem::fit_gaussians_to_pf_figtree(const mat<C_DIM,M_DIM>& P,
 		MatrixXd obj_particles_centered = obj_particles.colwise() - obj_particles.rowwise().mean();
 		obj_cov = (1/(double(num_mode_particles)-1))*(obj_particles_centered*obj_particles_centered.transpose());
 
-		planar_gmm.push_back(PlanarGaussian(obj_mean, obj_cov, obj_particles, num_mode_particles/double(M_DIM)));
+		planar_gmm.push_back(PlanarGaussian(obj_mean, obj_cov, obj_particles, num_mode_particles/double(M)));
 	}
 
 	// sort with highest pct first
@@ -914,20 +950,215 @@ void PlanarSystem::linearize_obsfunc(const vec<X_DIM>& x, const vec<R_DIM>& r, m
 //	}
 }
 
-void PlanarSystem::update_particles(const vec<J_DIM>& j_tp1_t, const double delta_fov_real, const vec<Z_DIM>& z_tp1_real, const mat<C_DIM,M_DIM>& P_t,
-		mat<C_DIM,M_DIM>& P_tp1) {
+/**
+ * \brief Fills lsds[i][t+1] with the signed distance of objects[i] from
+ *        the field of view after J[t], U[t] and its gradients. The joint gradient
+ *        follows the closest border point as the joints move it (get_border_point_jac),
+ *        so get_fov is called once per timestep instead of once per cost evaluation.
+ *        Where that point is on a border segment get_border_segment_jac cannot tell
+ *        the origin of, or the border crosses itself, the joint gradient is central
+ *        differences of the signed distance.
+ */
+void PlanarSystem::linearize_signed_distances(const std::vector<vec<J_DIM>, aligned_allocator<vec<J_DIM>>>& J,
+		const std::vector<vec<U_DIM>, aligned_allocator<vec<U_DIM>>>& U,
+		const std::vector<vec<C_DIM>, aligned_allocator<vec<C_DIM>>>& objects,
+		std::vector<StdVectorLSD>& lsds) {
+	int T = J.size();
+	int num_objects = objects.size();
+
+	lsds.assign(num_objects, StdVectorLSD(T));
+	for(int t=0; t < T-1; ++t) {
+		vec<J_DIM> j_tp1 = dynfunc(J[t], U[t], vec<Q_DIM>::Zero());
+		std::vector<Beam> fov = get_fov(j_tp1);
+		std::vector<Segment> border = geometry2d::beams_border(fov);
+
+		// non-adjacent border segments crossing, where the border point jacobians do not hold
+		bool self_intersecting = false;
+		for(int a=0; (a < border.size()) && !self_intersecting; ++a) {
+			for(int b=a+2; b < border.size(); ++b) {
+				Vector2d intersection;
+				if (((a > 0) || (b < border.size()-1)) && border[a].intersection(border[b], intersection)) {
+					self_intersecting = true;
+					break;
+				}
+			}
+		}
+
+		std::vector<int> unresolved;
+		for(int i=0; i < num_objects; ++i) {
+			LinearizedSignedDistance& lsd = lsds[i][t+1];
+			lsd.j = j_tp1;
+			lsd.object = objects[i];
+			Vector2d grad_object;
+			lsd.sd = geometry2d::signed_distance(objects[i], fov, grad_object);
+			lsd.grad_object = grad_object;
+
+			// moving the closest border point by dc changes the signed distance by -grad_object.dot(dc)
+			mat<C_DIM,J_DIM> border_jac;
+			if (!self_intersecting && get_border_point_jac(j_tp1, border, objects[i] - lsd.sd*lsd.grad_object, border_jac)) {
+				lsd.grad_j = -border_jac.transpose()*lsd.grad_object;
+			} else {
+				unresolved.push_back(i);
+			}
+		}
+
+		if (unresolved.size() == 0) {
+			continue;
+		}
+
+		vec<J_DIM> j_p = j_tp1, j_m = j_tp1;
+		for(int k=0; k < J_DIM; ++k) {
+			j_p(k) += step; j_m(k) -= step;
+			std::vector<Beam> fov_p = get_fov(j_p), fov_m = get_fov(j_m);
+			for(int n=0; n < unresolved.size(); ++n) {
+				int i = unresolved[n];
+				lsds[i][t+1].grad_j(k) = (geometry2d::signed_distance(objects[i], fov_p) -
+						geometry2d::signed_distance(objects[i], fov_m)) / (2*step);
+			}
+			j_p(k) = j_tp1(k); j_m(k) = j_tp1(k);
+		}
+	}
+}
+
+/**
+ * \brief Jacobian w.r.t. the joints of a point attached to link
+ */
+void PlanarSystem::get_link_point_jac(const vec<J_DIM>& j, const int link, const vec<C_DIM>& point, mat<C_DIM,J_DIM>& jac) {
+	std::vector<Segment> link_segments = get_link_segments(j.segment<E_DIM>(0));
+
+	jac.setZero();
+	for(int i=0; i <= link; ++i) {
+		// joint i rotates everything past its pivot
+		vec<C_DIM> r = point - link_segments[i].p0;
+		jac.col(i) << r(1), -r(0);
+	}
+}
+
+/**
+ * \brief Jacobian w.r.t. the joints of a point on segment of the field of view border,
+ *        only valid in the direction normal to the segment. The segment lies on a link,
+ *        on the max range top or on a ray from the camera, either an edge of the field
+ *        of view or the shadow of a link end point. Returns false for any other segment
+ *        (left over from truncating nearly degenerate beams), whose jacobian is unknown
+ */
+bool PlanarSystem::get_border_segment_jac(const vec<J_DIM>& j, const Segment& segment, const vec<C_DIM>& point,
+		mat<C_DIM,J_DIM>& jac) {
+	std::vector<Segment> link_segments = get_link_segments(j.segment<E_DIM>(0));
+	for(int l=0; l < link_segments.size(); ++l) {
+		if ((link_segments[l].distance_to(segment.p0) < epsilon) && (link_segments[l].distance_to(segment.p1) < epsilon)) {
+			get_link_point_jac(j, l, point, jac);
+			return true;
+		}
+	}
+
+	jac.setZero();
+
+	double angle = j(J_DIM-1);
+	vec<C_DIM> dir_right, dir_left;
+	dir_right << sin(angle+camera_fov/2.0), cos(angle+camera_fov/2.0);
+	dir_left << sin(angle-camera_fov/2.0), cos(angle-camera_fov/2.0);
+	Segment top(camera_origin + camera_max_dist*dir_right, camera_origin + camera_max_dist*dir_left);
+
+	vec<C_DIM> r0 = segment.p0 - camera_origin, r1 = segment.p1 - camera_origin;
+	vec<C_DIM> r_far = (r0.norm() > r1.norm()) ? r0 : r1;
+	vec<C_DIM> n(r_far(1), -r_far(0));
+	n.normalize();
+
+	bool is_ray = (fabs(n.dot(r0)) < epsilon) && (fabs(n.dot(r1)) < epsilon);
+	bool is_edge = ((r_far.normalized() - dir_right).norm() < epsilon) || ((r_far.normalized() - dir_left).norm() < epsilon);
+	bool is_top = (Line(top).distance_to(segment.p0) < epsilon) && (Line(top).distance_to(segment.p1) < epsilon);
+	if (is_edge || is_top) {
+		// turn with the camera
+		vec<C_DIM> r = point - camera_origin;
+		jac.col(J_DIM-1) << r(1), -r(0);
+		return true;
+	} else if (is_ray) {
+		// a shadow turns about the camera to keep passing through the link end point casting it
+		int link = -1;
+		for(int l=0; l < link_segments.size(); ++l) {
+			vec<C_DIM> r_l = link_segments[l].p1 - camera_origin;
+			if ((fabs(n.dot(r_l)) < epsilon) && (r_l.dot(r_far) > 0) &&
+					((link < 0) || (r_l.norm() < (link_segments[link].p1 - camera_origin).norm()))) {
+				link = l;
+			}
+		}
+		if (link >= 0) {
+			mat<C_DIM,J_DIM> cast_jac;
+			get_link_point_jac(j, link, link_segments[link].p1, cast_jac);
+			jac = ((point - camera_origin).norm() / (link_segments[link].p1 - camera_origin).norm())*n*n.transpose()*cast_jac;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * \brief Jacobian w.r.t. the joints of point on border. At a corner the normal directions
+ *        of the two segments meeting there determine it fully, otherwise it is only
+ *        valid in the direction normal to the segment through point. Returns false if
+ *        point is on no border segment or get_border_segment_jac fails for one it uses
+ */
+bool PlanarSystem::get_border_point_jac(const vec<J_DIM>& j, const std::vector<Segment>& border, const vec<C_DIM>& point,
+		mat<C_DIM,J_DIM>& jac) {
+	std::vector<int> touching;
+	for(int s=0; s < border.size(); ++s) {
+		Segment segment = border[s];
+		if (segment.distance_to(point) < epsilon) {
+			touching.push_back(s);
+		}
+	}
+
+	jac.setZero();
+	if (touching.size() == 0) {
+		return false;
+	}
+
+	mat<C_DIM,J_DIM> jac0;
+	if (!get_border_segment_jac(j, border[touching[0]], point, jac0)) {
+		return false;
+	}
+	vec<C_DIM> v0 = border[touching[0]].p1 - border[touching[0]].p0;
+	vec<C_DIM> n0 = vec<C_DIM>(v0(1), -v0(0)).normalized();
+
+	for(int k=1; k < touching.size(); ++k) {
+		vec<C_DIM> v1 = border[touching[k]].p1 - border[touching[k]].p0;
+		vec<C_DIM> n1 = vec<C_DIM>(v1(1), -v1(0)).normalized();
+		if (fabs(n0(0)*n1(1) - n0(1)*n1(0)) > epsilon) {
+			// corner, moves with both segments: n0.dc = n0.jac0 dj, n1.dc = n1.jac1 dj
+			mat<C_DIM,J_DIM> jac1;
+			if (!get_border_segment_jac(j, border[touching[k]], point, jac1)) {
+				return false;
+			}
+			mat<C_DIM,C_DIM> N;
+			N << n0.transpose(), n1.transpose();
+			mat<C_DIM,J_DIM> N_jac;
+			N_jac << n0.transpose()*jac0, n1.transpose()*jac1;
+			jac = N.inverse()*N_jac;
+			return true;
+		}
+	}
+
+	jac = n0*n0.transpose()*jac0;
+	return true;
+}
+
+void PlanarSystem::update_particles(const vec<J_DIM>& j_tp1_t, const double delta_fov_real, const vec<Z_DIM>& z_tp1_real, const MatrixP& P_t,
+		MatrixP& P_tp1) {
 
 	vec<C_DIM> z_obj_real = z_tp1_real.segment<C_DIM>(J_DIM);
 	std::vector<Beam> fov = get_fov(j_tp1_t);
 
-	vec<M_DIM> W = vec<M_DIM>::Zero();
+	Array<bool,Dynamic,1> inside;
+	geometry2d::is_inside(P_t, fov, inside);
+
+	VectorXd W = VectorXd::Zero(P_t.cols());
 	// for each particle, weight by gauss_likelihood of that measurement given particle/agent observation
-	for(int m=0; m < M_DIM; ++m) {
-		bool inside = geometry2d::is_inside(P_t.col(m), fov);
+	for(int m=0; m < P_t.cols(); ++m) {
 		if (delta_fov_real < epsilon) {
-			W(m) = (inside) ? 0 : 1;
+			W(m) = (inside(m)) ? 0 : 1;
 		} else {
-			if (inside) {
+			if (inside(m)) {
 				vec<C_DIM> z_obj_m = obsfunc(j_tp1_t, P_t.col(m), vec<R_DIM>::Zero()).segment<C_DIM>(J_DIM);
 				vec<C_DIM> e = z_obj_real - z_obj_m;
 				W(m) = gauss_likelihood(e, .1*R.block<C_DIM,C_DIM>(J_DIM,J_DIM));
@@ -953,16 +1184,20 @@ double PlanarSystem::gauss_likelihood(const vec<C_DIM>& v, const mat<C_DIM,C_DIM
 	return w;
 }
 
-void PlanarSystem::low_variance_sampler(const mat<C_DIM,M_DIM>& P, const vec<M_DIM>& W, mat<C_DIM,M_DIM>& P_sampled) {
-	double r = planar_utils::uniform(0, 1/double(M_DIM));
-	double c = W(0);
-	int i = 0;
-	for(int m=0; m < M_DIM; ++m) {
-		double u = r + m * (1/double(M_DIM));
-		while (u > c) {
-			c += W(++i);
-		}
-		P_sampled.col(m) = P.col(i);
+/**
+ * Resamples to an adaptive number of particles (KLD-sampling), more while the
+ * belief is spread over the grid and fewer once it has collapsed
+ */
+void PlanarSystem::low_variance_sampler(const MatrixP& P, const VectorXd& W, MatrixP& P_sampled) {
+	double r = planar_utils::uniform(0, 1);
+	std::vector<int> indices;
+	kld.resample(P.data(), C_DIM, W.data(), P.cols(), r, indices);
+
+	P_sampled.resize(C_DIM, indices.size());
+	kld.resampler.gather(P.data(), C_DIM, &indices[0], indices.size(), P_sampled.data());
+
+	if (gmm_tracker.tracks(P)) {
+		gmm_tracker.resample(P_sampled, indices);
 	}
 }
 
@@ -0,0 +1,145 @@
+#include "../include/gmm.h"
+
+#include "../../util/Timer.h"
+#include "../../util/random.h"
+#include "../../util/resampling.h"
+
+#include <iostream>
+#include <iomanip>
+
+#define M 1000
+#define STEPS 10
+
+/**
+ * Particle sets of the bimodal problem (planar/figures/bimodal_problem): the initial
+ * uniform belief over the workspace, then two objects the camera cannot tell apart,
+ * whose clusters tighten and drift as the arm replans
+ */
+MatrixXd uniform_particles(util::Random& random) {
+	MatrixXd P(2, M);
+	for(int m=0; m < M; ++m) {
+		P(0,m) = random.uniform(-10, 10);
+		P(1,m) = random.uniform(2, 11);
+	}
+	return P;
+}
+
+MatrixXd bimodal_particles(util::Random& random, int step) {
+	Vector2d left(-4 + .05*step, 6), right(3, 7 - .05*step);
+	double sigma = 1.5 / (1 + .5*step);
+	MatrixXd P(2, M);
+	for(int m=0; m < M; ++m) {
+		P.col(m) = ((m % 3 == 0) ? right : left) + sigma*Vector2d(random.normal(), random.normal());
+	}
+	return P;
+}
+
+void report(const std::string& name, double time, const std::vector<VectorXd>& modes) {
+	std::cout << std::setw(28) << name << std::setw(14) << time << std::setw(8) << modes.size();
+	for(int i=0; i < std::min<int>(modes.size(), 3); ++i) {
+		std::cout << "  (" << modes[i](0) << ", " << modes[i](1) << ")";
+	}
+	std::cout << "\n";
+}
+
+int main(int argc, char* argv[]) {
+	util::Random random(0);
+	std::vector<MatrixXd> problems(1, uniform_particles(random));
+	for(int step=0; step < STEPS; ++step) {
+		problems.push_back(bimodal_particles(random, step));
+	}
+
+	util::ThreadPool pool;
+	util::Timer timer;
+	std::vector<VectorXd> modes;
+	std::vector<std::vector<int>> indices;
+
+	std::cout << std::setw(28) << "mode finder" << std::setw(14) << "time (s)" << std::setw(8) << "modes" << "\n";
+
+	for(int p=0; p < problems.size(); p += STEPS) {
+		std::string problem = (p == 0) ? "uniform: " : "bimodal: ";
+
+		// every particle shifted over all particles, the previous find_modes
+		util::Timer_tic(&timer);
+		modes.clear();
+		for(int m=0; m < M; ++m) {
+			VectorXd mode = gmm::find_nearest_mode(problems[p].col(m), problems[p]);
+			bool mode_exists = false;
+			for(int i=0; (i < modes.size()) && !mode_exists; ++i) {
+				mode_exists = ((modes[i] - mode).norm() < .05);
+			}
+			if (!mode_exists) { modes.push_back(mode); }
+		}
+		report(problem + "all particles", util::Timer_toc(&timer), modes);
+
+		gmm::ModeFinder cold;
+		util::Timer_tic(&timer);
+		cold.find_modes(problems[p], modes, indices);
+		report(problem + "grid, cell seeds", util::Timer_toc(&timer), modes);
+	}
+
+	// bimodal replanning steps, warm started from the previous step
+	gmm::ModeFinder cold, warm(&pool);
+	double cold_time = 0, warm_time = 0;
+	for(int p=1; p < problems.size(); ++p) {
+		cold.reset();
+		util::Timer_tic(&timer);
+		cold.find_modes(problems[p], modes, indices);
+		cold_time += util::Timer_toc(&timer);
+
+		util::Timer_tic(&timer);
+		warm.find_modes(problems[p], modes, indices);
+		warm_time += util::Timer_toc(&timer);
+	}
+	report("steps: cold", cold_time / STEPS, modes);
+	report("steps: warm, pool", warm_time / STEPS, modes);
+
+	// reweight (no particles inside a sweeping field of view) and resample, then
+	// refit the mixture or follow the resampling with the tracker
+	MatrixXd P = problems[STEPS];
+	gmm::ModeFinder refit(&pool);
+	gmm::MixtureTracker tracker(&pool);
+	util::LowVarianceResampler resampler;
+	std::vector<VectorXd> means, tracked_means;
+	std::vector<MatrixXd> covs, tracked_covs, particles;
+	double refit_time = 0, track_time = 0, max_error = 0;
+	tracker.fit(P);
+	for(int step=0; step < STEPS; ++step) {
+		VectorXd W(M);
+		for(int m=0; m < M; ++m) {
+			double x = P(0,m);
+			W(m) = ((x > -6 + step) && (x < -5.5 + step)) ? 0 : 1;
+		}
+		std::vector<int> ancestors(M);
+		resampler.indices(W.data(), M, M, random.uniform(), &ancestors[0]);
+		MatrixXd P_sampled(2, M);
+		resampler.gather(P.data(), 2, &ancestors[0], M, P_sampled.data());
+
+		util::Timer_tic(&timer);
+		gmm::fit_gaussians_to_pf(P_sampled, refit, means, covs, particles);
+		refit_time += util::Timer_toc(&timer);
+
+		util::Timer_tic(&timer);
+		tracker.resample(P_sampled, ancestors);
+		tracker.get_gaussians(tracked_means, tracked_covs, particles);
+		track_time += util::Timer_toc(&timer);
+
+		// tracked moments against the sample moments of the tracked modes
+		for(int i=0; i < particles.size(); ++i) {
+			VectorXd mean = particles[i].rowwise().mean();
+			MatrixXd centered = particles[i].colwise() - mean;
+			MatrixXd cov = centered*centered.transpose() / (particles[i].cols() - 1);
+			max_error = std::max(max_error, (mean - tracked_means[i]).norm());
+			max_error = std::max(max_error, (cov - tracked_covs[i]).norm());
+		}
+		P = P_sampled;
+	}
+	report("resampling: refit", refit_time / STEPS, means);
+	report("resampling: tracked", track_time / STEPS, tracked_means);
+	std::cout << "tracker refits: " << tracker.num_refits() - 1 << " of " << STEPS
+			<< ", max moment error: " << max_error << "\n";
+
+	std::cout << "threads: " << pool.size() << "\n";
+
+	return 0;
+}
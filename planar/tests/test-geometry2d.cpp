@@ -284,6 +284,37 @@ void test_halfspace() {
 
 }
 
+void test_batch_signed_distance() {
+	vec<2> base, a, b, p0, p1;
+	base << 0 , 0;
+	a << 1 , 1;
+	b << -1 , 1;
+	Beam orig_beam(base, a, b);
+
+	p0 << .1, .3;
+	p1 << 1, .4;
+	std::vector<Beam> beams = orig_beam.truncate(Segment(p0, p1));
+
+	int M = 1000;
+	Matrix<double,2,Dynamic> P = 1.5*MatrixXd::Random(2, M);
+	P.col(0) = beams[0].a; // on the border
+	P.col(1) = p0;
+
+	VectorXd sd;
+	Array<bool,Dynamic,1> inside;
+	geometry2d::signed_distance(P, beams, sd);
+	geometry2d::is_inside(P, beams, inside);
+
+	int num_diff = 0;
+	for(int m=0; m < M; ++m) {
+		num_diff += (sd(m) != geometry2d::signed_distance(P.col(m), beams));
+		num_diff += (inside(m) != geometry2d::is_inside(P.col(m), beams));
+	}
+
+	std::cout << "batch and per point results should not differ\n";
+	std::cout << "number of differences: " << num_diff << "\n\n";
+}
+
 int main(int argc, char* argv[]) {
 //	test_segment_intersection();
 //	test_scope();
@@ -291,4 +322,5 @@ int main(int argc, char* argv[]) {
 //	test_segment_distance_to();
 	test_segment_closest_point();
 //	test_halfspace();
+	test_batch_signed_distance();
 }
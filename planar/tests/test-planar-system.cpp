@@ -259,7 +259,7 @@ void test_entropy() {
 	vec<J_DIM> j0;
 	j0 << M_PI/5, -M_PI/2+M_PI/16, -M_PI/4, 0;
 
-	mat<C_DIM,M_DIM> P;
+	MatrixP P(C_DIM, M_DIM);
 	for(int m=0; m < M_DIM; ++m) {
 		P(0, m) = planar_utils::uniform(-10, 10);
 		P(1, m) = planar_utils::uniform(2, 11);
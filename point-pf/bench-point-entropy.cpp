@@ -0,0 +1,93 @@
+#include "point-pf.h"
+#include "point-entropy.h"
+
+#include <../util/matrix.h>
+#include <../util/utils.h>
+#include <../util/logging.h>
+#include <../util/Timer.h>
+
+#include <iostream>
+#include <iomanip>
+
+// independently seeded estimates per configuration, for the variance
+#define REPLICATES 20
+
+int main(int argc, char* argv[]) {
+	srand(0);
+	point_pf::initialize();
+
+	Matrix<X_DIM> x0, xGoal;
+	x0[0] = -3.5; x0[1] = 2;
+	xGoal[0] = -3.5; xGoal[1] = -2;
+
+	SymmetricMatrix<X_DIM> Sigma0 = .01*identity<X_DIM>();
+
+	Matrix<U_DIM> u = (xGoal - x0) / (DT*(T-1));
+	std::vector<Matrix<U_DIM> > U(T-1, u);
+
+	std::vector<std::vector<Matrix<X_DIM>> > P(T, std::vector<Matrix<X_DIM> >(M));
+	for(int m=0; m < M; ++m) {
+		P[0][m] = sampleGaussian(x0, Sigma0);
+	}
+	for(int t=0; t < T-1; ++t) {
+		std::vector<Matrix<Q_DIM> > dyn_noise = sampleGaussianN(zeros<Q_DIM,1>(), Q, M);
+		for(int m=0; m < M; ++m) {
+			P[t+1][m] = point_pf::dynfunc(P[t][m], u, dyn_noise[m]);
+		}
+	}
+
+	util::Timer timer;
+
+	// variance versus wall time of the entropy estimate
+	std::cout << std::setw(8) << "sampler" << std::setw(10) << "samples" << std::setw(14) << "mean"
+			<< std::setw(14) << "variance" << std::setw(14) << "time (s)" << std::setw(16) << "var*time" << "\n";
+
+	int num_samples[] = {16, 32, 64, 128, 256, 512, 1000};
+	for(int quasi_random=0; quasi_random < 2; ++quasi_random) {
+		for(int i=0; i < sizeof(num_samples)/sizeof(num_samples[0]); ++i) {
+			double sum = 0, sum_sq = 0;
+			util::Timer_tic(&timer);
+			for(int r=0; r < REPLICATES; ++r) {
+				point_entropy::MonteCarloConfig config(num_samples[i], quasi_random, true, r+1);
+				double entropy = point_entropy::differential_entropy(P, U, config);
+				sum += entropy;
+				sum_sq += entropy*entropy;
+			}
+			double time = util::Timer_toc(&timer) / REPLICATES;
+			double variance = (sum_sq - sum*sum/REPLICATES) / (REPLICATES-1);
+
+			std::cout << std::setw(8) << (quasi_random ? "sobol" : "mc") << std::setw(10) << num_samples[i]
+					<< std::setw(14) << sum/REPLICATES << std::setw(14) << variance
+					<< std::setw(14) << time << std::setw(16) << variance*time << "\n";
+		}
+	}
+
+	// total variance of the gradient with and without common random numbers
+	std::cout << "\n" << std::setw(8) << "crn" << std::setw(10) << "samples"
+			<< std::setw(14) << "variance" << std::setw(14) << "time (s)" << "\n";
+
+	const int grad_samples = 4;
+	for(int crn=1; crn >= 0; --crn) {
+		std::vector<Matrix<TOTAL_VARS> > grads;
+		util::Timer_tic(&timer);
+		for(int r=0; r < REPLICATES; ++r) {
+			point_entropy::MonteCarloConfig config(grad_samples, false, crn, r+1);
+			grads.push_back(point_entropy::grad_differential_entropy(P, U, config));
+		}
+		double time = util::Timer_toc(&timer) / REPLICATES;
+
+		Matrix<TOTAL_VARS> mean;
+		for(int r=0; r < REPLICATES; ++r) {
+			mean += (1/double(REPLICATES))*grads[r];
+		}
+		double variance = 0;
+		for(int r=0; r < REPLICATES; ++r) {
+			variance += tr(~(grads[r] - mean)*(grads[r] - mean)) / (REPLICATES-1);
+		}
+
+		std::cout << std::setw(8) << (crn ? "yes" : "no") << std::setw(10) << grad_samples
+				<< std::setw(14) << variance << std::setw(14) << time << "\n";
+	}
+
+	return 0;
+}
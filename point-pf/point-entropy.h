@@ -3,6 +3,11 @@
 
 #include "point-pf.h"
 
+#include "../util/threadpool.h"
+#include "../util/sobol.h"
+
+#include <random>
+
 namespace point_entropy {
 
 float differential_entropy_noise(const std::vector<std::vector<Matrix<X_DIM> > >& P, const std::vector<Matrix<U_DIM> >& U,
@@ -73,122 +78,170 @@ float differential_entropy_noise(const std::vector<std::vector<Matrix<X_DIM> > >
 	return -entropy;
 }
 
-float differential_entropy(std::vector<std::vector<Matrix<X_DIM> > >& P, std::vector<Matrix<U_DIM> >& U) {
-	float avg_entropy = 0;
-	float max_iter = 1000;
-	for(int iter=0; iter < max_iter; iter++) {
-		std::vector<Matrix<Q_DIM> > dyn_noise = sampleGaussianN(zeros<Q_DIM,1>(), Q, (T-1)*M);
-		std::vector<Matrix<R_DIM> > obs_noise = sampleGaussianN(zeros<R_DIM,1>(), R, (T*M));
-		float entropy = point_entropy::differential_entropy_noise(P, U, dyn_noise, obs_noise);
-		avg_entropy += (1/float(max_iter))*entropy;
+struct MonteCarloConfig {
+	int num_samples;            // noise samples averaged
+	bool quasi_random;          // scrambled Sobol noise instead of pseudo-random noise
+	bool common_random_numbers; // same noise for the +/- evaluations of finite differences
+	unsigned seed;              // noise is a deterministic function of (seed, sample)
+
+	MonteCarloConfig(int num_samples=1000, bool quasi_random=false, bool common_random_numbers=true, unsigned seed=0) :
+		num_samples(num_samples), quasi_random(quasi_random), common_random_numbers(common_random_numbers), seed(seed) { }
+};
+
+/**
+ * Dynamics and observation noise for each Monte Carlo sample. Sample s is drawn from
+ * its own stream seeded with (seed, s), or is point s of a scrambled Sobol sequence over
+ * all (T-1)*M*Q_DIM + T*M*R_DIM noise dimensions, so samples can be drawn on any thread
+ * in any order and repeated evaluations see the same noise.
+ */
+class EntropyNoise {
+public:
+	EntropyNoise(const MonteCarloConfig& config) :
+		config(config), sobol(config.quasi_random ? NUM_DIMS : 0, config.seed) {
+		chol(Q, Q_sqrt);
+		chol(R, R_sqrt);
 	}
-	return avg_entropy;
-}
 
-Matrix<TOTAL_VARS> grad_differential_entropy(std::vector<std::vector<Matrix<X_DIM> > >& P, std::vector<Matrix<U_DIM> >& U) {
-	Matrix<TOTAL_VARS> g_avg;
-
-	int max_iter = 20;
-	for(int iter=0; iter < max_iter; iter++) {
-		Matrix<TOTAL_VARS> g;
-
-		std::vector<Matrix<Q_DIM> > dyn_noise = sampleGaussianN(zeros<Q_DIM,1>(), Q, (T-1)*M);
-		std::vector<Matrix<R_DIM> > obs_noise = sampleGaussianN(zeros<R_DIM,1>(), R, T*M);
+	void sample(int s, std::vector<Matrix<Q_DIM> >& dyn_noise, std::vector<Matrix<R_DIM> >& obs_noise) const {
+		std::vector<double> n(NUM_DIMS);
+		if (config.quasi_random) {
+			sobol.point(s, &n[0]);
+			for(int i=0; i < NUM_DIMS; ++i) { n[i] = util::inverse_normal_cdf(n[i]); }
+		} else {
+			std::seed_seq seq = {config.seed, unsigned(s)};
+			std::mt19937 rng(seq);
+			std::normal_distribution<double> normal;
+			for(int i=0; i < NUM_DIMS; ++i) { n[i] = normal(rng); }
+		}
 
-		float orig, entropy_p, entropy_l;
 		int index = 0;
-		for(int t=0; t < T; ++t) {
-			for(int m=0; m < M; ++m) {
-				for(int i=0; i < X_DIM; ++i) {
-					orig = P[t][m][i];
+		dyn_noise.resize((T-1)*M);
+		for(int i=0; i < dyn_noise.size(); ++i) {
+			Matrix<Q_DIM> q;
+			for(int j=0; j < Q_DIM; ++j) { q[j] = n[index++]; }
+			dyn_noise[i] = Q_sqrt*q;
+		}
+		obs_noise.resize(T*M);
+		for(int i=0; i < obs_noise.size(); ++i) {
+			Matrix<R_DIM> r;
+			for(int j=0; j < R_DIM; ++j) { r[j] = n[index++]; }
+			obs_noise[i] = R_sqrt*r;
+		}
+	}
 
-					P[t][m][i] = orig + step;
-					entropy_p = differential_entropy_noise(P,U, dyn_noise, obs_noise);
+private:
+	static const int NUM_DIMS = (T-1)*M*Q_DIM + T*M*R_DIM;
 
-					P[t][m][i] = orig - step;
-					entropy_l = differential_entropy_noise(P,U, dyn_noise, obs_noise);
+	MonteCarloConfig config;
+	util::SobolSampler sobol;
+	Matrix<Q_DIM,Q_DIM> Q_sqrt;
+	Matrix<R_DIM,R_DIM> R_sqrt;
+};
 
-					P[t][m][i] = orig;
-					g[index++] = (entropy_p - entropy_l)/(2*step);
-				}
-			}
+inline util::ThreadPool& monte_carlo_pool() {
+	static util::ThreadPool pool;
+	return pool;
+}
 
-			if (t < T-1) {
-				for(int i=0; i < U_DIM; ++i) {
-					orig = U[t][i];
+float differential_entropy(const std::vector<std::vector<Matrix<X_DIM> > >& P, const std::vector<Matrix<U_DIM> >& U,
+						   const MonteCarloConfig& config) {
+	EntropyNoise noise(config);
 
-					U[t][i] = orig + step;
-					entropy_p = differential_entropy_noise(P,U, dyn_noise, obs_noise);
+	std::vector<float> entropies(config.num_samples);
+	monte_carlo_pool().parallel_for(0, config.num_samples, [&](int s) {
+		std::vector<Matrix<Q_DIM> > dyn_noise;
+		std::vector<Matrix<R_DIM> > obs_noise;
+		noise.sample(s, dyn_noise, obs_noise);
+		entropies[s] = differential_entropy_noise(P, U, dyn_noise, obs_noise);
+	});
 
-					U[t][i] = orig - step;
-					entropy_l = differential_entropy_noise(P,U, dyn_noise, obs_noise);
+	// summed in sample order so the result does not depend on scheduling
+	float avg_entropy = 0;
+	for(int s=0; s < config.num_samples; ++s) {
+		avg_entropy += (1/float(config.num_samples))*entropies[s];
+	}
+	return avg_entropy;
+}
 
-					U[t][i] = orig;
-					g[index++] = (entropy_p - entropy_l)/(2*step);
-				}
-			}
+float differential_entropy(std::vector<std::vector<Matrix<X_DIM> > >& P, std::vector<Matrix<U_DIM> >& U) {
+	return differential_entropy(P, U, MonteCarloConfig(1000));
+}
+
+/**
+ * \brief Averages, over config.num_samples noise samples, the finite differences of
+ *        differential_entropy_noise with respect to every particle and control.
+ *        Computes the gradient, or the diagonal of the Hessian if diaghess is set.
+ */
+Matrix<TOTAL_VARS> finite_difference_differential_entropy(const std::vector<std::vector<Matrix<X_DIM> > >& P, const std::vector<Matrix<U_DIM> >& U,
+														 const MonteCarloConfig& config, bool diaghess) {
+	EntropyNoise noise(config);
+
+	std::vector<Matrix<TOTAL_VARS> > derivatives(config.num_samples);
+	monte_carlo_pool().parallel_for(0, config.num_samples, [&](int s) {
+		std::vector<std::vector<Matrix<X_DIM> > > P_s(P);
+		std::vector<Matrix<U_DIM> > U_s(U);
+
+		std::vector<Matrix<Q_DIM> > dyn_noise_p, dyn_noise_l;
+		std::vector<Matrix<R_DIM> > obs_noise_p, obs_noise_l;
+		noise.sample(s, dyn_noise_p, obs_noise_p);
+		if (config.common_random_numbers) {
+			dyn_noise_l = dyn_noise_p;
+			obs_noise_l = obs_noise_p;
+		} else {
+			noise.sample(config.num_samples + s, dyn_noise_l, obs_noise_l);
 		}
 
-		g_avg += (1/float(max_iter))*g;
-	}
+		float cost = diaghess ? differential_entropy_noise(P_s, U_s, dyn_noise_p, obs_noise_p) : 0;
 
-	return g_avg;
-}
+		Matrix<TOTAL_VARS>& d = derivatives[s];
+		int index = 0;
+		auto differentiate = [&](double& var) {
+			double orig = var;
 
-Matrix<TOTAL_VARS> diaghess_differential_entropy(std::vector<std::vector<Matrix<X_DIM> > >& P, std::vector<Matrix<U_DIM> >& U) {
-	Matrix<TOTAL_VARS> diaghess_avg;
+			var = orig + step;
+			float cost_p = differential_entropy_noise(P_s, U_s, dyn_noise_p, obs_noise_p);
 
-	int max_iter = 20;
-	for(int iter=0; iter < max_iter; iter++) {
-		Matrix<TOTAL_VARS> diaghess;
+			var = orig - step;
+			float cost_l = differential_entropy_noise(P_s, U_s, dyn_noise_l, obs_noise_l);
 
-		std::vector<Matrix<Q_DIM> > dyn_noise = sampleGaussianN(zeros<Q_DIM,1>(), Q, (T-1)*M);
-		std::vector<Matrix<R_DIM> > obs_noise = sampleGaussianN(zeros<R_DIM,1>(), R, T*M);
-		std::vector<float> sampling_noise(T);
-		for(int t=0; t < T; ++t) { sampling_noise[t] = (1/float(M))*(rand() / float(RAND_MAX)); }
+			var = orig;
+			d[index++] = diaghess ? (cost_p - 2*cost + cost_l)/(step*step) : (cost_p - cost_l)/(2*step);
+		};
 
-		float orig, cost_p, cost, cost_l;
-		int index = 0;
 		for(int t=0; t < T; ++t) {
 			for(int m=0; m < M; ++m) {
 				for(int i=0; i < X_DIM; ++i) {
-					cost = differential_entropy_noise(P, U, dyn_noise, obs_noise);
-					orig = P[t][m][i];
-
-					P[t][m][i] = orig + step;
-					cost_p = differential_entropy_noise(P, U, dyn_noise, obs_noise);
-
-					P[t][m][i] = orig - step;
-					cost_l = differential_entropy_noise(P,U, dyn_noise, obs_noise);
-
-					P[t][m][i] = orig;
-					diaghess[index++] = (cost_p - 2*cost + cost_l)/(step*step);
+					differentiate(P_s[t][m][i]);
 				}
 			}
 
 			if (t < T-1) {
 				for(int i=0; i < U_DIM; ++i) {
-					cost = differential_entropy_noise(P, U, dyn_noise, obs_noise);
-					orig = U[t][i];
-
-					U[t][i] = orig + step;
-					cost_p = differential_entropy_noise(P,U, dyn_noise, obs_noise);
-
-					U[t][i] = orig - step;
-					cost_l = differential_entropy_noise(P,U, dyn_noise, obs_noise);
-
-					U[t][i] = orig;
-					diaghess[index++] = (cost_p - 2*cost + cost_l)/(step*step);
+					differentiate(U_s[t][i]);
 				}
 			}
 		}
+	});
 
-		diaghess_avg += (1/float(max_iter))*diaghess;
+	Matrix<TOTAL_VARS> avg;
+	for(int s=0; s < config.num_samples; ++s) {
+		avg += (1/float(config.num_samples))*derivatives[s];
 	}
+	return avg;
+}
 
-	return diaghess_avg;
+Matrix<TOTAL_VARS> grad_differential_entropy(const std::vector<std::vector<Matrix<X_DIM> > >& P, const std::vector<Matrix<U_DIM> >& U,
+											 const MonteCarloConfig& config) {
+	return finite_difference_differential_entropy(P, U, config, false);
 }
 
+Matrix<TOTAL_VARS> grad_differential_entropy(std::vector<std::vector<Matrix<X_DIM> > >& P, std::vector<Matrix<U_DIM> >& U) {
+	return grad_differential_entropy(P, U, MonteCarloConfig(20));
+}
+
+Matrix<TOTAL_VARS> diaghess_differential_entropy(std::vector<std::vector<Matrix<X_DIM> > >& P, std::vector<Matrix<U_DIM> >& U) {
+	return finite_difference_differential_entropy(P, U, MonteCarloConfig(20), true);
+}
 
 }
 
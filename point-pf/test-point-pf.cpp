@@ -9,6 +9,7 @@
 
 int main(int argc, char* argv[]) {
 	srand(time(0));
+	util::seed_random(time(0));
 	point_pf::initialize();
 
 	Matrix<X_DIM> x0, xGoal;
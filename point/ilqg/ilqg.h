@@ -5,6 +5,9 @@
 #include "util/matrix.h"
 #include "util/utils.h"
 #include <vector>
+#include <memory>
+
+#include "util/threadpool.h"
 
 #define _sDim (((_xDim+1)*_xDim)/2)
 
@@ -68,9 +71,9 @@ inline void beliefDynamics(const Matrix<_xDim, _xDim>& A, const SymmetricMatrix<
 	SigmaNew -= W;
 }
 
-template <size_t _xDim, size_t _uDim, size_t _zDim>
-inline void computeCEFJ(void (*linearizeDynamics)(const Matrix<_xDim>&, const Matrix<_uDim>&, Matrix<_xDim>&, Matrix<_xDim, _xDim>&, Matrix<_xDim,_uDim>&, SymmetricMatrix<_xDim>&, unsigned int), 
-	void (*linearizeObservation)(const Matrix<_xDim>&, Matrix<_zDim, _xDim>&, SymmetricMatrix<_zDim>&),
+template <size_t _xDim, size_t _uDim, size_t _zDim, typename LinearizeDynamics, typename LinearizeObservation>
+inline void computeCEFJ(const LinearizeDynamics& linearizeDynamics, 
+	const LinearizeObservation& linearizeObservation,
 	const Matrix<_xDim>& xBar, const SymmetricMatrix<_xDim>& SigmaBar, const Matrix<_uDim>& uBar,
 	const Matrix<1,_sDim>& tT, const Matrix<1,_sDim>& hvecS,
 	Matrix<1,_xDim>& tTC, Matrix<1,_uDim>& tTE, Matrix<1,_xDim>& vecSF, Matrix<1,_uDim>& vecSJ)
@@ -164,10 +167,10 @@ inline void computeDG(const Matrix<_xDim, _xDim>& A, const SymmetricMatrix<_xDim
 }
 
 
-template <size_t _xDim, size_t _uDim, size_t _zDim>
-inline void controlPolicy(void (*linearizeDynamics)(const Matrix<_xDim>&, const Matrix<_uDim>&, Matrix<_xDim>&, Matrix<_xDim, _xDim>&, Matrix<_xDim,_uDim>&, SymmetricMatrix<_xDim>&, unsigned int), 
-	void (*linearizeObservation)(const Matrix<_xDim>&, Matrix<_zDim, _xDim>&, SymmetricMatrix<_zDim>&),
-	bool (*quadratizeCost)(const Matrix<_xDim>&, const SymmetricMatrix<_xDim>&, const Matrix<_uDim>&, double&, SymmetricMatrix<_xDim>&, SymmetricMatrix<_uDim>&, Matrix<_uDim, _xDim>&, Matrix<1,_xDim>&, Matrix<1,_uDim>&, Matrix<1,_sDim>&, unsigned int),
+template <size_t _xDim, size_t _uDim, size_t _zDim, typename LinearizeDynamics, typename LinearizeObservation, typename QuadratizeCost>
+inline void controlPolicy(const LinearizeDynamics& linearizeDynamics, 
+	const LinearizeObservation& linearizeObservation,
+	const QuadratizeCost& quadratizeCost,
 	const Matrix<_xDim>& xBar, const SymmetricMatrix<_xDim>& SigmaBar, const Matrix<_uDim>& uBar,
 	SymmetricMatrix<_xDim>& S, Matrix<1,_xDim>& sT, Matrix<1,_sDim>& tT, Matrix<_uDim,_xDim>& L, Matrix<_uDim>& l, double& gradient) 
 {
@@ -192,7 +195,7 @@ inline void controlPolicy(void (*linearizeDynamics)(const Matrix<_xDim>&, const
 
 	Matrix<1,_sDim> hvecS = vecTh(S);
 
-	computeCEFJ(linearizeDynamics, linearizeObservation, xBar, SigmaBar, uBar, tT, hvecS, tTC, tTE, hvecSF, hvecSJ); // O(n^4)
+	computeCEFJ<_xDim,_uDim,_zDim>(linearizeDynamics, linearizeObservation, xBar, SigmaBar, uBar, tT, hvecS, tTC, tTE, hvecSF, hvecSJ); // O(n^4)
 	computeDG(A, M, H, N, SigmaBar, tT, hvecS, tTD, hvecSG); // O(n^4)
 
 	SymmetricMatrix<_xDim> Q;
@@ -227,11 +230,11 @@ inline void controlPolicy(void (*linearizeDynamics)(const Matrix<_xDim>&, const
 	gradient += scalar(rT*l);
 }
 
-template <size_t _xDim, size_t _uDim, size_t _zDim>
-inline void backwardIteration(void (*linearizeDynamics)(const Matrix<_xDim>&, const Matrix<_uDim>&, Matrix<_xDim>&, Matrix<_xDim, _xDim>&, Matrix<_xDim,_uDim>&, SymmetricMatrix<_xDim>&, unsigned int), 
-	void (*linearizeObservation)(const Matrix<_xDim>&, Matrix<_zDim, _xDim>&, SymmetricMatrix<_zDim>&),
-	void (*quadratizeFinalCost)(const Matrix<_xDim>&, const SymmetricMatrix<_xDim>&, double&, SymmetricMatrix<_xDim>&, Matrix<1,_xDim>&, Matrix<1,_sDim>&, unsigned int),
-	bool (*quadratizeCost)(const Matrix<_xDim>&, const SymmetricMatrix<_xDim>&, const Matrix<_uDim>&, double&, SymmetricMatrix<_xDim>&, SymmetricMatrix<_uDim>&, Matrix<_uDim, _xDim>&, Matrix<1,_xDim>&, Matrix<1,_uDim>&, Matrix<1,_sDim>&, unsigned int),
+template <size_t _xDim, size_t _uDim, size_t _zDim, typename LinearizeDynamics, typename LinearizeObservation, typename QuadratizeFinalCost, typename QuadratizeCost>
+inline void backwardIteration(const LinearizeDynamics& linearizeDynamics, 
+	const LinearizeObservation& linearizeObservation,
+	const QuadratizeFinalCost& quadratizeFinalCost,
+	const QuadratizeCost& quadratizeCost,
 	const std::vector<Matrix<_xDim> >& xBar, const std::vector<SymmetricMatrix<_xDim> >& SigmaBar, const std::vector<Matrix<_uDim> >& uBar, 
 	std::vector<Matrix<_uDim, _xDim> >& L, std::vector<Matrix<_uDim> >& l, double& gradient)
 {
@@ -245,13 +248,13 @@ inline void backwardIteration(void (*linearizeDynamics)(const Matrix<_xDim>&, co
 	gradient = 0.0;
 
 	for (int t = uBar.size() - 1; t != -1; --t) {
-		controlPolicy(linearizeDynamics, linearizeObservation, quadratizeCost, xBar[t], SigmaBar[t], uBar[t], S, sT, tT, L[t], l[t], gradient);
+		controlPolicy<_xDim,_uDim,_zDim>(linearizeDynamics, linearizeObservation, quadratizeCost, xBar[t], SigmaBar[t], uBar[t], S, sT, tT, L[t], l[t], gradient);
 	}
 }
 
-template <size_t _xDim, size_t _uDim>
-inline void expectedCost(void (*linearizeDynamics)(const Matrix<_xDim>&, const Matrix<_uDim>&, Matrix<_xDim>&, Matrix<_xDim, _xDim>&, Matrix<_xDim,_uDim>&, SymmetricMatrix<_xDim>&, unsigned int), 
-	bool (*quadratizeCost)(const Matrix<_xDim>&, const SymmetricMatrix<_xDim>&, const Matrix<_uDim>&, double&, SymmetricMatrix<_xDim>&, SymmetricMatrix<_uDim>&, Matrix<_uDim, _xDim>&, Matrix<1,_xDim>&, Matrix<1,_uDim>&, Matrix<1,_sDim>&, unsigned int),
+template <size_t _xDim, size_t _uDim, typename LinearizeDynamics, typename QuadratizeCost>
+inline void expectedCost(const LinearizeDynamics& linearizeDynamics, 
+	const QuadratizeCost& quadratizeCost,
 	const Matrix<_xDim>& xBar, const SymmetricMatrix<_xDim>& SigmaBar, const Matrix<_uDim>& uBar, const SymmetricMatrix<_xDim>& WBar, const Matrix<_uDim,_xDim>& L,
 	SymmetricMatrix<_xDim>& S, double& s) 
 {
@@ -281,10 +284,10 @@ inline void expectedCost(void (*linearizeDynamics)(const Matrix<_xDim>&, const M
 	S = Q + SymProd(~L,R*L) + SymSum(~L*P) + SymProd(~ApBL,S*ApBL);
 }
 
-template <size_t _xDim, size_t _uDim>
-inline double computeExpectedCost(void (*linearizeDynamics)(const Matrix<_xDim>&, const Matrix<_uDim>&, Matrix<_xDim>&, Matrix<_xDim, _xDim>&, Matrix<_xDim,_uDim>&, SymmetricMatrix<_xDim>&, unsigned int), 
-	void (*quadratizeFinalCost)(const Matrix<_xDim>&, const SymmetricMatrix<_xDim>&, double&, SymmetricMatrix<_xDim>&, Matrix<1,_xDim>&, Matrix<1,_sDim>&, unsigned int),
-	bool (*quadratizeCost)(const Matrix<_xDim>&, const SymmetricMatrix<_xDim>&, const Matrix<_uDim>&, double&, SymmetricMatrix<_xDim>&, SymmetricMatrix<_uDim>&, Matrix<_uDim, _xDim>&, Matrix<1,_xDim>&, Matrix<1,_uDim>&, Matrix<1,_sDim>&, unsigned int),
+template <size_t _xDim, size_t _uDim, typename LinearizeDynamics, typename QuadratizeFinalCost, typename QuadratizeCost>
+inline double computeExpectedCost(const LinearizeDynamics& linearizeDynamics, 
+	const QuadratizeFinalCost& quadratizeFinalCost,
+	const QuadratizeCost& quadratizeCost,
 	const std::vector<Matrix<_uDim, _xDim> >& L,
 	const std::vector<Matrix<_xDim> >& xBar, const std::vector<SymmetricMatrix<_xDim> >& SigmaBar, const std::vector<Matrix<_uDim> >& uBar, const std::vector<SymmetricMatrix<_xDim> >& WBar) 
 {
@@ -304,9 +307,9 @@ inline double computeExpectedCost(void (*linearizeDynamics)(const Matrix<_xDim>&
 	return s;
 }
 
-template <size_t _xDim, size_t _uDim, size_t _zDim>
-inline void integrateControlPolicy(void (*linearizeDynamics)(const Matrix<_xDim>&, const Matrix<_uDim>&, Matrix<_xDim>&, Matrix<_xDim, _xDim>&, Matrix<_xDim,_uDim>&, SymmetricMatrix<_xDim>&, unsigned int), 
-	void (*linearizeObservation)(const Matrix<_xDim>&, Matrix<_zDim, _xDim>&, SymmetricMatrix<_zDim>&),
+template <size_t _xDim, size_t _uDim, size_t _zDim, typename LinearizeDynamics, typename LinearizeObservation>
+inline void integrateControlPolicy(const LinearizeDynamics& linearizeDynamics, 
+	const LinearizeObservation& linearizeObservation,
 	const std::vector<Matrix<_uDim, _xDim> >& L, const std::vector<Matrix<_uDim> >& l, double eps,
 	const std::vector<Matrix<_xDim> >& xBar, const SymmetricMatrix<_xDim>& SigmaBar0, const std::vector<Matrix<_uDim> >& uBar, 
 	std::vector<Matrix<_xDim> >& xNext, std::vector<SymmetricMatrix<_xDim> >& SigmaNext, std::vector<Matrix<_uDim> >& uNext, std::vector<SymmetricMatrix<_xDim> >& WNext)
@@ -336,26 +339,36 @@ inline void integrateControlPolicy(void (*linearizeDynamics)(const Matrix<_xDim>
 	}
 }
 
-template <size_t _xDim, size_t _uDim, size_t _zDim>
-inline void forwardIteration(void (*linearizeDynamics)(const Matrix<_xDim>&, const Matrix<_uDim>&, Matrix<_xDim>&, Matrix<_xDim, _xDim>&, Matrix<_xDim,_uDim>&, SymmetricMatrix<_xDim>&, unsigned int), 
-	void (*linearizeObservation)(const Matrix<_xDim>&, Matrix<_zDim, _xDim>&, SymmetricMatrix<_zDim>&),
-	void (*quadratizeFinalCost)(const Matrix<_xDim>&, const SymmetricMatrix<_xDim>&, double&, SymmetricMatrix<_xDim>&, Matrix<1,_xDim>&, Matrix<1,_sDim>&, unsigned int),
-	bool (*quadratizeCost)(const Matrix<_xDim>&, const SymmetricMatrix<_xDim>&, const Matrix<_uDim>&, double&, SymmetricMatrix<_xDim>&, SymmetricMatrix<_uDim>&, Matrix<_uDim, _xDim>&, Matrix<1,_xDim>&, Matrix<1,_uDim>&, Matrix<1,_sDim>&, unsigned int),
+// Rollout buffers for one step size of the line search, allocated once per solve
+template <size_t _xDim, size_t _uDim>
+struct LineSearchBuffers {
+	std::vector<Matrix<_xDim> > xNext;
+	std::vector<SymmetricMatrix<_xDim> > SigmaNext;
+	std::vector<Matrix<_uDim> > uNext;
+	std::vector<SymmetricMatrix<_xDim> > WNext;
+	double eps, cost;
+
+	LineSearchBuffers(size_t pathLen = 0) : xNext(pathLen + 1), SigmaNext(pathLen + 1), uNext(pathLen), WNext(pathLen), eps(0), cost(infCost) { }
+};
+
+template <size_t _xDim, size_t _uDim, size_t _zDim, typename LinearizeDynamics, typename LinearizeObservation, typename QuadratizeFinalCost, typename QuadratizeCost>
+inline void forwardIteration(const LinearizeDynamics& linearizeDynamics, 
+	const LinearizeObservation& linearizeObservation,
+	const QuadratizeFinalCost& quadratizeFinalCost,
+	const QuadratizeCost& quadratizeCost,
 	const std::vector<Matrix<_uDim, _xDim> >& L, const std::vector<Matrix<_uDim> >& l, 
 	std::vector<Matrix<_xDim> >& xBar, std::vector<SymmetricMatrix<_xDim> >& SigmaBar, std::vector<Matrix<_uDim> >& uBar, std::vector<SymmetricMatrix<_xDim> >& WBar, 
-	double& bestCost, double& eps, double gradient)
+	double& bestCost, double& eps, double gradient, LineSearchBuffers<_xDim,_uDim>& buffers)
 {
-	size_t pathLen = uBar.size();
-
-	std::vector<Matrix<_xDim> > xNext(pathLen + 1);
-	std::vector<SymmetricMatrix<_xDim> > SigmaNext(pathLen + 1);
-	std::vector<Matrix<_uDim> > uNext(pathLen);
-	std::vector<SymmetricMatrix<_xDim> > WNext(pathLen);
+	std::vector<Matrix<_xDim> >& xNext = buffers.xNext;
+	std::vector<SymmetricMatrix<_xDim> >& SigmaNext = buffers.SigmaNext;
+	std::vector<Matrix<_uDim> >& uNext = buffers.uNext;
+	std::vector<SymmetricMatrix<_xDim> >& WNext = buffers.WNext;
 
 	double cost;
 
 	/*for (eps *= 2.0; eps > 0.0; eps *= 0.5) {
-	integrateControlPolicy(linearizeDynamics, linearizeObservation,
+	integrateControlPolicy<_xDim,_uDim,_zDim>(linearizeDynamics, linearizeObservation,
 	L, l, eps, xBar, SigmaBar[0], uBar,
 	xNext, SigmaNext, uNext, WNext);
 
@@ -387,7 +400,7 @@ inline void forwardIteration(void (*linearizeDynamics)(const Matrix<_xDim>&, con
 
 	while (eps > 0.0 && (!middleFound || !rightFound)) {
 		// Compute cost at current eps
-		integrateControlPolicy(linearizeDynamics, linearizeObservation,
+		integrateControlPolicy<_xDim,_uDim,_zDim>(linearizeDynamics, linearizeObservation,
 			L, l, eps, xBar, SigmaBar[0], uBar,
 			xNext, SigmaNext, uNext, WNext);
 
@@ -440,7 +453,7 @@ inline void forwardIteration(void (*linearizeDynamics)(const Matrix<_xDim>&, con
 	coeffs = epss % costs;
 	eps = -0.5*coeffs[1]/coeffs[0];
 
-	integrateControlPolicy(linearizeDynamics, linearizeObservation,
+	integrateControlPolicy<_xDim,_uDim,_zDim>(linearizeDynamics, linearizeObservation,
 		L, l, eps, xBar, SigmaBar[0], uBar,
 		xNext, SigmaNext, uNext, WNext);
 
@@ -450,7 +463,7 @@ inline void forwardIteration(void (*linearizeDynamics)(const Matrix<_xDim>&, con
 		bestCost = cost;
 	} else {
 		eps = bestEps;
-		integrateControlPolicy(linearizeDynamics, linearizeObservation,
+		integrateControlPolicy<_xDim,_uDim,_zDim>(linearizeDynamics, linearizeObservation,
 			L, l, eps, xBar, SigmaBar[0], uBar,
 			xNext, SigmaNext, uNext, WNext);
 	}
@@ -464,7 +477,7 @@ inline void forwardIteration(void (*linearizeDynamics)(const Matrix<_xDim>&, con
 
 	for (size_t iter = 0; iter < 10; ++iter) {
 	std::cout << "#";
-	integrateControlPolicy(linearizeDynamics, linearizeObservation,
+	integrateControlPolicy<_xDim,_uDim,_zDim>(linearizeDynamics, linearizeObservation,
 	L, l, eps, xBar, SigmaBar[0], uBar,
 	xNext, SigmaNext, uNext, WNext);
 
@@ -493,7 +506,7 @@ inline void forwardIteration(void (*linearizeDynamics)(const Matrix<_xDim>&, con
 	}
 
 	eps = bestEps;
-	integrateControlPolicy(linearizeDynamics, linearizeObservation,
+	integrateControlPolicy<_xDim,_uDim,_zDim>(linearizeDynamics, linearizeObservation,
 	L, l, eps, xBar, SigmaBar[0], uBar,
 	xNext, SigmaNext, uNext, WNext);
 
@@ -503,14 +516,94 @@ inline void forwardIteration(void (*linearizeDynamics)(const Matrix<_xDim>&, con
 	WBar = WNext;*/
 }
 
-// nominal trajectory given as follows: xBar and SigmaBar must contain at least one item: the initial belief. uBar must contain the control inputs along the initial nominal trajectory.
+// Evaluates one step size per buffer concurrently, starting at twice the previous eps and halving,
+// and keeps the best. If none of them improves on the current cost, the serial bracketing search
+// continues below the smallest one. team has one thread per buffer plus one for the current cost.
+template <size_t _xDim, size_t _uDim, size_t _zDim, typename LinearizeDynamics, typename LinearizeObservation, typename QuadratizeFinalCost, typename QuadratizeCost>
+inline void parallelForwardIteration(const LinearizeDynamics& linearizeDynamics, 
+	const LinearizeObservation& linearizeObservation,
+	const QuadratizeFinalCost& quadratizeFinalCost,
+	const QuadratizeCost& quadratizeCost,
+	const std::vector<Matrix<_uDim, _xDim> >& L, const std::vector<Matrix<_uDim> >& l, 
+	std::vector<Matrix<_xDim> >& xBar, std::vector<SymmetricMatrix<_xDim> >& SigmaBar, std::vector<Matrix<_uDim> >& uBar, std::vector<SymmetricMatrix<_xDim> >& WBar, 
+	double& bestCost, double& eps, double gradient, std::vector<LineSearchBuffers<_xDim,_uDim> >& buffers, util::ForkJoin& team)
+{
+	const int numSteps = buffers.size();
+	const double topEps = std::min(1.0, 2.0*eps);
+
+	// index 0 is the expected cost for eps = 0, index k > 0 evaluates buffers[k-1]
+	auto evaluate = [&](int k) {
+		if (k == 0) {
+			bestCost = computeExpectedCost(linearizeDynamics, quadratizeFinalCost, quadratizeCost, L, xBar, SigmaBar, uBar, WBar);
+			return;
+		}
+
+		LineSearchBuffers<_xDim,_uDim>& b = buffers[k-1];
+		b.eps = ldexp(topEps, -(k-1));
+		integrateControlPolicy<_xDim,_uDim,_zDim>(linearizeDynamics, linearizeObservation,
+			L, l, b.eps, xBar, SigmaBar[0], uBar,
+			b.xNext, b.SigmaNext, b.uNext, b.WNext);
+		b.cost = computeExpectedCost(linearizeDynamics, quadratizeFinalCost, quadratizeCost, L, b.xNext, b.SigmaNext, b.uNext, b.WNext);
+	};
+	team.run(evaluate);
+
+	int best = -1;
+	for (int k = 0; k < numSteps; ++k) {
+		double cost = buffers[k].cost;
+		if (cost < bestCost && abs(cost) < 1.0 / DBL_EPSILON && (best < 0 || cost < buffers[best].cost)) {
+			best = k;
+		}
+	}
+
+	if (best < 0) {
+		eps = 0.5*buffers[numSteps-1].eps;
+		forwardIteration<_xDim,_uDim,_zDim>(linearizeDynamics, linearizeObservation, quadratizeFinalCost, quadratizeCost, L, l, xBar, SigmaBar, uBar, WBar, bestCost, eps, gradient, buffers[0]);
+		return;
+	}
+
+	eps = buffers[best].eps;
+	bestCost = buffers[best].cost;
+	xBar = buffers[best].xNext;
+	SigmaBar = buffers[best].SigmaNext;
+	uBar = buffers[best].uNext;
+	WBar = buffers[best].WNext;
+}
+
+// Buffers the solver reuses across iterations, and across solves with the same horizon, so that
+// repeated solves do not allocate. lineSearchSteps > 1 evaluates that many step sizes of each
+// line search concurrently, on threads that are started once with the workspace.
 template <size_t _xDim, size_t _uDim, size_t _zDim>
-inline void solvePOMDP(void (*linearizeDynamics)(const Matrix<_xDim>&, const Matrix<_uDim>&, Matrix<_xDim>&, Matrix<_xDim, _xDim>&, Matrix<_xDim,_uDim>&, SymmetricMatrix<_xDim>&, unsigned int), 
-	void (*linearizeObservation)(const Matrix<_xDim>&, Matrix<_zDim, _xDim>&, SymmetricMatrix<_zDim>&),
-	void (*quadratizeFinalCost)(const Matrix<_xDim>&, const SymmetricMatrix<_xDim>&, double&, SymmetricMatrix<_xDim>&, Matrix<1,_xDim>&, Matrix<1,_sDim>&, unsigned int),
-	bool (*quadratizeCost)(const Matrix<_xDim>&, const SymmetricMatrix<_xDim>&, const Matrix<_uDim>&, double&, SymmetricMatrix<_xDim>&, SymmetricMatrix<_uDim>&, 
-						   Matrix<_uDim, _xDim>&, Matrix<1,_xDim>&, Matrix<1,_uDim>&, Matrix<1,_sDim>&, unsigned int),
-	std::vector<Matrix<_xDim> >& xBar, std::vector<SymmetricMatrix<_xDim> >& SigmaBar, std::vector<Matrix<_uDim> >& uBar, std::vector<Matrix<_uDim, _xDim> >& L)
+struct ILQGWorkspace {
+	std::vector<Matrix<_uDim> > l;
+	std::vector<SymmetricMatrix<_xDim> > WBar;
+	std::vector<LineSearchBuffers<_xDim,_uDim> > lineSearchBuffers;
+	std::unique_ptr<util::ForkJoin> team;
+	int lineSearchSteps;
+
+	ILQGWorkspace(int lineSearchSteps = 0) : lineSearchSteps(lineSearchSteps) {
+		if (lineSearchSteps > 1) {
+			team.reset(new util::ForkJoin(lineSearchSteps + 1));
+		}
+	}
+
+	void resize(size_t pathLen) {
+		if (l.size() == pathLen && !lineSearchBuffers.empty()) {
+			return;
+		}
+		l.resize(pathLen);
+		WBar.resize(pathLen);
+		lineSearchBuffers.assign(std::max(1, lineSearchSteps), LineSearchBuffers<_xDim,_uDim>(pathLen));
+	}
+};
+
+// nominal trajectory given as follows: xBar and SigmaBar must contain at least one item: the initial belief. uBar must contain the control inputs along the initial nominal trajectory.
+template <size_t _xDim, size_t _uDim, size_t _zDim, typename LinearizeDynamics, typename LinearizeObservation, typename QuadratizeFinalCost, typename QuadratizeCost>
+inline void solvePOMDP(const LinearizeDynamics& linearizeDynamics, 
+	const LinearizeObservation& linearizeObservation,
+	const QuadratizeFinalCost& quadratizeFinalCost,
+	const QuadratizeCost& quadratizeCost,
+	std::vector<Matrix<_xDim> >& xBar, std::vector<SymmetricMatrix<_xDim> >& SigmaBar, std::vector<Matrix<_uDim> >& uBar, std::vector<Matrix<_uDim, _xDim> >& L,
+	ILQGWorkspace<_xDim,_uDim,_zDim>& workspace)
 {
 	double bestCost = DBL_MAX;
 	bool terminate = false;
@@ -520,8 +613,9 @@ inline void solvePOMDP(void (*linearizeDynamics)(const Matrix<_xDim>&, const Mat
 
 	size_t pathLen = uBar.size();
 
-	std::vector<Matrix<_uDim> > l(pathLen);
-	std::vector<SymmetricMatrix<_xDim> > WBar(pathLen);
+	workspace.resize(pathLen);
+	std::vector<Matrix<_uDim> >& l = workspace.l;
+	std::vector<SymmetricMatrix<_xDim> >& WBar = workspace.WBar;
 	L.resize(pathLen);
 	xBar.resize(pathLen + 1);
 	SigmaBar.resize(pathLen + 1);
@@ -550,9 +644,13 @@ inline void solvePOMDP(void (*linearizeDynamics)(const Matrix<_xDim>&, const Mat
 
 	while(!terminate)
 	{
-		backwardIteration(linearizeDynamics, linearizeObservation, quadratizeFinalCost, quadratizeCost, xBar, SigmaBar, uBar, L, l, gradient);
+		backwardIteration<_xDim,_uDim,_zDim>(linearizeDynamics, linearizeObservation, quadratizeFinalCost, quadratizeCost, xBar, SigmaBar, uBar, L, l, gradient);
 		//double prevCost = bestCost;
-		forwardIteration(linearizeDynamics, linearizeObservation, quadratizeFinalCost, quadratizeCost, L, l, xBar, SigmaBar, uBar, WBar, bestCost, eps, gradient);
+		if (workspace.team) {
+			parallelForwardIteration<_xDim,_uDim,_zDim>(linearizeDynamics, linearizeObservation, quadratizeFinalCost, quadratizeCost, L, l, xBar, SigmaBar, uBar, WBar, bestCost, eps, gradient, workspace.lineSearchBuffers, *workspace.team);
+		} else {
+			forwardIteration<_xDim,_uDim,_zDim>(linearizeDynamics, linearizeObservation, quadratizeFinalCost, quadratizeCost, L, l, xBar, SigmaBar, uBar, WBar, bestCost, eps, gradient, workspace.lineSearchBuffers[0]);
+		}
 
 		double absl = 0.0;
 		double absu = 0.0;
@@ -111,8 +111,11 @@ inline SymmetricMatrix<Z_DIM> varN(const Matrix<X_DIM>& x)
 	return S;
 }
 
+// Callbacks are function objects so that solvePOMDP is instantiated for them and can inline them
+
 // Compute closed form quadratic finalCost function around around b
-inline void quadratizeFinalCost(const Matrix<X_DIM>& xBar, const SymmetricMatrix<X_DIM>& SigmaBar, double& s, SymmetricMatrix<X_DIM>& S, Matrix<1,X_DIM>& sT, Matrix<1,S_DIM>& tT, unsigned int flag) 
+struct QuadratizeFinalCost {
+inline void operator()(const Matrix<X_DIM>& xBar, const SymmetricMatrix<X_DIM>& SigmaBar, double& s, SymmetricMatrix<X_DIM>& S, Matrix<1,X_DIM>& sT, Matrix<1,S_DIM>& tT, unsigned int flag) const
 {
 	if (flag & COMPUTE_S) S = QGoal;
 	if (flag & COMPUTE_sT) sT = ~(xBar - xGoal)*QGoal;
@@ -120,10 +123,12 @@ inline void quadratizeFinalCost(const Matrix<X_DIM>& xBar, const SymmetricMatrix
 	if (flag & COMPUTE_s) s = 2*(0.5*scalar(~(xBar - xGoal)*QGoal*(xBar - xGoal)) + scalar(vecTh(QGoal)*vectorize(SigmaBar)));
 	if (flag & COMPUTE_tT) tT = vecTh(QGoal);
 }
+};
 
 // Compute closed form quadratic cost function around around b and u
-inline bool quadratizeCost(const Matrix<X_DIM>& xBar, const SymmetricMatrix<X_DIM>& SigmaBar, const Matrix<U_DIM>& uBar, double& q, SymmetricMatrix<X_DIM>& Q, SymmetricMatrix<U_DIM>& R, 
-						   Matrix<U_DIM, X_DIM>& P, Matrix<1,X_DIM>& qT, Matrix<1,U_DIM>& rT, Matrix<1,S_DIM>& pT, unsigned int flag) 
+struct QuadratizeCost {
+inline bool operator()(const Matrix<X_DIM>& xBar, const SymmetricMatrix<X_DIM>& SigmaBar, const Matrix<U_DIM>& uBar, double& q, SymmetricMatrix<X_DIM>& Q, SymmetricMatrix<U_DIM>& R, 
+						   Matrix<U_DIM, X_DIM>& P, Matrix<1,X_DIM>& qT, Matrix<1,U_DIM>& rT, Matrix<1,S_DIM>& pT, unsigned int flag) const
 {
 	if (flag & COMPUTE_Q) Q = zeros<X_DIM>(); // penalize uncertainty
 	if (flag & COMPUTE_R) R = Rint;
@@ -136,20 +141,25 @@ inline bool quadratizeCost(const Matrix<X_DIM>& xBar, const SymmetricMatrix<X_DI
 
 	return true;
 }
+};
 
-inline void linearizeDynamics(const Matrix<X_DIM>& xBar, const Matrix<U_DIM>& uBar, Matrix<X_DIM>& c, Matrix<X_DIM, X_DIM>& A, Matrix<X_DIM, U_DIM>& B, SymmetricMatrix<X_DIM>& M, unsigned int flag)
+struct LinearizeDynamics {
+inline void operator()(const Matrix<X_DIM>& xBar, const Matrix<U_DIM>& uBar, Matrix<X_DIM>& c, Matrix<X_DIM, X_DIM>& A, Matrix<X_DIM, U_DIM>& B, SymmetricMatrix<X_DIM>& M, unsigned int flag) const
 {
 	if (flag & COMPUTE_c) c = f(xBar, uBar);
 	if (flag & COMPUTE_A) A = dfdx(f, xBar, uBar); //identity<X_DIM>();
 	if (flag & COMPUTE_B) B = dfdu(f, xBar, uBar); //identity<U_DIM>();
 	if (flag & COMPUTE_M) M = varM(xBar, uBar);
 }
+};
 
-inline void linearizeObservation(const Matrix<X_DIM>& xBar, Matrix<Z_DIM, X_DIM>& H, SymmetricMatrix<Z_DIM>& N)
+struct LinearizeObservation {
+inline void operator()(const Matrix<X_DIM>& xBar, Matrix<Z_DIM, X_DIM>& H, SymmetricMatrix<Z_DIM>& N) const
 {
 	H = dhdx(h, xBar); // identity<X_DIM>();
 	N = varN(xBar);
 }
+};
 
 
 double costfunc(const std::vector< Matrix<B_DIM> >& B, const std::vector< Matrix<U_DIM> >& U)
@@ -196,7 +206,10 @@ int main(int argc, char* argv[])
 	}
 	double cost_initial = costfunc(Binitial, uBar);
 
-	solvePOMDP(linearizeDynamics, linearizeObservation, quadratizeFinalCost, quadratizeCost, xBar, SigmaBar, uBar, L);
+	// line search over 4 step sizes at a time
+	ILQGWorkspace<X_DIM,U_DIM,Z_DIM> workspace(4);
+
+	solvePOMDP(LinearizeDynamics(), LinearizeObservation(), QuadratizeFinalCost(), QuadratizeCost(), xBar, SigmaBar, uBar, L, workspace);
 
 	//for (size_t i = 0; i < xBar.size(); ++i) {
 	//	std::cout << ~(xBar[i]);
@@ -29,6 +29,8 @@ double PR2EihSqp::collocation(StdVectorJ& J, StdVectorU& U, const MatrixJ& j_sig
 	double alpha = cfg::alpha_init;
 	double cost = INFINITY;
 
+	sys.set_obstacles(obstacles);
+
 	for(int num_alpha_increases=0; num_alpha_increases < cfg::alpha_max_increases; ++num_alpha_increases) {
 		LOG_DEBUG("Calling approximate collocation with alpha = %4.2f", alpha);
 		cost = approximate_collocation(J, U, j_sigma0, obj_gaussians, alpha, obstacles, sys, plot);
@@ -245,6 +247,8 @@ double PR2EihSqp::approximate_collocation(StdVectorJ& J, StdVectorU& U, const Ma
 		LOG_DEBUG(" ");
 		LOG_DEBUG(" ");
 		LOG_DEBUG("Iter: %d", it);
+		LOG_DEBUG("Frustum cache since the last iteration: %d hits, %d misses", sys.get_frustum_cache().hits(), sys.get_frustum_cache().misses());
+		sys.get_frustum_cache().reset_counters();
 
 		// only compute gradient/hessian if P/U has been changed
 		if (solution_accepted) {
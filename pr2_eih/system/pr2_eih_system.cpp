@@ -30,6 +30,8 @@ PR2EihSystem::PR2EihSystem(pr2_sim::Simulator *s, pr2_sim::Arm *a, pr2_sim::Came
 	R = R_diag.asDiagonal();
 
 	arm->set_posture(pr2_sim::Arm::Posture::mantis);
+
+	cull_obstacles = cull_volume_contains_frustum();
 }
 
 /**
@@ -127,8 +129,7 @@ MatrixZ PR2EihSystem::delta_matrix(const VectorJ& j, const Vector3d& object, con
 		// use relative pyramid
 		sd = cached_relative_pyramids[timestep][gaussian].signed_distance(cam_pose, object);
 	} else {
-		std::vector<geometry3d::TruncatedPyramid> truncated_frustum = cam->truncated_view_frustum(cam_pose, obstacles, false);
-		sd = cam->signed_distance(object, truncated_frustum);
+		sd = cam->signed_distance(object, truncated_view_frustum(cam_pose, obstacles, false));
 	}
 
 	double error = cam->radial_distance_error(cam_pose, object);
@@ -184,7 +185,13 @@ void PR2EihSystem::execute_control_step(const VectorJ& j_t_real, const VectorJ&
 	obj_gaussians_tp1.clear();
 	for(const Gaussian3d& obj_gaussian_t : obj_gaussians_t) {
 		const MatrixP& P_t = obj_gaussian_t.particles;
-		VectorP W_tp1 = update_particle_weights(j_tp1, P_t, (1/double(M_DIM))*VectorP::Ones(), obstacles);
+		// the filter update is not differenced, so it takes the single precision batch path
+		util::ParticleSet particles(3, P_t.cols());
+		particles.set_particles(P_t.data());
+		update_particle_weights(j_tp1, particles, obstacles);
+
+		VectorP W_tp1(P_t.cols());
+		particles.get_weights(W_tp1.data());
 		MatrixP P_tp1 = low_variance_sampler(P_t, W_tp1);
 
 		obj_gaussians_tp1.push_back(Gaussian3d(P_tp1));
@@ -270,7 +277,8 @@ void PR2EihSystem::cost_and_grad(StdVectorJ& J, const MatrixJ& j_sigma0, StdVect
 	const int M = obj_gaussians.size();
 	for(int t=0; t < TIMESTEPS-1; ++t) {
 		VectorJ j_tp1 = dynfunc(J[t], U[t], VectorQ::Zero(), true);
-		std::vector<geometry3d::TruncatedPyramid> truncated_frustum = cam->truncated_view_frustum(cam->get_pose(j_tp1), obstacles, false);
+		const std::vector<geometry3d::TruncatedPyramid>& truncated_frustum =
+				truncated_view_frustum(cam->get_pose(j_tp1), obstacles, false);
 		cached_relative_pyramids[t+1].resize(M);
 		for(int m=0; m < M; ++m) {
 			cached_relative_pyramids[t+1][m] = pr2_sim::RelativePyramid(cam->get_pose(j_tp1), cam, truncated_frustum, obstacles, obj_gaussians[m].mean);
@@ -312,14 +320,18 @@ void PR2EihSystem::cost_and_grad(StdVectorJ& J, const MatrixJ& j_sigma0, StdVect
 	cached_relative_pyramids.clear();
 }
 
+/**
+ * \brief Double precision weight update, for entropy, which entropy_grad central-differences
+ *        with a step far below the single precision path's resolution
+ */
 VectorP PR2EihSystem::update_particle_weights(const VectorJ& j_tp1, const MatrixP& P_t, const VectorP& W_t,
 		const std::vector<geometry3d::Triangle>& obstacles, bool add_radial_error) {
 	Matrix4d cam_pose = cam->get_pose(j_tp1);
-	std::vector<geometry3d::TruncatedPyramid> truncated_frustum = cam->truncated_view_frustum(cam_pose, obstacles, true);
+	const std::vector<geometry3d::TruncatedPyramid>& truncated_frustum = truncated_view_frustum(cam_pose, obstacles, true);
 
-	VectorP W_tp1;
+	VectorP W_tp1(P_t.cols());
 	// for each particle, weight by sigmoid of signed distance
-	for(int m=0; m < M_DIM; ++m) {
+	for(int m=0; m < P_t.cols(); ++m) {
 		double sd = cam->signed_distance(P_t.col(m), truncated_frustum);
 
 		if (add_radial_error) {
@@ -334,34 +346,148 @@ VectorP PR2EihSystem::update_particle_weights(const VectorJ& j_tp1, const Matrix
 	return W_tp1;
 }
 
-MatrixP PR2EihSystem::low_variance_sampler(const MatrixP& P, const VectorP& W) {
-	MatrixP P_sampled(3,M_DIM);
-
-	double r = (1/double(M_DIM))*(rand() / double(RAND_MAX));
-	double c = W(0);
-	int i = 0;
-	for(int m=0; m < M_DIM; ++m) {
-		double u = r + m * (1/double(M_DIM));
-		while (u > c) {
-			c += W(++i);
+/**
+ * \brief Single precision batch weight update, for the filter in execute_control_step
+ */
+
+void PR2EihSystem::update_particle_weights(const VectorJ& j_tp1, util::ParticleSet& particles,
+		const std::vector<geometry3d::Triangle>& obstacles, bool add_radial_error) {
+	Matrix4d cam_pose = cam->get_pose(j_tp1);
+	const std::vector<geometry3d::TruncatedPyramid>& truncated_frustum = truncated_view_frustum(cam_pose, obstacles, true);
+
+	// signed distance of each particle into the scratch row
+	const float *x = particles.coord(0), *y = particles.coord(1), *z = particles.coord(2);
+	float* sd = particles.scratch();
+	for(int m=0; m < particles.size(); ++m) {
+		Vector3d p(x[m], y[m], z[m]);
+		sd[m] = cam->signed_distance(p, truncated_frustum);
+
+		if (add_radial_error) {
+			sd[m] += cam->radial_distance_error(cam_pose, p);
 		}
-		P_sampled.col(m) = P.col(i) + .01*Vector3d::Random();
 	}
 
+	// weight by sigmoid of signed distance, across all particles at once
+	particles.multiply_sigmoid(sd, alpha_particle_sd);
+	particles.normalize();
+}
+
+/**
+ * \brief cam->truncated_view_frustum through frustum_cache, clipping only against the
+ *        obstacles obstacles_bvh finds in the view volume. The reference is valid
+ *        until the next call.
+ */
+const std::vector<geometry3d::TruncatedPyramid>& PR2EihSystem::truncated_view_frustum(const Matrix4d& cam_pose,
+		const std::vector<geometry3d::Triangle>& obstacles, bool should_clip) {
+	// contents are only compared in set_obstacles, once per planning call
+	if ((obstacles.data() != frustum_cache_obstacles_source) || (obstacles.size() != frustum_cache_obstacles.size())) {
+		set_obstacles(obstacles);
+	}
+
+	double pose[12];
+	for(int i=0; i < 3; ++i) {
+		for(int j=0; j < 4; ++j) {
+			pose[4*i+j] = cam_pose(i,j);
+		}
+	}
+
+	std::vector<geometry3d::TruncatedPyramid>* frustum = frustum_cache.find(pose, should_clip);
+	if (frustum != NULL) {
+		return *frustum;
+	}
+
+	if (!cull_obstacles) {
+		return frustum_cache.insert(pose, cam->truncated_view_frustum(cam_pose, frustum_cache_obstacles, should_clip), should_clip);
+	}
+
+	// obstacles outside the view volume cannot truncate the frustum
+	obstacles_bvh.query(TriangleBVH::view_volume(cam_pose, cull_tan_half_width, cull_tan_half_height, cull_max_range),
+			culled_indices);
+	culled_obstacles.clear();
+	for(int i=0; i < culled_indices.size(); ++i) {
+		culled_obstacles.push_back(frustum_cache_obstacles[culled_indices[i]]);
+	}
+
+	return frustum_cache.insert(pose, cam->truncated_view_frustum(cam_pose, culled_obstacles, should_clip), should_clip);
+}
+
+void PR2EihSystem::set_obstacles(const std::vector<geometry3d::Triangle>& obstacles) {
+	frustum_cache_obstacles_source = obstacles.data();
+	// the obstacles are plain vertex data, compared bytewise
+	if ((obstacles.size() == frustum_cache_obstacles.size()) && ((obstacles.size() == 0) ||
+			(memcmp(&obstacles[0], &frustum_cache_obstacles[0], obstacles.size()*sizeof(geometry3d::Triangle)) == 0))) {
+		return;
+	}
+
+	frustum_cache.clear();
+	frustum_cache_obstacles = obstacles;
+	obstacles_bvh.build(frustum_cache_obstacles);
+}
+
+/**
+ * \brief Checks that no point just outside the cull volume (on a grid over its four
+ *        sides and its far plane) is in the untruncated view frustum of cam
+ */
+bool PR2EihSystem::cull_volume_contains_frustum() {
+	Matrix4d cam_pose = cam->get_pose();
+	std::vector<geometry3d::TruncatedPyramid> frustum =
+			cam->truncated_view_frustum(cam_pose, std::vector<geometry3d::Triangle>(), false);
+	Matrix3d rot = cam_pose.block<3,3>(0,0);
+	Vector3d trans = cam_pose.block<3,1>(0,3);
+
+	const double eps = 1e-3;
+	const int samples = 20;
+	for(int i=0; i <= samples; ++i) {
+		double z = cull_max_range*i/double(samples);
+		double half_width = cull_tan_half_width*z, half_height = cull_tan_half_height*z;
+		for(int k=0; k <= samples; ++k) {
+			double s = 2*k/double(samples) - 1;
+			double r = 2*i/double(samples) - 1;
+			const Vector3d outside_cam[] = {Vector3d(half_width + eps, s*half_height, z),
+					Vector3d(-half_width - eps, s*half_height, z),
+					Vector3d(s*half_width, half_height + eps, z),
+					Vector3d(s*half_width, -half_height - eps, z),
+					Vector3d(s*cull_tan_half_width*cull_max_range, r*cull_tan_half_height*cull_max_range, cull_max_range + eps)};
+			for(const Vector3d& p_cam : outside_cam) {
+				if (cam->is_in_fov(rot*p_cam + trans, frustum)) {
+					LOG_ERROR("cull volume (tan half width %f, tan half height %f, max range %f) does not contain the camera frustum, not culling obstacles",
+							cull_tan_half_width, cull_tan_half_height, cull_max_range);
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * Resamples to an adaptive number of particles (KLD-sampling), more while the
+ * belief is spread over the grid and fewer once it has collapsed
+ */
+MatrixP PR2EihSystem::low_variance_sampler(const MatrixP& P, const VectorP& W) {
+	util::Random& random = util::thread_random();
+	std::vector<int> indices;
+	kld.resample(P.data(), 3, W.data(), P.cols(), random.uniform(), indices);
+
+	// copy with uniform jitter in [-.01, .01], drawn from a stream keyed by a fresh seed
+	MatrixP P_sampled(3, indices.size());
+	uint64_t seed = (uint64_t(random.uniform()*4294967296.0) << 32) | uint64_t(random.uniform()*4294967296.0);
+	kld.resampler.gather(P.data(), 3, &indices[0], indices.size(), P_sampled.data(), .01, seed);
+
 	return P_sampled;
 }
 
 double PR2EihSystem::entropy(const StdVectorJ& J, const StdVectorU& U, const MatrixP& P, const std::vector<geometry3d::Triangle>& obstacles) {
 	double entropy = 0;
 
-	VectorP W_t = (1/double(M_DIM))*VectorP::Ones(), W_tp1;
+	// entropy_grad differences this, so it stays in double precision
+	VectorP W_t = (1/double(P.cols()))*VectorP::Ones(P.cols()), W_tp1;
 	for(int t=0; t < TIMESTEPS-1; ++t) {
 		VectorJ j_tp1 = dynfunc(J[t], U[t], VectorQ::Zero());
 
 		W_tp1 = update_particle_weights(j_tp1, P, W_t, obstacles, true);
 
-//		entropy += (-W_tp1.array() * W_tp1.array().log()).sum();
-		for(int m=0; m < M_DIM; ++m) { // safe log
+		for(int m=0; m < W_tp1.rows(); ++m) { // safe log
 			if (W_tp1(m) > 1e-8) {
 				entropy += -W_tp1(m)*log(W_tp1(m));
 			}
@@ -430,7 +556,7 @@ void PR2EihSystem::plot(const StdVectorJ& J, const std::vector<Gaussian3d>& obj_
 		Matrix3d obj_sigma_world = sim->transform_from_to(obj_sigma_T, "base_link", "world").block<3,3>(0,0);
 		sim->plot_gaussian(obj_world, obj_sigma_world, {0,1,0});
 
-		for(int m=0; m < M_DIM; ++m) {
+		for(int m=0; m < obj_gaussian.particles.cols(); ++m) {
 			Vector3d particle = obj_gaussian.particles.col(m);
 			sim->plot_point(sim->transform_from_to(particle, "base_link", "world"), {0,1,0}, .001);
 		}
@@ -464,7 +590,7 @@ void PR2EihSystem::plot(const StdVectorJ& J, const MatrixP& P,
 		obstacle.plot(*sim, "base_link", {0,0,1}, true, 0.25);
 	}
 
-	for(int m=0; m < M_DIM; ++m) {
+	for(int m=0; m < P.cols(); ++m) {
 		Vector3d particle = P.col(m);
 		sim->plot_point(sim->transform_from_to(particle, "base_link", "world"), {0,1,0}, .005);
 	}
@@ -517,25 +643,26 @@ void PR2EihSystem::linearize_dynfunc(const VectorX& x, const VectorU& u, const V
 //	}
 }
 
+/**
+ * \brief obsfunc is linear in the object and the noise, so only the joint columns
+ *        are differenced (through cam->get_pose)
+ */
 void PR2EihSystem::linearize_obsfunc(const VectorX& x, const VectorR& r,
 		Matrix<double,Z_DIM,X_DIM>& H, Matrix<double,Z_DIM,R_DIM>& N) {
 	H.setZero();
 	VectorX x_p = x, x_m = x;
-	for(int i=0; i < X_DIM; ++i) {
+	for(int i=0; i < J_DIM; ++i) {
 		x_p(i) += step; x_m(i) -= step;
 		H.block<Z_DIM,1>(0, i) = (obsfunc(x_p.segment<J_DIM>(0), x_p.segment<3>(J_DIM), r) -
 				obsfunc(x_m.segment<J_DIM>(0), x_m.segment<3>(J_DIM), r)) / (2*step);
 		x_p(i) = x(i); x_m(i) = x(i);
 	}
 
-	N.setZero();
-	VectorR r_p = r, r_m = r;
-	for(int i=0; i < R_DIM; ++i) {
-		r_p(i) += step; r_m(i) -= step;
-		N.block<Z_DIM,1>(0, i) = (obsfunc(x.segment<J_DIM>(0), x.segment<3>(J_DIM), r_p) -
-				obsfunc(x.segment<J_DIM>(0), x.segment<3>(J_DIM), r_m)) / (2*step);
-		r_p(i) = r(i); r_m(i) = r(i);
-	}
+	// object in the camera frame
+	Matrix4d cam_pose_inv = cam->get_pose(x.segment<J_DIM>(0)).inverse();
+	H.block<3,3>(J_DIM, J_DIM) = cam_pose_inv.block<3,3>(0,0);
+
+	N = Matrix<double,Z_DIM,R_DIM>::Identity();
 }
 
 double PR2EihSystem::gauss_likelihood(const Vector3d& v, const Matrix3d& S) {
@@ -5,13 +5,17 @@
 #include "pr2_utils/pr2_sim/arm.h"
 #include "pr2_utils/pr2_sim/camera.h"
 
-#include <random>
+#include "triangle_bvh.h"
 
 #include <Eigen/Eigen>
 #include <Eigen/StdVector>
 using namespace Eigen;
 
 #include "../../util/logging.h"
+#include "../../util/random.h"
+#include "../../util/particles.h"
+#include "../../util/resampling.h"
+#include "../../util/pose-cache.h"
 
 #define TIMESTEPS 5
 #define DT 1.0 // Note: if you change this, must change the FORCES matlab file
@@ -26,7 +30,9 @@ using namespace Eigen;
 
 #define TOTAL_VARS (TIMESTEPS*J_DIM + (TIMESTEPS-1)*U_DIM)
 
-#define M_DIM 1000 // number of particles per object gaussian
+#define M_DIM 1000 // initial and maximum number of particles per object gaussian
+#define M_MIN 100 // minimum number of particles per object gaussian
+#define M_BIN_SIZE .02 // KLD-sampling grid resolution
 
 typedef Matrix<double,X_DIM,1> VectorX;
 //typedef Matrix<double,J_DIM,1> VectorJ;
@@ -35,7 +41,7 @@ typedef Matrix<double,Q_DIM,1> VectorQ;
 typedef Matrix<double,Z_DIM,1> VectorZ;
 typedef Matrix<double,R_DIM,1> VectorR;
 typedef Matrix<double,TOTAL_VARS,1> VectorTOTAL;
-typedef Matrix<double,M_DIM,1> VectorP;
+typedef Matrix<double,Dynamic,1> VectorP;
 
 typedef Matrix<double,X_DIM,X_DIM> MatrixX;
 typedef Matrix<double,J_DIM,J_DIM> MatrixJ;
@@ -46,7 +52,7 @@ typedef Matrix<double,R_DIM,R_DIM> MatrixR;
 typedef Matrix<double,TOTAL_VARS,TOTAL_VARS> MatrixTOTAL;
 typedef Matrix<double,G_DIM,J_DIM> MatrixJac;
 
-typedef Matrix<double,3,M_DIM> MatrixP;
+typedef Matrix<double,3,Dynamic> MatrixP; // particles are columns, their number adapts
 
 typedef std::vector<VectorX, aligned_allocator<VectorX>> StdVectorX;
 typedef std::vector<VectorJ, aligned_allocator<VectorJ>> StdVectorJ;
@@ -61,14 +67,12 @@ public:
 
 	Gaussian3d(const Vector3d& mean, const Matrix3d& cov, const MatrixP& particles) : mean(mean), cov(cov), particles(particles) { }
 	Gaussian3d(const Vector3d& mean, const Matrix3d& cov) : mean(mean), cov(cov) {
-		std::default_random_engine generator;
-		std::normal_distribution<double> distribution(0.0,1.0);
-
 		Matrix3d cov_chol = cov.llt().matrixL();
+		MatrixP z(3, M_DIM);
+		util::thread_random().normal(z.data(), z.size());
+		particles.resize(3, M_DIM);
 		for(int m=0; m < M_DIM; ++m) {
-			Vector3d z = {distribution(generator), distribution(generator), distribution(generator)};
-//			z.normalize();
-			particles.col(m) = cov_chol*z + mean;
+			particles.col(m) = cov_chol*z.col(m) + mean;
 		}
 
 	}
@@ -76,7 +80,7 @@ public:
 		mean = particles.rowwise().mean();
 
 		MatrixP particles_centered = particles.colwise() - particles.rowwise().mean();
-		cov = (1/double(M_DIM-1))*(particles_centered*particles_centered.transpose());
+		cov = (1/double(particles.cols()-1))*(particles_centered*particles_centered.transpose());
 	}
 };
 
@@ -90,6 +94,13 @@ public:
 
 	const double alpha_particle_sd = 1e3; // 100
 
+	// obstacles are culled against this view volume before the frustum is truncated, so it
+	// has to contain the camera frustum (checked against cam at construction, culling is
+	// turned off if it does not)
+	const double cull_tan_half_width = .6;
+	const double cull_tan_half_height = .6;
+	const double cull_max_range = 3;
+
 	PR2EihSystem(pr2_sim::Simulator *s, pr2_sim::Arm *a, pr2_sim::Camera *c);
 	PR2EihSystem() : PR2EihSystem(NULL, NULL, NULL) { }
 
@@ -119,6 +130,8 @@ public:
 
 	VectorP update_particle_weights(const VectorJ& j_tp1, const MatrixP& P_t, const VectorP& W_t,
 			const std::vector<geometry3d::Triangle>& obstacles, bool add_radial_error=false);
+	void update_particle_weights(const VectorJ& j_tp1, util::ParticleSet& particles,
+			const std::vector<geometry3d::Triangle>& obstacles, bool add_radial_error=false);
 	MatrixP low_variance_sampler(const MatrixP& P, const VectorP& W);
 
 	double entropy(const StdVectorJ& J, const StdVectorU& U, const MatrixP& P, const std::vector<geometry3d::Triangle>& obstacles);
@@ -129,6 +142,20 @@ public:
 	void plot(const StdVectorJ& J, const MatrixP& P,
 			const std::vector<geometry3d::Triangle>& obstacles, bool pause=true);
 
+	/**
+	 * \brief Truncated view frusta keyed by camera pose, so cost evaluations that revisit
+	 *        a configuration (other timesteps of a finite difference, other gaussians,
+	 *        line searches) do not truncate again. Cleared when the obstacles change.
+	 */
+	util::PoseCache<std::vector<geometry3d::TruncatedPyramid> >& get_frustum_cache() { return frustum_cache; }
+
+	/**
+	 * \brief Builds the obstacle BVH and clears frustum_cache. Called once per planning
+	 *        call; other calls only check that they pass the same obstacles vector (by
+	 *        address and size), so obstacles changed in place need another set_obstacles.
+	 */
+	void set_obstacles(const std::vector<geometry3d::Triangle>& obstacles);
+
 private:
 	pr2_sim::Simulator *sim;
 	pr2_sim::Arm *arm;
@@ -140,6 +167,20 @@ private:
 
 	std::vector<std::vector<pr2_sim::RelativePyramid> > cached_relative_pyramids; // [timestep][gaussian]
 
+	util::PoseCache<std::vector<geometry3d::TruncatedPyramid> > frustum_cache;
+	std::vector<geometry3d::Triangle> frustum_cache_obstacles;
+	const geometry3d::Triangle* frustum_cache_obstacles_source = NULL; // address of the vector last set
+	TriangleBVH obstacles_bvh; // over frustum_cache_obstacles
+	bool cull_obstacles;
+	std::vector<int> culled_indices;
+	std::vector<geometry3d::Triangle> culled_obstacles;
+
+	const std::vector<geometry3d::TruncatedPyramid>& truncated_view_frustum(const Matrix4d& cam_pose,
+			const std::vector<geometry3d::Triangle>& obstacles, bool should_clip);
+	bool cull_volume_contains_frustum();
+
+	util::KLDSampling kld = util::KLDSampling(M_BIN_SIZE, M_MIN, M_DIM);
+
 	void linearize_dynfunc(const VectorX& x, const VectorU& u, const VectorQ& q,
 			Matrix<double,X_DIM,X_DIM>& A, Matrix<double,X_DIM,Q_DIM>& M);
 	void linearize_obsfunc(const VectorX& x, const VectorR& r,
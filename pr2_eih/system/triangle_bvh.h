@@ -0,0 +1,207 @@
+#ifndef __TRIANGLE_BVH_H__
+#define __TRIANGLE_BVH_H__
+
+#include <Eigen/Eigen>
+#include <Eigen/StdVector>
+using namespace Eigen;
+
+#include <vector>
+#include <algorithm>
+
+/**
+ * Bounding volume hierarchy over a list of triangles (any type with Vector3d members
+ * a, b and c, e.g. geometry3d::Triangle), to find the triangles that may touch a convex
+ * volume such as a view frustum without testing every one.
+ *
+ * Built top down by median splits of the triangle centroids along the widest axis of
+ * the node's box. A query descends only into boxes not entirely outside one of the
+ * planes (at most 32), and keeps a leaf triangle unless all its vertices are outside the
+ * same plane. Planes a box is entirely inside of are not tested again below it. The test
+ * is conservative: it never drops a triangle that intersects the volume.
+ */
+class TriangleBVH {
+public:
+	typedef std::vector<Vector4d, aligned_allocator<Vector4d> > Planes; // (n, d), inside where n.dot(x) + d >= 0
+
+	static const int LEAF_SIZE = 4;
+
+	TriangleBVH() { }
+
+	template<typename TriangleT>
+	TriangleBVH(const std::vector<TriangleT>& triangles) { build(triangles); }
+
+	template<typename TriangleT>
+	void build(const std::vector<TriangleT>& triangles) {
+		int n = triangles.size();
+		vertices.resize(9*n);
+		for(int i=0; i < n; ++i) {
+			const Vector3d* v[3] = {&triangles[i].a, &triangles[i].b, &triangles[i].c};
+			for(int j=0; j < 3; ++j) {
+				for(int d=0; d < 3; ++d) {
+					vertices[9*i + 3*j + d] = (*v[j])(d);
+				}
+			}
+		}
+
+		order.resize(n);
+		centroids.resize(n);
+		for(int i=0; i < n; ++i) {
+			order[i] = i;
+			centroids[i] = (triangles[i].a + triangles[i].b + triangles[i].c) / 3.0;
+		}
+
+		nodes.clear();
+		nodes.reserve(2*(n / LEAF_SIZE + 1));
+		if (n > 0) {
+			build_node(0, n);
+		}
+		centroids.clear();
+	}
+
+	/**
+	 * \brief Indices (in increasing order) of the triangles that may intersect the volume
+	 */
+	void query(const Planes& planes, std::vector<int>& indices) const {
+		indices.clear();
+		if (nodes.empty()) { return; }
+
+		// bit p set while the box may still cross plane p, children of a box entirely
+		// on the inside of a plane skip it
+		int stack[64], masks[64], top = 0;
+		stack[top] = 0;
+		masks[top++] = (1 << planes.size()) - 1;
+		while (top > 0) {
+			--top;
+			int n = stack[top], mask = masks[top];
+			const Node& node = nodes[n];
+			if (!clip_box(node, planes, mask)) { continue; }
+
+			if (node.count > 0) {
+				for(int i=node.first; i < node.first + node.count; ++i) {
+					if ((mask == 0) || !triangle_outside(order[i], planes, mask)) {
+						indices.push_back(order[i]);
+					}
+				}
+			} else {
+				stack[top] = node.first; // right child
+				masks[top++] = mask;
+				stack[top] = n + 1;      // left child, stored right after its parent
+				masks[top++] = mask;
+			}
+		}
+		std::sort(indices.begin(), indices.end());
+	}
+
+	/**
+	 * \brief The pyramid of a camera at cam_pose looking down its z axis, out to max_range,
+	 *        whose sides have slopes tan_half_width (x/z) and tan_half_height (y/z)
+	 */
+	static Planes view_volume(const Matrix4d& cam_pose, double tan_half_width, double tan_half_height, double max_range) {
+		const Vector3d normals_cam[] = {Vector3d(0,0,1), Vector3d(0,0,-1),
+				Vector3d(1,0,tan_half_width), Vector3d(-1,0,tan_half_width),
+				Vector3d(0,1,tan_half_height), Vector3d(0,-1,tan_half_height)};
+		const double offsets_cam[] = {0, max_range, 0, 0, 0, 0};
+
+		Planes planes(6);
+		Matrix3d rot = cam_pose.block<3,3>(0,0);
+		Vector3d trans = cam_pose.block<3,1>(0,3);
+		for(int p=0; p < 6; ++p) {
+			Vector3d normal = rot*normals_cam[p].normalized();
+			double offset = offsets_cam[p] / normals_cam[p].norm();
+			planes[p] << normal, offset - normal.dot(trans);
+		}
+		return planes;
+	}
+
+	int size() const { return order.size(); }
+	int num_nodes() const { return nodes.size(); }
+
+private:
+	struct Node {
+		double lo[3], hi[3];
+		int first; // leaf: first index into order; interior: right child
+		int count; // leaf: number of triangles; interior: 0
+	};
+
+	std::vector<Node> nodes;
+	std::vector<int> order;
+	std::vector<double> vertices; // 9 per triangle
+	std::vector<Vector3d, aligned_allocator<Vector3d> > centroids; // only while building
+
+	int build_node(int begin, int end) {
+		int index = nodes.size();
+		nodes.push_back(Node());
+
+		Array3d lo = Array3d::Constant(INFINITY), hi = Array3d::Constant(-INFINITY);
+		Array3d centroid_lo = lo, centroid_hi = hi;
+		for(int i=begin; i < end; ++i) {
+			for(int v=0; v < 3; ++v) {
+				Map<const Array3d> vertex(&vertices[9*order[i] + 3*v]);
+				lo = lo.min(vertex);
+				hi = hi.max(vertex);
+			}
+			centroid_lo = centroid_lo.min(centroids[order[i]].array());
+			centroid_hi = centroid_hi.max(centroids[order[i]].array());
+		}
+		for(int d=0; d < 3; ++d) {
+			nodes[index].lo[d] = lo(d);
+			nodes[index].hi[d] = hi(d);
+		}
+
+		int axis;
+		double extent = (centroid_hi - centroid_lo).maxCoeff(&axis);
+		if ((end - begin <= LEAF_SIZE) || (extent <= 0)) {
+			nodes[index].first = begin;
+			nodes[index].count = end - begin;
+			return index;
+		}
+
+		int middle = begin + (end - begin)/2;
+		std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+				[this, axis](int i, int j) { return centroids[i](axis) < centroids[j](axis); });
+
+		build_node(begin, middle);
+		int right = build_node(middle, end);
+		nodes[index].first = right;
+		nodes[index].count = 0;
+		return index;
+	}
+
+	/**
+	 * \brief False if the box is entirely outside one of the planes in mask, otherwise
+	 *        clears the planes it is entirely inside of from mask
+	 */
+	static bool clip_box(const Node& node, const Planes& planes, int& mask) {
+		for(int p=0; p < planes.size(); ++p) {
+			if ((mask & (1 << p)) == 0) { continue; }
+
+			// signed distances of the corners furthest along and against the normal
+			const Vector4d& plane = planes[p];
+			double far = plane(3), near = plane(3);
+			for(int d=0; d < 3; ++d) {
+				far += plane(d) * ((plane(d) >= 0) ? node.hi[d] : node.lo[d]);
+				near += plane(d) * ((plane(d) >= 0) ? node.lo[d] : node.hi[d]);
+			}
+			if (far < 0) { return false; }
+			if (near >= 0) { mask &= ~(1 << p); }
+		}
+		return true;
+	}
+
+	bool triangle_outside(int t, const Planes& planes, int mask) const {
+		const double* v = &vertices[9*t];
+		for(int p=0; p < planes.size(); ++p) {
+			if ((mask & (1 << p)) == 0) { continue; }
+
+			const Vector4d& plane = planes[p];
+			bool outside = true;
+			for(int i=0; (i < 3) && outside; ++i) {
+				outside = (plane(0)*v[3*i] + plane(1)*v[3*i+1] + plane(2)*v[3*i+2] + plane(3) < 0);
+			}
+			if (outside) { return true; }
+		}
+		return false;
+	}
+};
+
+#endif
@@ -0,0 +1,125 @@
+#include "system/triangle_bvh.h"
+
+#include "../../util/Timer.h"
+#include "../../util/logging.h"
+#include "../../util/random.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#define NUM_POSES 200
+
+// slopes of the PR2 hand camera frustum sides, and its range
+#define TAN_HALF_WIDTH .25
+#define TAN_HALF_HEIGHT .25
+#define MAX_RANGE 1.5
+
+// stands in for geometry3d::Triangle
+struct Triangle {
+	Vector3d a, b, c;
+	Triangle(const Vector3d& a, const Vector3d& b, const Vector3d& c) : a(a), b(b), c(c) { }
+};
+
+/**
+ * \brief A table top mesh as it comes out of a point cloud: a table of large triangles
+ *        and clusters of small triangles (objects, shelf walls) over a 2 x 2 m area
+ */
+void random_obstacles(int n, util::Random& random, std::vector<Triangle>& triangles) {
+	triangles.clear();
+	triangles.push_back(Triangle(Vector3d(0,-1,.5), Vector3d(2,-1,.5), Vector3d(2,1,.5)));
+	triangles.push_back(Triangle(Vector3d(0,-1,.5), Vector3d(0,1,.5), Vector3d(2,1,.5)));
+
+	Vector3d cluster = Vector3d::Zero();
+	for(int i=2; i < n; ++i) {
+		if (i % 100 == 2) {
+			cluster = Vector3d(2*random.uniform(), 2*random.uniform() - 1, .5 + .3*random.uniform());
+		}
+		Vector3d a = cluster + .1*Vector3d(random.uniform(), random.uniform(), random.uniform());
+		triangles.push_back(Triangle(a, a + .01*Vector3d(random.uniform(), random.uniform(), 0),
+				a + .01*Vector3d(0, random.uniform(), random.uniform())));
+	}
+}
+
+/**
+ * \brief Camera above the table, looking down at a random point on it
+ */
+Matrix4d random_cam_pose(util::Random& random) {
+	Vector3d position(random.uniform(), 2*random.uniform() - 1, 1 + .3*random.uniform());
+	Vector3d target(.5 + random.uniform(), 2*random.uniform() - 1, .5);
+	Vector3d z = (target - position).normalized();
+	Vector3d x = z.cross(Vector3d(0,0,1)).normalized();
+	Matrix4d pose = Matrix4d::Identity();
+	pose.block<3,1>(0,0) = x;
+	pose.block<3,1>(0,1) = z.cross(x);
+	pose.block<3,1>(0,2) = z;
+	pose.block<3,1>(0,3) = position;
+	return pose;
+}
+
+/**
+ * \brief The same conservative test as the BVH leaves, on every triangle
+ */
+void linear_query(const std::vector<Triangle>& triangles, const TriangleBVH::Planes& planes, std::vector<int>& indices) {
+	indices.clear();
+	for(int t=0; t < triangles.size(); ++t) {
+		const Vector3d* v[3] = {&triangles[t].a, &triangles[t].b, &triangles[t].c};
+		bool culled = false;
+		for(int p=0; (p < planes.size()) && !culled; ++p) {
+			culled = true;
+			for(int i=0; (i < 3) && culled; ++i) {
+				culled = (planes[p].head<3>().dot(*v[i]) + planes[p](3) < 0);
+			}
+		}
+		if (!culled) {
+			indices.push_back(t);
+		}
+	}
+}
+
+int main(int argc, char* argv[]) {
+	util::Random random(0);
+	util::Timer timer;
+
+	std::vector<TriangleBVH::Planes> volumes;
+	for(int i=0; i < NUM_POSES; ++i) {
+		volumes.push_back(TriangleBVH::view_volume(random_cam_pose(random), TAN_HALF_WIDTH, TAN_HALF_HEIGHT, MAX_RANGE));
+	}
+
+	std::cout << std::setw(12) << "triangles" << std::setw(14) << "build (ms)" << std::setw(16) << "linear (us)"
+			<< std::setw(14) << "bvh (us)" << std::setw(12) << "speedup" << std::setw(14) << "kept (avg)" << "\n";
+
+	int sizes[] = {100, 1000, 10000, 100000};
+	for(int s=0; s < sizeof(sizes)/sizeof(sizes[0]); ++s) {
+		std::vector<Triangle> triangles;
+		random_obstacles(sizes[s], random, triangles);
+
+		util::Timer_tic(&timer);
+		TriangleBVH bvh(triangles);
+		double build_time = util::Timer_toc(&timer);
+
+		std::vector<int> linear_indices, bvh_indices;
+		int num_kept = 0, num_diff = 0;
+		double linear_time = 0, bvh_time = 0;
+		for(int i=0; i < NUM_POSES; ++i) {
+			util::Timer_tic(&timer);
+			linear_query(triangles, volumes[i], linear_indices);
+			linear_time += util::Timer_toc(&timer);
+
+			util::Timer_tic(&timer);
+			bvh.query(volumes[i], bvh_indices);
+			bvh_time += util::Timer_toc(&timer);
+
+			num_kept += bvh_indices.size();
+			num_diff += (linear_indices != bvh_indices);
+		}
+
+		std::cout << std::setw(12) << triangles.size() << std::setw(14) << 1e3*build_time
+				<< std::setw(16) << 1e6*linear_time/NUM_POSES << std::setw(14) << 1e6*bvh_time/NUM_POSES
+				<< std::setw(12) << linear_time/bvh_time << std::setw(14) << num_kept/double(NUM_POSES) << "\n";
+
+		if (num_diff != 0) {
+			LOG_ERROR("BVH culling differs from the linear scan for %d of %d poses", num_diff, NUM_POSES);
+		}
+	}
+}
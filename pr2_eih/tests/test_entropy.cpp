@@ -109,7 +109,7 @@ void init_obstacles_and_objects(pr2_sim::Camera& cam,
 		double z_max = z_min + 2*fabs(y_max - y_min);
 
 		int num_particles = 0;
-		MatrixP particles;
+		MatrixP particles(3, M_DIM);
 		while(num_particles < M_DIM) {
 			Vector3d p_cam = Vector3d(uniform(x_min, x_max), uniform(y_min, y_max), uniform(z_min, z_max));
 			Vector3d p_world = cam_rot*p_cam + cam_pos;
@@ -0,0 +1,297 @@
+#ifndef __CUBE_H__
+#define __CUBE_H__
+
+#include "../../util/logging.h"
+
+#include <Eigen/Eigen>
+using namespace Eigen;
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <stdint.h>
+#include <assert.h>
+
+// adapted from http://www.geometrictools.com/LibMathematics/Interpolation/Wm5IntpTrilinear3.cpp
+template<typename CubeT>
+double trilinear_interpolation(const CubeT& cube, const Vector3d& voxel) {
+	const Vector3i size = cube.size();
+	const int x_size = size(0), y_size = size(1), z_size = size(2);
+
+    // Check for inputs not in the domain of the function.
+	double x = voxel(0), y = voxel(1), z = voxel(2);
+    if (x < 0 || x > x_size ||  y < 0 || y > y_size ||  z < 0 || y > z_size) {
+    	LOG_WARN("Voxel to do trilinear interpolation is out of bounds");
+        return INFINITY;
+    }
+
+    // clamp x, y, and z
+    int x_index = (int)x;
+    x_index = (x_index < 0) ? 0 : x_index;
+    x_index = (x_index > x_size) ? x_size : x_index;
+
+    int y_index = (int)y;
+    y_index = (y_index < 0) ? 0 : y_index;
+    y_index = (y_index > y_size) ? y_size : y_index;
+
+    int z_index = (int)z;
+    z_index = (z_index < 0) ? 0 : z_index;
+    z_index = (z_index > z_size) ? z_size : z_index;
+
+    Vector2d U(1, x - x_index);
+    Vector2d V(1, y - y_index);
+    Vector2d W(1, z - z_index);
+
+    // Compute P = M*U, Q = M*V, R = M*W.
+    Matrix2d M;
+    M << 1.0, -1.0, 0.0, 1.0;
+
+    Vector2d P = M*U;
+    Vector2d Q = M*V;
+    Vector2d R = M*W;
+
+    double max_val = -INFINITY;
+    for (int slice = 0; slice < 2; ++slice)
+    {
+    	int z_clamp = z_index + slice;
+    	if (z_clamp >= z_size) {
+    		z_clamp = z_size - 1;
+    	}
+
+    	for(int row=0; row < 2; ++row) {
+    		int y_clamp = y_index + row;
+    		if (y_clamp >= y_size) {
+    			y_clamp = y_size - 1;
+    		}
+
+    		for (int col = 0; col < 2; ++col) {
+    			int x_clamp = x_index + col;
+    			if (x_clamp >= x_size) {
+    				x_clamp = x_size - 1;
+    			}
+
+    			double val = cube.get(x_clamp, y_clamp, z_clamp);
+    			if (val < INFINITY) {
+    				max_val = (max_val > val) ? max_val : val;
+    			}
+    		}
+    	}
+    }
+
+    // compute the tensor product (M*U)(M*V)(M*W)*D where D is the 2x2x2
+    // subimage containing (x,y,z)
+    double result = 0;
+    for (int slice = 0; slice < 2; ++slice)
+    {
+        int z_clamp = z_index + slice;
+        if (z_clamp >= z_size) {
+            z_clamp = z_size - 1;
+        }
+
+        for(int row=0; row < 2; ++row) {
+            int y_clamp = y_index + row;
+            if (y_clamp >= y_size) {
+                y_clamp = y_size - 1;
+            }
+
+            for (int col = 0; col < 2; ++col) {
+                int x_clamp = x_index + col;
+                if (x_clamp >= x_size) {
+                    x_clamp = x_size - 1;
+                }
+
+                double val = cube.get(x_clamp, y_clamp, z_clamp);
+                if (val < INFINITY) {
+                	result += P(col)*Q(row)*R(slice)*val;
+                } else if (max_val > -INFINITY) {
+                	result += P(col)*Q(row)*R(slice)*max_val;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Dense voxel grid of doubles, indexed z + y*z_size + x*y_size*z_size
+ */
+class Cube {
+public:
+	Cube() : x_size(0), y_size(0), z_size(0) { };
+
+	Cube(int x, int y, int z) : x_size(x), y_size(y), z_size(z) {
+		array = VectorXd(x_size*y_size*z_size);
+		array.setZero();
+	}
+
+	inline double get(int x, int y, int z) const {
+		assert((x >= 0) && (x < x_size) && (y >= 0) && (y < y_size) && (z >= 0) && (z < z_size));
+		return array(z + y*(z_size) + x*(y_size*z_size));
+	}
+
+	inline double get(const Vector3i& xyz) const {
+		return get(xyz(0), xyz(1), xyz(2));
+	}
+
+	inline void set(int x, int y, int z, double val) {
+		assert((x >= 0) && (x < x_size) && (y >= 0) && (y < y_size) && (z >= 0) && (z < z_size));
+		array(z + y*(z_size) + x*(y_size*z_size)) = val;
+	}
+
+	inline void set(const Vector3i& xyz, double val) {
+		set(xyz(0), xyz(1), xyz(2), val);
+	}
+
+	inline void set_all(double val) {
+		for(int i=0; i < x_size*y_size*z_size; ++i) {
+			array(i) = val;
+		}
+	}
+
+	inline Vector3i size() const {
+		return Vector3i(x_size, y_size, z_size);
+	}
+
+	inline double* data() { return array.data(); }
+	inline const double* data() const { return array.data(); }
+
+	double trilinear_interpolation(const Vector3d& voxel) const {
+		return ::trilinear_interpolation(*this, voxel);
+	}
+
+private:
+	int x_size, y_size, z_size;
+	VectorXd array;
+};
+
+/**
+ * Voxel grid with the API of Cube that only stores the BLOCK^3 voxel blocks holding a
+ * value other than the background. Blocks are found through a hash on the block index,
+ * so a grid that is mostly background (the free space of a TSDF) costs memory and sweep
+ * time in proportion to its surface, not its volume.
+ *
+ * A set to the background in an unallocated block allocates nothing. Pointers returned
+ * by find_block are valid until the next set or set_all.
+ */
+class SparseCube {
+public:
+	static const int BLOCK = 8;
+	static const int BLOCK_VOXELS = BLOCK*BLOCK*BLOCK;
+
+	SparseCube() : x_size(0), y_size(0), z_size(0), x_blocks(0), y_blocks(0), z_blocks(0), background(0) { };
+
+	SparseCube(int x, int y, int z, double background=0) : x_size(x), y_size(y), z_size(z), background(background) {
+		x_blocks = (x + BLOCK - 1) / BLOCK;
+		y_blocks = (y + BLOCK - 1) / BLOCK;
+		z_blocks = (z + BLOCK - 1) / BLOCK;
+	}
+
+	inline double get(int x, int y, int z) const {
+		assert((x >= 0) && (x < x_size) && (y >= 0) && (y < y_size) && (z >= 0) && (z < z_size));
+		const double* block = find_block(x, y, z);
+		return (block != NULL) ? block[offset_in_block(x, y, z)] : background;
+	}
+
+	inline double get(const Vector3i& xyz) const {
+		return get(xyz(0), xyz(1), xyz(2));
+	}
+
+	inline void set(int x, int y, int z, double val) {
+		assert((x >= 0) && (x < x_size) && (y >= 0) && (y < y_size) && (z >= 0) && (z < z_size));
+		int key = block_key(x, y, z);
+		std::unordered_map<int,int>::const_iterator it = index.find(key);
+		int b;
+		if (it != index.end()) {
+			b = it->second;
+		} else {
+			if (val == background) { return; }
+			b = blocks.size() / BLOCK_VOXELS;
+			blocks.resize(blocks.size() + BLOCK_VOXELS, background);
+			keys.push_back(key);
+			index[key] = b;
+		}
+		blocks[b*BLOCK_VOXELS + offset_in_block(x, y, z)] = val;
+	}
+
+	inline void set(const Vector3i& xyz, double val) {
+		set(xyz(0), xyz(1), xyz(2), val);
+	}
+
+	/**
+	 * \brief Every voxel becomes val, and all blocks are freed
+	 */
+	inline void set_all(double val) {
+		background = val;
+		index.clear();
+		keys.clear();
+		blocks.clear();
+	}
+
+	inline Vector3i size() const {
+		return Vector3i(x_size, y_size, z_size);
+	}
+
+	inline double get_background() const { return background; }
+
+	/**
+	 * \brief Values of the block holding voxel (x,y,z), NULL if it is all background.
+	 *        Index it with offset_in_block.
+	 */
+	inline const double* find_block(int x, int y, int z) const {
+		std::unordered_map<int,int>::const_iterator it = index.find(block_key(x, y, z));
+		return (it != index.end()) ? &blocks[it->second*BLOCK_VOXELS] : NULL;
+	}
+
+	static inline int offset_in_block(int x, int y, int z) {
+		return (z % BLOCK) + (y % BLOCK)*BLOCK + (x % BLOCK)*BLOCK*BLOCK;
+	}
+
+	/**
+	 * \brief Calls f(x, y, z, value) for the voxels of the allocated blocks only,
+	 *        in no particular order. The rest of the grid is background.
+	 */
+	template<typename F>
+	void for_each_allocated(F f) const {
+		for(int b=0; b < keys.size(); ++b) {
+			int bx = keys[b] / (y_blocks*z_blocks), by = (keys[b] / z_blocks) % y_blocks, bz = keys[b] % z_blocks;
+			const double* block = &blocks[b*BLOCK_VOXELS];
+			for(int x=bx*BLOCK; x < std::min(x_size, (bx+1)*BLOCK); ++x) {
+				for(int y=by*BLOCK; y < std::min(y_size, (by+1)*BLOCK); ++y) {
+					for(int z=bz*BLOCK; z < std::min(z_size, (bz+1)*BLOCK); ++z) {
+						f(x, y, z, block[offset_in_block(x, y, z)]);
+					}
+				}
+			}
+		}
+	}
+
+	inline int num_blocks() const { return keys.size(); }
+
+	/**
+	 * \brief Bytes held by the blocks and the hash index (approximately, for the index)
+	 */
+	inline size_t memory() const {
+		return blocks.capacity()*sizeof(double) + keys.capacity()*sizeof(int) +
+				index.bucket_count()*sizeof(void*) + index.size()*(2*sizeof(int) + sizeof(void*));
+	}
+
+	double trilinear_interpolation(const Vector3d& voxel) const {
+		return ::trilinear_interpolation(*this, voxel);
+	}
+
+private:
+	int x_size, y_size, z_size;
+	int x_blocks, y_blocks, z_blocks;
+	double background;
+
+	std::unordered_map<int,int> index; // block key to block number
+	std::vector<int> keys;             // block number to block key
+	std::vector<double> blocks;        // BLOCK_VOXELS values per block, layout of Cube within a block
+
+	inline int block_key(int x, int y, int z) const {
+		return (z / BLOCK) + (y / BLOCK)*z_blocks + (x / BLOCK)*y_blocks*z_blocks;
+	}
+};
+
+#endif
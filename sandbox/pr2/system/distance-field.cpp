@@ -0,0 +1,230 @@
+#include "distance-field.h"
+
+#include <cmath>
+#include <algorithm>
+
+/**
+ * GeodesicDistanceField constructor
+ */
+
+GeodesicDistanceField::GeodesicDistanceField(const Vector3i& size, const Vector3d& spacing, util::ThreadPool* pool) :
+		size(size), num_voxels(size.prod()), pool(pool), tentative(new std::atomic<double>[size.prod()]),
+		settled(size.prod()) {
+	int n = 0;
+	double max_step = 0;
+	bucket_width = spacing.minCoeff();
+	for(int a=-1; a <= 1; ++a) {
+		for(int b=-1; b <= 1; ++b) {
+			for(int c=-1; c <= 1; ++c) {
+				if ((a == 0) && (b == 0) && (c == 0)) { continue; }
+				offsets[n][0] = a; offsets[n][1] = b; offsets[n][2] = c;
+
+				// computed as VoxelGrid's offset_dists, so the sums match bit for bit
+				int nonzero = abs(a) + abs(b) + abs(c);
+				if (nonzero == 1) {
+					steps[n] = (a != 0) ? spacing(0) : ((b != 0) ? spacing(1) : spacing(2));
+				} else {
+					steps[n] = Vector3d(abs(a)*spacing(0), abs(b)*spacing(1), abs(c)*spacing(2)).norm();
+				}
+				max_step = std::max(max_step, steps[n]);
+				++n;
+			}
+		}
+	}
+
+	// narrower than the shortest step by far more than the rounding of the bucket index
+	bucket_width *= 1 - 1e-9;
+
+	// tentative distances stay below the current bucket plus the longest step
+	buckets.resize(int(ceil(max_step / bucket_width)) + 2);
+}
+
+/**
+ * GeodesicDistanceField public methods
+ */
+
+void GeodesicDistanceField::compute(const uint8_t* free, const Vector3i& source, double* dist) {
+	for(int v=0; v < num_voxels; ++v) {
+		tentative[v].store(INFINITY, std::memory_order_relaxed);
+	}
+	std::fill(settled.begin(), settled.end(), 0);
+	for(int b=0; b < buckets.size(); ++b) { buckets[b].clear(); }
+
+	const int num_buckets = buckets.size();
+	int pending = 0;
+	if ((source.minCoeff() >= 0) && ((size - source).minCoeff() > 0)) {
+		int s = source(2) + source(1)*size(2) + source(0)*size(1)*size(2);
+		if (free[s] != 0) {
+			tentative[s].store(0, std::memory_order_relaxed);
+			buckets[0].push_back(s);
+			pending = 1;
+		}
+	}
+
+	std::vector<int> frontier;
+	for(int64_t bucket=0; pending > 0; ++bucket) {
+		std::vector<int>& entries = buckets[bucket % num_buckets];
+		pending -= entries.size();
+
+		// voxels can be queued more than once, keep those whose distance is in this bucket
+		frontier.clear();
+		for(int i=0; i < entries.size(); ++i) {
+			int v = entries[i];
+			if ((settled[v] == 0) && (int64_t(tentative[v].load(std::memory_order_relaxed) / bucket_width) == bucket)) {
+				settled[v] = 1;
+				frontier.push_back(v);
+			}
+		}
+		entries.clear();
+		if (frontier.empty()) { continue; }
+
+		int num_blocks = (frontier.size() + BLOCK - 1) / BLOCK;
+		if (improved.size() < num_blocks) { improved.resize(num_blocks); }
+		auto block = [&](int b) {
+			relax(free, &frontier[0], b*BLOCK, std::min<int>(frontier.size(), (b+1)*BLOCK), improved[b]);
+		};
+		if ((pool != NULL) && (num_blocks > 1)) {
+			pool->parallel_for(0, num_blocks, block);
+		} else {
+			for(int b=0; b < num_blocks; ++b) { block(b); }
+		}
+
+		// queue by the final tentative distance of this round
+		for(int b=0; b < num_blocks; ++b) {
+			for(int i=0; i < improved[b].size(); ++i) {
+				int v = improved[b][i];
+				int64_t target = int64_t(tentative[v].load(std::memory_order_relaxed) / bucket_width);
+				buckets[target % num_buckets].push_back(v);
+			}
+			pending += improved[b].size();
+			improved[b].clear();
+		}
+	}
+
+	for(int v=0; v < num_voxels; ++v) {
+		dist[v] = tentative[v].load(std::memory_order_relaxed);
+	}
+}
+
+/**
+ * GeodesicDistanceField private methods
+ */
+
+void GeodesicDistanceField::relax(const uint8_t* free, const int* frontier, int begin, int end,
+		std::vector<int>& improved) {
+	const int y_stride = size(2), x_stride = size(1)*size(2);
+	for(int f=begin; f < end; ++f) {
+		int v = frontier[f];
+		int x = v / x_stride, y = (v / y_stride) % size(1), z = v % y_stride;
+		double d = tentative[v].load(std::memory_order_relaxed);
+
+		for(int n=0; n < 26; ++n) {
+			int nx = x + offsets[n][0], ny = y + offsets[n][1], nz = z + offsets[n][2];
+			if ((nx < 0) || (nx >= size(0)) || (ny < 0) || (ny >= size(1)) || (nz < 0) || (nz >= size(2))) {
+				continue;
+			}
+			int u = nz + ny*y_stride + nx*x_stride;
+			if ((free[u] == 0) || (settled[u] != 0)) { continue; }
+
+			// atomic minimum
+			double candidate = d + steps[n];
+			double current = tentative[u].load(std::memory_order_relaxed);
+			while ((candidate < current) &&
+					!tentative[u].compare_exchange_weak(current, candidate, std::memory_order_relaxed)) { }
+			if (candidate < current) {
+				improved.push_back(u);
+			}
+		}
+	}
+}
+
+/**
+ * EuclideanDistanceField constructor
+ */
+
+EuclideanDistanceField::EuclideanDistanceField(const Vector3i& size, const Vector3d& spacing, util::ThreadPool* pool) :
+		size(size), spacing(spacing), num_voxels(size.prod()), pool(pool) { }
+
+/**
+ * EuclideanDistanceField public methods
+ */
+
+void EuclideanDistanceField::compute(const uint8_t* site, double* dist) {
+	for(int v=0; v < num_voxels; ++v) {
+		dist[v] = (site[v] != 0) ? 0 : INFINITY;
+	}
+
+	// squared distances until the last pass
+	for(int axis=2; axis >= 0; --axis) {
+		transform_lines(dist, axis);
+	}
+
+	for(int v=0; v < num_voxels; ++v) {
+		dist[v] = sqrt(dist[v]);
+	}
+}
+
+/**
+ * EuclideanDistanceField private methods
+ */
+
+/**
+ * \brief Lower envelope of the parabolas (p - q*s)^2 + f[q] over the finite f[q],
+ *        sampled at p = 0, s, .., (n-1)*s
+ */
+inline void squared_distance_1d(const double* f, int n, double s, double* d, int* v, double* z) {
+	int k = -1;
+	for(int q=0; q < n; ++q) {
+		if (f[q] == INFINITY) { continue; }
+
+		double x = -INFINITY;
+		while (k >= 0) {
+			double pq = q*s, pv = v[k]*s;
+			x = ((f[q] + pq*pq) - (f[v[k]] + pv*pv)) / (2*(pq - pv));
+			if (x > z[k]) { break; }
+			--k;
+		}
+		++k;
+		v[k] = q;
+		z[k] = (k == 0) ? -INFINITY : x;
+	}
+
+	if (k < 0) {
+		std::fill(d, d + n, INFINITY);
+		return;
+	}
+	z[k+1] = INFINITY;
+
+	int j = 0;
+	for(int q=0; q < n; ++q) {
+		while (z[j+1] < q*s) { ++j; }
+		double offset = (q - v[j])*s;
+		d[q] = offset*offset + f[v[j]];
+	}
+}
+
+void EuclideanDistanceField::transform_lines(double* sq_dist, int axis) {
+	const int strides[3] = {size(1)*size(2), size(2), 1};
+	// the two axes the lines are enumerated over
+	const int a = (axis == 0) ? 1 : 0, b = (axis == 2) ? 1 : 2;
+	const int n = size(axis), stride = strides[axis];
+	const int num_lines = size(a)*size(b);
+	const int num_tasks = (num_lines + LINES_PER_TASK - 1) / LINES_PER_TASK;
+
+	auto task = [&](int t) {
+		std::vector<double> f(n), d(n), z(n+1);
+		std::vector<int> v(n);
+		for(int l=t*LINES_PER_TASK; l < std::min(num_lines, (t+1)*LINES_PER_TASK); ++l) {
+			double* line = sq_dist + (l / size(b))*strides[a] + (l % size(b))*strides[b];
+			for(int q=0; q < n; ++q) { f[q] = line[q*stride]; }
+			squared_distance_1d(&f[0], n, spacing(axis), &d[0], &v[0], &z[0]);
+			for(int q=0; q < n; ++q) { line[q*stride] = d[q]; }
+		}
+	};
+
+	if ((pool != NULL) && (num_tasks > 1)) {
+		pool->parallel_for(0, num_tasks, task);
+	} else {
+		for(int t=0; t < num_tasks; ++t) { task(t); }
+	}
+}
@@ -0,0 +1,91 @@
+#ifndef __DISTANCE_FIELD_H__
+#define __DISTANCE_FIELD_H__
+
+#include <Eigen/Eigen>
+using namespace Eigen;
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <stdint.h>
+
+#include "../../util/threadpool.h"
+
+/**
+ * Shortest path distances through the free voxels of a dense grid, from a source voxel,
+ * over the 26-connected neighborhood with Euclidean step lengths. This is the occlusion
+ * distance field (ODF) of VoxelGrid.
+ *
+ * Instead of a priority queue it uses buckets of width slightly below the shortest step,
+ * indexed cyclically (Dial's algorithm). No step out of a bucket lands back in it, so
+ * every voxel in the current bucket is final and the bucket can be relaxed in parallel
+ * in any order. Each voxel ends at the minimum over its final neighbors of their
+ * distance plus the step, the same sums Dijkstra takes, so the field is identical.
+ *
+ * Voxels are indexed z + y*z_size + x*y_size*z_size, the layout of Cube.
+ */
+class GeodesicDistanceField {
+public:
+	GeodesicDistanceField(const Vector3i& size, const Vector3d& spacing, util::ThreadPool* pool=NULL);
+
+	/**
+	 * \brief dist[v] = distance from source to voxel v through voxels with free[v] != 0,
+	 *        INFINITY if unreachable (everywhere if the source is outside or not free)
+	 */
+	void compute(const uint8_t* free, const Vector3i& source, double* dist);
+
+	void set_pool(util::ThreadPool* pool) { this->pool = pool; }
+
+private:
+	Vector3i size;
+	int num_voxels;
+	util::ThreadPool* pool;
+
+	int offsets[26][3];
+	double steps[26];
+	double bucket_width;
+
+	std::unique_ptr<std::atomic<double>[]> tentative;
+	std::vector<uint8_t> settled;
+	std::vector<std::vector<int> > buckets;
+	std::vector<std::vector<int> > improved; // per block of the frontier
+
+	static const int BLOCK = 1024;
+
+	void relax(const uint8_t* free, const int* frontier, int begin, int end, std::vector<int>& improved);
+};
+
+/**
+ * Exact Euclidean distance transform of a dense grid with anisotropic spacing: the straight
+ * line distance from every voxel center to the nearest site voxel center.
+ *
+ * Separable (Felzenszwalb and Huttenlocher): a 1D lower envelope of parabolas along z, then
+ * y, then x, so O(voxels) per call. The lines of each pass are independent and split over
+ * the pool.
+ *
+ * Voxels are indexed z + y*z_size + x*y_size*z_size, the layout of Cube.
+ */
+class EuclideanDistanceField {
+public:
+	EuclideanDistanceField(const Vector3i& size, const Vector3d& spacing, util::ThreadPool* pool=NULL);
+
+	/**
+	 * \brief dist[v] = distance from voxel v to the nearest voxel with site[v] != 0,
+	 *        INFINITY everywhere if there is no site
+	 */
+	void compute(const uint8_t* site, double* dist);
+
+	void set_pool(util::ThreadPool* pool) { this->pool = pool; }
+
+private:
+	Vector3i size;
+	Vector3d spacing;
+	int num_voxels;
+	util::ThreadPool* pool;
+
+	static const int LINES_PER_TASK = 64;
+
+	void transform_lines(double* sq_dist, int axis);
+};
+
+#endif
@@ -171,22 +171,40 @@ Matrix4d Arm::get_pose(const Matrix<double,ARM_DIM,1>& j) {
 	return rave_utils::rave_to_eigen(pose_mat);
 }
 
-Matrix<double,3,ARM_DIM> Arm::get_position_jacobian(const Matrix<double,ARM_DIM,1>& j) {
-	Matrix<double,3,ARM_DIM> jac;
-	jac.setZero();
+/**
+ * \brief Pose (as get_pose) and geometric jacobian in one pass over the chain
+ * \param jac rows 0-2 linear velocity of the pose origin, rows 3-5 angular velocity,
+ *            both in the world frame, per unit joint velocity
+ */
+void Arm::get_pose_jacobian(const Matrix<double,ARM_DIM,1>& j, Matrix4d& pose, Matrix<double,6,ARM_DIM>& jac) {
+	rave::Transform pose_mat = origin;
+	Matrix<double,3,ARM_DIM> axes, points;
 
-	Matrix<double,ARM_DIM,1> j_p = j, j_m = j;
+	rave::Transform R;
 	for(int i=0; i < ARM_DIM; ++i) {
-		j_p(i) = j(i) + step;
-		j_m(i) = j(i) - step;
+		R.rot = rave::geometry::quatFromAxisAngle(arm_joint_axes[i], j(i));
+		R.trans = arm_link_trans[i];
+		pose_mat = pose_mat*R;
 
-		jac.block<3,1>(0,i) = (get_position(j_p) - get_position(j_m)) / (2*step);
+		// joint i rotates everything after it about its axis through the origin of link i
+		Matrix4d link_pose = rave_utils::rave_to_eigen(pose_mat);
+		axes.col(i) = link_pose.block<3,3>(0,0)*rave_utils::rave_to_eigen(arm_joint_axes[i]);
+		points.col(i) = link_pose.block<3,1>(0,3);
+	}
 
-		j_p(i) = j(i);
-		j_m(i) = j(i);
+	pose = rave_utils::rave_to_eigen(pose_mat);
+	for(int i=0; i < ARM_DIM; ++i) {
+		Vector3d axis = axes.col(i);
+		jac.block<3,1>(0,i) = axis.cross(pose.block<3,1>(0,3) - points.col(i));
+		jac.block<3,1>(3,i) = axis;
 	}
+}
 
-	return jac;
+Matrix<double,3,ARM_DIM> Arm::get_position_jacobian(const Matrix<double,ARM_DIM,1>& j) {
+	Matrix4d pose;
+	Matrix<double,6,ARM_DIM> jac;
+	get_pose_jacobian(j, pose, jac);
+	return jac.block<3,ARM_DIM>(0,0);
 }
 
 /**
@@ -645,9 +663,34 @@ Vector3d Camera::get_point_from_pixel_and_dist(const Vector2i& pixel, const doub
 	return point_world.block<3,1>(0,3);
 }
 
+/**
+ * \brief Pose (as get_pose) and geometric jacobian of the camera, see Arm::get_pose_jacobian
+ */
+void Camera::get_pose_jacobian(const Matrix<double,ARM_DIM,1>& j, Matrix4d& pose, Matrix<double,6,ARM_DIM>& jac) {
+	Matrix4d arm_pose;
+	arm->get_pose_jacobian(j, arm_pose, jac);
+	pose = arm_pose*gripper_tool_to_sensor;
+
+	// the sensor is rigidly attached to the gripper tool frame
+	Vector3d offset = pose.block<3,1>(0,3) - arm_pose.block<3,1>(0,3);
+	for(int i=0; i < ARM_DIM; ++i) {
+		jac.block<3,1>(0,i) += jac.block<3,1>(3,i).cross(offset);
+	}
+}
+
 bool Camera::is_in_fov(const Vector3d& point, const Matrix<double,H_SUB,W_SUB>& zbuffer, const Matrix4d& cam_pose) {
-	Vector2i pixel = get_pixel_from_point(point, cam_pose, KK_SUB);
-	int h = pixel(0), w = pixel(1);
+	return is_in_fov(point, zbuffer, cam_pose, cam_pose.inverse());
+}
+
+bool Camera::is_in_fov(const Vector3d& point, const Matrix<double,H_SUB,W_SUB>& zbuffer, const Matrix4d& cam_pose,
+		const Matrix4d& cam_pose_inv) {
+	Matrix4d point_pose = Matrix4d::Identity();
+	point_pose.block<3,1>(0,3) = point;
+	Matrix4d point_pose_cam = cam_pose_inv*point_pose;
+
+	// as get_pixel_from_point
+	Vector3d y = KK_SUB*point_pose_cam.block<3,1>(0,3);
+	int h = int(y(1)/y(2)), w = int(y(0)/y(2));
 
 	// out of frustrum
 	if ((w < 0) || (w >= W_SUB) || (h < 0) || (h >= H_SUB)) {
@@ -660,9 +703,7 @@ bool Camera::is_in_fov(const Vector3d& point, const Matrix<double,H_SUB,W_SUB>&
 	}
 
 	// behind camera pose
-	Matrix4d point_pose = Matrix4d::Identity();
-	point_pose.block<3,1>(0,3) = point;
-	if ((cam_pose.inverse()*point_pose)(2,3) < 0) {
+	if (point_pose_cam(2,3) < 0) {
 		return false;
 	}
 
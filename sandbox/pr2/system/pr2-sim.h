@@ -80,8 +80,6 @@ private:
 };
 
 class Arm {
-	const double step = 1e-5;
-
 public:
 	enum ArmType { left, right };
 	enum Posture { untucked, tucked, up, side, mantis };
@@ -93,6 +91,7 @@ public:
 	Matrix4d get_pose(const Matrix<double,ARM_DIM,1>& j);
 	Vector3d get_position(const Matrix<double,ARM_DIM,1>& j) { return get_pose(j).block<3,1>(0,3); }
 
+	void get_pose_jacobian(const Matrix<double,ARM_DIM,1>& j, Matrix4d& pose, Matrix<double,6,ARM_DIM>& jac);
 	Matrix<double,3,ARM_DIM> get_position_jacobian(const Matrix<double,ARM_DIM,1>& j);
 	bool ik(const Vector3d& pos, Matrix<double,ARM_DIM,1>& j);
 
@@ -153,9 +152,13 @@ public:
 	Vector2i get_pixel_from_point(const Vector3d& point, const Matrix4d& cam_pose, const Matrix3d& P);
 	Vector3d get_point_from_pixel_and_dist(const Vector2i& pixel, const double dist, const Matrix4d& cam_pose);
 	bool is_in_fov(const Vector3d& point, const Matrix<double,H_SUB,W_SUB>& zbuffer, const Matrix4d& cam_pose);
+	// cam_pose_inv = cam_pose.inverse(), hoisted out of loops over many points
+	bool is_in_fov(const Vector3d& point, const Matrix<double,H_SUB,W_SUB>& zbuffer, const Matrix4d& cam_pose,
+			const Matrix4d& cam_pose_inv);
 
 	inline Matrix4d get_pose(const Matrix<double,ARM_DIM,1>& j) { return arm->get_pose(j)*gripper_tool_to_sensor; }
 	inline Vector3d get_position(const Matrix<double,ARM_DIM,1>& j) { return get_pose(j).block<3,1>(0,3); }
+	void get_pose_jacobian(const Matrix<double,ARM_DIM,1>& j, Matrix4d& pose, Matrix<double,6,ARM_DIM>& jac);
 
 	inline rave::SensorBasePtr get_sensor() { return sensor; }
 	inline Matrix4d get_gripper_tool_to_sensor() { return gripper_tool_to_sensor; }
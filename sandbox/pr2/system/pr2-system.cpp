@@ -606,10 +606,20 @@ void PR2System::linearize_dynfunc(const VectorX& x, const VectorU& u, const Vect
 //	}
 }
 
+/**
+ * \brief The joints observe themselves and the object is observed relative to the
+ *        camera position, so the only non-identity block of H is minus the camera
+ *        position jacobian (one pass over the chain instead of 2*X_DIM FK calls)
+ */
 void PR2System::linearize_obsfunc(const VectorX& x, const VectorR& r,
 		Matrix<double,Z_DIM,X_DIM>& H) {
 	H = Matrix<double,Z_DIM,X_DIM>::Identity();
 
+	Matrix4d cam_pose;
+	Matrix<double,6,ARM_DIM> cam_jac;
+	cam->get_pose_jacobian(x.segment<J_DIM>(0), cam_pose, cam_jac);
+	H.block<3,J_DIM>(J_DIM,0) = -cam_jac.block<3,J_DIM>(0,0);
+
 //	H.setZero();
 //	VectorX x_p = x, x_m = x;
 //	for(int i=0; i < X_DIM; ++i) {
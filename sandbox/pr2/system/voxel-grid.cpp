@@ -1,121 +1,5 @@
 #include "voxel-grid.h"
 
-/**
- * Local Helper classes/functions
- */
-
-struct VoxelDist {
-	Vector3i voxel;
-	double dist;
-
-	VoxelDist(const Vector3i& v, const double d) : voxel(v), dist(d) { };
-
-	bool operator<(VoxelDist const & rhs) const {
-		return (dist > rhs.dist);
-	}
-};
-
-/**
- * Cube public methods
- */
-
-// adapted from http://www.geometrictools.com/LibMathematics/Interpolation/Wm5IntpTrilinear3.cpp
-double Cube::trilinear_interpolation(const Vector3d& voxel) const {
-    // Check for inputs not in the domain of the function.
-	double x = voxel(0), y = voxel(1), z = voxel(2);
-    if (x < 0 || x > x_size ||  y < 0 || y > y_size ||  z < 0 || y > z_size) {
-    	LOG_WARN("Voxel to do trilinear interpolation is out of bounds");
-        return INFINITY;
-    }
-
-    // clamp x, y, and z
-    int x_index = (int)x;
-    x_index = (x_index < 0) ? 0 : x_index;
-    x_index = (x_index > x_size) ? x_size : x_index;
-
-    int y_index = (int)y;
-    y_index = (y_index < 0) ? 0 : y_index;
-    y_index = (y_index > y_size) ? y_size : y_index;
-
-    int z_index = (int)z;
-    z_index = (z_index < 0) ? 0 : z_index;
-    z_index = (z_index > z_size) ? z_size : z_index;
-
-    Vector2d U(1, x - x_index);
-    Vector2d V(1, y - y_index);
-    Vector2d W(1, z - z_index);
-
-    // Compute P = M*U, Q = M*V, R = M*W.
-    Matrix2d M;
-    M << 1.0, -1.0, 0.0, 1.0;
-
-    Vector2d P = M*U;
-    Vector2d Q = M*V;
-    Vector2d R = M*W;
-
-    double max_val = -INFINITY;
-    for (int slice = 0; slice < 2; ++slice)
-    {
-    	int z_clamp = z_index + slice;
-    	if (z_clamp >= z_size) {
-    		z_clamp = z_size - 1;
-    	}
-
-    	for(int row=0; row < 2; ++row) {
-    		int y_clamp = y_index + row;
-    		if (y_clamp >= y_size) {
-    			y_clamp = y_size - 1;
-    		}
-
-    		for (int col = 0; col < 2; ++col) {
-    			int x_clamp = x_index + col;
-    			if (x_clamp >= x_size) {
-    				x_clamp = x_size - 1;
-    			}
-
-    			double val = get(x_clamp, y_clamp, z_clamp);
-    			if (val < INFINITY) {
-    				max_val = (max_val > val) ? max_val : val;
-    			}
-    		}
-    	}
-    }
-
-    // compute the tensor product (M*U)(M*V)(M*W)*D where D is the 2x2x2
-    // subimage containing (x,y,z)
-    double result = 0;
-    for (int slice = 0; slice < 2; ++slice)
-    {
-        int z_clamp = z_index + slice;
-        if (z_clamp >= z_size) {
-            z_clamp = z_size - 1;
-        }
-
-        for(int row=0; row < 2; ++row) {
-            int y_clamp = y_index + row;
-            if (y_clamp >= y_size) {
-                y_clamp = y_size - 1;
-            }
-
-            for (int col = 0; col < 2; ++col) {
-                int x_clamp = x_index + col;
-                if (x_clamp >= x_size) {
-                    x_clamp = x_size - 1;
-                }
-
-                double val = get(x_clamp, y_clamp, z_clamp);
-                if (val < INFINITY) {
-                	result += P(col)*Q(row)*R(slice)*val;
-                } else if (max_val > -INFINITY) {
-                	result += P(col)*Q(row)*R(slice)*max_val;
-                }
-            }
-        }
-    }
-
-    return result;
-}
-
 /**
  * VoxelGrid Constructors
  */
@@ -129,8 +13,12 @@ VoxelGrid::VoxelGrid(const Vector3d& pos_center, double x, double y, double z, i
 	dz = z / double(resolution);
 	radius = std::min(dx, std::min(dy, dz))/10.0;
 
-	TSDF = new Cube(resolution, resolution, resolution);
-	TSDF->set_all(1);
+	// free space (1) is the background, only blocks with occupied voxels are stored
+	TSDF = new SparseCube(resolution, resolution, resolution, 1);
+
+	pool = new util::ThreadPool();
+	ODF_field = new GeodesicDistanceField(Vector3i(resolution, resolution, resolution), Vector3d(dx, dy, dz), pool);
+	FOV_field = new EuclideanDistanceField(Vector3i(resolution, resolution, resolution), Vector3d(dx, dy, dz), pool);
 
 	offsets.push_back(Vector3i(0, 0, -1));
 	offsets.push_back(Vector3i(1, 0, -1));
@@ -230,78 +118,44 @@ void VoxelGrid::update(const StdVector3d& pc, const Matrix<double,HEIGHT_FULL,WI
 	update_kinfu(zbuffer, cam_pose);
 }
 
+/**
+ * \brief Shortest path distance from obj through the non-empty voxels of the TSDF
+ */
 Cube VoxelGrid::get_ODF(const Vector3d& obj) {
-	typedef boost::heap::fibonacci_heap<VoxelDist>::handle_type handle_t;
-
 	Cube ODF(resolution, resolution, resolution);
-//	ODF.set_all(dx*resolution*dy*resolution*dz*resolution);
-	ODF.set_all(INFINITY);
 
-	Vector3i obj_voxel = voxel_from_point(obj);
-
-	boost::heap::fibonacci_heap<VoxelDist> pq;
-	std::map<std::vector<int>,handle_t> voxel_handle;
-
-	for(int i=0; i < resolution; ++i) {
-		for(int j=0; j < resolution; ++j) {
-			for(int k=0; k < resolution; ++k) {
-				if (TSDF->get(i,j,k) != 0) {
-					const Vector3i voxel(i,j,k);
-					double dist = (voxel == obj_voxel) ? 0 : INFINITY;
-					handle_t handle = pq.push(VoxelDist(voxel, dist));
-					voxel_handle[{i,j,k}] = handle;
-				}
-			}
-		}
-	}
+	std::vector<uint8_t> free(resolution*resolution*resolution, TSDF->get_background() != 0);
+	TSDF->for_each_allocated([&](int i, int j, int k, double val) {
+		free[voxel_index(Vector3i(i,j,k))] = (val != 0);
+	});
 
-	StdVector3i neighbors;
-	std::vector<double> neighbor_dists;
-	while (pq.size() > 0) {
-		VoxelDist curr = pq.top();
-		pq.pop();
-
-//		rave_utils::plot_point(env, point_from_voxel(curr.voxel), Vector3d(1,0,0));
-//		std::cin.ignore();
-
-		ODF.set(curr.voxel, curr.dist);
-
-		get_voxel_neighbors_and_dists(curr.voxel, neighbors, neighbor_dists);
-		for(int i=0; i < neighbors.size(); ++i) {
-			double dist = curr.dist + neighbor_dists[i];
-			if (dist < ODF.get(neighbors[i])) {
-				ODF.set(neighbors[i], dist);
-				std::vector<int> n_vec = {neighbors[i](0), neighbors[i](1), neighbors[i](2)};
-				handle_t handle = voxel_handle[n_vec];
-				pq.update(handle, VoxelDist(neighbors[i], dist));
-			}
-		}
-	}
+	ODF_field->compute(&free[0], voxel_from_point(obj), ODF.data());
 
 	return ODF;
 }
 
+/**
+ * \brief For one query at a pose: scans the free voxels, calling is_in_fov on each,
+ *        instead of building a VisibilityField
+ */
 Vector3d VoxelGrid::signed_distance_complete_voxel_center(const Vector3d& object, const Cube& ODF,
 		Camera* cam, const Matrix<double,H_SUB,W_SUB>& zbuffer, const Matrix4d& cam_pose) {
-	bool obj_in_fov = cam->is_in_fov(object, zbuffer, cam_pose);
+	Matrix4d cam_pose_inv = cam_pose.inverse();
+	bool obj_in_fov = cam->is_in_fov(object, zbuffer, cam_pose, cam_pose_inv);
 
 	double min_dist = INFINITY;
 	Vector3i min_voxel;
 	for(int i=0; i < resolution; ++i) {
 		for(int j=0; j < resolution; ++j) {
-			for(int k=0; k < resolution; ++k) {
-				if (TSDF->get(i,j,k) != 0) {
-					Vector3d voxel_center = point_from_voxel(Vector3i(i,j,k));
-					if (obj_in_fov) {
-						if (!(cam->is_in_fov(voxel_center, zbuffer, cam_pose)) && (ODF.get(i,j,k) < min_dist)) {
-							min_dist = ODF.get(i,j,k);
-							min_voxel = {i,j,k};
-						}
-					} else {
-						if ((cam->is_in_fov(voxel_center, zbuffer, cam_pose)) && (ODF.get(i,j,k) < min_dist)) {
-							min_dist = ODF.get(i,j,k);
-							min_voxel = {i,j,k};
-						}
+			// one TSDF block lookup per BLOCK voxels along z
+			for(int k_block=0; k_block < resolution; k_block += SparseCube::BLOCK) {
+				const double* block = TSDF->find_block(i, j, k_block);
+				for(int k=k_block; k < std::min(resolution, k_block + SparseCube::BLOCK); ++k) {
+					double tsdf = (block != NULL) ? block[SparseCube::offset_in_block(i,j,k)] : TSDF->get_background();
+					if ((tsdf != 0) && (ODF.get(i,j,k) < min_dist) &&
+							(cam->is_in_fov(point_from_voxel(Vector3i(i,j,k)), zbuffer, cam_pose, cam_pose_inv) != obj_in_fov)) {
+						min_dist = ODF.get(i,j,k);
+						min_voxel = {i,j,k};
 					}
 				}
 			}
@@ -313,91 +167,151 @@ Vector3d VoxelGrid::signed_distance_complete_voxel_center(const Vector3d& object
 	return point_from_voxel(min_voxel);
 }
 
-inline bool XOR(const bool& lhs, const bool& rhs) {
-    return !( lhs && rhs ) && ( lhs || rhs );
-}
-
 Vector3d VoxelGrid::signed_distance_greedy_voxel_center(const Vector3d& object, const Cube& ODF,
 			Camera* cam, const Matrix<double,H_SUB,W_SUB>& zbuffer, const Matrix4d& cam_pose) {
 	bool obj_in_fov = cam->is_in_fov(object, zbuffer, cam_pose);
+	return signed_distance_greedy_voxel_center(object, obj_in_fov, ODF, cam, zbuffer, cam_pose, NULL);
+}
 
-	StdVector3i neighbors;
-	std::vector<double> neighbor_dists;
+double VoxelGrid::signed_distance_complete(const Vector3d& object, Cube& ODF,
+		Camera* cam, const Matrix<double,H_SUB,W_SUB>& zbuffer, const Matrix4d& cam_pose) {
+	Vector3d voxel_center = signed_distance_complete_voxel_center(object, ODF, cam, zbuffer, cam_pose);
+	double dist = (object - voxel_center).norm();
 
-	std::vector<Vector3i> start_voxels;
+	bool obj_in_fov = cam->is_in_fov(object, zbuffer, cam_pose);
+	double sd = (obj_in_fov) ? dist : -dist;
 
-	if (obj_in_fov) {
-		start_voxels.push_back(Vector3i(resolution-1, int(resolution/2), resolution-1));
-		start_voxels.push_back(Vector3i(0, resolution-1, resolution-1));
-		start_voxels.push_back(Vector3i(0, 0, resolution-1));
-	} else {
-		Matrix4d start_cam_frame = Matrix4d::Identity();
-		start_cam_frame(2,3) = .2; // intrinsics::MIN_RANGE;
-		Vector3d start_world = (cam_pose*start_cam_frame).block<3,1>(0,3);
+	return sd;
+}
 
-		start_voxels.push_back(voxel_from_point(start_world));
-	}
+double VoxelGrid::signed_distance_greedy(const Vector3d& object, const Cube& ODF,
+		Camera* cam, const Matrix<double,H_SUB,W_SUB>& zbuffer, const Matrix4d& cam_pose) {
 
-	Vector3i min_voxel = start_voxels[0];
-	for(int s=0; s < start_voxels.size(); ++s) {
-		Vector3i curr_voxel = start_voxels[s], next_voxel = Vector3i::Zero();
-		double curr_OD = ODF.get(curr_voxel), next_OD;
+	Vector3d voxel_center = signed_distance_greedy_voxel_center(object, ODF, cam, zbuffer, cam_pose);
+	double dist = (object - voxel_center).norm();
 
-		while(true) {
-			rave_utils::plot_point(cam->get_sensor()->GetEnv(), point_from_voxel(curr_voxel), Vector3d(0,0,1), .01);
+	bool obj_in_fov = cam->is_in_fov(object, zbuffer, cam_pose);
+	double sd = (obj_in_fov) ? dist : -dist;
 
-			next_OD = INFINITY;
-			get_voxel_neighbors_and_dists(curr_voxel, neighbors, neighbor_dists);
-			for(int i=0; i < neighbors.size(); ++i) {
-				if (XOR(obj_in_fov, cam->is_in_fov(point_from_voxel(neighbors[i]), zbuffer, cam_pose))) {
-					double neighbor_OD = ODF.get(neighbors[i]);
-					if (neighbor_OD < next_OD) {
-						next_OD = neighbor_OD;
-						next_voxel = neighbors[i];
+	return sd;
+}
+
+/**
+ * \brief Which voxel centers are in the FOV at cam_pose, and the signed distance field of the FOV boundary
+ */
+VisibilityField VoxelGrid::get_visibility_field(Camera* cam, const Matrix<double,H_SUB,W_SUB>& zbuffer, const Matrix4d& cam_pose) {
+	VisibilityField field;
+	field.cam = cam;
+	field.zbuffer = zbuffer;
+	field.cam_pose = cam_pose;
+	field.cam_pose_inv = cam_pose.inverse();
+	field.size = Vector3i(resolution, resolution, resolution);
+
+	int num_voxels = resolution*resolution*resolution;
+	field.visible.resize(num_voxels);
+	pool->parallel_for(0, resolution, [&](int i) {
+		for(int j=0; j < resolution; ++j) {
+			for(int k=0; k < resolution; ++k) {
+				Vector3i voxel(i,j,k);
+				field.visible[voxel_index(voxel)] = field.is_in_fov(point_from_voxel(voxel));
+			}
+		}
+	});
+
+	// inside the FOV the distance to the nearest hidden voxel, outside to the nearest visible one
+	std::vector<uint8_t> hidden(num_voxels);
+	field.num_visible = 0;
+	for(int v=0; v < num_voxels; ++v) {
+		hidden[v] = (field.visible[v] == 0);
+		field.num_visible += field.visible[v];
+	}
+
+	field.free_visible.clear();
+	field.free_hidden.clear();
+	for(int i=0; i < resolution; ++i) {
+		for(int j=0; j < resolution; ++j) {
+			for(int k_block=0; k_block < resolution; k_block += SparseCube::BLOCK) {
+				const double* block = TSDF->find_block(i, j, k_block);
+				for(int k=k_block; k < std::min(resolution, k_block + SparseCube::BLOCK); ++k) {
+					double tsdf = (block != NULL) ? block[SparseCube::offset_in_block(i,j,k)] : TSDF->get_background();
+					if (tsdf != 0) {
+						int v = voxel_index(Vector3i(i,j,k));
+						((field.visible[v] != 0) ? field.free_visible : field.free_hidden).push_back(v);
 					}
 				}
 			}
+		}
+	}
 
-			if (next_OD >= curr_OD) {
-				break;
-			}
+	std::vector<double> to_hidden(num_voxels);
+	field.signed_distance = Cube(resolution, resolution, resolution);
+	double* to_visible = field.signed_distance.data();
+	FOV_field->compute(&hidden[0], &to_hidden[0]);
+	FOV_field->compute(&field.visible[0], to_visible);
+	for(int v=0; v < num_voxels; ++v) {
+		to_visible[v] = (field.visible[v] != 0) ? to_hidden[v] : -to_visible[v];
+	}
 
-			curr_OD = next_OD;
-			curr_voxel = next_voxel;
-		}
+	return field;
+}
 
-		if (curr_OD < ODF.get(min_voxel)) {
-			min_voxel = curr_voxel;
+/**
+ * \brief Voxel center with the smallest ODF on the other side of the FOV boundary from object
+ */
+Vector3d VoxelGrid::signed_distance_complete_voxel_center(const Vector3d& object, const Cube& ODF, const VisibilityField& field) {
+	// only the free voxels on the other side of the FOV boundary are candidates
+	const std::vector<int>& candidates = (field.is_in_fov(object)) ? field.free_hidden : field.free_visible;
+	const double* odf = ODF.data();
+
+	double min_dist = INFINITY;
+	int min_index = 0;
+	for(int c=0; c < candidates.size(); ++c) {
+		if (odf[candidates[c]] < min_dist) {
+			min_dist = odf[candidates[c]];
+			min_index = candidates[c];
 		}
 	}
+	Vector3i min_voxel = voxel_from_index(min_index);
 
-	rave_utils::plot_point(cam->get_sensor()->GetEnv(), point_from_voxel(min_voxel), Vector3d(0,0,1), .02);
+	rave_utils::plot_point(field.cam->get_sensor()->GetEnv(), point_from_voxel(min_voxel), Vector3d(0,1,0), .03);
 
 	return point_from_voxel(min_voxel);
 }
 
-double VoxelGrid::signed_distance_complete(const Vector3d& object, Cube& ODF,
-		Camera* cam, const Matrix<double,H_SUB,W_SUB>& zbuffer, const Matrix4d& cam_pose) {
+Vector3d VoxelGrid::signed_distance_greedy_voxel_center(const Vector3d& object, const Cube& ODF, const VisibilityField& field) {
+	return signed_distance_greedy_voxel_center(object, field.is_in_fov(object), ODF, field.cam, field.zbuffer, field.cam_pose, &field);
+}
 
-	Vector3d voxel_center = signed_distance_complete_voxel_center(object, ODF, cam, zbuffer, cam_pose);
+double VoxelGrid::signed_distance_complete(const Vector3d& object, const Cube& ODF, const VisibilityField& field) {
+	Vector3d voxel_center = signed_distance_complete_voxel_center(object, ODF, field);
 	double dist = (object - voxel_center).norm();
 
-	bool obj_in_fov = cam->is_in_fov(object, zbuffer, cam_pose);
-	double sd = (obj_in_fov) ? dist : -dist;
-
-	return sd;
+	return (field.is_in_fov(object)) ? dist : -dist;
 }
 
-double VoxelGrid::signed_distance_greedy(const Vector3d& object, const Cube& ODF,
-		Camera* cam, const Matrix<double,H_SUB,W_SUB>& zbuffer, const Matrix4d& cam_pose) {
-
-	Vector3d voxel_center = signed_distance_greedy_voxel_center(object, ODF, cam, zbuffer, cam_pose);
+double VoxelGrid::signed_distance_greedy(const Vector3d& object, const Cube& ODF, const VisibilityField& field) {
+	Vector3d voxel_center = signed_distance_greedy_voxel_center(object, ODF, field);
 	double dist = (object - voxel_center).norm();
 
-	bool obj_in_fov = cam->is_in_fov(object, zbuffer, cam_pose);
-	double sd = (obj_in_fov) ? dist : -dist;
+	return (field.is_in_fov(object)) ? dist : -dist;
+}
 
-	return sd;
+/**
+ * \brief Approximation of signed_distance_complete: the Euclidean signed distance of object
+ *        to the FOV boundary, interpolated between voxel centers. O(1), but it ignores the
+ *        occupied TSDF voxels the ODF paths go around, so it differs from the ODF based
+ *        distance wherever they lie between object and the boundary.
+ */
+double VoxelGrid::signed_distance_interpolated(const Vector3d& object, const VisibilityField& field) {
+	// without a boundary the field is INFINITY or -INFINITY everywhere
+	if (field.num_visible == 0) {
+		return -INFINITY;
+	}
+	if (field.num_visible == field.size.prod()) {
+		return INFINITY;
+	}
+
+	return field.signed_distance.trilinear_interpolation(exact_voxel_from_point(object));
 }
 
 Matrix<double,H_SUB,W_SUB> VoxelGrid::get_zbuffer(const Matrix4d& cam_pose) {
@@ -440,16 +354,13 @@ Matrix<double,H_SUB,W_SUB> VoxelGrid::get_zbuffer(const Matrix4d& cam_pose) {
 double VoxelGrid::distance_to_TSDF(const Vector3d& cam_pos) {
 	double min_dist = INFINITY;
 
-	for(int i=0; i < resolution; ++i) {
-		for(int j=0; j < resolution; ++j) {
-			for(int k=0; k < resolution; ++k) {
-				if (TSDF->get(i,j,k) == 0) {
-					double dist = (cam_pos - point_from_voxel(Vector3i(i,j,k))).norm();
-					min_dist = (min_dist < dist) ? min_dist : dist;
-				}
-			}
+	// the background is free, so every occupied voxel is in an allocated block
+	TSDF->for_each_allocated([&](int i, int j, int k, double val) {
+		if (val == 0) {
+			double dist = (cam_pos - point_from_voxel(Vector3i(i,j,k))).norm();
+			min_dist = (min_dist < dist) ? min_dist : dist;
 		}
-	}
+	});
 
 	return min_dist;
 }
@@ -534,15 +445,11 @@ void VoxelGrid::plot_kinfu_tsdf(rave::EnvironmentBasePtr env) {
 
 void VoxelGrid::plot_TSDF(rave::EnvironmentBasePtr env) {
 	Vector3d color(1,0,0);
-	for(int i=0; i < resolution; ++i) {
-		for(int j=0; j < resolution; ++j) {
-			for(int k=0; k < resolution; ++k) {
-				if (TSDF->get(i,j,k) == 0) {
-					rave_utils::plot_point(env, point_from_voxel(Vector3i(i,j,k)), color, radius);
-				}
-			}
+	TSDF->for_each_allocated([&](int i, int j, int k, double val) {
+		if (val == 0) {
+			rave_utils::plot_point(env, point_from_voxel(Vector3i(i,j,k)), color, radius);
 		}
-	}
+	});
 }
 
 void VoxelGrid::plot_ODF(Cube& ODF, rave::EnvironmentBasePtr env) {
@@ -659,6 +566,73 @@ void VoxelGrid::update_TSDF(const StdVector3d& pc) {
 	}
 }
 
+inline bool XOR(const bool& lhs, const bool& rhs) {
+    return !( lhs && rhs ) && ( lhs || rhs );
+}
+
+/**
+ * \brief Descends the ODF through voxels on the other side of the FOV boundary from object,
+ *        looking visibility up in field if there is one
+ */
+Vector3d VoxelGrid::signed_distance_greedy_voxel_center(const Vector3d& object, bool obj_in_fov, const Cube& ODF,
+		Camera* cam, const Matrix<double,H_SUB,W_SUB>& zbuffer, const Matrix4d& cam_pose, const VisibilityField* field) {
+	StdVector3i neighbors;
+	std::vector<double> neighbor_dists;
+
+	std::vector<Vector3i> start_voxels;
+
+	if (obj_in_fov) {
+		start_voxels.push_back(Vector3i(resolution-1, int(resolution/2), resolution-1));
+		start_voxels.push_back(Vector3i(0, resolution-1, resolution-1));
+		start_voxels.push_back(Vector3i(0, 0, resolution-1));
+	} else {
+		Matrix4d start_cam_frame = Matrix4d::Identity();
+		start_cam_frame(2,3) = .2; // intrinsics::MIN_RANGE;
+		Vector3d start_world = (cam_pose*start_cam_frame).block<3,1>(0,3);
+
+		start_voxels.push_back(voxel_from_point(start_world));
+	}
+
+	Vector3i min_voxel = start_voxels[0];
+	for(int s=0; s < start_voxels.size(); ++s) {
+		Vector3i curr_voxel = start_voxels[s], next_voxel = Vector3i::Zero();
+		double curr_OD = ODF.get(curr_voxel), next_OD;
+
+		while(true) {
+			rave_utils::plot_point(cam->get_sensor()->GetEnv(), point_from_voxel(curr_voxel), Vector3d(0,0,1), .01);
+
+			next_OD = INFINITY;
+			get_voxel_neighbors_and_dists(curr_voxel, neighbors, neighbor_dists);
+			for(int i=0; i < neighbors.size(); ++i) {
+				bool neighbor_in_fov = (field != NULL) ? field->is_visible(neighbors[i]) :
+						cam->is_in_fov(point_from_voxel(neighbors[i]), zbuffer, cam_pose);
+				if (XOR(obj_in_fov, neighbor_in_fov)) {
+					double neighbor_OD = ODF.get(neighbors[i]);
+					if (neighbor_OD < next_OD) {
+						next_OD = neighbor_OD;
+						next_voxel = neighbors[i];
+					}
+				}
+			}
+
+			if (next_OD >= curr_OD) {
+				break;
+			}
+
+			curr_OD = next_OD;
+			curr_voxel = next_voxel;
+		}
+
+		if (curr_OD < ODF.get(min_voxel)) {
+			min_voxel = curr_voxel;
+		}
+	}
+
+	rave_utils::plot_point(cam->get_sensor()->GetEnv(), point_from_voxel(min_voxel), Vector3d(0,0,1), .02);
+
+	return point_from_voxel(min_voxel);
+}
+
 void VoxelGrid::get_voxel_neighbors_and_dists(const Vector3i& voxel, StdVector3i& neighbors, std::vector<double>& dists) {
 	neighbors.clear();
 	dists.clear();
@@ -2,6 +2,8 @@
 #define __VOXEL_GRID_H__
 
 #include "pr2-sim.h"
+#include "cube.h"
+#include "distance-field.h"
 #include "../utils/rave-utils.h"
 #include "../../util/logging.h"
 
@@ -16,7 +18,6 @@ namespace rave = OpenRAVE;
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/dijkstra_shortest_paths.hpp>
 #include <boost/property_map/property_map.hpp>
-#include <boost/heap/fibonacci_heap.hpp>
 
 #include <pcl/console/parse.h>
 #include <pcl/gpu/kinfu_large_scale/kinfu.h>
@@ -43,48 +44,36 @@ typedef short            WeightT;
 
 typedef std::vector<Vector3i, aligned_allocator<Vector3i>> StdVector3i;
 
-class Cube {
+/**
+ * The voxel centers in the FOV of one camera pose, and their signed distance to the FOV
+ * boundary: the distance to the nearest voxel center on the other side, + in the FOV and
+ * - outside. Built once per pose by VoxelGrid::get_visibility_field, so signed distance
+ * queries at that pose look voxels up instead of calling is_in_fov over the grid.
+ */
+class VisibilityField {
 public:
-	Cube() : x_size(0), y_size(0), z_size(0) { };
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
-	Cube(int x, int y, int z) : x_size(x), y_size(y), z_size(z) {
-		array = VectorXd(x_size*y_size*z_size);
-		array.setZero();
-	}
-
-	inline double get(int x, int y, int z) const {
-		assert((x >= 0) && (x < x_size) && (y >= 0) && (y < y_size) && (z >= 0) && (z < z_size));
-		return array(z + y*(z_size) + x*(y_size*z_size));
-	}
-
-	inline double get(const Vector3i& xyz) const {
-		return get(xyz(0), xyz(1), xyz(2));
-	}
+	Camera* cam;
+	Matrix<double,H_SUB,W_SUB> zbuffer;
+	Matrix4d cam_pose, cam_pose_inv;
 
-	inline void set(int x, int y, int z, double val) {
-		assert((x >= 0) && (x < x_size) && (y >= 0) && (y < y_size) && (z >= 0) && (z < z_size));
-		array(z + y*(z_size) + x*(y_size*z_size)) = val;
-	}
+	Vector3i size;
+	std::vector<uint8_t> visible; // layout of Cube
+	int num_visible;
+	Cube signed_distance;
 
-	inline void set(const Vector3i& xyz, double val) {
-		set(xyz(0), xyz(1), xyz(2), val);
-	}
+	// indices of the free (TSDF != 0) voxels on each side of the FOV boundary, the candidates
+	// of signed_distance_complete, so a field is only valid until the next VoxelGrid::update
+	std::vector<int> free_visible, free_hidden;
 
-	inline void set_all(double val) {
-		for(int i=0; i < x_size*y_size*z_size; ++i) {
-			array(i) = val;
-		}
+	inline bool is_visible(const Vector3i& voxel) const {
+		return (visible[voxel(2) + voxel(1)*size(2) + voxel(0)*size(1)*size(2)] != 0);
 	}
 
-	inline Vector3i size() const {
-		return Vector3i(x_size, y_size, z_size);
+	inline bool is_in_fov(const Vector3d& point) const {
+		return cam->is_in_fov(point, zbuffer, cam_pose, cam_pose_inv);
 	}
-
-	double trilinear_interpolation(const Vector3d& voxel) const;
-
-private:
-	int x_size, y_size, z_size;
-	VectorXd array;
 };
 
 
@@ -105,6 +94,15 @@ public:
 	double signed_distance_greedy(const Vector3d& object, const Cube& ODF,
 			Camera* cam, const Matrix<double,H_SUB,W_SUB>& zbuffer, const Matrix4d& cam_pose);
 
+	VisibilityField get_visibility_field(Camera* cam, const Matrix<double,H_SUB,W_SUB>& zbuffer, const Matrix4d& cam_pose);
+
+	Vector3d signed_distance_complete_voxel_center(const Vector3d& object, const Cube& ODF, const VisibilityField& field);
+	Vector3d signed_distance_greedy_voxel_center(const Vector3d& object, const Cube& ODF, const VisibilityField& field);
+
+	double signed_distance_complete(const Vector3d& object, const Cube& ODF, const VisibilityField& field);
+	double signed_distance_greedy(const Vector3d& object, const Cube& ODF, const VisibilityField& field);
+	double signed_distance_interpolated(const Vector3d& object, const VisibilityField& field);
+
 	Matrix<double,H_SUB,W_SUB> get_zbuffer(const Matrix4d& cam_pose);
 	double distance_to_TSDF(const Vector3d& cam_pos);
 
@@ -123,7 +121,10 @@ private:
 	Vector3d size, bottom_corner, top_corner;
 	double dx, dy, dz, radius;
 
-	Cube *TSDF;
+	SparseCube *TSDF;
+	util::ThreadPool *pool;
+	GeodesicDistanceField *ODF_field;
+	EuclideanDistanceField *FOV_field;
 	pcl::gpu::kinfuLS::KinfuTracker *pcl_kinfu_tracker;
 
 	Vector3i gpu_resolution;
@@ -136,6 +137,9 @@ private:
 	void update_kinfu(const Matrix<double,HEIGHT_FULL,WIDTH_FULL>& zbuffer, const Matrix4d& cam_pose);
 	void update_TSDF(const StdVector3d& pc);
 
+	Vector3d signed_distance_greedy_voxel_center(const Vector3d& object, bool obj_in_fov, const Cube& ODF,
+			Camera* cam, const Matrix<double,H_SUB,W_SUB>& zbuffer, const Matrix4d& cam_pose, const VisibilityField* field);
+
 	void get_voxel_neighbors_and_dists(const Vector3i& voxel, StdVector3i& neighbors, std::vector<double>& dists);
 	Vector3i voxel_from_point(const Vector3d& point);
 	Vector3d point_from_voxel(const Vector3i& voxel);
@@ -151,6 +155,9 @@ private:
 	inline int voxel_index(const Vector3i& voxel) {
 		return (voxel(2) + voxel(1)*resolution + voxel(0)*resolution*resolution);
 	}
+	inline Vector3i voxel_from_index(int index) {
+		return Vector3i(index / (resolution*resolution), (index / resolution) % resolution, index % resolution);
+	}
 
 };
 
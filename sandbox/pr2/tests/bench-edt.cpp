@@ -0,0 +1,121 @@
+#include "../system/distance-field.h"
+
+#include "../../util/Timer.h"
+#include "../../util/logging.h"
+#include "../../util/random.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+typedef std::vector<Vector3d, aligned_allocator<Vector3d>> StdVector3d;
+
+#define RUNS 3
+
+// largest resolution the brute force reference is run at
+#define MAX_REFERENCE_RESOLUTION 32
+
+/**
+ * \brief Nearest site by scanning every site, for every voxel
+ */
+void reference_EDT(const Vector3i& size, const Vector3d& spacing, const std::vector<uint8_t>& site, std::vector<double>& dist) {
+	StdVector3d sites;
+	for(int i=0; i < size(0); ++i) {
+		for(int j=0; j < size(1); ++j) {
+			for(int k=0; k < size(2); ++k) {
+				if (site[k + j*size(2) + i*size(1)*size(2)] != 0) {
+					sites.push_back(Vector3d(i*spacing(0), j*spacing(1), k*spacing(2)));
+				}
+			}
+		}
+	}
+
+	dist.assign(size.prod(), INFINITY);
+	for(int i=0; i < size(0); ++i) {
+		for(int j=0; j < size(1); ++j) {
+			for(int k=0; k < size(2); ++k) {
+				Vector3d p(i*spacing(0), j*spacing(1), k*spacing(2));
+				double& d = dist[k + j*size(2) + i*size(1)*size(2)];
+				for(int s=0; s < sites.size(); ++s) {
+					d = std::min(d, (p - sites[s]).norm());
+				}
+			}
+		}
+	}
+}
+
+/**
+ * \brief A viewing cone from above the grid, with random holes (occluded voxels)
+ */
+void random_visibility(const Vector3i& size, util::Random& random, std::vector<uint8_t>& site) {
+	site.assign(size.prod(), 0);
+	Vector3d apex(.5*size(0), .3*size(1), 1.5*size(2)), axis = Vector3d(0, .4, -1).normalized();
+	for(int i=0; i < size(0); ++i) {
+		for(int j=0; j < size(1); ++j) {
+			for(int k=0; k < size(2); ++k) {
+				Vector3d d = Vector3d(i,j,k) - apex;
+				bool in_cone = (d.normalized().dot(axis) > .85);
+				site[k + j*size(2) + i*size(1)*size(2)] = (in_cone && (random.uniform() > .05));
+			}
+		}
+	}
+}
+
+int main(int argc, char* argv[]) {
+	util::ThreadPool pool;
+	util::Random random(0);
+	util::Timer timer;
+
+	// a 1 x 1 x .5 m workspace
+	Vector3d extents(1, 1, .5);
+
+	std::cout << "threads: " << pool.size() << "\n";
+	std::cout << std::setw(12) << "resolution" << std::setw(16) << "reference (s)" << std::setw(16) << "serial (s)"
+			<< std::setw(16) << "pool (s)" << std::setw(16) << "max abs diff" << "\n";
+
+	int resolutions[] = {16, 24, 32, 64, 100, 128, 192};
+	for(int r=0; r < sizeof(resolutions)/sizeof(resolutions[0]); ++r) {
+		int n = resolutions[r];
+		Vector3i size(n, n, n);
+		Vector3d spacing = extents / n;
+		std::vector<uint8_t> site;
+		random_visibility(size, random, site);
+
+		std::vector<double> dist(n*n*n), dist_pool(n*n*n);
+		EuclideanDistanceField serial(size, spacing), parallel(size, spacing, &pool);
+
+		util::Timer_tic(&timer);
+		for(int run=0; run < RUNS; ++run) {
+			serial.compute(&site[0], &dist[0]);
+		}
+		double serial_time = util::Timer_toc(&timer) / RUNS;
+
+		util::Timer_tic(&timer);
+		for(int run=0; run < RUNS; ++run) {
+			parallel.compute(&site[0], &dist_pool[0]);
+		}
+		double pool_time = util::Timer_toc(&timer) / RUNS;
+
+		double reference_time = NAN, max_diff = 0;
+		if (n <= MAX_REFERENCE_RESOLUTION) {
+			std::vector<double> dist_reference;
+			util::Timer_tic(&timer);
+			reference_EDT(size, spacing, site, dist_reference);
+			reference_time = util::Timer_toc(&timer);
+
+			for(int v=0; v < n*n*n; ++v) {
+				max_diff = std::max(max_diff, fabs(dist[v] - dist_reference[v]));
+			}
+		}
+		for(int v=0; v < n*n*n; ++v) {
+			max_diff = std::max(max_diff, fabs(dist[v] - dist_pool[v]));
+		}
+
+		std::cout << std::setw(12) << n << std::setw(16) << reference_time << std::setw(16) << serial_time
+				<< std::setw(16) << pool_time << std::setw(16) << max_diff << "\n";
+
+		if (max_diff > 1e-12) {
+			LOG_ERROR("EDT differs from the reference by %g at resolution %d", max_diff, n);
+		}
+	}
+}
@@ -0,0 +1,173 @@
+#include "../system/distance-field.h"
+
+#include "../../util/Timer.h"
+#include "../../util/logging.h"
+#include "../../util/random.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <map>
+
+#include <boost/heap/fibonacci_heap.hpp>
+
+typedef std::vector<Vector3i, aligned_allocator<Vector3i>> StdVector3i;
+
+#define RUNS 3
+
+// largest resolution the reference is run at, it takes seconds beyond
+#define MAX_REFERENCE_RESOLUTION 64
+
+struct VoxelDist {
+	Vector3i voxel;
+	double dist;
+
+	VoxelDist(const Vector3i& v, const double d) : voxel(v), dist(d) { };
+
+	bool operator<(VoxelDist const & rhs) const {
+		return (dist > rhs.dist);
+	}
+};
+
+/**
+ * \brief The former VoxelGrid::get_ODF: Dijkstra on a fibonacci heap, handles looked up by voxel
+ */
+void reference_ODF(int resolution, const Vector3d& spacing, const std::vector<uint8_t>& free,
+		const Vector3i& source, std::vector<double>& ODF) {
+	typedef boost::heap::fibonacci_heap<VoxelDist>::handle_type handle_t;
+	auto index = [resolution](const Vector3i& v) { return v(2) + v(1)*resolution + v(0)*resolution*resolution; };
+
+	StdVector3i offsets;
+	std::vector<double> offset_dists;
+	for(int a=-1; a <= 1; ++a) {
+		for(int b=-1; b <= 1; ++b) {
+			for(int c=-1; c <= 1; ++c) {
+				if ((a == 0) && (b == 0) && (c == 0)) { continue; }
+				offsets.push_back(Vector3i(a,b,c));
+				int nonzero = abs(a) + abs(b) + abs(c);
+				offset_dists.push_back((nonzero == 1) ? spacing.dot(Vector3d(abs(a), abs(b), abs(c))) :
+						Vector3d(abs(a)*spacing(0), abs(b)*spacing(1), abs(c)*spacing(2)).norm());
+			}
+		}
+	}
+
+	ODF.assign(resolution*resolution*resolution, INFINITY);
+
+	boost::heap::fibonacci_heap<VoxelDist> pq;
+	std::map<std::vector<int>,handle_t> voxel_handle;
+	for(int i=0; i < resolution; ++i) {
+		for(int j=0; j < resolution; ++j) {
+			for(int k=0; k < resolution; ++k) {
+				const Vector3i voxel(i,j,k);
+				if (free[index(voxel)] != 0) {
+					double dist = (voxel == source) ? 0 : INFINITY;
+					voxel_handle[{i,j,k}] = pq.push(VoxelDist(voxel, dist));
+				}
+			}
+		}
+	}
+
+	while (pq.size() > 0) {
+		VoxelDist curr = pq.top();
+		pq.pop();
+		ODF[index(curr.voxel)] = curr.dist;
+
+		for(int n=0; n < offsets.size(); ++n) {
+			Vector3i neighbor = curr.voxel + offsets[n];
+			if ((neighbor.minCoeff() < 0) || (neighbor.maxCoeff() >= resolution) || (free[index(neighbor)] == 0)) {
+				continue;
+			}
+			double dist = curr.dist + offset_dists[n];
+			if (dist < ODF[index(neighbor)]) {
+				ODF[index(neighbor)] = dist;
+				pq.update(voxel_handle[{neighbor(0), neighbor(1), neighbor(2)}], VoxelDist(neighbor, dist));
+			}
+		}
+	}
+}
+
+/**
+ * \brief Table-top occupancy: an empty slab (the table) and random empty boxes (objects)
+ */
+void random_occupancy(int resolution, util::Random& random, std::vector<uint8_t>& free) {
+	int n = resolution;
+	free.assign(n*n*n, 1);
+	auto clear_box = [&](int x0, int x1, int y0, int y1, int z0, int z1) {
+		for(int i=std::max(x0,0); i < std::min(x1,n); ++i) {
+			for(int j=std::max(y0,0); j < std::min(y1,n); ++j) {
+				for(int k=std::max(z0,0); k < std::min(z1,n); ++k) {
+					free[k + j*n + i*n*n] = 0;
+				}
+			}
+		}
+	};
+
+	clear_box(0, n, 0, n, 0, n/8);
+	for(int b=0; b < 12; ++b) {
+		int x = random.uniform()*n, y = random.uniform()*n, z = n/8;
+		int w = 1 + random.uniform()*n/6, h = 1 + random.uniform()*n/3;
+		clear_box(x, x + w, y, y + w, z, z + h);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	util::ThreadPool pool;
+	util::Random random(0);
+	util::Timer timer;
+
+	// a 1 x 1 x .5 m workspace
+	Vector3d extents(1, 1, .5);
+
+	std::cout << "threads: " << pool.size() << "\n";
+	std::cout << std::setw(12) << "resolution" << std::setw(16) << "reference (s)" << std::setw(16) << "serial (s)"
+			<< std::setw(16) << "pool (s)" << std::setw(12) << "speedup" << std::setw(16) << "max abs diff" << "\n";
+
+	int resolutions[] = {16, 32, 48, 64, 96, 128, 192};
+	for(int r=0; r < sizeof(resolutions)/sizeof(resolutions[0]); ++r) {
+		int n = resolutions[r];
+		Vector3d spacing = extents / n;
+		std::vector<uint8_t> free;
+		random_occupancy(n, random, free);
+		Vector3i source(n/2, n/2, n - 2);
+
+		std::vector<double> ODF(n*n*n), ODF_pool(n*n*n);
+		GeodesicDistanceField serial(Vector3i(n,n,n), spacing), parallel(Vector3i(n,n,n), spacing, &pool);
+
+		util::Timer_tic(&timer);
+		for(int run=0; run < RUNS; ++run) {
+			serial.compute(&free[0], source, &ODF[0]);
+		}
+		double serial_time = util::Timer_toc(&timer) / RUNS;
+
+		util::Timer_tic(&timer);
+		for(int run=0; run < RUNS; ++run) {
+			parallel.compute(&free[0], source, &ODF_pool[0]);
+		}
+		double pool_time = util::Timer_toc(&timer) / RUNS;
+
+		double reference_time = NAN, max_diff = 0;
+		if (n <= MAX_REFERENCE_RESOLUTION) {
+			std::vector<double> ODF_reference;
+			util::Timer_tic(&timer);
+			reference_ODF(n, spacing, free, source, ODF_reference);
+			reference_time = util::Timer_toc(&timer);
+
+			for(int v=0; v < n*n*n; ++v) {
+				bool both_inf = std::isinf(ODF_reference[v]) && std::isinf(ODF[v]);
+				max_diff = std::max(max_diff, both_inf ? 0 : fabs(ODF[v] - ODF_reference[v]));
+			}
+		}
+		for(int v=0; v < n*n*n; ++v) {
+			bool both_inf = std::isinf(ODF_pool[v]) && std::isinf(ODF[v]);
+			max_diff = std::max(max_diff, both_inf ? 0 : fabs(ODF[v] - ODF_pool[v]));
+		}
+
+		std::cout << std::setw(12) << n << std::setw(16) << reference_time << std::setw(16) << serial_time
+				<< std::setw(16) << pool_time << std::setw(12) << reference_time / pool_time
+				<< std::setw(16) << max_diff << "\n";
+
+		if (max_diff != 0) {
+			LOG_ERROR("ODF differs from the reference by %g at resolution %d", max_diff, n);
+		}
+	}
+}
@@ -0,0 +1,140 @@
+#include "../system/cube.h"
+
+#include "../../util/Timer.h"
+#include "../../util/logging.h"
+#include "../../util/random.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+typedef std::vector<Vector3i, aligned_allocator<Vector3i>> StdVector3i;
+
+// largest resolution the dense Cube is allocated at (8 bytes per voxel)
+#define MAX_DENSE_RESOLUTION 256
+
+#define NUM_GETS 1000000
+
+/**
+ * \brief Occupied voxels of a shelf as update_TSDF sees it: the surfaces of a table slab
+ *        and of random boxes on it, the insides are never observed
+ */
+void shelf_surface(int n, util::Random& random, StdVector3i& occupied) {
+	occupied.clear();
+	auto box_surface = [&](int x0, int x1, int y0, int y1, int z0, int z1) {
+		for(int i=std::max(x0,0); i < std::min(x1,n); ++i) {
+			for(int j=std::max(y0,0); j < std::min(y1,n); ++j) {
+				for(int k=std::max(z0,0); k < std::min(z1,n); ++k) {
+					if ((i == x0) || (i == x1-1) || (j == y0) || (j == y1-1) || (k == z0) || (k == z1-1)) {
+						occupied.push_back(Vector3i(i,j,k));
+					}
+				}
+			}
+		}
+	};
+
+	box_surface(0, n, 0, n, n/8 - 1, n/8);
+	for(int b=0; b < 12; ++b) {
+		int x = random.uniform()*n, y = random.uniform()*n, z = n/8;
+		int w = 1 + random.uniform()*n/6, h = 1 + random.uniform()*n/3;
+		box_surface(x, x + w, y, y + w, z, z + h);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	util::Random random(0);
+	util::Timer timer;
+
+	std::cout << std::setw(8) << "res" << std::setw(12) << "occupied" << std::setw(10) << "blocks"
+			<< std::setw(14) << "dense (MB)" << std::setw(14) << "sparse (MB)"
+			<< std::setw(14) << "set dense" << std::setw(14) << "set sparse"
+			<< std::setw(14) << "sweep dense" << std::setw(14) << "sweep sparse"
+			<< std::setw(14) << "get dense" << std::setw(14) << "get sparse" << "  (s)\n";
+
+	int resolutions[] = {64, 128, 256, 512, 1024};
+	for(int r=0; r < sizeof(resolutions)/sizeof(resolutions[0]); ++r) {
+		int n = resolutions[r];
+		StdVector3i occupied;
+		shelf_surface(n, random, occupied);
+
+		StdVector3i queries(NUM_GETS);
+		for(int q=0; q < NUM_GETS; ++q) {
+			queries[q] = Vector3i(random.uniform()*n, random.uniform()*n, random.uniform()*n).cwiseMin(n-1);
+		}
+
+		// as update_TSDF
+		util::Timer_tic(&timer);
+		SparseCube sparse(n, n, n, 1);
+		for(int i=0; i < occupied.size(); ++i) {
+			sparse.set(occupied[i], 0);
+		}
+		double set_sparse = util::Timer_toc(&timer);
+
+		// as distance_to_TSDF and plot_TSDF
+		util::Timer_tic(&timer);
+		int num_occupied = 0;
+		sparse.for_each_allocated([&](int i, int j, int k, double val) { num_occupied += (val == 0); });
+		double sweep_sparse = util::Timer_toc(&timer);
+
+		util::Timer_tic(&timer);
+		double sum_sparse = 0;
+		for(int q=0; q < NUM_GETS; ++q) {
+			sum_sparse += sparse.get(queries[q]);
+		}
+		double get_sparse = util::Timer_toc(&timer);
+
+		double dense_mb = NAN, set_dense = NAN, sweep_dense = NAN, get_dense = NAN;
+		if (n <= MAX_DENSE_RESOLUTION) {
+			util::Timer_tic(&timer);
+			Cube dense(n, n, n);
+			dense.set_all(1);
+			for(int i=0; i < occupied.size(); ++i) {
+				dense.set(occupied[i], 0);
+			}
+			set_dense = util::Timer_toc(&timer);
+			dense_mb = n*n*double(n)*sizeof(double) / 1e6;
+
+			util::Timer_tic(&timer);
+			int num_occupied_dense = 0;
+			for(int i=0; i < n; ++i) {
+				for(int j=0; j < n; ++j) {
+					for(int k=0; k < n; ++k) {
+						num_occupied_dense += (dense.get(i,j,k) == 0);
+					}
+				}
+			}
+			sweep_dense = util::Timer_toc(&timer);
+
+			util::Timer_tic(&timer);
+			double sum_dense = 0;
+			for(int q=0; q < NUM_GETS; ++q) {
+				sum_dense += dense.get(queries[q]);
+			}
+			get_dense = util::Timer_toc(&timer);
+
+			int num_diff = (num_occupied != num_occupied_dense) + (sum_sparse != sum_dense);
+			for(int q=0; q < 10000; ++q) {
+				Vector3d voxel = Vector3d(random.uniform(), random.uniform(), random.uniform())*(n-1);
+				num_diff += (sparse.trilinear_interpolation(voxel) != dense.trilinear_interpolation(voxel));
+			}
+			if (n <= 128) {
+				for(int i=0; i < n; ++i) {
+					for(int j=0; j < n; ++j) {
+						for(int k=0; k < n; ++k) {
+							num_diff += (sparse.get(i,j,k) != dense.get(i,j,k));
+						}
+					}
+				}
+			}
+			if (num_diff != 0) {
+				LOG_ERROR("SparseCube differs from Cube in %d checks at resolution %d", num_diff, n);
+			}
+		}
+
+		std::cout << std::setw(8) << n << std::setw(12) << num_occupied << std::setw(10) << sparse.num_blocks()
+				<< std::setw(14) << dense_mb << std::setw(14) << sparse.memory() / 1e6
+				<< std::setw(14) << set_dense << std::setw(14) << set_sparse
+				<< std::setw(14) << sweep_dense << std::setw(14) << sweep_sparse
+				<< std::setw(14) << get_dense << std::setw(14) << get_sparse << "\n";
+	}
+}
@@ -271,6 +271,49 @@ void test_fk() {
 	std::cout << "fk_cam_pose:\n" << fk_cam_pose << "\n\n";
 }
 
+void test_fk_jacobian() {
+	Vector3d object(3.35, -1.11, 0.8);
+	Arm::ArmType arm_type = Arm::ArmType::right;
+	bool view = false;
+	PR2System sys(object, arm_type, view);
+
+	Arm* arm = sys.get_arm();
+	Camera* cam = sys.get_camera();
+
+	arm->set_posture(Arm::Posture::mantis);
+	VectorJ j = arm->get_joint_values();
+
+	Matrix4d pose;
+	Matrix<double,6,ARM_DIM> jac, jac_fd;
+	cam->get_pose_jacobian(j, pose, jac);
+
+	// central differences of the position, and of the rotation as an angular velocity
+	const double step = 1e-5;
+	VectorJ j_p = j, j_m = j;
+	for(int i=0; i < ARM_DIM; ++i) {
+		j_p(i) += step; j_m(i) -= step;
+		Matrix4d pose_p = cam->get_pose(j_p), pose_m = cam->get_pose(j_m);
+		jac_fd.block<3,1>(0,i) = (pose_p.block<3,1>(0,3) - pose_m.block<3,1>(0,3)) / (2*step);
+		Matrix3d omega = (pose_p.block<3,3>(0,0) - pose_m.block<3,3>(0,0)) / (2*step) * pose.block<3,3>(0,0).transpose();
+		jac_fd.block<3,1>(3,i) << omega(2,1), omega(0,2), omega(1,0);
+		j_p(i) = j(i); j_m(i) = j(i);
+	}
+
+	std::cout << "pose difference from get_pose: " << (pose - cam->get_pose(j)).norm() << "\n";
+	std::cout << "jacobian:\n" << jac << "\n\n";
+	std::cout << "max difference from finite differences: " << (jac - jac_fd).cwiseAbs().maxCoeff() << "\n";
+
+	// joint columns of the object observation, which linearize_obsfunc takes from the jacobian
+	Matrix<double,3,ARM_DIM> obs_jac_fd;
+	for(int i=0; i < ARM_DIM; ++i) {
+		j_p(i) += step; j_m(i) -= step;
+		obs_jac_fd.col(i) = (sys.obsfunc(j_p, object, VectorR::Zero()).segment<3>(J_DIM) -
+				sys.obsfunc(j_m, object, VectorR::Zero()).segment<3>(J_DIM)) / (2*step);
+		j_p(i) = j(i); j_m(i) = j(i);
+	}
+	std::cout << "max observation jacobian difference: " << (-jac.block<3,ARM_DIM>(0,0) - obs_jac_fd).cwiseAbs().maxCoeff() << "\n";
+}
+
 void test_ik() {
 	Vector3d object(3.35, -1.11, 0.8);
 	Arm::ArmType arm_type = Arm::ArmType::right;
@@ -332,6 +375,11 @@ void test_greedy() {
 
 	Vector3d lower = pos_center - Vector3d(x_height/2., y_height/2., z_height/2.);
 	Vector3d upper = pos_center + Vector3d(x_height/2., y_height/2., z_height/2.);
+
+	tc.start("visibility_field");
+	VisibilityField field = vgrid.get_visibility_field(cam, zbuffer, cam->get_pose(arm->get_joint_values()));
+	tc.stop("visibility_field");
+
 	for(int iter=0; iter < 10; ++iter) {
 		rave_utils::clear_plots();
 		vgrid.plot_TSDF(env);
@@ -357,8 +405,18 @@ void test_greedy() {
 		double sd_greedy = vgrid.signed_distance_greedy(object, ODF, cam, zbuffer, cam->get_pose(arm->get_joint_values()));
 		tc.stop("sd_greedy");
 
+		tc.start("sd_complete_field");
+		double sd_complete_field = vgrid.signed_distance_complete(object, ODF, field);
+		tc.stop("sd_complete_field");
+
+		tc.start("sd_interpolated");
+		double sd_interpolated = vgrid.signed_distance_interpolated(object, field);
+		tc.stop("sd_interpolated");
+
 		std::cout << "sd_complete: " << sd_complete << "\n";
 		std::cout << "sd_greedy: " << sd_greedy << "\n";
+		std::cout << "sd_complete_field: " << sd_complete_field << "\n";
+		std::cout << "sd_interpolated: " << sd_interpolated << "\n";
 
 		tc.print_all_elapsed();
 		tc.clear_all();
@@ -677,6 +735,7 @@ int main() {
 //	test_pr2_system();
 //	test_camera();
 //	test_fk();
+//	test_fk_jacobian();
 //	test_ik();
 //	test_voxel_grid();
 //	test_greedy();
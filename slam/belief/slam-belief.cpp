@@ -1,10 +1,14 @@
 #include <vector>
 #include <iomanip>
+#include <memory>
+#include <future>
 #include <sys/resource.h>
 
 #include "util/matrix.h"
 #include "util/Timer.h"
 #include "util/logging.h"
+#include "util/threadpool.h"
+#include "util/continuation.h"
 
 extern "C" {
 #include "beliefPenaltyMPC.h"
@@ -41,8 +45,21 @@ const double initial_Uangle_trust_box_size = M_PI/8; // 10*M_PI/8;
 
 const int max_penalty_coeff_increases = 3; // 4
 const int max_sqp_iterations = 50; // 50
+
+// number of trust region sizes tried per round, each shrunk by trust_shrink_ratio
+// from the previous one, with the true merits evaluated concurrently (1 is the serial loop)
+const int num_parallel_trust_regions = 1;
+
+// fine timesteps per coarse timestep of the warm start, 1 disables it
+// (off: every factor solves slower than the cold start on every waypoint)
+const int coarse_to_fine_factor = 1;
+const double coarse_goal_penalty = 1e3;
+const int continuation_benchmark_runs = 3;
 }
 
+// time cold solves against coarse-to-fine warm started solves
+//#define CONTINUATION_BENCHMARK
+
 struct forces_exception {
 	forces_exception() { }
 };
@@ -330,28 +347,155 @@ bool isValidInputs()
 }
 
 
+/**
+ * Trust region box sizes, one per group of optimization variables
+ */
+struct TrustRegion {
+	double Beps, Ueps;
+	double Xpos_eps, Xangle_eps, Uvel_eps, Uangle_eps;
+
+	TrustRegion() :
+		Beps(cfg::initial_trust_box_size), Ueps(cfg::initial_trust_box_size),
+		Xpos_eps(cfg::initial_Xpos_trust_box_size), Xangle_eps(cfg::initial_Xangle_trust_box_size),
+		Uvel_eps(cfg::initial_Uvel_trust_box_size), Uangle_eps(cfg::initial_Uangle_trust_box_size) { }
+
+	void scale(double ratio) {
+		Beps *= ratio;
+		Ueps *= ratio;
+		Xpos_eps *= ratio;
+		Xangle_eps *= ratio;
+		Uvel_eps *= ratio;
+		Uangle_eps *= ratio;
+	}
+
+	bool below_min() const {
+		return (Beps < cfg::min_trust_box_size && Ueps < cfg::min_trust_box_size &&
+				Xpos_eps < cfg::min_trust_box_size && Xangle_eps < cfg::min_trust_box_size &&
+				Uvel_eps < cfg::min_trust_box_size && Uangle_eps < cfg::min_trust_box_size);
+	}
+};
+
+// fill in lb, ub for the trust region around (B, U)
+void fillTrustRegionBounds(const std::vector< Matrix<B_DIM> >& B, const std::vector< Matrix<U_DIM> >& U, const TrustRegion& tr)
+{
+	int index;
+	for(int t = 0; t < T-1; ++t)
+	{
+		const Matrix<B_DIM>& bt = B[t];
+		const Matrix<U_DIM>& ut = U[t];
+
+		index = 0;
+		// car pos lower bound
+		for(int i = 0; i < P_DIM; ++i) { lb[t][index++] = MAX(xMin[i], bt[i] - tr.Xpos_eps); }
+		// car angle lower bound
+		lb[t][index++] = MAX(xMin[P_DIM], bt[P_DIM] - tr.Xangle_eps);
+		// landmark pos lower bound
+		for(int i = C_DIM; i < X_DIM; ++i) { lb[t][index++] = MAX(xMin[i], bt[i] - tr.Xpos_eps); }
+
+		// sigma lower bound
+		for(int i = 0; i < S_DIM; ++i) { lb[t][index] = bt[index] - tr.Beps; index++; }
+
+		// u velocity lower bound
+		lb[t][index++] = MAX(uMin[0], ut[0] - tr.Uvel_eps);
+		// u angle lower bound
+		lb[t][index++] = MAX(uMin[1], ut[1] - tr.Uangle_eps);
+
+		// for lower bound on L1 slacks
+		for(int i = 0; i < 2*B_DIM; ++i) { lb[t][index++] = 0; }
+
+		index = 0;
+		// car pos upper bound
+		for(int i = 0; i < P_DIM; ++i) { ub[t][index++] = MIN(xMax[i], bt[i] + tr.Xpos_eps); }
+		// car angle upper bound
+		ub[t][index++] = MIN(xMax[P_DIM], bt[P_DIM] + tr.Xangle_eps);
+		// landmark pos upper bound
+		for(int i = C_DIM; i < X_DIM; ++i) { ub[t][index++] = MIN(xMax[i], bt[i] + tr.Xpos_eps); }
+
+		// sigma upper bound
+		for(int i = 0; i < S_DIM; ++i) { ub[t][index] = bt[index] + tr.Beps; index++; }
+
+		// u velocity upper bound
+		ub[t][index++] = MIN(uMax[0], ut[0] + tr.Uvel_eps);
+		// u angle upper bound
+		ub[t][index++] = MIN(uMax[1], ut[1] + tr.Uangle_eps);
+	}
+
+	const Matrix<B_DIM>& bT = B[T-1];
+
+	index = 0;
+	double finalPosDelta = .1;
+	double finalAngleDelta = M_PI/4;
+
+	// xGoal lower bound
+	for(int i = 0; i < P_DIM; ++i) { lb[T-1][index++] = xGoal[i] - finalPosDelta; }
+	// loose on car angles and landmarks
+	lb[T-1][index++] = nearestAngleFromTo(bT[2], xGoal[2] - finalAngleDelta);
+	for(int i = C_DIM; i < X_DIM; ++i) { lb[T-1][index++] = MAX(xMin[i], bT[i] - tr.Xpos_eps); }
+	// sigma lower bound
+	for(int i = 0; i < S_DIM; ++i) { lb[T-1][index] = bT[index] - tr.Beps; index++;}
+
+	index = 0;
+	// xGoal upper bound
+	for(int i = 0; i < P_DIM; ++i) { ub[T-1][index++] = xGoal[i] + finalPosDelta; }
+	// loose on car angles and landmarks
+	ub[T-1][index++] = nearestAngleFromTo(bT[2], xGoal[2] + finalAngleDelta);
+	for(int i = C_DIM; i < X_DIM; ++i) { ub[T-1][index++] = MIN(xMax[i], bT[i] + tr.Xpos_eps); }
+	// sigma upper bound
+	for(int i = 0; i < S_DIM; ++i) { ub[T-1][index] = bT[index] + tr.Beps; index++;}
+}
+
+// solve the QP currently set up in problem and read the solution into Bopt, Uopt
+double solveTrustRegionQP(beliefPenaltyMPC_params &problem, beliefPenaltyMPC_output &output, beliefPenaltyMPC_info &info,
+		std::vector< Matrix<B_DIM> >& Bopt, std::vector< Matrix<U_DIM> >& Uopt)
+{
+	int exitflag = beliefPenaltyMPC_solve(&problem, &output, &info);
+	if (exitflag != 1) {
+		LOG_ERROR("Some problem in solver");
+		throw forces_exception();
+	}
+
+	for(int t = 0; t < T-1; ++t) {
+		Matrix<B_DIM>& bt = Bopt[t];
+		Matrix<U_DIM>& ut = Uopt[t];
+
+		for(int i = 0; i < B_DIM; ++i) {
+			bt[i] = z[t][i];
+		}
+		for(int i = 0; i < U_DIM; ++i) {
+			ut[i] = z[t][B_DIM+i];
+		}
+	}
+	for(int i = 0; i < B_DIM; ++i) {
+		Bopt[T-1][i] = z[T-1][i];
+	}
+	return info.pobj;
+}
+
 bool minimizeMeritFunction(std::vector< Matrix<B_DIM> >& B, std::vector< Matrix<U_DIM> >& U, beliefPenaltyMPC_params &problem, beliefPenaltyMPC_output &output, beliefPenaltyMPC_info &info, double penalty_coeff)
 {
 	LOG_DEBUG("Solving sqp problem with penalty parameter: %2.4f", penalty_coeff);
 
-	//Matrix<B_DIM,1> b0 = B[0];
-
 	std::vector< Matrix<B_DIM,B_DIM> > F(T-1);
 	std::vector< Matrix<B_DIM,U_DIM> > G(T-1);
 	std::vector< Matrix<B_DIM> > h(T-1);
 
-	double Beps = cfg::initial_trust_box_size;
-	double Ueps = cfg::initial_trust_box_size;
+	TrustRegion tr;
 
-	double Xpos_eps = cfg::initial_Xpos_trust_box_size;
-	double Xangle_eps = cfg::initial_Xangle_trust_box_size;
-	double Uvel_eps = cfg::initial_Uvel_trust_box_size;
-	double Uangle_eps = cfg::initial_Uangle_trust_box_size;
+	// candidate k uses the trust region shrunk k times, so one round
+	// covers what would otherwise be k rejected steps in a row
+	const int num_candidates = std::max(1, cfg::num_parallel_trust_regions);
 
-	double optcost;
+	std::vector<TrustRegion> tr_candidates(num_candidates);
+	std::vector<std::vector<Matrix<B_DIM> > > Bopt(num_candidates, std::vector<Matrix<B_DIM> >(T));
+	std::vector<std::vector<Matrix<U_DIM> > > Uopt(num_candidates, std::vector<Matrix<U_DIM> >(T-1));
+	std::vector<double> model_merits(num_candidates);
+	std::vector<std::future<double> > new_merits(num_candidates);
 
-	std::vector<Matrix<B_DIM> > Bopt(T);
-	std::vector<Matrix<U_DIM> > Uopt(T-1);
+	// declared after Bopt, Uopt so it is joined before they go away
+	std::unique_ptr<util::ThreadPool> pool;
+	if (num_candidates > 1) {
+		pool.reset(new util::ThreadPool(num_candidates));
+	}
 
 	double merit, model_merit, new_merit;
 	double approx_merit_improve, exact_merit_improve, merit_improve_ratio;
@@ -365,10 +509,8 @@ bool minimizeMeritFunction(std::vector< Matrix<B_DIM> >& B, std::vector< Matrix<
 		minusIB(i,i) = -1;
 	}
 	
-	//Matrix<3*B_DIM+U_DIM, 3*B_DIM+U_DIM> HMat;
 	Matrix<B_DIM,3*B_DIM+U_DIM> CMat;
 	Matrix<B_DIM> eVec;
-	//Matrix<S_DIM,S_DIM> Hess;
 
 	// sqp loop
 	while(true)
@@ -418,182 +560,86 @@ bool minimizeMeritFunction(std::vector< Matrix<B_DIM> >& B, std::vector< Matrix<
 		
 
 		// trust region size adjustment
-		while(true)
+		bool accepted = false;
+		while(!accepted)
 		{
-			//std::cout << "PAUSED INSIDE MINIMIZEMERITFUNCTION" << std::endl;
-			//std::cin.ignore();
-
+			LOG_DEBUG("       trust region size: %2.6f %2.6f", tr.Beps, tr.Ueps);
 
-			LOG_DEBUG("       trust region size: %2.6f %2.6f", Beps, Ueps);
-
-			// solve the innermost QP here
-			for(int t = 0; t < T-1; ++t)
-			{
-				Matrix<B_DIM>& bt = B[t];
-				Matrix<U_DIM>& ut = U[t];
-
-				// Fill in lb, ub
-
-				index = 0;
-				// x lower bound
-				//for(int i = 0; i < X_DIM; ++i) { lb[t][index++] = MAX(xMin[i], bt[i] - Beps); }
-
-				// car pos lower bound
-				for(int i = 0; i < P_DIM; ++i) { lb[t][index++] = MAX(xMin[i], bt[i] - Xpos_eps); }
-				// car angle lower bound
-				lb[t][index++] = MAX(xMin[P_DIM], bt[P_DIM] - Xangle_eps);
-				// landmark pos lower bound
-				for(int i = C_DIM; i < X_DIM; ++i) { lb[t][index++] = MAX(xMin[i], bt[i] - Xpos_eps); }
-
-				// sigma lower bound
-				for(int i = 0; i < S_DIM; ++i) { lb[t][index] = bt[index] - Beps; index++; }
-
-				// u lower bound
-				//for(int i = 0; i < U_DIM; ++i) { lb[t][index++] = MAX(uMin[i], ut[i] - Ueps); }
-
-				// u velocity lower bound
-				lb[t][index++] = MAX(uMin[0], ut[0] - Uvel_eps);
-				// u angle lower bound
-				lb[t][index++] = MAX(uMin[1], ut[1] - Uangle_eps);
-
-				// for lower bound on L1 slacks
-				for(int i = 0; i < 2*B_DIM; ++i) { lb[t][index++] = 0; }
-
-				index = 0;
-				// x upper bound
-				//for(int i = 0; i < X_DIM; ++i) { ub[t][index++] = MIN(xMax[i], bt[i] + Beps); }
-
-				// car pos upper bound
-				for(int i = 0; i < P_DIM; ++i) { ub[t][index++] = MIN(xMax[i], bt[i] + Xpos_eps); }
-				// car angle upper bound
-				ub[t][index++] = MIN(xMax[P_DIM], bt[P_DIM] + Xangle_eps);
-				// landmark pos upper bound
-				for(int i = C_DIM; i < X_DIM; ++i) { ub[t][index++] = MIN(xMax[i], bt[i] + Xpos_eps); }
-
-				// sigma upper bound
-				for(int i = 0; i < S_DIM; ++i) { ub[t][index] = bt[index] + Beps; index++; }
-
-				// u upper bound
-				//for(int i = 0; i < U_DIM; ++i) { ub[t][index++] = MIN(uMax[i], ut[i] + Ueps); }
-
-				// u velocity upper bound
-				ub[t][index++] = MIN(uMax[0], ut[0] + Uvel_eps);
-				// u angle upper bound
-				ub[t][index++] = MIN(uMax[1], ut[1] + Uangle_eps);
+			tr_candidates[0] = tr;
+			for(int k = 1; k < num_candidates; ++k) {
+				tr_candidates[k] = tr_candidates[k-1];
+				tr_candidates[k].scale(cfg::trust_shrink_ratio);
 			}
 
-			Matrix<B_DIM>& bT = B[T-1];
-
-			// Fill in lb, ub, C, e
-			index = 0;
-			double finalPosDelta = .1;
-			double finalAngleDelta = M_PI/4;
-
-			// xGoal lower bound
-			for(int i = 0; i < P_DIM; ++i) { lb[T-1][index++] = xGoal[i] - finalPosDelta; }
-			// loose on car angles and landmarks
-			lb[T-1][index++] = nearestAngleFromTo(bT[2], xGoal[2] - finalAngleDelta);
-			//lb[T-1][index++] = xGoal[2] - finalAngleDelta;
-			for(int i = C_DIM; i < X_DIM; ++i) { lb[T-1][index++] = MAX(xMin[i], bT[i] - Xpos_eps); }
-			// sigma lower bound
-			for(int i = 0; i < S_DIM; ++i) { lb[T-1][index] = bT[index] - Beps; index++;}
-
-			index = 0;
-			// xGoal upper bound
-			for(int i = 0; i < P_DIM; ++i) { ub[T-1][index++] = xGoal[i] + finalPosDelta; }
-			// loose on car angles and landmarks
-			ub[T-1][index++] = nearestAngleFromTo(bT[2], xGoal[2] + finalAngleDelta);
-			//ub[T-1][index++] = xGoal[2] + finalAngleDelta;
-			for(int i = C_DIM; i < X_DIM; ++i) { ub[T-1][index++] = MIN(xMax[i], bT[i] + Xpos_eps); }
-			// sigma upper bound
-			for(int i = 0; i < S_DIM; ++i) { ub[T-1][index] = bT[index] + Beps; index++;}
-
-			// Verify problem inputs
-			//if (!isValidInputs()) {
-			//	std::cout << "Inputs are not valid!" << std::endl;
-			//	exit(-1);
-			//}
-
-
-			int exitflag = beliefPenaltyMPC_solve(&problem, &output, &info);
-			if (exitflag == 1) {
-				for(int t = 0; t < T-1; ++t) {
-					Matrix<B_DIM>& bt = Bopt[t];
-					Matrix<U_DIM>& ut = Uopt[t];
-
-					for(int i = 0; i < B_DIM; ++i) {
-						bt[i] = z[t][i];
-					}
-					for(int i = 0; i < U_DIM; ++i) {
-						ut[i] = z[t][B_DIM+i];
-					}
-					optcost = info.pobj;
-				}
-				for(int i = 0; i < B_DIM; ++i) {
-					Bopt[T-1][i] = z[T-1][i];
+			// FORCES keeps its workspace in globals, so the QPs are solved one after another
+			// while the merit rollouts of the already solved candidates run on the pool
+			for(int k = 0; k < num_candidates; ++k) {
+				fillTrustRegionBounds(B, U, tr_candidates[k]);
+				model_merits[k] = solveTrustRegionQP(problem, output, info, Bopt[k], Uopt[k]);
+
+				if (pool) {
+					new_merits[k] = pool->enqueue([&, k] { return computeMerit(Bopt[k], Uopt[k], penalty_coeff); });
+				} else {
+					std::promise<double> p;
+					p.set_value(computeMerit(Bopt[k], Uopt[k], penalty_coeff));
+					new_merits[k] = p.get_future();
 				}
 			}
-			else {
-				LOG_ERROR("Some problem in solver");
-				throw forces_exception();
-			}
-
-			LOG_DEBUG("Optimized cost: %4.10f", optcost);
 
-			model_merit = optcost;
-			new_merit = computeMerit(Bopt, Uopt, penalty_coeff);
-
-			LOG_DEBUG("merit: %4.10f", merit);
-			LOG_DEBUG("model_merit: %4.10f", model_merit);
-			LOG_DEBUG("new_merit: %4.10f", new_merit);
-			
-			approx_merit_improve = merit - model_merit;
-			exact_merit_improve = merit - new_merit;
-			merit_improve_ratio = exact_merit_improve / approx_merit_improve;
-
-			LOG_DEBUG("approx_merit_improve: %1.6f", approx_merit_improve);
-			LOG_DEBUG("exact_merit_improve: %1.6f", exact_merit_improve);
-			LOG_DEBUG("merit_improve_ratio: %1.6f", merit_improve_ratio);
-			
-			//std::cout << "PAUSED INSIDE minimizeMeritFunction" << std::endl;
-			//int num;
-			//std::cin >> num;
-
-			if (approx_merit_improve < -1e-5) {
-				LOG_ERROR("Approximate merit function got worse: %1.6f", approx_merit_improve);
-				//LOG_ERROR("Either convexification is wrong to zeroth order, or you are in numerical trouble");
-				//LOG_ERROR("Failure!");
-
-				return false;
-			} else if (approx_merit_improve < cfg::min_approx_improve) {
-				LOG_DEBUG("Converged: improvement small enough");
-				B = Bopt; U = Uopt;
-				return true;
-			} else if ((exact_merit_improve < 0) || (merit_improve_ratio < cfg::improve_ratio_threshold)) {
-				Beps *= cfg::trust_shrink_ratio;
-				Ueps *= cfg::trust_shrink_ratio;
-				Xpos_eps *= cfg::trust_shrink_ratio;
-				Xangle_eps *= cfg::trust_shrink_ratio;
-				Uvel_eps *= cfg::trust_shrink_ratio;
-				Uangle_eps *= cfg::trust_shrink_ratio;
-				LOG_DEBUG("Shrinking trust region size to: %2.6f %2.6f %2.6f %2.6f", Xpos_eps, Xangle_eps, Uvel_eps, Uangle_eps);
-			} else {
-				Beps *= cfg::trust_expand_ratio;
-				Ueps *= cfg::trust_expand_ratio;
-				Xpos_eps *= cfg::trust_expand_ratio;
-				Xangle_eps *= cfg::trust_expand_ratio;
-				Uvel_eps *= cfg::trust_expand_ratio;
-				Uangle_eps *= cfg::trust_expand_ratio;
-				B = Bopt; U = Uopt;
-				LOG_DEBUG("Accepted, Increasing trust region size to:  %2.6f %2.6f", Beps, Ueps);
-				break;
-			}
+			// go through the candidates from the largest trust region down, the first one
+			// accepted is the step the serial shrinking loop would have taken
+			for(int k = 0; k < num_candidates; ++k) {
+				model_merit = model_merits[k];
+				new_merit = new_merits[k].get();
+
+				LOG_DEBUG("Optimized cost: %4.10f", model_merit);
+				LOG_DEBUG("merit: %4.10f", merit);
+				LOG_DEBUG("model_merit: %4.10f", model_merit);
+				LOG_DEBUG("new_merit: %4.10f", new_merit);
+
+				approx_merit_improve = merit - model_merit;
+				exact_merit_improve = merit - new_merit;
+				merit_improve_ratio = exact_merit_improve / approx_merit_improve;
+
+				LOG_DEBUG("approx_merit_improve: %1.6f", approx_merit_improve);
+				LOG_DEBUG("exact_merit_improve: %1.6f", exact_merit_improve);
+				LOG_DEBUG("merit_improve_ratio: %1.6f", merit_improve_ratio);
+
+				if (approx_merit_improve < -1e-5) {
+					LOG_ERROR("Approximate merit function got worse: %1.6f", approx_merit_improve);
+					//LOG_ERROR("Either convexification is wrong to zeroth order, or you are in numerical trouble");
+					//LOG_ERROR("Failure!");
+					success = false;
+				} else if (approx_merit_improve < cfg::min_approx_improve) {
+					LOG_DEBUG("Converged: improvement small enough");
+					B = Bopt[k]; U = Uopt[k];
+					success = true;
+				} else if ((exact_merit_improve < 0) || (merit_improve_ratio < cfg::improve_ratio_threshold)) {
+					tr = tr_candidates[k];
+					tr.scale(cfg::trust_shrink_ratio);
+					LOG_DEBUG("Shrinking trust region size to: %2.6f %2.6f %2.6f %2.6f", tr.Xpos_eps, tr.Xangle_eps, tr.Uvel_eps, tr.Uangle_eps);
+
+					if (tr.below_min()) {
+						LOG_DEBUG("Converged: x tolerance");
+						success = true;
+					} else {
+						continue;
+					}
+				} else {
+					tr = tr_candidates[k];
+					tr.scale(cfg::trust_expand_ratio);
+					B = Bopt[k]; U = Uopt[k];
+					LOG_DEBUG("Accepted, Increasing trust region size to:  %2.6f %2.6f", tr.Beps, tr.Ueps);
+					accepted = true;
+				}
 
-			if (Beps < cfg::min_trust_box_size && Ueps < cfg::min_trust_box_size &&
-					Xpos_eps < cfg::min_trust_box_size && Xangle_eps < cfg::min_trust_box_size &&
-					Uvel_eps < cfg::min_trust_box_size && Uangle_eps < cfg::min_trust_box_size) {
-			    LOG_DEBUG("Converged: x tolerance");
-			    return true;
+				// the rollouts still in flight reference Bopt, Uopt, which the next round
+				// of QPs overwrites, so wait for them before leaving this round
+				for(int j = k+1; j < num_candidates; ++j) { new_merits[j].wait(); }
+				if (accepted) {
+					break;
+				}
+				return success;
 			}
 
 		} // trust region loop
@@ -638,6 +684,31 @@ double beliefPenaltyCollocation(std::vector< Matrix<B_DIM> >& B, std::vector< Ma
 	return computeCost(B, U);
 }
 
+// solve a coarse problem with controls held over factor timesteps and
+// interpolate it to warm start U, B is rolled out along the result
+double coarseToFineInit(std::vector< Matrix<B_DIM> >& B, std::vector< Matrix<U_DIM> >& U, int factor)
+{
+	// stands in for the final car position constraint
+	auto goalPenalty = [](const Matrix<B_DIM>& bT) -> double {
+		Matrix<P_DIM> posErr = bT.subMatrix<P_DIM,1>(0,0) - xGoal.subMatrix<P_DIM,1>(0,0);
+		return cfg::coarse_goal_penalty*tr(~posErr*posErr);
+	};
+	return util::coarse_to_fine_init(beliefDynamics, computeCost, goalPenalty, uMin, uMax, factor, B, U);
+}
+
+void benchmarkContinuation(const std::vector< Matrix<B_DIM> >& Binit, const std::vector< Matrix<U_DIM> >& Uinit, beliefPenaltyMPC_params& problem, beliefPenaltyMPC_output& output, beliefPenaltyMPC_info& info)
+{
+	auto solve = [&](std::vector< Matrix<B_DIM> >& B, std::vector< Matrix<U_DIM> >& U) -> double {
+		try {
+			return beliefPenaltyCollocation(B, U, problem, output, info);
+		}
+		catch (forces_exception &e) {
+			return INFINITY;
+		}
+	};
+	util::benchmark_continuation(coarseToFineInit, solve, std::vector<int>({1, 2, 3, 5}), cfg::continuation_benchmark_runs, Binit, Uinit);
+}
+
 void planPath(std::vector<Matrix<P_DIM> > l, beliefPenaltyMPC_params& problem, beliefPenaltyMPC_output& output, beliefPenaltyMPC_info& info, std::ofstream& f) {
 	initProblemParams(l);
 
@@ -693,8 +764,16 @@ void planPath(std::vector<Matrix<P_DIM> > l, beliefPenaltyMPC_params& problem, b
 		//double initTrajCost = computeCost(B, U);
 		//LOG_INFO("Initial trajectory cost: %4.10f", initTrajCost);
 
+#ifdef CONTINUATION_BENCHMARK
+		benchmarkContinuation(B, U, problem, output, info);
+#endif
+
 		Timer_tic(&solveTimer);
 
+		if (cfg::coarse_to_fine_factor > 1) {
+			coarseToFineInit(B, U, cfg::coarse_to_fine_factor);
+		}
+
 		double cost = 0;
 		int iter = 0;
 		while(true) {
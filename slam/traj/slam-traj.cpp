@@ -7,6 +7,9 @@
 #include "util/matrix.h"
 #include "util/Timer.h"
 #include "util/logging.h"
+#include "util/multistart.h"
+
+#include <mutex>
 
 extern "C" {
 #include "trajMPC.h"
@@ -15,6 +18,10 @@ trajMPC_FLOAT **f_traj, **lb_traj, **ub_traj, **C_traj, **e_traj, **z_traj;
 
 #include "boost/preprocessor.hpp"
 
+// FORCES keeps its workspace in globals, so concurrent collocations
+// must fill the problem and solve while holding this
+std::mutex forces_mutex;
+
 Matrix<C_DIM> c0;
 Matrix<C_DIM> cGoal;
 
@@ -45,6 +52,9 @@ const double initial_Uangle_trust_box_size = M_PI/8; // M_PI/8;
 
 const int max_penalty_coeff_increases = 2; // 2
 const int max_sqp_iterations = 50; // 50
+
+const int num_starts = 4; // one per initial speed scaling, 1 tries the scalings in turn
+const double multistart_cancel_margin = .25; // relative merit gap before a start is cancelled
 }
 
 struct exit_exception {
@@ -338,7 +348,8 @@ bool isValidTrajInputs()
 
 
 
-bool minimizeMeritFunction(std::vector< Matrix<C_DIM> >& X, std::vector< Matrix<U_DIM> >& U, trajMPC_params &problem, trajMPC_output &output, trajMPC_info &info, double penalty_coeff)
+bool minimizeMeritFunction(std::vector< Matrix<C_DIM> >& X, std::vector< Matrix<U_DIM> >& U, trajMPC_params &problem, trajMPC_output &output, trajMPC_info &info, double penalty_coeff,
+		util::MultiStartContext* ctx=NULL, int stage=0)
 {
 	LOG_DEBUG("Solving sqp problem with penalty parameter: %2.4f", penalty_coeff);
 
@@ -382,44 +393,11 @@ bool minimizeMeritFunction(std::vector< Matrix<C_DIM> >& X, std::vector< Matrix<
 		
 		LOG_DEBUG("  merit: %4.10f", merit);
 
-		// Problem linearization and definition
-		// fill in f_traj, C_traj, e_traj
-		
+		// Problem linearization, the QP itself is filled in below while holding forces_mutex
 		for (int t = 0; t < T_TRAJ_MPC-1; ++t)
 		{
-			Matrix<C_DIM>& xt = X[t];
-			Matrix<U_DIM>& ut = U[t];
-
-			linearizeCarDynamicsTraj(xt, ut, F[t], G[t], h[t]);
-
-			// initialize f_traj in cost function to penalize
-			// belief dynamics slack variables
-			index = 0;
-			for(int i = 0; i < (C_DIM+U_DIM); ++i) { f_traj[t][index++] = 0; }
-			for(int i = 0; i < 2*C_DIM; ++i) { f_traj[t][index++] = penalty_coeff; }
-
-			CMat.reset();
-			eVec.reset();
-
-			CMat.insert<C_DIM,C_DIM>(0,0,F[t]);
-			CMat.insert<C_DIM,U_DIM>(0,C_DIM,G[t]);
-			CMat.insert<C_DIM,C_DIM>(0,C_DIM+U_DIM,IB);
-			CMat.insert<C_DIM,C_DIM>(0,2*C_DIM+U_DIM,minusIB);
-
-			fillColMajor(C_traj[t], CMat);
-
-			if (t == 0) {
-				eVec.insert<C_DIM,1>(0,0,X[0]);
-				fillCol(e_traj[0], eVec);
-			} 
-			
-			eVec = -h[t] + F[t]*xt + G[t]*ut;
-			fillCol(e_traj[t+1], eVec);
-
+			linearizeCarDynamicsTraj(X[t], U[t], F[t], G[t], h[t]);
 		}
-		
-		for(int i=0; i < P_DIM; ++i) { f_traj[T_TRAJ_MPC-1][i] = -2*alpha_goal*cGoal[i]; }
-		f_traj[T_TRAJ_MPC-1][2] = 0;
 
 
 		//std::cout << "PAUSED INSIDE MINIMIZEMERITFUNCTION" << std::endl;
@@ -434,6 +412,41 @@ bool minimizeMeritFunction(std::vector< Matrix<C_DIM> >& X, std::vector< Matrix<
 
 			util::Timer fillVarsTimer;
 			util::Timer_tic(&fillVarsTimer);
+
+			// everything from filling in the problem to reading the solution touches FORCES globals
+			std::unique_lock<std::mutex> forces_lock(forces_mutex);
+
+			// fill in f_traj, C_traj, e_traj
+			for (int t = 0; t < T_TRAJ_MPC-1; ++t)
+			{
+				// initialize f_traj in cost function to penalize
+				// belief dynamics slack variables
+				index = 0;
+				for(int i = 0; i < (C_DIM+U_DIM); ++i) { f_traj[t][index++] = 0; }
+				for(int i = 0; i < 2*C_DIM; ++i) { f_traj[t][index++] = penalty_coeff; }
+
+				CMat.reset();
+				eVec.reset();
+
+				CMat.insert<C_DIM,C_DIM>(0,0,F[t]);
+				CMat.insert<C_DIM,U_DIM>(0,C_DIM,G[t]);
+				CMat.insert<C_DIM,C_DIM>(0,C_DIM+U_DIM,IB);
+				CMat.insert<C_DIM,C_DIM>(0,2*C_DIM+U_DIM,minusIB);
+
+				fillColMajor(C_traj[t], CMat);
+
+				if (t == 0) {
+					eVec.insert<C_DIM,1>(0,0,X[0]);
+					fillCol(e_traj[0], eVec);
+				}
+
+				eVec = -h[t] + F[t]*X[t] + G[t]*U[t];
+				fillCol(e_traj[t+1], eVec);
+			}
+
+			for(int i=0; i < P_DIM; ++i) { f_traj[T_TRAJ_MPC-1][i] = -2*alpha_goal*cGoal[i]; }
+			f_traj[T_TRAJ_MPC-1][2] = 0;
+
 			// solve the innermost QP here
 			for(int t = 0; t < T_TRAJ_MPC-1; ++t)
 			{
@@ -542,6 +555,7 @@ bool minimizeMeritFunction(std::vector< Matrix<C_DIM> >& X, std::vector< Matrix<
 				LOG_ERROR("Some problem in traj solver, retrying");
 				throw exit_exception(-1);
 			}
+			forces_lock.unlock();
 
 
 
@@ -606,6 +620,10 @@ bool minimizeMeritFunction(std::vector< Matrix<C_DIM> >& X, std::vector< Matrix<
 				Uangle_eps *= cfg::trust_expand_ratio;
 				X = Xopt; U = Uopt;
 				LOG_DEBUG("Accepted, Increasing trust region size to:  %2.6f %2.6f %2.6f %2.6f", Xpos_eps, Xangle_eps, Uvel_eps, Uangle_eps);
+
+				if ((ctx != NULL) && !ctx->report(new_merit, stage)) {
+					return false;
+				}
 				break;
 			}
 
@@ -622,7 +640,8 @@ bool minimizeMeritFunction(std::vector< Matrix<C_DIM> >& X, std::vector< Matrix<
 	return success;
 }
 
-double trajCollocation(std::vector< Matrix<C_DIM> >& X, std::vector< Matrix<U_DIM> >& U, trajMPC_params &problem, trajMPC_output &output, trajMPC_info &info)
+double trajCollocation(std::vector< Matrix<C_DIM> >& X, std::vector< Matrix<U_DIM> >& U, trajMPC_params &problem, trajMPC_output &output, trajMPC_info &info,
+		util::MultiStartContext* ctx=NULL)
 {
 	double penalty_coeff = cfg::initial_penalty_coeff;
 	//double trust_box_size = cfg::initial_trust_box_size;
@@ -634,7 +653,10 @@ double trajCollocation(std::vector< Matrix<C_DIM> >& X, std::vector< Matrix<U_DI
 	// penalty loop
 	while(penalty_increases < cfg::max_penalty_coeff_increases)
 	{
-		bool success = minimizeMeritFunction(X, U, problem, output, info, penalty_coeff);
+		bool success = minimizeMeritFunction(X, U, problem, output, info, penalty_coeff, ctx, penalty_increases);
+		if ((ctx != NULL) && ctx->is_cancelled()) {
+			return INFINITY;
+		}
 
 		double cntviol = 0;
 		for(int t = 0; t < T_TRAJ_MPC-1; ++t) {
@@ -658,6 +680,56 @@ double trajCollocation(std::vector< Matrix<C_DIM> >& X, std::vector< Matrix<U_DI
 }
 
 
+struct SlamTrajectory {
+	std::vector<Matrix<C_DIM> > X;
+	std::vector<Matrix<U_DIM> > U;
+};
+
+// constant control u and the states it reaches from c0
+void initTrajGuess(const Matrix<U_DIM>& u, std::vector<Matrix<C_DIM> >& X, std::vector<Matrix<U_DIM> >& U)
+{
+	for(int i=0; i < T_TRAJ_MPC-1; ++i) { U[i] = u; }
+
+	X[0].insert(0,0,c0);
+	for(int t=0; t < T_TRAJ_MPC-1; ++t) {
+		X[t+1] = dynfunccar(X[t],U[t]);
+	}
+}
+
+/**
+ * Runs one collocation per initial speed scaling in parallel, the first from (X,U),
+ * and keeps the cheapest trajectory instead of the first one that succeeds.
+ * Returns false if every collocation failed.
+ */
+bool multistartTrajCollocation(const Matrix<U_DIM>& uinit, const double* scaling, int num_scalings,
+		std::vector< Matrix<C_DIM> >& X, std::vector< Matrix<U_DIM> >& U,
+		trajMPC_params &problem, trajMPC_output &output, trajMPC_info &info)
+{
+	int num_starts = std::min(cfg::num_starts, num_scalings);
+	util::MultiStart<SlamTrajectory> multistart(util::MultiStartConfig(num_starts, 0, cfg::multistart_cancel_margin));
+
+	SlamTrajectory best;
+	best.X = X; best.U = U;
+
+	double cost = multistart.run(
+			[&](const util::MultiStartContext& ctx, SlamTrajectory& traj) {
+				if (ctx.start > 0) {
+					initTrajGuess(uinit*scaling[ctx.start], traj.X, traj.U);
+				}
+			},
+			[&](util::MultiStartContext& ctx, SlamTrajectory& traj) -> double {
+				try {
+					double traj_cost = trajCollocation(traj.X, traj.U, problem, output, info, &ctx);
+					return ctx.is_cancelled() ? INFINITY : traj_cost;
+				} catch(exit_exception& e) {
+					return INFINITY;
+				}
+			}, best);
+
+	X = best.X; U = best.U;
+	return std::isfinite(cost);
+}
+
 bool initTraj(const Matrix<C_DIM>& cStart, const Matrix<C_DIM>& cEnd, std::vector<Matrix<U_DIM> >& U, int timesteps) {
 	T_TRAJ_MPC = timesteps;
 
@@ -689,36 +761,45 @@ bool initTraj(const Matrix<C_DIM>& cStart, const Matrix<C_DIM>& cEnd, std::vecto
 	util::Timer_tic(&solveTimer);
 
 	std::vector<Matrix<C_DIM> > X(T_TRAJ_MPC);
-	for(int scalingIndex=0; scalingIndex < 4; scalingIndex++) {
+	if (cfg::num_starts > 1) {
+		initTrajGuess(uinit*scaling[0], X, U);
 
-		//std::cout << "scaling factor: " << scaling[scalingIndex] << std::endl;
+		initTrajCost = computeTrajCost(X, U);
+		LOG_DEBUG("Initial trajectory cost: %4.10f", initTrajCost);
 
-		for(int i=0; i < T_TRAJ_MPC-1; ++i) { U[i] = uinit*scaling[scalingIndex]; }
+		success = multistartTrajCollocation(uinit, scaling, 4, X, U, problem, output, info);
+	} else {
+		for(int scalingIndex=0; scalingIndex < 4; scalingIndex++) {
 
-		//pythonDisplayTrajectory(U, T, true);
+			//std::cout << "scaling factor: " << scaling[scalingIndex] << std::endl;
 
-		//std::cout << "X initial" << std::endl;
-		X[0].insert(0,0,c0);
-		for(int t=0; t < timesteps-1; ++t) {
-			//std::cout << ~X[t];
-			X[t+1] = dynfunccar(X[t],U[t]);
-		}
-		//std::cout << ~X[T-1];
+			for(int i=0; i < T_TRAJ_MPC-1; ++i) { U[i] = uinit*scaling[scalingIndex]; }
 
-		initTrajCost = computeTrajCost(X, U);
-		LOG_DEBUG("Initial trajectory cost: %4.10f", initTrajCost);
+			//pythonDisplayTrajectory(U, T, true);
 
-		try {
-			trajCollocation(X, U, problem, output, info);
-			success = true;
-		} catch(exit_exception& e) {
-			success = false;
-		}
+			//std::cout << "X initial" << std::endl;
+			X[0].insert(0,0,c0);
+			for(int t=0; t < timesteps-1; ++t) {
+				//std::cout << ~X[t];
+				X[t+1] = dynfunccar(X[t],U[t]);
+			}
+			//std::cout << ~X[T-1];
 
-		if (success) {
-			break;
-		}
+			initTrajCost = computeTrajCost(X, U);
+			LOG_DEBUG("Initial trajectory cost: %4.10f", initTrajCost);
+
+			try {
+				trajCollocation(X, U, problem, output, info);
+				success = true;
+			} catch(exit_exception& e) {
+				success = false;
+			}
 
+			if (success) {
+				break;
+			}
+
+		}
 	}
 
 	double solvetime = util::Timer_toc(&solveTimer);
@@ -0,0 +1,98 @@
+#include "particles.h"
+#include "random.h"
+#include "Timer.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+
+#define DIM 3
+#define RUNS 200
+
+// sigmoid slope of PR2EihSystem::update_particle_weights
+#define ALPHA 1e3
+
+// signed distance to a sphere of radius .1 around the origin, stand-in for the camera frustum
+inline double signed_distance(const double* x) {
+	return sqrt(x[0]*x[0] + x[1]*x[1] + x[2]*x[2]) - .1;
+}
+
+// AoS double precision loop, as in update_particle_weights and PR2EihSystem::entropy
+double reference_update(const std::vector<double>& P, std::vector<double>& W) {
+	int M = W.size();
+	double total = 0;
+	for(int m=0; m < M; ++m) {
+		double sd = signed_distance(&P[m*DIM]);
+		W[m] *= 1.0/(1.0 + exp(-ALPHA*sd));
+		total += W[m];
+	}
+	double entropy = 0;
+	for(int m=0; m < M; ++m) {
+		W[m] /= total;
+		if (W[m] > 1e-8) {
+			entropy += -W[m]*log(W[m]);
+		}
+	}
+	return entropy;
+}
+
+double soa_update(util::ParticleSet& particles) {
+	int M = particles.size();
+	const float *x = particles.coord(0), *y = particles.coord(1), *z = particles.coord(2);
+	float* sd = particles.scratch();
+	for(int m=0; m < M; ++m) {
+		sd[m] = sqrtf(x[m]*x[m] + y[m]*y[m] + z[m]*z[m]) - .1f;
+	}
+	particles.multiply_sigmoid(sd, ALPHA);
+	particles.normalize();
+	return particles.entropy();
+}
+
+int main(int argc, char* argv[]) {
+	util::Random random(0);
+	util::Timer timer;
+
+	std::cout << std::setw(8) << "M" << std::setw(16) << "reference (s)" << std::setw(14) << "soa (s)"
+			<< std::setw(12) << "speedup" << std::setw(16) << "entropy err" << std::setw(16) << "max weight err" << "\n";
+
+	int Ms[] = {1000, 10000, 100000};
+	for(int i=0; i < sizeof(Ms)/sizeof(Ms[0]); ++i) {
+		int M = Ms[i];
+		std::vector<double> P(DIM*M);
+		random.normal(&P[0], DIM*M);
+		for(int j=0; j < DIM*M; ++j) { P[j] *= .1; }
+
+		std::vector<double> W;
+		double reference_entropy = 0;
+		util::Timer_tic(&timer);
+		for(int run=0; run < RUNS; ++run) {
+			W.assign(M, 1.0/M);
+			reference_entropy = reference_update(P, W);
+		}
+		double reference_time = util::Timer_toc(&timer) / RUNS;
+
+		util::ParticleSet particles(DIM, M);
+		particles.set_particles(&P[0]);
+		double soa_entropy = 0;
+		util::Timer_tic(&timer);
+		for(int run=0; run < RUNS; ++run) {
+			particles.set_uniform_weights();
+			soa_entropy = soa_update(particles);
+		}
+		double soa_time = util::Timer_toc(&timer) / RUNS;
+
+		double max_err = 0;
+		for(int m=0; m < M; ++m) {
+			if (W[m] > 1e-8) {
+				max_err = std::max(max_err, fabs(particles.weights()[m] - W[m]) / W[m]);
+			}
+		}
+
+		std::cout << std::setw(8) << M << std::setw(16) << reference_time << std::setw(14) << soa_time
+				<< std::setw(12) << reference_time / soa_time << std::setw(16) << fabs(soa_entropy - reference_entropy)
+				<< std::setw(16) << max_err << "\n";
+	}
+
+	return 0;
+}
@@ -0,0 +1,131 @@
+#include "pose-cache.h"
+#include "random.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+
+/**
+ * Replays the camera poses that the eye-in-hand cost functions look up during one SQP
+ * iteration and counts PoseCache hits. Whether a lookup hits depends only on the
+ * sequence of poses, so a stand-in forward kinematics (a 7 joint chain) gives the same
+ * counts as the robot as long as distinct joints give distinct poses.
+ */
+
+#define J_DIM 7
+#define TIMESTEPS 5
+#define DT 1.0
+
+// SQP iterations replayed, each at a new trajectory
+#define ITERATIONS 10
+
+const double step = 0.0078125*0.0078125;
+
+typedef std::vector<std::vector<double> > Trajectory;
+
+// row-major 3x4 pose of a chain alternating z and y rotations with .1 m links
+void forward_kinematics(const std::vector<double>& j, double pose[12]) {
+	double R[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1}, p[3] = {0, 0, 0};
+	for(int i=0; i < J_DIM; ++i) {
+		double c = cos(j[i]), s = sin(j[i]), A[9];
+		if (i % 2 == 0) {
+			double Rz[9] = {c, -s, 0, s, c, 0, 0, 0, 1};
+			std::copy(Rz, Rz + 9, A);
+		} else {
+			double Ry[9] = {c, 0, s, 0, 1, 0, -s, 0, c};
+			std::copy(Ry, Ry + 9, A);
+		}
+		double RA[9];
+		for(int r=0; r < 3; ++r) {
+			for(int k=0; k < 3; ++k) {
+				RA[3*r+k] = R[3*r]*A[k] + R[3*r+1]*A[3+k] + R[3*r+2]*A[6+k];
+			}
+		}
+		std::copy(RA, RA + 9, R);
+		for(int r=0; r < 3; ++r) { p[r] += .1*R[3*r+2]; }
+	}
+	for(int r=0; r < 3; ++r) {
+		for(int k=0; k < 3; ++k) { pose[4*r+k] = R[3*r+k]; }
+		pose[4*r+3] = p[r];
+	}
+}
+
+std::vector<double> dynfunc(const std::vector<double>& j, const std::vector<double>& u) {
+	std::vector<double> j_tp1(J_DIM);
+	for(int i=0; i < J_DIM; ++i) { j_tp1[i] = j[i] + DT*u[i]; }
+	return j_tp1;
+}
+
+// one lookup per timestep per gaussian, counting the misses as renders or truncations
+void cost(const Trajectory& J, const Trajectory& U, int num_gaussians, util::PoseCache<int>& cache) {
+	for(int m=0; m < num_gaussians; ++m) {
+		for(int t=0; t < TIMESTEPS-1; ++t) {
+			double pose[12];
+			forward_kinematics(dynfunc(J[t], U[t]), pose);
+			if (cache.find(pose) == NULL) {
+				cache.insert(pose, 0);
+			}
+		}
+	}
+}
+
+// central differences over every state and control, as System::cost_grad and PR2EihSystem::cost_grad
+void cost_grad(Trajectory& J, Trajectory& U, int num_gaussians, util::PoseCache<int>& cache) {
+	for(int t=0; t < TIMESTEPS; ++t) {
+		for(int i=0; i < J_DIM; ++i) {
+			double orig = J[t][i];
+			J[t][i] = orig + step; cost(J, U, num_gaussians, cache);
+			J[t][i] = orig - step; cost(J, U, num_gaussians, cache);
+			J[t][i] = orig;
+		}
+		if (t < TIMESTEPS-1) {
+			for(int i=0; i < J_DIM; ++i) {
+				double orig = U[t][i];
+				U[t][i] = orig + step; cost(J, U, num_gaussians, cache);
+				U[t][i] = orig - step; cost(J, U, num_gaussians, cache);
+				U[t][i] = orig;
+			}
+		}
+	}
+}
+
+// PR2EihSystem::cost_and_grad truncates once per timestep and differences relative pyramids
+void cost_and_grad(const Trajectory& J, const Trajectory& U, util::PoseCache<int>& cache) {
+	cost(J, U, 1, cache);
+}
+
+void report(const char* name, int num_gaussians, const util::PoseCache<int>& cache) {
+	int lookups = cache.hits() + cache.misses();
+	std::cout << std::setw(36) << name << std::setw(10) << num_gaussians << std::setw(10) << lookups/ITERATIONS
+			<< std::setw(10) << cache.misses()/ITERATIONS << std::setw(12) << std::fixed << std::setprecision(1)
+			<< 100.0*cache.hits()/lookups << "\n";
+}
+
+int main(int argc, char* argv[]) {
+	util::Random random(0);
+	std::cout << std::setw(36) << "per SQP iteration" << std::setw(10) << "gaussians" << std::setw(10) << "lookups"
+			<< std::setw(10) << "misses" << std::setw(12) << "hit rate %" << "\n";
+
+	for(int num_gaussians=1; num_gaussians <= 3; num_gaussians += 2) {
+		// eih: merit at the QP solution, then the finite difference gradient once accepted
+		// pr2_eih without USE_COST_AND_GRAD: the same, with a lookup per gaussian
+		// pr2_eih with USE_COST_AND_GRAD: merit at the QP solution, then cost_and_grad there
+		util::PoseCache<int> fd_cache, cag_cache;
+		Trajectory J(TIMESTEPS, std::vector<double>(J_DIM)), U(TIMESTEPS-1, std::vector<double>(J_DIM));
+		for(int it=0; it < ITERATIONS; ++it) {
+			for(int t=0; t < TIMESTEPS; ++t) { random.uniform(&J[t][0], J_DIM); }
+			for(int t=0; t < TIMESTEPS-1; ++t) { random.uniform(&U[t][0], J_DIM); }
+
+			cost(J, U, num_gaussians, fd_cache);
+			cost_grad(J, U, num_gaussians, fd_cache);
+
+			cost(J, U, num_gaussians, cag_cache);
+			cost_and_grad(J, U, cag_cache);
+		}
+		report("cost + cost_grad", num_gaussians, fd_cache);
+		report("cost + cost_and_grad", num_gaussians, cag_cache);
+	}
+
+	return 0;
+}
@@ -0,0 +1,104 @@
+#include "random.h"
+#include "threadpool.h"
+#include "Timer.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <cstdlib>
+
+// samples per measurement
+#define N (1 << 22)
+
+void report(const char* name, double time) {
+	std::cout << std::setw(24) << name << std::setw(14) << time
+			<< std::setw(16) << (N / time) * 1e-6 << "\n";
+}
+
+int main(int argc, char* argv[]) {
+	std::vector<double> x(N);
+	double checksum = 0;
+	util::Timer timer;
+
+	std::cout << std::setw(24) << "generator" << std::setw(14) << "time (s)" << std::setw(16) << "Msamples/s" << "\n";
+
+	// uniforms
+	srand(0);
+	util::Timer_tic(&timer);
+	for(int i=0; i < N; ++i) {
+		x[i] = rand() / double(RAND_MAX);
+	}
+	report("rand", util::Timer_toc(&timer));
+	checksum += x[N-1];
+
+	std::mt19937 mt(0);
+	std::uniform_real_distribution<double> uniform;
+	util::Timer_tic(&timer);
+	for(int i=0; i < N; ++i) {
+		x[i] = uniform(mt);
+	}
+	report("mt19937 uniform", util::Timer_toc(&timer));
+	checksum += x[N-1];
+
+	util::Random random(0);
+	util::Timer_tic(&timer);
+	for(int i=0; i < N; ++i) {
+		x[i] = random.uniform();
+	}
+	report("philox uniform", util::Timer_toc(&timer));
+	checksum += x[N-1];
+
+	util::Timer_tic(&timer);
+	random.uniform(&x[0], N);
+	report("philox batch uniform", util::Timer_toc(&timer));
+	checksum += x[N-1];
+
+	// normals
+	std::normal_distribution<double> normal;
+	util::Timer_tic(&timer);
+	for(int i=0; i < N; ++i) {
+		x[i] = normal(mt);
+	}
+	report("mt19937 normal", util::Timer_toc(&timer));
+	checksum += x[N-1];
+
+	util::Timer_tic(&timer);
+	for(int i=0; i < N; ++i) {
+		x[i] = random.normal();
+	}
+	report("philox normal", util::Timer_toc(&timer));
+	checksum += x[N-1];
+
+	util::Timer_tic(&timer);
+	random.normal(&x[0], N);
+	report("philox batch normal", util::Timer_toc(&timer));
+	checksum += x[N-1];
+
+	// 3d gaussians, N/3 samples
+	double mean[3] = {1, 2, 3};
+	double L[9] = {1, 0, 0,
+			.5, 1, 0,
+			.2, .3, 1};
+	util::Timer_tic(&timer);
+	for(int i=0; i+3 <= N; i += 3) {
+		random.gaussian(3, mean, L, &x[i]);
+	}
+	report("philox gaussian 3d", util::Timer_toc(&timer));
+	checksum += x[0];
+
+	// batch normals split over the pool, one stream per chunk
+	util::ThreadPool pool;
+	const int chunks = 64;
+	util::Timer_tic(&timer);
+	pool.parallel_for(0, chunks, [&](int c) {
+		util::Random chunk_random(0, 0, c);
+		chunk_random.normal(&x[c*(N/chunks)], N/chunks);
+	});
+	report("philox parallel normal", util::Timer_toc(&timer));
+	checksum += x[N-1];
+
+	std::cout << "threads: " << pool.size() << ", checksum: " << checksum << "\n";
+
+	return 0;
+}
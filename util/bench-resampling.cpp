@@ -0,0 +1,75 @@
+#include "resampling.h"
+#include "threadpool.h"
+#include "random.h"
+#include "Timer.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+// resamples per measurement
+#define REPEATS 20
+
+// the per-system loop this replaces: scalar walk and per-column copy
+void serial_resample(const double* P, int dim, const double* W, int M, double r, double* out) {
+	double c = W[0];
+	int i = 0;
+	for(int m=0; m < M; ++m) {
+		double u = (r + m) / M;
+		while ((u > c) && (i < M-1)) {
+			c += W[++i];
+		}
+		for(int d=0; d < dim; ++d) {
+			out[m*dim+d] = P[i*dim+d];
+		}
+	}
+}
+
+int main(int argc, char* argv[]) {
+	const int dim = 3;
+	util::Random random(0);
+	util::ThreadPool pool;
+	util::LowVarianceResampler serial_resampler, parallel_resampler(&pool);
+	util::Timer timer;
+	double checksum = 0;
+
+	std::cout << std::setw(10) << "particles" << std::setw(14) << "loop (s)" << std::setw(14) << "shared (s)"
+			<< std::setw(14) << "pool (s)" << std::setw(16) << "pool Mpart/s" << "\n";
+
+	for(int M=1000; M <= 1000000; M *= 10) {
+		std::vector<double> W(M), P(dim*M), out(dim*M);
+		random.uniform(&W[0], M);
+		random.uniform(&P[0], dim*M);
+		double total = 0;
+		for(int i=0; i < M; ++i) { total += W[i]; }
+		for(int i=0; i < M; ++i) { W[i] /= total; }
+
+		util::Timer_tic(&timer);
+		for(int k=0; k < REPEATS; ++k) {
+			serial_resample(&P[0], dim, &W[0], M, random.uniform(), &out[0]);
+		}
+		double loop_time = util::Timer_toc(&timer) / REPEATS;
+		checksum += out[dim*M-1];
+
+		util::Timer_tic(&timer);
+		for(int k=0; k < REPEATS; ++k) {
+			serial_resampler.resample(&P[0], dim, &W[0], M, M, random.uniform(), &out[0]);
+		}
+		double shared_time = util::Timer_toc(&timer) / REPEATS;
+		checksum += out[dim*M-1];
+
+		util::Timer_tic(&timer);
+		for(int k=0; k < REPEATS; ++k) {
+			parallel_resampler.resample(&P[0], dim, &W[0], M, M, random.uniform(), &out[0]);
+		}
+		double pool_time = util::Timer_toc(&timer) / REPEATS;
+		checksum += out[dim*M-1];
+
+		std::cout << std::setw(10) << M << std::setw(14) << loop_time << std::setw(14) << shared_time
+				<< std::setw(14) << pool_time << std::setw(16) << (M / pool_time) * 1e-6 << "\n";
+	}
+
+	std::cout << "threads: " << pool.size() << ", checksum: " << checksum << "\n";
+
+	return 0;
+}
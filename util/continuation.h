@@ -0,0 +1,256 @@
+#ifndef __CONTINUATION_H__
+#define __CONTINUATION_H__
+
+#include "matrix.h"
+#include "logging.h"
+#include "Timer.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+namespace util {
+
+/**
+ * Coarse-to-fine horizon continuation for the belief SQPs.
+ *
+ * The FORCES solvers are generated for a fixed number of timesteps, so the coarse
+ * problem is not solved as a shorter QP. Instead each coarse control is held over
+ * factor fine timesteps (the coarse problem with DT scaled by factor) and the few
+ * remaining variables are optimized with projected BFGS on the rolled out cost.
+ * Holding the controls again gives the warm start for the full horizon.
+ */
+struct ContinuationConfig {
+	int factor;            // number of fine timesteps per coarse timestep
+	int max_iters;         // quasi-Newton iterations on the coarse problem
+	double fd_eps;         // central finite difference step for the gradient
+	double initial_step;   // first step size tried by the line search
+	double min_step;       // stop once the line search needs a step below this
+	double min_improve;    // stop once an iteration improves the cost less than this
+
+	ContinuationConfig(int factor=3, int max_iters=100, double fd_eps=1e-5,
+			double initial_step=1, double min_step=1e-6, double min_improve=1e-6) :
+		factor(factor), max_iters(max_iters), fd_eps(fd_eps),
+		initial_step(initial_step), min_step(min_step), min_improve(min_improve) { }
+};
+
+// number of coarse controls needed to cover num_controls fine controls
+inline int coarse_horizon(int num_controls, int factor) {
+	return (num_controls + factor - 1) / factor;
+}
+
+// average each block of factor fine controls into one coarse control
+template <size_t _uDim>
+inline void coarsen_controls(const std::vector< Matrix<_uDim> >& U, int factor, std::vector< Matrix<_uDim> >& Ucoarse) {
+	Ucoarse.assign(coarse_horizon(U.size(), factor), zeros<_uDim,1>());
+	for(int t = 0; t < U.size(); ++t) {
+		int block_size = std::min(factor, int(U.size()) - (t/factor)*factor);
+		Ucoarse[t/factor] += U[t] / double(block_size);
+	}
+}
+
+// zero-order hold interpolation of the coarse controls onto the fine horizon
+template <size_t _uDim>
+inline void refine_controls(const std::vector< Matrix<_uDim> >& Ucoarse, int factor, std::vector< Matrix<_uDim> >& U) {
+	for(int t = 0; t < U.size(); ++t) {
+		U[t] = Ucoarse[t/factor];
+	}
+}
+
+template <size_t _uDim>
+inline void clamp_controls(const Matrix<_uDim>& uMin, const Matrix<_uDim>& uMax, std::vector< Matrix<_uDim> >& U) {
+	for(int t = 0; t < U.size(); ++t) {
+		for(int i = 0; i < _uDim; ++i) {
+			U[t][i] = std::max(uMin[i], std::min(uMax[i], U[t][i]));
+		}
+	}
+}
+
+/**
+ * \brief Optimizes U over the controls held constant across blocks of config.factor
+ *        timesteps and replaces U with the interpolated result
+ * \param cost evaluates cost(U) for a full horizon control sequence, including any
+ *        penalty for missing the goal, since the coarse problem has no constraints
+ * \return cost of the warm start
+ */
+template <size_t _uDim, typename CostFn>
+double coarse_to_fine_controls(CostFn cost, const Matrix<_uDim>& uMin, const Matrix<_uDim>& uMax,
+		const ContinuationConfig& config, std::vector< Matrix<_uDim> >& U)
+{
+	std::vector< Matrix<_uDim> > Ucoarse, Unew;
+	coarsen_controls(U, config.factor, Ucoarse);
+	clamp_controls(uMin, uMax, Ucoarse);
+
+	const int Tc = Ucoarse.size();
+	const int n = Tc*_uDim;
+	std::vector< Matrix<_uDim> > Ufine(U.size());
+
+	// central differences through the fine rollout
+	auto gradient = [&](std::vector< Matrix<_uDim> >& Uc, std::vector<double>& grad) {
+		for(int t = 0; t < Tc; ++t) {
+			for(int i = 0; i < _uDim; ++i) {
+				double orig = Uc[t][i];
+
+				Uc[t][i] = orig + config.fd_eps;
+				refine_controls(Uc, config.factor, Ufine);
+				double cost_plus = cost(Ufine);
+
+				Uc[t][i] = orig - config.fd_eps;
+				refine_controls(Uc, config.factor, Ufine);
+				double cost_minus = cost(Ufine);
+
+				Uc[t][i] = orig;
+				grad[t*_uDim+i] = (cost_plus - cost_minus) / (2*config.fd_eps);
+			}
+		}
+	};
+
+	refine_controls(Ucoarse, config.factor, Ufine);
+	double current_cost = cost(Ufine);
+	LOG_DEBUG("Coarse problem with %d controls, initial cost: %4.10f", Tc, current_cost);
+
+	// projected BFGS, the coarse problem is small enough for a dense inverse Hessian
+	std::vector<double> Hinv(n*n, 0), grad(n), new_grad(n), dir(n), s(n), y(n);
+	for(int i = 0; i < n; ++i) { Hinv[i*n+i] = 1; }
+	gradient(Ucoarse, grad);
+	bool steepest = true;
+
+	int iter;
+	for(iter = 0; iter < config.max_iters; ++iter) {
+		for(int i = 0; i < n; ++i) {
+			dir[i] = 0;
+			for(int j = 0; j < n; ++j) { dir[i] -= Hinv[i*n+j]*grad[j]; }
+		}
+
+		// backtracking line search along the projected direction
+		double step = config.initial_step, new_cost = current_cost;
+		for(; step >= config.min_step; step *= .5) {
+			Unew = Ucoarse;
+			for(int t = 0; t < Tc; ++t) {
+				for(int i = 0; i < _uDim; ++i) { Unew[t][i] += step*dir[t*_uDim+i]; }
+			}
+			clamp_controls(uMin, uMax, Unew);
+
+			refine_controls(Unew, config.factor, Ufine);
+			new_cost = cost(Ufine);
+			if (new_cost < current_cost) {
+				break;
+			}
+		}
+
+		if (step < config.min_step) {
+			if (steepest) { break; }
+			// bad curvature estimate, retry along the gradient
+			std::fill(Hinv.begin(), Hinv.end(), 0);
+			for(int i = 0; i < n; ++i) { Hinv[i*n+i] = 1; }
+			steepest = true;
+			continue;
+		}
+
+		gradient(Unew, new_grad);
+		for(int t = 0; t < Tc; ++t) {
+			for(int i = 0; i < _uDim; ++i) { s[t*_uDim+i] = Unew[t][i] - Ucoarse[t][i]; }
+		}
+		for(int i = 0; i < n; ++i) { y[i] = new_grad[i] - grad[i]; }
+
+		double improve = current_cost - new_cost;
+		Ucoarse = Unew;
+		current_cost = new_cost;
+		grad = new_grad;
+
+		if (improve < config.min_improve) {
+			break;
+		}
+
+		// Hinv = (I - rho*s*y')*Hinv*(I - rho*y*s') + rho*s*s'
+		double sy = 0;
+		for(int i = 0; i < n; ++i) { sy += s[i]*y[i]; }
+		if (sy > 1e-12) {
+			steepest = false;
+			double rho = 1/sy;
+			std::vector<double> Hy(n, 0);
+			for(int i = 0; i < n; ++i) {
+				for(int j = 0; j < n; ++j) { Hy[i] += Hinv[i*n+j]*y[j]; }
+			}
+			double yHy = 0;
+			for(int i = 0; i < n; ++i) { yHy += y[i]*Hy[i]; }
+			for(int i = 0; i < n; ++i) {
+				for(int j = 0; j < n; ++j) {
+					Hinv[i*n+j] += -rho*(Hy[i]*s[j] + s[i]*Hy[j]) + (rho*rho*yHy + rho)*s[i]*s[j];
+				}
+			}
+		}
+	}
+
+	LOG_DEBUG("Coarse problem finished after %d iterations, cost: %4.10f", iter, current_cost);
+
+	refine_controls(Ucoarse, config.factor, U);
+	return current_cost;
+}
+
+/**
+ * \brief Coarse-to-fine warm start of a belief trajectory: coarse_to_fine_controls on the
+ *        rollout of dynamics(b, u) from B[0], then B is rolled out along the new U
+ * \param cost evaluates cost(B, U) of a rolled out trajectory
+ * \param goal_penalty evaluates goal_penalty(b) of the final belief, in place of the
+ *        goal constraint the SQP enforces
+ * \return cost of the warm start
+ */
+template <size_t _bDim, size_t _uDim, typename DynamicsFn, typename CostFn, typename GoalPenaltyFn>
+double coarse_to_fine_init(DynamicsFn dynamics, CostFn cost, GoalPenaltyFn goal_penalty,
+		const Matrix<_uDim>& uMin, const Matrix<_uDim>& uMax, int factor,
+		std::vector< Matrix<_bDim> >& B, std::vector< Matrix<_uDim> >& U)
+{
+	const int T = B.size();
+
+	std::vector< Matrix<_bDim> > Brollout(T);
+	Brollout[0] = B[0];
+	auto rollout_cost = [&](const std::vector< Matrix<_uDim> >& Uc) -> double {
+		for(int t = 0; t < T-1; ++t) {
+			Brollout[t+1] = dynamics(Brollout[t], Uc[t]);
+		}
+		return cost(Brollout, Uc) + goal_penalty(Brollout[T-1]);
+	};
+
+	double warm_start_cost = coarse_to_fine_controls(rollout_cost, uMin, uMax, ContinuationConfig(factor), U);
+
+	for(int t = 0; t < T-1; ++t) {
+		B[t+1] = dynamics(B[t], U[t]);
+	}
+	return warm_start_cost;
+}
+
+/**
+ * \brief Logs the average time and final cost of solve(B, U) from Binit, Uinit over
+ *        num_runs runs, cold (factor 1) and after init(B, U, factor) for the other factors
+ * \param solve returns the cost of the solution, or INFINITY if the solver failed
+ */
+template <size_t _bDim, size_t _uDim, typename InitFn, typename SolveFn>
+void benchmark_continuation(InitFn init, SolveFn solve, const std::vector<int>& factors, int num_runs,
+		const std::vector< Matrix<_bDim> >& Binit, const std::vector< Matrix<_uDim> >& Uinit)
+{
+	Timer solve_timer;
+	for(int k = 0; k < factors.size(); ++k) {
+		double total_time = 0, cost = 0;
+		int failures = 0;
+		for(int run = 0; run < num_runs; ++run) {
+			std::vector< Matrix<_bDim> > B = Binit;
+			std::vector< Matrix<_uDim> > U = Uinit;
+
+			Timer_tic(&solve_timer);
+			if (factors[k] > 1) {
+				init(B, U, factors[k]);
+			}
+			cost = solve(B, U);
+			total_time += Timer_toc(&solve_timer);
+
+			failures += !std::isfinite(cost);
+		}
+		LOG_INFO("%s (factor %d): cost %4.10f, average solve time %5.3f ms, %d solver failures",
+				(factors[k] > 1) ? "coarse-to-fine" : "cold", factors[k], cost, total_time*1000/num_runs, failures);
+	}
+}
+
+}
+
+#endif
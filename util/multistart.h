@@ -0,0 +1,143 @@
+#ifndef __MULTISTART_H__
+#define __MULTISTART_H__
+
+#include "threadpool.h"
+#include "logging.h"
+
+#include <map>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+namespace util {
+
+struct MultiStartConfig {
+	int num_starts;       // number of differently-seeded solves (K)
+	int num_threads;      // worker threads, <= 0 means one per core
+	double cancel_margin; // cancel a start whose merit is worse than the incumbent by this relative margin
+	int grace_reports;    // number of reports a start gets before it can be cancelled
+	unsigned base_seed;   // start k is seeded with base_seed + k
+
+	MultiStartConfig(int num_starts=4, int num_threads=0, double cancel_margin=.25,
+			int grace_reports=3, unsigned base_seed=0) :
+		num_starts(num_starts), num_threads(num_threads), cancel_margin(cancel_margin),
+		grace_reports(grace_reports), base_seed(base_seed) { }
+};
+
+/**
+ * Best merit reported by any start, kept separately per stage
+ * (e.g. per penalty/alpha level) since merits of different stages are not comparable
+ */
+class MultiStartIncumbent {
+public:
+	double update(int stage, double merit) {
+		std::lock_guard<std::mutex> lock(mutex);
+		std::map<int,double>::iterator it = best.find(stage);
+		if ((it == best.end()) || (merit < it->second)) {
+			best[stage] = merit;
+			return merit;
+		}
+		return it->second;
+	}
+
+private:
+	std::mutex mutex;
+	std::map<int,double> best;
+};
+
+/**
+ * Handed to each start so the solver can share progress and learn
+ * whether it has fallen far enough behind to give up
+ */
+class MultiStartContext {
+public:
+	MultiStartContext(int start, unsigned seed, const MultiStartConfig& config, MultiStartIncumbent& incumbent) :
+		start(start), seed(seed), config(config), incumbent(incumbent), num_reports(0), cancelled(false) { }
+
+	const int start;
+	const unsigned seed;
+
+	/**
+	 * \brief Report the current merit of this start at the given stage
+	 * \return false if the start should stop, in which case its result is discarded
+	 */
+	bool report(double merit, int stage=0) {
+		if (cancelled) { return false; }
+		if (!std::isfinite(merit)) { return true; }
+
+		double best = incumbent.update(stage, merit);
+		if ((++num_reports > config.grace_reports) &&
+				(merit - best > config.cancel_margin*std::max(fabs(best), 1e-8))) {
+			LOG_DEBUG("Multistart %d cancelled at stage %d: merit %4.5f, incumbent %4.5f", start, stage, merit, best);
+			cancelled = true;
+		}
+		return !cancelled;
+	}
+
+	bool is_cancelled() const { return cancelled; }
+
+private:
+	const MultiStartConfig& config;
+	MultiStartIncumbent& incumbent;
+	int num_reports;
+	bool cancelled;
+};
+
+/**
+ * Runs config.num_starts solves concurrently on a thread pool and keeps the best.
+ *
+ * init(ctx, solution) fills in the initial guess for start ctx.start (start 0 should be
+ * the deterministic default guess so multistart is never worse than a single solve).
+ * solve(ctx, solution) optimizes in place, calls ctx.report() as it makes progress and
+ * returns the final merit, which must be comparable across starts.
+ */
+template<typename Solution>
+class MultiStart {
+public:
+	MultiStart(const MultiStartConfig& config) : config(config), pool(config.num_threads) { }
+
+	template<typename Init, typename Solve>
+	double run(Init init, Solve solve, Solution& best_solution) {
+		MultiStartIncumbent incumbent;
+
+		std::vector<Solution> solutions(config.num_starts, best_solution);
+		std::vector<double> merits(config.num_starts, INFINITY);
+		std::vector<int> cancelled(config.num_starts, 0); // not vector<bool>, starts write concurrently
+
+		std::vector<std::future<void> > done;
+		for(int k=0; k < config.num_starts; ++k) {
+			done.push_back(pool.enqueue([&, k] {
+				MultiStartContext ctx(k, config.base_seed + k, config, incumbent);
+				init(ctx, solutions[k]);
+				merits[k] = solve(ctx, solutions[k]);
+				cancelled[k] = ctx.is_cancelled();
+			}));
+		}
+		for(int k=0; k < done.size(); ++k) { done[k].get(); }
+
+		int best_start = -1;
+		for(int k=0; k < config.num_starts; ++k) {
+			LOG_DEBUG("Multistart %d: merit %4.5f%s", k, merits[k], cancelled[k] ? " (cancelled)" : "");
+			if (!cancelled[k] && ((best_start < 0) || (merits[k] < merits[best_start]))) {
+				best_start = k;
+			}
+		}
+
+		if (best_start < 0) {
+			LOG_WARN("Every multistart was cancelled, keeping initial solution");
+			return INFINITY;
+		}
+
+		LOG_DEBUG("Multistart %d is best with merit %4.5f", best_start, merits[best_start]);
+		best_solution = solutions[best_start];
+		return merits[best_start];
+	}
+
+private:
+	MultiStartConfig config;
+	ThreadPool pool;
+};
+
+}
+
+#endif
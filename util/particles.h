@@ -0,0 +1,336 @@
+#ifndef __PARTICLES_H__
+#define __PARTICLES_H__
+
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <algorithm>
+#include <stdint.h>
+
+namespace util {
+
+/**
+ * Allocator for 64-byte (cache line, AVX-512 register) aligned storage
+ */
+template<typename T, size_t Alignment=64>
+struct AlignedAllocator {
+	typedef T value_type;
+
+	template<typename U> struct rebind { typedef AlignedAllocator<U,Alignment> other; };
+
+	AlignedAllocator() { }
+	template<typename U> AlignedAllocator(const AlignedAllocator<U,Alignment>&) { }
+
+	T* allocate(size_t n) {
+		void* p = NULL;
+		if (posix_memalign(&p, Alignment, n*sizeof(T)) != 0) { throw std::bad_alloc(); }
+		return static_cast<T*>(p);
+	}
+	void deallocate(T* p, size_t) { free(p); }
+
+	template<typename U> bool operator==(const AlignedAllocator<U,Alignment>&) const { return true; }
+	template<typename U> bool operator!=(const AlignedAllocator<U,Alignment>&) const { return false; }
+};
+
+/**
+ * Batch kernels over float arrays. The loops have no calls or branches so the
+ * compiler vectorizes them; exp and log are Cephes' single precision polynomials
+ * (relative error around 1e-7) instead of libm calls.
+ */
+namespace particles {
+
+// double precision accumulators per reduction, enough for a vectorized sum
+const int LANES = 8;
+
+// elements per block of a two pass (evaluate, then sum) reduction
+const int BLOCK = 256;
+
+/*
+ * Float comparisons may trap unless -fno-trapping-math, which keeps gcc from if-converting
+ * them, so clamps and selects compare the bit patterns as integers instead. For floats of
+ * the same sign the bit patterns order like the values; ordered_key extends that to all
+ * floats and is its own inverse.
+ */
+inline int32_t float_bits(float x) {
+	int32_t i;
+	memcpy(&i, &x, sizeof(float));
+	return i;
+}
+
+inline float bits_float(int32_t i) {
+	float x;
+	memcpy(&x, &i, sizeof(float));
+	return x;
+}
+
+inline int32_t ordered_key(int32_t i) {
+	return (i < 0) ? i ^ 0x7fffffff : i;
+}
+
+inline float clamp(float x, float low, float high) {
+	int32_t k = ordered_key(float_bits(x));
+	int32_t k_low = ordered_key(float_bits(low)), k_high = ordered_key(float_bits(high));
+	k = (k < k_low) ? k_low : k;
+	k = (k > k_high) ? k_high : k;
+	return bits_float(ordered_key(k));
+}
+
+inline float fast_exp(float x) {
+	x = clamp(x, -87.f, 88.f);
+	// round to nearest through a positive offset, so truncation is floor
+	int n = int(x*1.44269504f + 126.5f) - 126;
+	float r = x - n*0.693359375f + n*2.12194440e-4f;
+
+	float p = 1.9875691500e-4f;
+	p = p*r + 1.3981999507e-3f;
+	p = p*r + 8.3334519073e-3f;
+	p = p*r + 4.1665795894e-2f;
+	p = p*r + 1.6666665459e-1f;
+	p = p*r + 5.0000001201e-1f;
+	p = p*r*r + r + 1;
+
+	return p*bits_float((n + 127) << 23);
+}
+
+/**
+ * \brief Natural log of x > 0 (normal floats)
+ */
+inline float fast_log(float x) {
+	int32_t bits = float_bits(x);
+	int e = ((bits >> 23) & 0xff) - 126;
+	bits = (bits & 0x807fffff) | 0x3f000000;
+
+	// m in [sqrt(.5), sqrt(2)) - 1, 0x3f3504f3 is sqrt(.5)
+	int small = bits < 0x3f3504f3;
+	e -= small;
+	float m = bits_float(bits + (small << 23)) - 1;
+
+	float z = m*m;
+	float y = 7.0376836292e-2f;
+	y = y*m - 1.1514610310e-1f;
+	y = y*m + 1.1676998740e-1f;
+	y = y*m - 1.2420140846e-1f;
+	y = y*m + 1.4249322787e-1f;
+	y = y*m - 1.6668057665e-1f;
+	y = y*m + 2.0000714765e-1f;
+	y = y*m - 2.4999993993e-1f;
+	y = y*m + 3.3333331174e-1f;
+	y = y*m*z;
+
+	y += -2.12194440e-4f*e - 0.5f*z;
+	return m + y + 0.693359375f*e;
+}
+
+/**
+ * \brief out = 1/(1 + exp(-alpha*x)), out may alias x
+ */
+inline void sigmoid(const float* x, float alpha, float* out, int n) {
+	for(int i=0; i < n; ++i) {
+		out[i] = 1.f / (1.f + fast_exp(-alpha*x[i]));
+	}
+}
+
+inline void multiply(float* w, const float* f, int n) {
+	for(int i=0; i < n; ++i) {
+		w[i] *= f[i];
+	}
+}
+
+inline void scale(float* w, float a, int n) {
+	for(int i=0; i < n; ++i) {
+		w[i] *= a;
+	}
+}
+
+inline double sum(const float* x, int n) {
+	double acc[LANES] = {0};
+	int i = 0;
+	for(; i + LANES <= n; i += LANES) {
+		for(int l=0; l < LANES; ++l) { acc[l] += x[i+l]; }
+	}
+	double total = 0;
+	for(; i < n; ++i) { total += x[i]; }
+	for(int l=0; l < LANES; ++l) { total += acc[l]; }
+	return total;
+}
+
+inline double sum_squares(const float* x, int n) {
+	double acc[LANES] = {0};
+	int i = 0;
+	for(; i + LANES <= n; i += LANES) {
+		for(int l=0; l < LANES; ++l) { acc[l] += double(x[i+l])*x[i+l]; }
+	}
+	double total = 0;
+	for(; i < n; ++i) { total += double(x[i])*x[i]; }
+	for(int l=0; l < LANES; ++l) { total += acc[l]; }
+	return total;
+}
+
+/**
+ * \brief log(sum_i exp(x_i)), shifted by the maximum so it does not overflow
+ */
+inline double log_sum_exp(const float* x, int n) {
+	if (n == 0) { return -std::numeric_limits<double>::infinity(); }
+	float x_max = *std::max_element(x, x + n);
+	if (std::isinf(x_max)) { return x_max; }
+
+	float terms[BLOCK];
+	double total = 0;
+	for(int begin=0; begin < n; begin += BLOCK) {
+		int count = std::min(n - begin, BLOCK);
+		for(int i=0; i < count; ++i) {
+			terms[i] = fast_exp(x[begin+i] - x_max);
+		}
+		total += sum(terms, count);
+	}
+	return x_max + log(total);
+}
+
+/**
+ * \brief -sum_i w_i log(w_i), skipping weights at or below min_weight
+ */
+inline double entropy(const float* w, int n, float min_weight=1e-8f) {
+	// weights are non-negative, so their bits compare like their values
+	int32_t min_bits = float_bits(min_weight);
+
+	float terms[BLOCK];
+	double total = 0;
+	for(int begin=0; begin < n; begin += BLOCK) {
+		int count = std::min(n - begin, BLOCK);
+		for(int i=0; i < count; ++i) {
+			// fast_log(0) is finite, so masking by multiplication is safe
+			float keep = float_bits(w[begin+i]) > min_bits;
+			terms[i] = -keep*w[begin+i]*fast_log(w[begin+i]);
+		}
+		total += sum(terms, count);
+	}
+	return total;
+}
+
+}
+
+/**
+ * Weighted particle set stored as structure of arrays in single precision.
+ *
+ * Coordinate d of every particle is contiguous, 64-byte aligned and padded to a
+ * multiple of 16 floats, so per-particle computations (distances, likelihoods)
+ * run across particles in SIMD registers. Weights are stored alongside, with a
+ * scratch row for per-particle values such as signed distances.
+ */
+class ParticleSet {
+public:
+	ParticleSet(int dim=0, int size=0) { resize(dim, size); }
+
+	void resize(int dim, int size) {
+		this->dim = dim;
+		this->num_particles = size;
+		stride = (size + PAD - 1) / PAD * PAD;
+		data.assign((dim + 2)*stride, 0.f);
+		set_uniform_weights();
+	}
+
+	int dimension() const { return dim; }
+	int size() const { return num_particles; }
+
+	float* coord(int d) { return &data[d*stride]; }
+	const float* coord(int d) const { return &data[d*stride]; }
+	float* weights() { return &data[dim*stride]; }
+	const float* weights() const { return &data[dim*stride]; }
+	float* scratch() { return &data[(dim+1)*stride]; }
+
+	/**
+	 * \brief Copies particles from column-major dim x size storage (Eigen and Armadillo default)
+	 */
+	void set_particles(const double* P) {
+		for(int d=0; d < dim; ++d) {
+			float* x = coord(d);
+			for(int m=0; m < num_particles; ++m) {
+				x[m] = P[m*dim+d];
+			}
+		}
+	}
+
+	void get_particles(double* P) const {
+		for(int d=0; d < dim; ++d) {
+			const float* x = coord(d);
+			for(int m=0; m < num_particles; ++m) {
+				P[m*dim+d] = x[m];
+			}
+		}
+	}
+
+	void set_uniform_weights() {
+		std::fill(weights(), weights() + num_particles, 1.f / std::max(num_particles, 1));
+	}
+
+	void set_weights(const double* W) {
+		std::copy(W, W + num_particles, weights());
+	}
+
+	void get_weights(double* W) const {
+		std::copy(weights(), weights() + num_particles, W);
+	}
+
+	/**
+	 * \brief w_m *= likelihood_m
+	 */
+	void multiply_weights(const float* likelihood) {
+		particles::multiply(weights(), likelihood, num_particles);
+	}
+
+	/**
+	 * \brief w_m *= 1/(1 + exp(-alpha*x_m)), x can be scratch()
+	 */
+	void multiply_sigmoid(float* x, float alpha) {
+		particles::sigmoid(x, alpha, x, num_particles);
+		multiply_weights(x);
+	}
+
+	/**
+	 * \brief Scales the weights to sum to one and returns their sum before scaling
+	 */
+	double normalize() {
+		double total = particles::sum(weights(), num_particles);
+		particles::scale(weights(), 1/total, num_particles);
+		return total;
+	}
+
+	/**
+	 * \brief Sets normalized weights from unnormalized log weights and returns their log-sum-exp
+	 */
+	double set_log_weights(const float* log_w) {
+		double lse = particles::log_sum_exp(log_w, num_particles);
+		float* w = weights();
+		for(int m=0; m < num_particles; ++m) {
+			w[m] = particles::fast_exp(log_w[m] - lse);
+		}
+		return lse;
+	}
+
+	/**
+	 * \brief Entropy of the (normalized) weights
+	 */
+	double entropy() const {
+		return particles::entropy(weights(), num_particles);
+	}
+
+	/**
+	 * \brief 1/sum_m w_m^2 of the (normalized) weights
+	 */
+	double effective_sample_size() const {
+		return 1 / particles::sum_squares(weights(), num_particles);
+	}
+
+private:
+	static const int PAD = 16; // floats per 64 bytes
+
+	int dim, num_particles, stride;
+	std::vector<float, AlignedAllocator<float> > data; // coordinates, weights, scratch
+};
+
+}
+
+#endif
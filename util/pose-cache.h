@@ -0,0 +1,137 @@
+#ifndef __POSE_CACHE_H__
+#define __POSE_CACHE_H__
+
+#include <list>
+#include <utility>
+#include <cmath>
+#include <unordered_map>
+#include <stdint.h>
+
+namespace util {
+
+/**
+ * Least recently used cache of per-view results (z-buffers, truncated frusta) keyed by
+ * camera pose.
+ *
+ * The pose is a row-major 3x4 [R t]; every entry is rounded to a multiple of tolerance,
+ * so poses that agree to within rounding noise share an entry, while poses further apart
+ * than tolerance never do. The tolerance has to stay below the pose change of a finite
+ * difference step, or the gradient through the cached value is lost. An integer tag
+ * separates variants of the value for the same pose.
+ */
+template<typename V>
+class PoseCache {
+public:
+	PoseCache(int capacity=64, double tolerance=1e-9) :
+		capacity(capacity), tolerance(tolerance), num_hits(0), num_misses(0) { }
+
+	/**
+	 * \brief Cached value for pose, NULL if there is none. Counts a hit or a miss.
+	 *        The pointer is valid until the next insert or clear.
+	 */
+	V* find(const double pose[12], int tag=0) {
+		typename Index::iterator it = index.find(make_key(pose, tag));
+		if (it == index.end()) {
+			++num_misses;
+			return NULL;
+		}
+
+		++num_hits;
+		entries.splice(entries.begin(), entries, it->second);
+		return &it->second->second;
+	}
+
+	/**
+	 * \brief Stores value for pose, evicting the least recently used entry if full
+	 */
+	V& insert(const double pose[12], const V& value, int tag=0) {
+		Key key = make_key(pose, tag);
+		typename Index::iterator it = index.find(key);
+		if (it != index.end()) {
+			entries.splice(entries.begin(), entries, it->second);
+			it->second->second = value;
+			return it->second->second;
+		}
+
+		if ((int(index.size()) >= capacity) && !entries.empty()) {
+			index.erase(entries.back().first);
+			entries.pop_back();
+		}
+		entries.push_front(std::make_pair(key, value));
+		index[key] = entries.begin();
+		return entries.front().second;
+	}
+
+	void clear() {
+		entries.clear();
+		index.clear();
+	}
+
+	void reset_counters() { num_hits = num_misses = 0; }
+
+	void set_capacity(int capacity) {
+		this->capacity = capacity;
+		while (int(index.size()) > capacity) {
+			index.erase(entries.back().first);
+			entries.pop_back();
+		}
+	}
+
+	/**
+	 * \brief Changing the tolerance changes every key, so it clears the cache
+	 */
+	void set_tolerance(double tolerance) {
+		this->tolerance = tolerance;
+		clear();
+	}
+
+	int size() const { return index.size(); }
+	int hits() const { return num_hits; }
+	int misses() const { return num_misses; }
+	double get_tolerance() const { return tolerance; }
+
+private:
+	struct Key {
+		int64_t q[13];
+
+		bool operator==(const Key& other) const {
+			for(int i=0; i < 13; ++i) {
+				if (q[i] != other.q[i]) { return false; }
+			}
+			return true;
+		}
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const {
+			uint64_t h = 0xcbf29ce484222325ULL;
+			for(int i=0; i < 13; ++i) {
+				h = (h ^ uint64_t(key.q[i])) * 0x100000001B3ULL; // FNV-1a style mixing
+			}
+			return size_t(h ^ (h >> 32));
+		}
+	};
+
+	typedef std::list<std::pair<Key, V> > Entries;
+	typedef std::unordered_map<Key, typename Entries::iterator, KeyHash> Index;
+
+	int capacity;
+	double tolerance;
+	int num_hits, num_misses;
+
+	Entries entries; // most recently used first
+	Index index;
+
+	Key make_key(const double pose[12], int tag) const {
+		Key key;
+		for(int i=0; i < 12; ++i) {
+			key.q[i] = int64_t(floor(pose[i] / tolerance + .5));
+		}
+		key.q[12] = tag;
+		return key;
+	}
+};
+
+}
+
+#endif
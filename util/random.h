@@ -0,0 +1,205 @@
+#ifndef __RANDOM_H__
+#define __RANDOM_H__
+
+#include <cmath>
+#include <atomic>
+#include <algorithm>
+#include <stdint.h>
+
+namespace util {
+
+/**
+ * Philox4x32-10 counter-based generator (Salmon et al., "Parallel random numbers:
+ * as easy as 1, 2, 3"). Output block i is a pure function of (key, counter i), so
+ * every (seed, thread, stream) triple is an independent stream that needs no shared
+ * state, can be skipped ahead for free and gives the same numbers under any
+ * thread schedule.
+ */
+namespace philox {
+
+const uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+const uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+
+/**
+ * \brief Fills out[4*i .. 4*i+3] with the output for counter (first + i, stream, thread)
+ *
+ * The blocks are independent and the loop is written over them, so the compiler can
+ * run several blocks per SIMD register.
+ */
+inline void generate(uint64_t first, int num_blocks, uint32_t stream, uint32_t thread,
+		const uint32_t key[2], uint32_t* out) {
+	for(int i=0; i < num_blocks; ++i) {
+		uint64_t counter = first + i;
+		uint32_t c0 = uint32_t(counter), c1 = uint32_t(counter >> 32), c2 = stream, c3 = thread;
+		uint32_t k0 = key[0], k1 = key[1];
+		for(int round=0; round < 10; ++round) {
+			uint64_t p0 = uint64_t(M0)*c0, p1 = uint64_t(M1)*c2;
+			uint32_t n0 = uint32_t(p1 >> 32) ^ c1 ^ k0;
+			uint32_t n2 = uint32_t(p0 >> 32) ^ c3 ^ k1;
+			c1 = uint32_t(p1);
+			c3 = uint32_t(p0);
+			c0 = n0;
+			c2 = n2;
+			k0 += W0;
+			k1 += W1;
+		}
+		out[4*i] = c0; out[4*i+1] = c1; out[4*i+2] = c2; out[4*i+3] = c3;
+	}
+}
+
+}
+
+/**
+ * Random stream keyed by (seed, thread, stream) on top of Philox4x32-10.
+ *
+ * Numbers are generated in batches; the scalar calls draw from an internal batch.
+ * Two Random objects with the same key produce the same sequence, so a parallel loop
+ * that keys its streams by task rather than by worker is reproducible.
+ */
+class Random {
+public:
+	Random(uint64_t seed=0, uint32_t thread=0, uint32_t stream=0) {
+		reset(seed, thread, stream);
+	}
+
+	void reset(uint64_t seed, uint32_t thread, uint32_t stream) {
+		key[0] = uint32_t(seed);
+		key[1] = uint32_t(seed >> 32);
+		this->thread = thread;
+		this->stream = stream;
+		counter = 0;
+		uniform_pos = normal_pos = BATCH;
+	}
+
+	/**
+	 * \brief n uniform samples in (0,1), 53 bits each
+	 */
+	void uniform(double* out, int n) {
+		uint32_t bits[4*CHUNK];
+		for(int begin=0; begin < n; begin += 2*CHUNK) {
+			int count = std::min(n - begin, 2*CHUNK);
+			int blocks = (count + 1) / 2;
+			philox::generate(counter, blocks, stream, thread, key, bits);
+			counter += blocks;
+			for(int i=0; i < count; ++i) {
+				uint64_t x = (uint64_t(bits[2*i]) << 32) | bits[2*i+1];
+				out[begin+i] = ((x >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+			}
+		}
+	}
+
+	/**
+	 * \brief n standard normal samples (Box-Muller on batches of uniforms)
+	 */
+	void normal(double* out, int n) {
+		double u[2*CHUNK];
+		for(int begin=0; begin < n; begin += 2*CHUNK) {
+			int count = std::min(n - begin, 2*CHUNK);
+			int pairs = (count + 1) / 2;
+			uniform(u, 2*pairs);
+
+			double r[CHUNK], theta[CHUNK];
+			for(int i=0; i < pairs; ++i) {
+				r[i] = sqrt(-2*log(u[2*i]));
+				theta[i] = 2*M_PI*u[2*i+1];
+			}
+			for(int i=0; i < pairs; ++i) {
+				u[2*i] = r[i]*cos(theta[i]);
+				u[2*i+1] = r[i]*sin(theta[i]);
+			}
+			std::copy(u, u + count, out + begin);
+		}
+	}
+
+	/**
+	 * \brief Samples out = mean + L*z with z ~ N(0,I)
+	 * \param L row-major lower triangular Cholesky factor of the covariance, dim x dim
+	 */
+	void gaussian(int dim, const double* mean, const double* L, double* out) {
+		double z[MAX_GAUSSIAN_DIM];
+		for(int i=0; i < dim; ++i) {
+			z[i] = normal();
+		}
+		for(int i=0; i < dim; ++i) {
+			double x = mean[i];
+			for(int j=0; j <= i; ++j) {
+				x += L[i*dim+j]*z[j];
+			}
+			out[i] = x;
+		}
+	}
+
+	double uniform() {
+		if (uniform_pos == BATCH) {
+			uniform(uniform_batch, BATCH);
+			uniform_pos = 0;
+		}
+		return uniform_batch[uniform_pos++];
+	}
+
+	double uniform(double low, double high) {
+		return low + (high - low)*uniform();
+	}
+
+	double normal() {
+		if (normal_pos == BATCH) {
+			normal(normal_batch, BATCH);
+			normal_pos = 0;
+		}
+		return normal_batch[normal_pos++];
+	}
+
+	static const int MAX_GAUSSIAN_DIM = 64;
+
+private:
+	static const int CHUNK = 64;
+	static const int BATCH = 64;
+
+	uint32_t key[2];
+	uint32_t thread, stream;
+	uint64_t counter;
+
+	double uniform_batch[BATCH], normal_batch[BATCH];
+	int uniform_pos, normal_pos;
+};
+
+inline std::atomic<uint64_t>& random_seed() {
+	static std::atomic<uint64_t> seed(0);
+	return seed;
+}
+
+inline std::atomic<uint32_t>& random_generation() {
+	static std::atomic<uint32_t> generation(0);
+	return generation;
+}
+
+/**
+ * \brief Sets the seed of every thread_random() stream, replaces srand for the
+ *        samplers built on it. Streams are re-keyed on their next use.
+ */
+inline void seed_random(uint64_t seed) {
+	random_seed() = seed;
+	++random_generation();
+}
+
+/**
+ * \brief Stream of the calling thread, keyed (seed, thread index, 0). Thread indices
+ *        are handed out in order of first use, so the first thread to draw (normally
+ *        main) gets index 0 and single threaded programs are reproducible.
+ */
+inline Random& thread_random() {
+	static std::atomic<uint32_t> next_thread(0);
+	thread_local uint32_t thread = next_thread++;
+	thread_local uint32_t generation = random_generation();
+	thread_local Random random(random_seed(), thread, 0);
+
+	if (generation != random_generation()) {
+		generation = random_generation();
+		random.reset(random_seed(), thread, 0);
+	}
+	return random;
+}
+
+}
+
+#endif
@@ -0,0 +1,247 @@
+#ifndef __RESAMPLING_H__
+#define __RESAMPLING_H__
+
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <unordered_set>
+#include <stdint.h>
+
+#include "threadpool.h"
+#include "random.h"
+
+namespace util {
+
+/**
+ * Systematic (low variance) resampler shared by the particle filters.
+ *
+ * Sample m is the first particle whose cumulative weight reaches (r + m)/n. The weights
+ * are quantized to 62-bit fixed point before the prefix sum, so the sums are exact and
+ * the result does not depend on how the work is split over the pool (if any). Instead of
+ * walking the positions, which mispredicts a branch per sample, every particle computes
+ * how many positions its cumulative weight reaches and marks the first of its copies;
+ * the indices are then a running maximum over the marks. Jitter for output block b
+ * comes from the Random stream (seed, 0, b), so it is also independent of the number
+ * of threads.
+ */
+class LowVarianceResampler {
+public:
+	LowVarianceResampler(ThreadPool* pool=NULL) : pool(pool) { }
+
+	void set_pool(ThreadPool* pool) { this->pool = pool; }
+
+	/**
+	 * \brief Indices of n systematic samples from the M weights W (need not be normalized)
+	 * \param r offset in [0,1)
+	 */
+	void indices(const double* W, int M, int n, double r, int* indices) {
+		mark_first_copies(W, M, n, r);
+
+		for_blocks(n, [&](int begin, int end) {
+			// owner of the first position is the last mark at or before it (none if all weights are zero)
+			int first = begin;
+			while ((first > 0) && (marks[first] < 0)) { --first; }
+			int i = std::max(marks[first], 0);
+			for(int m=begin; m < end; ++m) {
+				i = std::max(i, marks[m]);
+				indices[m] = i;
+			}
+		});
+	}
+
+	/**
+	 * \brief out (dim x n, column-major) = columns indices[0..n) of P (dim x M, column-major),
+	 *        plus uniform noise in [-jitter, jitter] per coordinate
+	 */
+	void gather(const double* P, int dim, const int* indices, int n, double* out,
+			double jitter=0, uint64_t seed=0) {
+		for_blocks(n, [&](int begin, int end) {
+			// checking for runs of consecutive columns costs more than it saves unless they are long
+			for(int m=begin; m < end; ++m) {
+				memcpy(out + m*dim, P + indices[m]*dim, dim*sizeof(double));
+			}
+
+			if (jitter > 0) {
+				const int block_size = BLOCK; // std::min takes references, BLOCK has no definition
+				double noise[BLOCK];
+				Random random(seed, 0, begin / BLOCK);
+				for(int offset=begin*dim; offset < end*dim; offset += BLOCK) {
+					int count = std::min(end*dim - offset, block_size);
+					random.uniform(noise, count);
+					for(int k=0; k < count; ++k) {
+						out[offset+k] += jitter*(2*noise[k] - 1);
+					}
+				}
+			}
+		});
+	}
+
+	/**
+	 * \brief n systematic samples of the weighted particles P (dim x M) into out (dim x n)
+	 */
+	void resample(const double* P, int dim, const double* W, int M, int n, double r, double* out,
+			double jitter=0, uint64_t seed=0) {
+		index_buffer.resize(n);
+		indices(W, M, n, r, &index_buffer[0]);
+		gather(P, dim, &index_buffer[0], n, out, jitter, seed);
+	}
+
+	static const int BLOCK = 4096;
+
+private:
+	ThreadPool* pool;
+	std::vector<uint64_t> block_offsets;
+	std::vector<double> block_max;
+	std::vector<int> marks;
+	std::vector<int> index_buffer;
+
+	template<typename F>
+	void for_blocks(int n, F f) {
+		int num_blocks = (n + BLOCK - 1) / BLOCK;
+		auto block = [&](int b) { f(b*BLOCK, std::min(n, (b+1)*BLOCK)); };
+		if ((pool != NULL) && (num_blocks > 1)) {
+			pool->parallel_for(0, num_blocks, block);
+		} else {
+			for(int b=0; b < num_blocks; ++b) { block(b); }
+		}
+	}
+
+	/**
+	 * \brief marks[m] = i if particle i has copies and the first is sample m, -1 otherwise
+	 *
+	 * The prefix sum is in fixed point: a pass for the maximum weight (the scale), a pass for
+	 * the block sums and a pass that redoes the prefix sum from the block offsets and marks.
+	 */
+	void mark_first_copies(const double* W, int M, int n, double r) {
+		int num_blocks = (M + BLOCK - 1) / BLOCK;
+		block_offsets.resize(num_blocks);
+		block_max.resize(num_blocks);
+		// particles without copies mark the spare position n
+		marks.resize(n + 1);
+
+		for_blocks(M, [&](int begin, int end) {
+			block_max[begin / BLOCK] = *std::max_element(W + begin, W + end);
+		});
+		double w_max = *std::max_element(block_max.begin(), block_max.end());
+
+		// every weight at most 2^62 / M, so the total fits
+		double scale = (w_max > 0) ? std::ldexp(1.0, 62) / (double(M) * w_max) : 0;
+
+		for_blocks(M, [&](int begin, int end) {
+			uint64_t sum = 0;
+			for(int i=begin; i < end; ++i) {
+				sum += int64_t(W[i] * scale);
+			}
+			block_offsets[begin / BLOCK] = sum;
+		});
+
+		uint64_t total = 0;
+		for(int b=0; b < num_blocks; ++b) {
+			uint64_t block_sum = block_offsets[b];
+			block_offsets[b] = total;
+			total += block_sum;
+		}
+
+		for_blocks(n + 1, [&](int begin, int end) {
+			std::fill(marks.begin() + begin, marks.begin() + end, -1);
+		});
+
+		// c/total >= (r + m)/n for m < c*n/total + 1 - r, which is positive so truncation is floor
+		double positions_per_unit = (total > 0) ? n / double(total) : 0;
+		for_blocks(M, [&](int begin, int end) {
+			uint64_t c = block_offsets[begin / BLOCK];
+			int reached_before = positions_reached(c, positions_per_unit, r, n);
+			for(int i=begin; i < end; ++i) {
+				c += int64_t(W[i] * scale);
+				int reached = positions_reached(c, positions_per_unit, r, n);
+				marks[(reached > reached_before) ? reached_before : n] = i;
+				reached_before = reached;
+			}
+		});
+	}
+
+	/**
+	 * \brief Number of positions (r + m)/n, m < n, at or below the cumulative weight c
+	 */
+	static int positions_reached(uint64_t c, double positions_per_unit, double r, int n) {
+		int64_t count = int64_t(int64_t(c)*positions_per_unit + (1 - r));
+		// zero reaches none, also for r = 0, so leading zero weights are not selected
+		return (c == 0) ? 0 : int(std::min<int64_t>(count, n));
+	}
+};
+
+/**
+ * KLD-sampling (Fox, "Adapting the sample size in particle filters through KLD-sampling").
+ *
+ * Picks the number of particles so that, with probability 1 - delta, the KL divergence
+ * between the particle approximation and the posterior, both discretized on a grid of
+ * bin_size, stays below epsilon. The count grows with the number k of occupied bins,
+ * so a spread out belief gets more particles and a collapsed one fewer.
+ */
+class KLDSampling {
+public:
+	/**
+	 * \param z upper 1 - delta quantile of the standard normal (2.326 for delta = .01)
+	 */
+	KLDSampling(double bin_size, int min_particles, int max_particles, double epsilon=.05, double z=2.326) :
+		bin_size(bin_size), min_particles(min_particles), max_particles(max_particles), epsilon(epsilon), z(z) { }
+
+	/**
+	 * \brief Particles needed for k occupied bins (Wilson-Hilferty approximation of the chi-square quantile)
+	 */
+	int sample_count(int k) const {
+		if (k < 2) { return min_particles; }
+		double a = 2 / (9.0*(k - 1));
+		double b = 1 - a + sqrt(a)*z;
+		double n = ceil((k - 1) / (2*epsilon) * b*b*b);
+		return int(std::max<double>(min_particles, std::min<double>(max_particles, n)));
+	}
+
+	/**
+	 * \brief Number of grid bins occupied by the particles indices[0..n) of P,
+	 *        column-major dim x M (Eigen and Armadillo default)
+	 */
+	int occupied_bins(const double* P, int dim, const int* indices, int n) {
+		bins.clear();
+		for(int m=0; m < n; ++m) {
+			const double* p = P + indices[m]*dim;
+			uint64_t key = 0;
+			for(int d=0; d < dim; ++d) {
+				int64_t bin = int64_t(floor(p[d] / bin_size));
+				key = (key ^ uint64_t(bin)) * 0x100000001B3ULL; // FNV-1a style mixing
+			}
+			bins.insert(key);
+		}
+		return bins.size();
+	}
+
+	/**
+	 * \brief Systematic resampling of the weighted particles P (dim x M) to an adaptive count.
+	 *        The occupied bins are those of a resample at the current count M, whose
+	 *        positions are then respaced for the new count. indices is resized to it.
+	 */
+	void resample(const double* P, int dim, const double* W, int M, double r, std::vector<int>& indices) {
+		indices.resize(M);
+		resampler.indices(W, M, M, r, &indices[0]);
+		int n = sample_count(occupied_bins(P, dim, &indices[0], M));
+
+		if (n != M) {
+			indices.resize(n);
+			resampler.indices(W, M, n, r, &indices[0]);
+		}
+	}
+
+	LowVarianceResampler resampler;
+
+private:
+	double bin_size;
+	int min_particles, max_particles;
+	double epsilon, z;
+
+	std::unordered_set<uint64_t> bins;
+};
+
+}
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef __SOBOL_H__
+#define __SOBOL_H__
+
+#include <vector>
+#include <cmath>
+#include <stdint.h>
+
+namespace util {
+
+/**
+ * \brief Inverse of the standard normal CDF (Acklam's rational approximation,
+ *        relative error below 1.2e-9), for mapping quasi-random points to Gaussians
+ */
+inline double inverse_normal_cdf(double p) {
+	static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+			1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+	static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+			6.680131188771972e+01, -1.328068155288572e+01};
+	static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+			-2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+	static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+			3.754408661907416e+00};
+	const double p_low = 0.02425;
+
+	if (p < p_low) {
+		double q = sqrt(-2*log(p));
+		return (((((c[0]*q+c[1])*q+c[2])*q+c[3])*q+c[4])*q+c[5]) / ((((d[0]*q+d[1])*q+d[2])*q+d[3])*q+1);
+	} else if (p <= 1 - p_low) {
+		double q = p - 0.5, r = q*q;
+		return (((((a[0]*r+a[1])*r+a[2])*r+a[3])*r+a[4])*r+a[5])*q / (((((b[0]*r+b[1])*r+b[2])*r+b[3])*r+b[4])*r+1);
+	} else {
+		double q = sqrt(-2*log(1-p));
+		return -(((((c[0]*q+c[1])*q+c[2])*q+c[3])*q+c[4])*q+c[5]) / ((((d[0]*q+d[1])*q+d[2])*q+d[3])*q+1);
+	}
+}
+
+/**
+ * Scrambled Sobol sequence in any number of dimensions.
+ *
+ * Dimension 0 is the van der Corput sequence and dimension j > 0 uses the j-th
+ * primitive polynomial over GF(2), in order of degree. The initial direction numbers
+ * are drawn at random (odd, m_k < 2^k) instead of read from a table, which keeps the
+ * (t,s)-sequence property without a size limit. Each seed gives an independent
+ * randomization (Matousek's random linear scramble plus a digital shift), so
+ * replicates give unbiased estimates and an error estimate.
+ *
+ * point() is const and indexes the sequence directly, so threads can share a sampler.
+ */
+class SobolSampler {
+public:
+	SobolSampler(int dim, uint32_t seed) : dim(dim), directions(dim*BITS), shifts(dim) {
+		uint64_t state = seed*0x9E3779B97F4A7C15ULL + 1;
+
+		uint32_t poly = 1; // x + 1, degree 1
+		for(int j=0; j < dim; ++j) {
+			uint32_t* v = &directions[j*BITS];
+			if (j == 0) {
+				for(int k=0; k < BITS; ++k) { v[k] = 1u << (BITS-1-k); }
+			} else {
+				int degree = next_primitive_polynomial(poly);
+
+				std::vector<uint32_t> m(BITS);
+				for(int k=0; k < degree && k < BITS; ++k) {
+					// odd and below 2^(k+1)
+					m[k] = ((next(state) >> 32) & ((1u << (k+1)) - 1)) | 1;
+				}
+				for(int k=degree; k < BITS; ++k) {
+					m[k] = m[k-degree] ^ (m[k-degree] << degree);
+					for(int i=1; i < degree; ++i) {
+						if ((poly >> (degree-i)) & 1) {
+							m[k] ^= m[k-i] << i;
+						}
+					}
+				}
+				for(int k=0; k < BITS; ++k) { v[k] = m[k] << (BITS-1-k); }
+			}
+
+			// random lower triangular scramble, row r holds the digits that feed output digit r
+			uint32_t rows[BITS];
+			for(int r=0; r < BITS; ++r) {
+				uint32_t above = (r == 0) ? 0 : ~0u << (BITS-r);
+				rows[r] = (uint32_t(next(state) >> 32) & above) | (1u << (BITS-1-r));
+			}
+			for(int k=0; k < BITS; ++k) {
+				uint32_t scrambled = 0;
+				for(int r=0; r < BITS; ++r) {
+					scrambled |= uint32_t(__builtin_parity(rows[r] & v[k])) << (BITS-1-r);
+				}
+				v[k] = scrambled;
+			}
+			shifts[j] = uint32_t(next(state) >> 32);
+		}
+	}
+
+	int dimension() const { return dim; }
+
+	/**
+	 * \brief Writes point index of the sequence, in (0,1)^dim, to u
+	 */
+	void point(uint32_t index, double* u) const {
+		uint32_t gray = index ^ (index >> 1);
+		for(int j=0; j < dim; ++j) {
+			const uint32_t* v = &directions[j*BITS];
+			uint32_t x = shifts[j];
+			for(int k=0; gray >> k; ++k) {
+				if ((gray >> k) & 1) { x ^= v[k]; }
+			}
+			u[j] = (x + 0.5) / 4294967296.0;
+		}
+	}
+
+private:
+	static const int BITS = 32;
+
+	int dim;
+	std::vector<uint32_t> directions; // dimension j is [j*BITS, (j+1)*BITS)
+	std::vector<uint32_t> shifts;
+
+	static uint64_t next(uint64_t& state) {
+		// splitmix64
+		uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	static int degree_of(uint64_t p) {
+		int d = -1;
+		while (p) { p >>= 1; ++d; }
+		return d;
+	}
+
+	// a*b mod p over GF(2)
+	static uint64_t mulmod(uint64_t a, uint64_t b, uint64_t p, int degree) {
+		uint64_t result = 0;
+		while (b) {
+			if (b & 1) { result ^= a; }
+			b >>= 1;
+			a <<= 1;
+			if ((a >> degree) & 1) { a ^= p; }
+		}
+		return result;
+	}
+
+	static uint64_t powmod(uint64_t e, uint64_t p, int degree) {
+		uint64_t result = 1, base = 2; // x
+		while (e) {
+			if (e & 1) { result = mulmod(result, base, p, degree); }
+			base = mulmod(base, base, p, degree);
+			e >>= 1;
+		}
+		return result;
+	}
+
+	static bool is_primitive(uint32_t p) {
+		int degree = degree_of(p);
+		if (!(p & 1)) { return false; }
+		uint64_t order = (uint64_t(1) << degree) - 1;
+		if (degree == 1) { return true; }
+		if (powmod(order, p, degree) != 1) { return false; }
+		uint64_t n = order;
+		for(uint64_t q=2; q*q <= n; ++q) {
+			if (n % q == 0) {
+				if (powmod(order/q, p, degree) == 1) { return false; }
+				while (n % q == 0) { n /= q; }
+			}
+		}
+		if ((n > 1) && (powmod(order/n, p, degree) == 1)) { return false; }
+		return true;
+	}
+
+	// advances poly to the next primitive polynomial and returns its degree
+	static int next_primitive_polynomial(uint32_t& poly) {
+		static const uint32_t first = 3; // x + 1
+		if (poly < first) { poly = first; return 1; }
+		do { ++poly; } while (!is_primitive(poly));
+		return degree_of(poly);
+	}
+};
+
+}
+
+#endif
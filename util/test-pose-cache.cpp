@@ -0,0 +1,39 @@
+#include "pose-cache.h"
+
+#include <iostream>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+	util::PoseCache<int> cache(2, 1e-6);
+	double a[12] = {1, 0, 0, .5, 0, 1, 0, .2, 0, 0, 1, 1};
+	double b[12], c[12];
+	std::copy(a, a + 12, b);
+	std::copy(a, a + 12, c);
+	b[3] += 1e-9; // within tolerance of a
+	c[3] += 1e-4; // a finite difference step away
+
+	int failures = 0;
+	if (cache.find(a) != NULL) { std::cout << "empty cache hit\n"; ++failures; }
+	cache.insert(a, 1);
+	if ((cache.find(b) == NULL) || (*cache.find(b) != 1)) { std::cout << "nearby pose missed\n"; ++failures; }
+	if (cache.find(c) != NULL) { std::cout << "pose beyond tolerance hit\n"; ++failures; }
+	if (cache.find(a, 1) != NULL) { std::cout << "other tag hit\n"; ++failures; }
+
+	// a was used last, so c evicts the third entry rather than a
+	cache.insert(c, 2);
+	cache.find(a);
+	cache.insert(a, 3, 1);
+	if ((cache.find(a) == NULL) || (cache.find(c) != NULL) || (cache.size() != 2)) {
+		std::cout << "least recently used entry not evicted\n"; ++failures;
+	}
+
+	if ((cache.hits() != 4) || (cache.misses() != 4)) {
+		std::cout << "counters " << cache.hits() << " hits, " << cache.misses() << " misses\n"; ++failures;
+	}
+
+	cache.set_tolerance(1e-3);
+	if ((cache.size() != 0) || (cache.find(a) != NULL)) { std::cout << "tolerance change kept entries\n"; ++failures; }
+
+	std::cout << (failures ? "FAILED\n" : "passed\n");
+	return failures;
+}
@@ -0,0 +1,79 @@
+#include "resampling.h"
+#include "threadpool.h"
+#include "random.h"
+
+#include <iostream>
+#include <vector>
+
+// serial systematic resampling on the normalized double cumulative sum
+void serial_indices(const std::vector<double>& W, int n, double r, std::vector<int>& indices) {
+	int M = W.size();
+	double total = 0;
+	for(int i=0; i < M; ++i) { total += W[i]; }
+
+	indices.resize(n);
+	double c = W[0] / total;
+	int i = 0;
+	for(int m=0; m < n; ++m) {
+		double u = (r + m) / n;
+		while ((u > c) && (i < M-1)) {
+			c += W[++i] / total;
+		}
+		indices[m] = i;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	const int dim = 3;
+	int sizes[] = {1, 7, 1000, 4096, 4097, 100000};
+	util::Random random(0);
+	util::ThreadPool pool(4);
+
+	int failures = 0;
+	for(int s=0; s < sizeof(sizes)/sizeof(sizes[0]); ++s) {
+		int M = sizes[s];
+		std::vector<double> W(M), P(dim*M);
+		random.uniform(&W[0], M);
+		random.uniform(&P[0], dim*M);
+		// a few zero and dominant weights
+		for(int i=0; (M > 1) && (i < M); i += 97) { W[i] = 0; }
+		if (M > 10) { W[M/3] = M / 10.0; }
+		int n = (M > 1) ? M/2 + 1 : 1;
+		double r = random.uniform();
+
+		std::vector<int> expected, serial(n), parallel(n);
+		serial_indices(W, n, r, expected);
+
+		util::LowVarianceResampler serial_resampler, parallel_resampler(&pool);
+		serial_resampler.indices(&W[0], M, n, r, &serial[0]);
+		parallel_resampler.indices(&W[0], M, n, r, &parallel[0]);
+
+		int mismatches = 0, zero_selected = 0;
+		for(int m=0; m < n; ++m) {
+			mismatches += (serial[m] != expected[m]) + (parallel[m] != serial[m]);
+			zero_selected += (W[serial[m]] == 0);
+		}
+
+		// gathered columns with jitter must match between thread counts
+		std::vector<double> out_serial(dim*n), out_parallel(dim*n);
+		serial_resampler.gather(&P[0], dim, &serial[0], n, &out_serial[0], .01, 42);
+		parallel_resampler.resample(&P[0], dim, &W[0], M, n, r, &out_parallel[0], .01, 42);
+
+		int gather_errors = 0;
+		for(int m=0; m < n; ++m) {
+			for(int d=0; d < dim; ++d) {
+				double x = out_serial[m*dim+d];
+				gather_errors += (x != out_parallel[m*dim+d]) + (std::abs(x - P[serial[m]*dim+d]) > .01);
+			}
+		}
+
+		bool ok = (mismatches == 0) && (zero_selected == 0) && (gather_errors == 0);
+		failures += !ok;
+		std::cout << "M = " << M << ", n = " << n << ": index mismatches " << mismatches
+				<< ", zero weights selected " << zero_selected << ", gather errors " << gather_errors
+				<< (ok ? "  ok" : "  FAILED") << "\n";
+	}
+
+	std::cout << (failures == 0 ? "all passed" : "FAILED") << "\n";
+	return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,195 @@
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#include <vector>
+#include <algorithm>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+namespace util {
+
+/**
+ * Fixed-size pool of worker threads that run queued tasks in FIFO order.
+ * Tasks are submitted with enqueue(), which returns a std::future for the result.
+ */
+class ThreadPool {
+public:
+	explicit ThreadPool(int num_threads=0) : stop(false) {
+		if (num_threads <= 0) {
+			num_threads = std::max(1, int(std::thread::hardware_concurrency()));
+		}
+
+		for(int i=0; i < num_threads; ++i) {
+			workers.push_back(std::thread([this] { this->worker_loop(); }));
+		}
+	}
+
+	~ThreadPool() {
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex);
+			stop = true;
+		}
+		condition.notify_all();
+		for(int i=0; i < workers.size(); ++i) {
+			workers[i].join();
+		}
+	}
+
+	int size() const { return workers.size(); }
+
+	template<typename F>
+	std::future<typename std::result_of<F()>::type> enqueue(F f) {
+		typedef typename std::result_of<F()>::type result_type;
+
+		auto task = std::make_shared<std::packaged_task<result_type()> >(f);
+		std::future<result_type> result = task->get_future();
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex);
+			tasks.push([task] { (*task)(); });
+		}
+		condition.notify_one();
+		return result;
+	}
+
+	/**
+	 * \brief Calls f(i) for i in [begin, end), split into contiguous chunks
+	 *        across the pool, and blocks until every chunk is done
+	 */
+	template<typename F>
+	void parallel_for(int begin, int end, F f) {
+		int n = end - begin;
+		if (n <= 0) { return; }
+
+		int num_chunks = std::min(n, size());
+		int chunk_size = (n + num_chunks - 1) / num_chunks;
+
+		std::vector<std::future<void> > done;
+		for(int c=0; c < num_chunks; ++c) {
+			int chunk_begin = begin + c*chunk_size;
+			int chunk_end = std::min(end, chunk_begin + chunk_size);
+			done.push_back(enqueue([chunk_begin, chunk_end, &f] {
+				for(int i=chunk_begin; i < chunk_end; ++i) { f(i); }
+			}));
+		}
+		for(int c=0; c < done.size(); ++c) { done[c].get(); }
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()> > tasks;
+
+	std::mutex queue_mutex;
+	std::condition_variable condition;
+	bool stop;
+
+	void worker_loop() {
+		while(true) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(queue_mutex);
+				condition.wait(lock, [this] { return this->stop || !this->tasks.empty(); });
+				if (stop && tasks.empty()) {
+					return;
+				}
+				task = std::move(tasks.front());
+				tasks.pop();
+			}
+			task();
+		}
+	}
+};
+
+/**
+ * Fixed team of threads for a fork-join loop that is run over and over, such as one
+ * line search per solver iteration. Unlike ThreadPool::parallel_for, run() allocates
+ * no futures or task closures: the calling thread and the size()-1 workers each call
+ * f(i) for their own index i, and run() returns once all of them are done.
+ */
+class ForkJoin {
+public:
+	explicit ForkJoin(int num_threads) : generation(0), remaining(0), stop(false), task(NULL), context(NULL) {
+		for(int i=1; i < num_threads; ++i) {
+			workers.push_back(std::thread([this, i] { this->worker_loop(i); }));
+		}
+	}
+
+	~ForkJoin() {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			stop = true;
+		}
+		start.notify_all();
+		for(int i=0; i < workers.size(); ++i) {
+			workers[i].join();
+		}
+	}
+
+	int size() const { return workers.size() + 1; }
+
+	template<typename F>
+	void run(F& f) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			task = &invoke<F>;
+			context = &f;
+			remaining = workers.size();
+			++generation;
+		}
+		start.notify_all();
+
+		f(0);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this] { return this->remaining == 0; });
+	}
+
+private:
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable start, done;
+	size_t generation;
+	int remaining;
+	bool stop;
+
+	void (*task)(void*, int);
+	void* context;
+
+	template<typename F>
+	static void invoke(void* f, int i) { (*static_cast<F*>(f))(i); }
+
+	void worker_loop(int i) {
+		size_t seen = 0;
+		while(true) {
+			void (*t)(void*, int);
+			void* c;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				start.wait(lock, [this, seen] { return this->stop || this->generation != seen; });
+				if (stop) {
+					return;
+				}
+				seen = generation;
+				t = task;
+				c = context;
+			}
+			t(c, i);
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				if (--remaining == 0) {
+					done.notify_one();
+				}
+			}
+		}
+	}
+};
+
+}
+
+#endif
@@ -3,6 +3,8 @@
 
 #include <vector>
 
+#include "random.h"
+
 #define M_SQRT_PI_2 sqrt(M_PI/2.0)
 #define M_1_SQRT2PI 1.0/sqrt(M_PI*2.0)
 #define M_SQRT_2_PI sqrt(2.0/M_PI)
@@ -416,7 +418,7 @@ inline double cdf(double x) {
  *  \ingroup globalfunc
  */
 inline double random_highprecision() {
-  return ((rand() << 15) + rand()) / 1073741823.0;
+  return util::thread_random().uniform();
 }
 
 /*!
@@ -425,17 +427,9 @@ inline double random_highprecision() {
  *  \ingroup globalfunc
  */
 inline std::pair<double, double> normal() {
-  double u, v, s;
-
-  do {
-    u = 2.0*random_highprecision()-1.0;
-    v = 2.0*random_highprecision()-1.0;
-    s = u*u + v*v;
-  } while (s > 1.0 || s == 0.0);
-
-  double r = sqrt(-2.0*log(s)/s);
-
-  return std::make_pair(u*r, v*r);
+  double n[2];
+  util::thread_random().normal(n, 2);
+  return std::make_pair(n[0], n[1]);
 }
 
 
@@ -448,14 +442,7 @@ inline std::pair<double, double> normal() {
 template <size_t dim>
 inline Matrix<dim> sampleGaussian() {
   Matrix<dim> sample;
-  for (size_t j = 0; j < dim / 2; ++j) {
-	std::pair<double,double> n = normal();
-    sample[j*2] = n.first;
-	sample[j*2+1] = n.second;
-  }
-  if (dim % 2 == 1) {
-    sample[dim - 1] = normal().first;
-  }
+  util::thread_random().normal(sample.getPtr(), dim);
   return sample;
 }
 
@@ -488,9 +475,17 @@ inline Matrix<dim> sampleGaussian(const Matrix<dim>& mean, const SymmetricMatrix
  */
 template <size_t dim>
 inline std::vector<Matrix<dim> > sampleGaussianN(const Matrix<dim>& mean, const SymmetricMatrix<dim>& var, int N) {
+  Matrix<dim,dim> L;
+  chol(var, L);
+
+  // one batch of standard normals for all N samples
+  std::vector<double> z(N*dim);
+  util::thread_random().normal(&z[0], N*dim);
+
   std::vector<Matrix<dim> > samples(N);
   for(int n=0; n < N; ++n) {
-	  samples[n] = sampleGaussian(mean, var);
+	  std::copy(z.begin() + n*dim, z.begin() + (n+1)*dim, samples[n].getPtr());
+	  samples[n] = L * samples[n] + mean;
   }
   return samples;
 }